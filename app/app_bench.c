@@ -0,0 +1,197 @@
+/**
+ * @file app_bench.c
+ * @brief Execution time probes.
+ */
+
+#include "app_bench.h"
+
+#define BENCH_CALIBRATION_ROUNDS 16u /* Empty samples taken to measure the overhead */
+
+static uint8_t Bench_BitLength(uint32_t value);
+static uint8_t *Bench_Put32(uint8_t *buffer, uint32_t value);
+
+/**
+ * @brief Initialize the probes without samples and measure the probe overhead.
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param counter Function reading the free running counter.
+ * @param frequency Counter ticks per second, only reported.
+ */
+void Bench_Init(Bench_HandleTypeDef *hbench, Bench_CounterFunction counter, uint32_t frequency)
+{
+    hbench->Counter = counter;
+    hbench->Frequency = frequency;
+    hbench->Overhead = 0;
+
+    for (uint8_t i = 0; i < BENCH_MAX_PROBES; i++)
+    {
+        (void)Bench_Reset(hbench, i);
+    }
+
+    /* The shortest empty sample is the cost of the probe itself, interrupts can only make them longer */
+    for (uint8_t i = 0; i < BENCH_CALIBRATION_ROUNDS; i++)
+    {
+        Bench_Begin(hbench, 0);
+        Bench_End(hbench, 0);
+    }
+
+    hbench->Overhead = hbench->Probes[0].Min;
+    (void)Bench_Reset(hbench, 0);
+}
+
+/**
+ * @brief Start a sample.
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param probe Probe number, ignored if out of range.
+ */
+void Bench_Begin(Bench_HandleTypeDef *hbench, uint8_t probe)
+{
+    if (probe < BENCH_MAX_PROBES)
+    {
+        hbench->Probes[probe].Start = hbench->Counter();
+    }
+}
+
+/**
+ * @brief End the sample started by Bench_Begin and add it to the statistics.
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param probe Probe number, ignored if out of range.
+ */
+void Bench_End(Bench_HandleTypeDef *hbench, uint8_t probe)
+{
+    uint32_t end = hbench->Counter();
+    Bench_ProbeTypeDef *p;
+    uint32_t sample;
+
+    if (probe < BENCH_MAX_PROBES)
+    {
+        p = &hbench->Probes[probe];
+
+        /* Unsigned difference, right across a counter wrap around */
+        sample = end - p->Start;
+        sample = (sample > hbench->Overhead) ? (sample - hbench->Overhead) : 0u;
+
+        p->Count++;
+        p->Sum += sample;
+        p->Min = (sample < p->Min) ? sample : p->Min;
+        p->Max = (sample > p->Max) ? sample : p->Max;
+        p->Histogram[Bench_BitLength(sample)]++;
+    }
+}
+
+/**
+ * @brief Clear the samples of a probe.
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param probe Probe number.
+ * @return BENCH_OK if cleared, BENCH_ERROR if the probe is out of range.
+ */
+uint8_t Bench_Reset(Bench_HandleTypeDef *hbench, uint8_t probe)
+{
+    uint8_t status = BENCH_ERROR;
+    Bench_ProbeTypeDef *p;
+
+    if (probe < BENCH_MAX_PROBES)
+    {
+        p = &hbench->Probes[probe];
+        p->Start = 0;
+        p->Count = 0;
+        p->Min = UINT32_MAX;
+        p->Max = 0;
+        p->Sum = 0;
+
+        for (uint8_t i = 0; i < BENCH_HISTOGRAM_BINS; i++)
+        {
+            p->Histogram[i] = 0;
+        }
+
+        status = BENCH_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Get the mean of the samples of a probe.
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param probe Probe number.
+ * @return Mean in counter ticks, 0 without samples or if the probe is out of range.
+ */
+uint32_t Bench_Mean(const Bench_HandleTypeDef *hbench, uint8_t probe)
+{
+    uint32_t mean = 0;
+
+    if ((probe < BENCH_MAX_PROBES) && (hbench->Probes[probe].Count > 0u))
+    {
+        mean = (uint32_t)(hbench->Probes[probe].Sum / hbench->Probes[probe].Count);
+    }
+
+    return mean;
+}
+
+/**
+ * @brief Write the statistics of a probe in a record for the bus.
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param probe Probe number.
+ * @param buffer Destination of BENCH_RECORD_SIZE bytes.
+ * @return Bytes written, 0 if the probe is out of range.
+ */
+uint8_t Bench_Serialize(const Bench_HandleTypeDef *hbench, uint8_t probe, uint8_t *buffer)
+{
+    const Bench_ProbeTypeDef *p;
+    uint8_t *next = buffer;
+    uint32_t bin;
+
+    if (probe < BENCH_MAX_PROBES)
+    {
+        p = &hbench->Probes[probe];
+
+        *next++ = probe;
+        next = Bench_Put32(next, hbench->Frequency);
+        next = Bench_Put32(next, p->Count);
+        next = Bench_Put32(next, (p->Count > 0u) ? p->Min : 0u);
+        next = Bench_Put32(next, p->Max);
+        next = Bench_Put32(next, Bench_Mean(hbench, probe));
+
+        for (uint8_t i = 0; i < BENCH_HISTOGRAM_BINS; i++)
+        {
+            bin = (p->Histogram[i] > 0xFFFFu) ? 0xFFFFu : p->Histogram[i];
+            *next++ = (uint8_t)(bin >> 8);
+            *next++ = (uint8_t)bin;
+        }
+    }
+
+    return (uint8_t)(next - buffer);
+}
+
+/**
+ * @brief Histogram bin of a sample: number of significant bits, the last bin for longer ones
+ * @param value Sample
+ * @return Bin index
+ */
+static uint8_t Bench_BitLength(uint32_t value)
+{
+    uint8_t bits = 0;
+
+    while ((value != 0u) && (bits < (BENCH_HISTOGRAM_BINS - 1u)))
+    {
+        value >>= 1;
+        bits++;
+    }
+
+    return bits;
+}
+
+/**
+ * @brief Write a 32 bit value big endian
+ * @param buffer Destination
+ * @param value Value to write
+ * @return Position after the value
+ */
+static uint8_t *Bench_Put32(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value >> 24);
+    buffer[1] = (uint8_t)(value >> 16);
+    buffer[2] = (uint8_t)(value >> 8);
+    buffer[3] = (uint8_t)value;
+
+    return &buffer[4];
+}
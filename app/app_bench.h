@@ -0,0 +1,154 @@
+#ifndef __APP_BENCH_H__
+#define __APP_BENCH_H__
+
+#include <stdint.h>
+
+/**
+ * @file app_bench.h
+ * @brief Execution time probes.
+ *
+ * A probe measures the code between a begin and an end with a free running
+ * counter: the minimum, maximum and mean of the samples are kept together
+ * with a histogram of their orders of magnitude (bin n counts the samples
+ * needing n bits, the last bin everything longer). The cost of a begin/end
+ * pair is measured once by Bench_Init and taken out of every sample. The
+ * counter is given by the user, on the target a 32 bit timer running at the
+ * CPU clock (the Cortex-M0+ has no DWT cycle counter), on the host the
+ * monotonic clock in nanoseconds, so the same probes run on both. Samples
+ * must be shorter than a counter period, an interrupt taken in between is
+ * counted in the sample. Each probe must only be used from one context.
+ *
+ * The BENCH_BEGIN and BENCH_END macros compile to nothing unless
+ * BENCH_ENABLED is set, so probes can stay in the code.
+ */
+
+/**
+ * @brief Compile the probes placed with BENCH_BEGIN and BENCH_END.
+ */
+#ifndef BENCH_ENABLED
+#define BENCH_ENABLED 0u
+#endif
+
+/**
+ * @brief Maximum number of probes.
+ */
+#ifndef BENCH_MAX_PROBES
+#define BENCH_MAX_PROBES 8u
+#endif
+
+#define BENCH_HISTOGRAM_BINS 16u    /**< Bins of 1, 2, 4, ... counts, the last one open */
+
+/**
+ * @brief Size of a probe record written by Bench_Serialize.
+ */
+#define BENCH_RECORD_SIZE (1u + (5u * 4u) + (BENCH_HISTOGRAM_BINS * 2u))
+
+#define BENCH_OK      0x00U
+#define BENCH_ERROR   0x01U
+
+/**
+ * @brief Free running counter read function.
+ */
+typedef uint32_t (*Bench_CounterFunction)(void);
+
+/**
+ * @brief Statistics of one probe, in counter ticks.
+ */
+typedef struct
+{
+    uint32_t Start;                         /**< Counter value at the last begin */
+    uint32_t Count;                         /**< Number of samples */
+    uint32_t Min;                           /**< Shortest sample */
+    uint32_t Max;                           /**< Longest sample */
+    uint64_t Sum;                           /**< Sum of the samples, for the mean */
+    uint32_t Histogram[BENCH_HISTOGRAM_BINS];   /**< Samples per number of significant bits */
+} Bench_ProbeTypeDef;
+
+/**
+ * @brief Benchmark handler structure.
+ */
+typedef struct
+{
+    Bench_CounterFunction Counter;  /**< Time base */
+    uint32_t Frequency;             /**< Counter ticks per second */
+    uint32_t Overhead;              /**< Ticks of an empty begin/end pair, taken out of the samples */
+    Bench_ProbeTypeDef Probes[BENCH_MAX_PROBES];    /**< Probe statistics */
+} Bench_HandleTypeDef;
+
+#if (BENCH_ENABLED != 0u)
+#define BENCH_BEGIN(hbench, probe)  Bench_Begin((hbench), (probe))
+#define BENCH_END(hbench, probe)    Bench_End((hbench), (probe))
+#else
+#define BENCH_BEGIN(hbench, probe)  ((void)0)
+#define BENCH_END(hbench, probe)    ((void)0)
+#endif
+
+/**
+ * @brief Initialize the probes without samples and measure the probe overhead.
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param counter Function reading the free running counter.
+ * @param frequency Counter ticks per second, only reported.
+ */
+void Bench_Init(Bench_HandleTypeDef *hbench, Bench_CounterFunction counter, uint32_t frequency);
+
+/**
+ * @brief Start a sample.
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param probe Probe number, ignored if out of range.
+ */
+void Bench_Begin(Bench_HandleTypeDef *hbench, uint8_t probe);
+
+/**
+ * @brief End the sample started by Bench_Begin and add it to the statistics.
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param probe Probe number, ignored if out of range.
+ */
+void Bench_End(Bench_HandleTypeDef *hbench, uint8_t probe);
+
+/**
+ * @brief Clear the samples of a probe.
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param probe Probe number.
+ * @return BENCH_OK if cleared, BENCH_ERROR if the probe is out of range.
+ */
+uint8_t Bench_Reset(Bench_HandleTypeDef *hbench, uint8_t probe);
+
+/**
+ * @brief Get the mean of the samples of a probe.
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param probe Probe number.
+ * @return Mean in counter ticks, 0 without samples or if the probe is out of range.
+ */
+uint32_t Bench_Mean(const Bench_HandleTypeDef *hbench, uint8_t probe);
+
+/**
+ * @brief Write the statistics of a probe in a record for the bus.
+ *
+ * All fields are big endian: probe number (1 byte), counter frequency, sample
+ * count, minimum, maximum and mean (4 bytes each), then the histogram bins
+ * (2 bytes each, saturated). Without samples the minimum is 0.
+ *
+ * @param hbench Pointer to the benchmark handle structure.
+ * @param probe Probe number.
+ * @param buffer Destination of BENCH_RECORD_SIZE bytes.
+ * @return Bytes written, 0 if the probe is out of range.
+ */
+uint8_t Bench_Serialize(const Bench_HandleTypeDef *hbench, uint8_t probe, uint8_t *buffer);
+
+/**
+ * @brief Start the free running counter of the board.
+ *
+ * Provided by the board support (a 32 bit timer on the target, the monotonic
+ * clock on the host), not by this module.
+ *
+ * @return Counter ticks per second.
+ */
+uint32_t Bench_CounterStart(void);
+
+/**
+ * @brief Read the free running counter of the board.
+ * @return Counter value, wrapping around at 32 bits.
+ */
+uint32_t Bench_CounterRead(void);
+
+#endif // __APP_BENCH_H__
@@ -0,0 +1,113 @@
+/**
+ * @file app_bittiming.c
+ * @brief CAN bit timing calculator.
+ */
+
+#include "app_bittiming.h"
+#include <stddef.h>
+
+/* Shortest bit accepted: sync segment + 2 quanta before and 1 after the sample point */
+#define BITTIMING_MIN_QUANTA 4u
+
+/**
+ * @brief Register limits of one bit timing phase.
+ */
+typedef struct
+{
+    uint32_t MaxPrescaler;
+    uint32_t MaxTimeSeg1;
+    uint32_t MaxTimeSeg2;
+    uint32_t MaxSyncJumpWidth;
+} BitTiming_LimitsTypeDef;
+
+/* FDCAN NBTP and DBTP field ranges, indexed by BitTiming_PhaseTypeDef */
+static const BitTiming_LimitsTypeDef BitTimingLimits[2] =
+{
+    {512u, 256u, 128u, 128u},   /* Nominal phase */
+    {32u, 32u, 16u, 16u}        /* Data phase */
+};
+
+/**
+ * @brief Compute the bit timing for a bit rate and sample point.
+ * @param clock FDCAN kernel clock in Hz.
+ * @param bitrate Bit rate in bits per second.
+ * @param samplePoint Sample point in tenths of percent (1 to 999).
+ * @param phase BITTIMING_NOMINAL or BITTIMING_DATA.
+ * @param timing Pointer where the solution is written.
+ * @return BITTIMING_OK if a solution exists, BITTIMING_ERROR otherwise.
+ */
+uint8_t BitTiming_Calculate(uint32_t clock, uint32_t bitrate, uint16_t samplePoint,
+                            BitTiming_PhaseTypeDef phase, APP_BitTimingTypeDef *timing)
+{
+    const BitTiming_LimitsTypeDef *limits = &BitTimingLimits[BITTIMING_NOMINAL];
+    uint32_t maxPrescaler = 0; /* No search unless the parameters are valid */
+    uint8_t status = BITTIMING_ERROR;
+    uint32_t bestError = UINT32_MAX;
+    uint32_t quanta;
+    uint32_t seg1;
+    uint32_t seg2;
+    uint32_t reached;
+    uint32_t error;
+
+    if ((timing != NULL) && (bitrate != 0u) && (samplePoint != 0u) && (samplePoint < 1000u) &&
+        ((phase == BITTIMING_NOMINAL) || (phase == BITTIMING_DATA)))
+    {
+        limits = &BitTimingLimits[phase];
+        maxPrescaler = limits->MaxPrescaler;
+    }
+
+    for (uint32_t prescaler = 1; (prescaler <= maxPrescaler) && ((clock / prescaler) >= bitrate); prescaler++)
+    {
+        /* Only prescalers giving the exact bit rate */
+        if (((clock % prescaler) != 0u) || (((clock / prescaler) % bitrate) != 0u))
+        {
+            continue;
+        }
+
+        quanta = (clock / prescaler) / bitrate;
+
+        if ((quanta < BITTIMING_MIN_QUANTA) || (quanta > (1u + limits->MaxTimeSeg1 + limits->MaxTimeSeg2)))
+        {
+            continue;
+        }
+
+        /* The sample point sits at the end of seg1, after the one quantum sync segment */
+        seg1 = (((quanta * samplePoint) + 500u) / 1000u) - 1u;
+
+        if (seg1 > limits->MaxTimeSeg1)
+        {
+            seg1 = limits->MaxTimeSeg1;
+        }
+        if (seg1 > (quanta - 2u))
+        {
+            seg1 = quanta - 2u; /* Leave at least one quantum for seg2 */
+        }
+        if ((quanta - 1u - seg1) > limits->MaxTimeSeg2)
+        {
+            seg1 = quanta - 1u - limits->MaxTimeSeg2;
+        }
+        if (seg1 < 1u)
+        {
+            seg1 = 1u;
+        }
+        seg2 = quanta - 1u - seg1;
+
+        /* Distance to the requested sample point in thousandths of tenths of percent */
+        reached = ((1u + seg1) * 1000000u) / quanta;
+        error = (reached > (samplePoint * 1000u)) ? (reached - (samplePoint * 1000u)) : ((samplePoint * 1000u) - reached);
+
+        /* Strictly better only, so ties keep the smallest prescaler */
+        if (error < bestError)
+        {
+            bestError = error;
+            timing->Prescaler = prescaler;
+            timing->TimeSeg1 = seg1;
+            timing->TimeSeg2 = seg2;
+            timing->SyncJumpWidth = (seg2 < limits->MaxSyncJumpWidth) ? seg2 : limits->MaxSyncJumpWidth;
+            timing->SamplePoint = (uint16_t)(reached / 1000u);
+            status = BITTIMING_OK;
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,58 @@
+#ifndef __APP_BITTIMING_H__
+#define __APP_BITTIMING_H__
+
+#include <stdint.h>
+
+/**
+ * @file app_bittiming.h
+ * @brief CAN bit timing calculator.
+ *
+ * Finds the prescaler, time segments and synchronization jump width that give
+ * a bit rate from the FDCAN kernel clock with the sample point closest to the
+ * one requested. The results are copied by the caller into the FDCAN init
+ * structure.
+ */
+
+#define BITTIMING_OK      0x00U
+#define BITTIMING_ERROR   0x01U
+
+/**
+ * @brief Phase of the CAN frame the timing is computed for, each one has its own register limits.
+ */
+typedef enum
+{
+    BITTIMING_NOMINAL = 0,  /**< Arbitration phase (and whole classic frame) */
+    BITTIMING_DATA          /**< Data phase of CAN FD frames with bit rate switching */
+} BitTiming_PhaseTypeDef;
+
+/**
+ * @brief Bit timing parameters, in the same units as the FDCAN init structure.
+ */
+typedef struct
+{
+    uint32_t Prescaler;       /**< Kernel clock divider, one time quantum is Prescaler clock cycles */
+    uint32_t TimeSeg1;        /**< Propagation + phase segment 1 in time quanta */
+    uint32_t TimeSeg2;        /**< Phase segment 2 in time quanta */
+    uint32_t SyncJumpWidth;   /**< Synchronization jump width in time quanta */
+    uint16_t SamplePoint;     /**< Resulting sample point in tenths of percent (750 = 75.0%) */
+} APP_BitTimingTypeDef;
+
+/**
+ * @brief Compute the bit timing for a bit rate and sample point.
+ *
+ * Only exact bit rates are accepted. Among the prescalers giving the exact bit
+ * rate, the one with the sample point closest to the requested one wins and
+ * ties go to the smallest prescaler (more time quanta per bit, as recommended
+ * by CiA 601-3). SJW is made as big as phase segment 2 allows.
+ *
+ * @param clock FDCAN kernel clock in Hz.
+ * @param bitrate Bit rate in bits per second.
+ * @param samplePoint Sample point in tenths of percent (1 to 999).
+ * @param phase BITTIMING_NOMINAL or BITTIMING_DATA.
+ * @param timing Pointer where the solution is written.
+ * @return BITTIMING_OK if a solution exists, BITTIMING_ERROR otherwise.
+ */
+uint8_t BitTiming_Calculate(uint32_t clock, uint32_t bitrate, uint16_t samplePoint,
+                            BitTiming_PhaseTypeDef phase, APP_BitTimingTypeDef *timing);
+
+#endif // __APP_BITTIMING_H__
@@ -15,12 +15,7 @@
 typedef enum
 {
     IDLE_STATE,      /**< Idle state */
-    MESSAGE_STATE,   /**< Message state */
-    TIME_STATE,      /**< Time state */
-    DATE_STATE,      /**< Date state */
-    ALARM_STATE,     /**< Alarm state */
-    OK_STATE,        /**< OK state */
-    ERROR_STATE      /**< Error state */
+    RESPONSE_STATE   /**< Response waiting for the transport layer */
 } States;
 
 /**
@@ -31,43 +26,83 @@ typedef enum
     SERIAL_MSG_NONE = 0, /**< No message */
     SERIAL_MSG_TIME,     /**< Time message */
     SERIAL_MSG_DATE,     /**< Date message */
-    SERIAL_MSG_ALARM     /**< Alarm message */
+    SERIAL_MSG_ALARM,    /**< Alarm message */
+    SERIAL_MSG_BENCH,    /**< Benchmark probe dump request, only with BENCH_ENABLED */
+    SERIAL_MSG_ALARM_EVENT /**< Alarm went off, posted by the clock for its broadcast, time of the event */
 } APP_Messages;
 
 /**
- * @brief Structure defining the time in a standardized format (Part I: State Machines)
+ * @brief Compile time check, a false condition declares an array of negative size (C99 has no _Static_assert)
  */
-typedef struct _APP_TmTypeDef
+#define APP_STATIC_ASSERT(condition, name) typedef char app_static_assert_##name[(condition) ? 1 : -1]
+
+/**
+ * @brief Time carried by a time message (Part I: State Machines)
+ */
+typedef struct _APP_TimeTypeDef
+{
+    uint8_t hour;       /**< Hours, range 0 to 23 */
+    uint8_t min;        /**< Minutes, range 0 to 59 */
+    uint8_t sec;        /**< Seconds, range 0 to 59 */
+} APP_TimeTypeDef;
+
+/**
+ * @brief Date carried by a date message (Part I: State Machines)
+ */
+typedef struct _APP_DateTypeDef
 {
-    uint32_t tm_sec;    /**< Seconds, range 0 to 59 */
-    uint32_t tm_min;    /**< Minutes, range 0 to 59 */
-    uint32_t tm_hour;   /**< Hours, range 0 to 23 */
-    uint32_t tm_mday;   /**< Day of the month, range 1 to 31 */
-    uint32_t tm_mon;    /**< Month, range 0 to 11 */
-    uint32_t tm_year;   /**< Years in range 1900 to 2100 */
-    uint32_t tm_wday;   /**< Day of the week, range 0 to 6 */
-    uint32_t tm_yday;   /**< Day in the year, range 0 to 365 */
-    uint32_t tm_isdst;  /**< Daylight saving time */
-} APP_TmTypeDef;
+    uint16_t year;      /**< Year, range 1901 to 2099 */
+    uint8_t mday;       /**< Day of the month, range 1 to 31 */
+    uint8_t mon;        /**< Month, range 1 to 12 */
+    uint8_t wday;       /**< Day of the week as the RTC counts it, 1 (Monday) to 7 (Sunday) */
+} APP_DateTypeDef;
+
+/**
+ * @brief Alarm carried by an alarm message (Part I: State Machines)
+ */
+typedef struct _APP_AlarmTypeDef
+{
+    uint8_t hour;       /**< Hours, range 0 to 23 */
+    uint8_t min;        /**< Minutes, range 0 to 59 */
+} APP_AlarmTypeDef;
+
+/**
+ * @brief Values read back from the RTC for the display (Part I: State Machines)
+ */
+typedef struct _APP_ClockTypeDef
+{
+    APP_DateTypeDef date;   /**< Current date */
+    APP_TimeTypeDef time;   /**< Current time */
+} APP_ClockTypeDef;
 
 /**
  * @brief Structure defining the application message (Part I: State Machines)
+ *
+ * The message type selects the member of data, the largest member is aligned
+ * to two bytes and the type fills its padding, so a message is copied as a
+ * whole with a single assignment of 16 bytes.
  */
 typedef struct _APP_MsgTypeDef
 {
-    uint8_t msg;           /**< Store the message type to send */
-    APP_TmTypeDef tm;      /**< Time and date in stdlib tm format */
+    uint32_t rxTime;            /**< Start of the request frame, microseconds of Serial_TimestampRead */
+    union
+    {
+        APP_TimeTypeDef time;   /**< SERIAL_MSG_TIME and SERIAL_MSG_ALARM_EVENT */
+        APP_DateTypeDef date;   /**< SERIAL_MSG_DATE */
+        APP_AlarmTypeDef alarm; /**< SERIAL_MSG_ALARM */
+        APP_ClockTypeDef clock; /**< Clock values for the display */
+    } data;                     /**< Values of the message */
+    uint8_t msg;                /**< Store the message type to send */
 } APP_MsgTypeDef;
 
+APP_STATIC_ASSERT(sizeof(APP_ClockTypeDef) <= 10u, clock_size);
+APP_STATIC_ASSERT(sizeof(APP_MsgTypeDef) == 16u, message_size);
+
 /**
  * @brief Enum for the state machine related to the RTC (Part II: Clock)
  */
 typedef enum {
-    CLOCK_IDLE_STATE,           /**< Idle state for clock */
-    CLOCK_VALID_DATA_STATE,     /**< Valid data state for clock */
-    CLOCK_UPDATE_TIME_STATE,    /**< Update time state for clock */
-    CLOCK_UPDATE_DATE_STATE,    /**< Update date state for clock */
-    CLOCK_UPDATE_ALARM_STATE,   /**< Update alarm state for clock */
+    CLOCK_IDLE_STATE,           /**< Idle state for clock, applies the messages */
     CLOCK_DISPLAY_DATA_STATE    /**< Display data state for clock */
 } Clock_States;
 
@@ -108,9 +143,32 @@ typedef struct {
 typedef enum
 {
     CAN_IDLE_STATE,
-    CAN_SEND_TIME_STATE,
-    CAN_SEND_DATE_STATE,
-    CAN_SEND_ALARM_STATE
+    CAN_SEND_STATE
 } CAN_StateTypeDef;
 
+/**
+ * @brief Scheduler events, set from the interrupts or by the task feeding the next one (Scheduler)
+ */
+typedef enum
+{
+    APP_EVENT_SERIAL = 0,   /**< CAN frames received or command being processed */
+    APP_EVENT_CLOCK,        /**< Validated message for the clock task */
+    APP_EVENT_CAN,          /**< Broadcast pending for the CAN task */
+    APP_EVENT_DISPLAY       /**< New clock values for the display */
+} APP_Events;
+
+/**
+ * @brief Execution time probes of the hot paths, see app_bench.h (Benchmark)
+ */
+typedef enum
+{
+    APP_PROBE_SERIAL_TASK = 0,  /**< One run of Serial_Task */
+    APP_PROBE_CLOCK_TASK,       /**< One run of Clock_Task */
+    APP_PROBE_CAN_TASK,         /**< One run of CAN_Task */
+    APP_PROBE_FDCAN_ISR,        /**< FIFO 0 reception callback */
+    APP_PROBE_WEEKDAY,          /**< Day of the week calculation */
+    APP_PROBE_LCD_STRING,       /**< Text written to the LCD driver */
+    APP_PROBES                  /**< Number of probes */
+} APP_Probes;
+
 #endif /* __APP_BSP_H__ */
@@ -7,25 +7,52 @@
 #include "app_serial.h"
 #include "app_clock.h"
 #include "app_can.h"
+#include "app_sched.h"
+#include "app_bench.h"
+#include "app_queue.h"
 #include <stdio.h>
 
 #define CAN_TIME_MESSAGE_ID 0x130
 #define CAN_DATE_MESSAGE_ID 0x131
 #define CAN_ALARM_MESSAGE_ID 0x132
+#define CAN_ALARM_EVENT_ID 0x133
 
 /* External Variables, Definitions, and Prototypes */
-extern FDCAN_HandleTypeDef CANHandler;  /* Structure type variable for CAN initialization */
-extern FDCAN_TxHeaderTypeDef CANTxHeader; /* CAN Tx header structure */
-extern FDCAN_FilterTypeDef CANFilter;     /* CAN filter structure */
+extern Queue_HandleTypeDef CANQueue; /* Messages applied by the clock task, to broadcast */
 
-extern APP_MsgTypeDef CANMsg; /* Application message structure for CAN application */
+extern Sched_HandleTypeDef Scheduler; /* Scheduler running the tasks */
+
+extern Bench_HandleTypeDef Bench; /* Execution time probes */
+
+/* Broadcast of a message type: identifier and payload encoder */
+typedef struct
+{
+    uint32_t Identifier;                                    /* Broadcast identifier */
+    void (*Encode)(const APP_MsgTypeDef *message, uint8_t *data); /* Writes the values broadcast */
+} CAN_BroadcastTypeDef;
+
+static void CAN_EncodeTime(const APP_MsgTypeDef *message, uint8_t *data);
+static void CAN_EncodeDate(const APP_MsgTypeDef *message, uint8_t *data);
+static void CAN_EncodeAlarm(const APP_MsgTypeDef *message, uint8_t *data);
+static void CAN_EncodeAlarmEvent(const APP_MsgTypeDef *message, uint8_t *data);
+
+/* Broadcast of each message type, indexed by APP_Messages, no encoder for the types not broadcast */
+static const CAN_BroadcastTypeDef CANBroadcasts[] =
+{
+    {0, NULL},                                  /* SERIAL_MSG_NONE */
+    {CAN_TIME_MESSAGE_ID, CAN_EncodeTime},      /* SERIAL_MSG_TIME */
+    {CAN_DATE_MESSAGE_ID, CAN_EncodeDate},      /* SERIAL_MSG_DATE */
+    {CAN_ALARM_MESSAGE_ID, CAN_EncodeAlarm},    /* SERIAL_MSG_ALARM */
+    {0, NULL},                                  /* SERIAL_MSG_BENCH */
+    {CAN_ALARM_EVENT_ID, CAN_EncodeAlarmEvent}  /* SERIAL_MSG_ALARM_EVENT */
+};
 
 /**
  * @brief Executes CAN tasks based on the current CAN state.
  * 
  * The function processes any pending CAN tasks by switching through different
- * CAN states. Depending on the current state, it prepares data for transmission,
- * updates the message identifier, and sends CAN messages.
+ * CAN states. The message type selects the identifier and the encoder of the
+ * broadcast in CANBroadcasts, the message is then sent until the queue takes it.
  */
 void CAN_Task(void)
 {
@@ -35,74 +62,108 @@ void CAN_Task(void)
     /* Static variable to hold the current state of CAN operations */
     static CAN_StateTypeDef currentCanState = CAN_IDLE_STATE;
 
+    /* Broadcast being sent */
+    static const CAN_BroadcastTypeDef *broadcast = NULL;
+
+    /* Oldest message waiting for its broadcast */
+    const APP_MsgTypeDef *message = Queue_Peek(&CANQueue);
+
+    /* The transmission queue was full, the message is sent again on the next TX complete event */
+    uint8_t txRefused = 0;
+
+    BENCH_BEGIN(&Bench, APP_PROBE_CAN_TASK);
+
     switch(currentCanState)
     {
         /* Check the state and process accordingly */
         
         case CAN_IDLE_STATE:
-            /* If a message is pending, update the state to prepare for transmission */
-            if(CANMsg.msg == 1)
+            /* If a message is pending, prepare its data for transmission, it leaves the queue once encoded */
+            if (message != NULL)
             {
-                currentCanState = CAN_SEND_TIME_STATE;
+                if ((message->msg < (sizeof(CANBroadcasts) / sizeof(CANBroadcasts[0]))) && (CANBroadcasts[message->msg].Encode != NULL))
+                {
+                    broadcast = &CANBroadcasts[message->msg];
+                    broadcast->Encode(message, TxData);
+                    currentCanState = CAN_SEND_STATE;
+                }
+
+                Queue_Release(&CANQueue);
             }
-            else if(CANMsg.msg == 2)
+            break;
+
+        case CAN_SEND_STATE:
+            /* Queue the data for transmission, wait for a free slot if the queue is full */
+            if (Serial_CanTransmit(broadcast->Identifier, TxData, sizeof(TxData)) == SERIAL_OK)
             {
-                currentCanState = CAN_SEND_DATE_STATE;
+                /* Revert to idle state */
+                currentCanState = CAN_IDLE_STATE;
             }
-            else if(CANMsg.msg == 3)
+            else
             {
-                currentCanState = CAN_SEND_ALARM_STATE;
+                txRefused = 1;
             }
             break;
 
-        case CAN_SEND_TIME_STATE:
-            /* Prepare time data for transmission */
-            TxData[0] = (uint8_t) CANMsg.tm.tm_hour;
-            TxData[1] = (uint8_t) CANMsg.tm.tm_min;
-            TxData[2] = (uint8_t) CANMsg.tm.tm_sec;
-
-            /* Set message identifier and transmit time data using FDCAN */
-            CANTxHeader.Identifier = CAN_TIME_MESSAGE_ID; /* CAN time message ID */
-            HAL_FDCAN_AddMessageToTxFifoQ(&CANHandler, &CANTxHeader, TxData);
-
-            /* Reset message indicator and revert to idle state */
-            CANMsg.msg = 0;
-            currentCanState = CAN_IDLE_STATE;
-            break;
-
-        case CAN_SEND_DATE_STATE:
-            /* Prepare date data for transmission */
-            TxData[0] = (uint8_t) CANMsg.tm.tm_mday;
-            TxData[1] = (uint8_t) CANMsg.tm.tm_mon;
-            TxData[2] = (uint8_t) (CANMsg.tm.tm_year / 100); /* Most significant 2 digits of year */
-            TxData[3] = (uint8_t) (CANMsg.tm.tm_year % 100); /* Least significant 2 digits of year */
-            
-            /* Set message identifier and transmit date data using FDCAN */
-            CANTxHeader.Identifier = CAN_DATE_MESSAGE_ID; /* CAN date message ID */
-            HAL_FDCAN_AddMessageToTxFifoQ(&CANHandler, &CANTxHeader, TxData);
-            
-            /* Reset message indicator and revert to idle state */
-            CANMsg.msg = 0;
-            currentCanState = CAN_IDLE_STATE;
-            break;
-
-        case CAN_SEND_ALARM_STATE:
-            /* Prepare alarm data for transmission */
-            TxData[0] = (uint8_t) CANMsg.tm.tm_hour;
-            TxData[1] = (uint8_t) CANMsg.tm.tm_min;
-
-            /* Set message identifier and transmit alarm data using FDCAN */
-            CANTxHeader.Identifier = CAN_ALARM_MESSAGE_ID; /* CAN alarm message ID */
-            HAL_FDCAN_AddMessageToTxFifoQ(&CANHandler, &CANTxHeader, TxData);
-            
-            /* Reset message indicator and revert to idle state */
-            CANMsg.msg = 0;
-            currentCanState = CAN_IDLE_STATE;
-            break;
-
         default:
             /* In case of an unknown state, revert to idle state */
             currentCanState = CAN_IDLE_STATE;
         break;
     }
-}
\ No newline at end of file
+
+    /* Keep running until the pending message is sent and the queue is empty */
+    if (((currentCanState != CAN_IDLE_STATE) || (Queue_Count(&CANQueue) > 0u)) && (txRefused == 0u))
+    {
+        Sched_SetEvent(&Scheduler, APP_EVENT_CAN);
+    }
+
+    BENCH_END(&Bench, APP_PROBE_CAN_TASK);
+}
+
+/**
+ * @brief Prepare time data for transmission
+ * @param message Message broadcast
+ * @param data Frame payload
+ */
+static void CAN_EncodeTime(const APP_MsgTypeDef *message, uint8_t *data)
+{
+    data[0] = message->data.time.hour;
+    data[1] = message->data.time.min;
+    data[2] = message->data.time.sec;
+}
+
+/**
+ * @brief Prepare date data for transmission
+ * @param message Message broadcast
+ * @param data Frame payload
+ */
+static void CAN_EncodeDate(const APP_MsgTypeDef *message, uint8_t *data)
+{
+    data[0] = message->data.date.mday;
+    data[1] = message->data.date.mon;
+    data[2] = (uint8_t) (message->data.date.year / 100); /* Most significant 2 digits of year */
+    data[3] = (uint8_t) (message->data.date.year % 100); /* Least significant 2 digits of year */
+}
+
+/**
+ * @brief Prepare alarm data for transmission
+ * @param message Message broadcast
+ * @param data Frame payload
+ */
+static void CAN_EncodeAlarm(const APP_MsgTypeDef *message, uint8_t *data)
+{
+    data[0] = message->data.alarm.hour;
+    data[1] = message->data.alarm.min;
+}
+
+/**
+ * @brief Prepare the data of an alarm that went off for transmission
+ * @param message Message broadcast
+ * @param data Frame payload
+ */
+static void CAN_EncodeAlarmEvent(const APP_MsgTypeDef *message, uint8_t *data)
+{
+    data[0] = message->data.time.hour;
+    data[1] = message->data.time.min;
+    data[2] = message->data.time.sec;
+}
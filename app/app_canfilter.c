@@ -0,0 +1,327 @@
+/**
+ * @file app_canfilter.c
+ * @brief Table of the CAN identifiers to receive, compiled into FDCAN filter elements.
+ */
+
+#include "app_canfilter.h"
+#include <stddef.h>
+
+#define CAN_FILTER_STD_ID_MAX 0x7FFuL
+#define CAN_FILTER_EXT_ID_MAX 0x1FFFFFFFuL
+
+static uint8_t CanFilter_AddRule(CanFilter_HandleTypeDef *hfilter, uint8_t type, uint8_t idType, uint32_t id1, uint32_t id2, uint8_t priority);
+static uint8_t CanFilter_BuildGroup(CanFilter_HandleTypeDef *hfilter, uint8_t idType, uint8_t fifo);
+static uint8_t CanFilter_Emit(CanFilter_HandleTypeDef *hfilter, uint8_t type, uint8_t idType, uint8_t fifo, uint32_t id1, uint32_t id2);
+static uint8_t CanFilter_Matches(const CanFilter_ElementTypeDef *element, uint32_t id);
+
+/**
+ * @brief Initialize the table without registrations nor elements.
+ * @param hfilter Pointer to the filter table handle structure.
+ */
+void CanFilter_Init(CanFilter_HandleTypeDef *hfilter)
+{
+    hfilter->RuleCount = 0;
+    hfilter->StdCount = 0;
+    hfilter->ExtCount = 0;
+}
+
+/**
+ * @brief Register one identifier.
+ * @param hfilter Pointer to the filter table handle structure.
+ * @param idType CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED.
+ * @param id Identifier to receive.
+ * @param priority CAN_FILTER_PRIORITY_NORMAL or CAN_FILTER_PRIORITY_HIGH.
+ * @return CANFILTER_OK if registered, CANFILTER_ERROR if invalid or the table is full.
+ */
+uint8_t CanFilter_AddId(CanFilter_HandleTypeDef *hfilter, uint8_t idType, uint32_t id, uint8_t priority)
+{
+    return CanFilter_AddRule(hfilter, CAN_FILTER_RANGE, idType, id, id, priority);
+}
+
+/**
+ * @brief Register a range of identifiers.
+ * @param hfilter Pointer to the filter table handle structure.
+ * @param idType CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED.
+ * @param first First identifier to receive.
+ * @param last Last identifier to receive, included.
+ * @param priority CAN_FILTER_PRIORITY_NORMAL or CAN_FILTER_PRIORITY_HIGH.
+ * @return CANFILTER_OK if registered, CANFILTER_ERROR if invalid or the table is full.
+ */
+uint8_t CanFilter_AddRange(CanFilter_HandleTypeDef *hfilter, uint8_t idType, uint32_t first, uint32_t last, uint8_t priority)
+{
+    uint8_t status = CANFILTER_ERROR;
+
+    if (first <= last)
+    {
+        status = CanFilter_AddRule(hfilter, CAN_FILTER_RANGE, idType, first, last, priority);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Register the identifiers equal to id on the bits set in mask.
+ * @param hfilter Pointer to the filter table handle structure.
+ * @param idType CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED.
+ * @param id Identifier to compare with.
+ * @param mask Bits compared, the others are don't care.
+ * @param priority CAN_FILTER_PRIORITY_NORMAL or CAN_FILTER_PRIORITY_HIGH.
+ * @return CANFILTER_OK if registered, CANFILTER_ERROR if invalid or the table is full.
+ */
+uint8_t CanFilter_AddMask(CanFilter_HandleTypeDef *hfilter, uint8_t idType, uint32_t id, uint32_t mask, uint8_t priority)
+{
+    /* The bits out of the mask do not matter, clear them so equal masks are found when building */
+    return CanFilter_AddRule(hfilter, CAN_FILTER_MASK, idType, id & mask, mask, priority);
+}
+
+/**
+ * @brief Compile the registrations into filter elements.
+ * @param hfilter Pointer to the filter table handle structure.
+ * @return CANFILTER_OK if built, CANFILTER_ERROR if more elements than the hardware has are needed.
+ */
+uint8_t CanFilter_Build(CanFilter_HandleTypeDef *hfilter)
+{
+    uint8_t status = CANFILTER_OK;
+
+    hfilter->StdCount = 0;
+    hfilter->ExtCount = 0;
+
+    /* The controller takes the first matching element, the high priority ones go first */
+    status |= CanFilter_BuildGroup(hfilter, CAN_FILTER_STANDARD, 1u);
+    status |= CanFilter_BuildGroup(hfilter, CAN_FILTER_STANDARD, 0u);
+    status |= CanFilter_BuildGroup(hfilter, CAN_FILTER_EXTENDED, 1u);
+    status |= CanFilter_BuildGroup(hfilter, CAN_FILTER_EXTENDED, 0u);
+
+    return (status == CANFILTER_OK) ? CANFILTER_OK : CANFILTER_ERROR;
+}
+
+/**
+ * @brief Look up an identifier in the elements built, as the controller does.
+ * @param hfilter Pointer to the filter table handle structure.
+ * @param idType CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED.
+ * @param id Identifier received.
+ * @param fifo Where the RX FIFO of the first matching element is written.
+ * @return CANFILTER_OK if an element matches, CANFILTER_ERROR if the frame would be rejected.
+ */
+uint8_t CanFilter_Match(const CanFilter_HandleTypeDef *hfilter, uint8_t idType, uint32_t id, uint8_t *fifo)
+{
+    const CanFilter_ElementTypeDef *elements = (idType == CAN_FILTER_STANDARD) ? hfilter->Std : hfilter->Ext;
+    uint8_t count = (idType == CAN_FILTER_STANDARD) ? hfilter->StdCount : hfilter->ExtCount;
+    uint8_t status = CANFILTER_ERROR;
+
+    for (uint8_t i = 0; (i < count) && (status != CANFILTER_OK); i++)
+    {
+        if (CanFilter_Matches(&elements[i], id) != 0u)
+        {
+            *fifo = elements[i].Fifo;
+            status = CANFILTER_OK;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief Check and store a registration
+ * @param hfilter Pointer to the filter table handle structure
+ * @param type CAN_FILTER_RANGE or CAN_FILTER_MASK
+ * @param idType CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED
+ * @param id1 First identifier or identifier
+ * @param id2 Last identifier or mask
+ * @param priority CAN_FILTER_PRIORITY_NORMAL or CAN_FILTER_PRIORITY_HIGH
+ * @return CANFILTER_OK if stored, CANFILTER_ERROR otherwise
+ */
+static uint8_t CanFilter_AddRule(CanFilter_HandleTypeDef *hfilter, uint8_t type, uint8_t idType, uint32_t id1, uint32_t id2, uint8_t priority)
+{
+    CanFilter_ElementTypeDef *rule;
+    uint32_t maxId = (idType == CAN_FILTER_STANDARD) ? CAN_FILTER_STD_ID_MAX : CAN_FILTER_EXT_ID_MAX;
+    uint8_t status = CANFILTER_ERROR;
+
+    if ((hfilter->RuleCount < CAN_FILTER_MAX_RULES) && (idType <= CAN_FILTER_EXTENDED) &&
+        (priority <= CAN_FILTER_PRIORITY_HIGH) && (id1 <= maxId) && (id2 <= maxId))
+    {
+        rule = &hfilter->Rules[hfilter->RuleCount];
+        rule->Type = type;
+        rule->IdType = idType;
+        rule->Fifo = (priority == CAN_FILTER_PRIORITY_HIGH) ? 1u : 0u;
+        rule->Id1 = id1;
+        rule->Id2 = id2;
+        hfilter->RuleCount++;
+        status = CANFILTER_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Build the elements of the registrations of one identifier type and FIFO
+ *
+ * The ranges are sorted and merged when they overlap or touch, what is left
+ * of a single identifier is paired with the next one in a dual element, the
+ * rest become range elements. Masks are written once each.
+ *
+ * @param hfilter Pointer to the filter table handle structure
+ * @param idType CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED
+ * @param fifo RX FIFO, 0 or 1
+ * @return CANFILTER_OK if all the elements fit, CANFILTER_ERROR otherwise
+ */
+static uint8_t CanFilter_BuildGroup(CanFilter_HandleTypeDef *hfilter, uint8_t idType, uint8_t fifo)
+{
+    CanFilter_ElementTypeDef ranges[CAN_FILTER_MAX_RULES];
+    CanFilter_ElementTypeDef key;
+    const CanFilter_ElementTypeDef *rule;
+    uint8_t count = 0;
+    uint8_t merged = 0;
+    uint8_t single = 0;     /* A single identifier is waiting for a partner */
+    uint32_t singleId = 0;
+    uint8_t duplicate;
+    uint8_t status = CANFILTER_OK;
+    uint8_t j;
+
+    for (uint8_t i = 0; i < hfilter->RuleCount; i++)
+    {
+        rule = &hfilter->Rules[i];
+
+        if ((rule->IdType == idType) && (rule->Fifo == fifo))
+        {
+            if (rule->Type == CAN_FILTER_RANGE)
+            {
+                ranges[count++] = *rule;
+            }
+            else
+            {
+                duplicate = 0;
+                for (j = 0; j < i; j++)
+                {
+                    if ((hfilter->Rules[j].Type == CAN_FILTER_MASK) && (hfilter->Rules[j].IdType == idType) &&
+                        (hfilter->Rules[j].Fifo == fifo) && (hfilter->Rules[j].Id1 == rule->Id1) &&
+                        (hfilter->Rules[j].Id2 == rule->Id2))
+                    {
+                        duplicate = 1;
+                    }
+                }
+
+                if (duplicate == 0u)
+                {
+                    status |= CanFilter_Emit(hfilter, CAN_FILTER_MASK, idType, fifo, rule->Id1, rule->Id2);
+                }
+            }
+        }
+    }
+
+    /* Insertion sort on the first identifier, there are only a few */
+    for (uint8_t i = 1; i < count; i++)
+    {
+        key = ranges[i];
+        for (j = i; (j > 0u) && (ranges[j - 1u].Id1 > key.Id1); j--)
+        {
+            ranges[j] = ranges[j - 1u];
+        }
+        ranges[j] = key;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if ((merged > 0u) && (ranges[i].Id1 <= (ranges[merged - 1u].Id2 + 1u)))
+        {
+            if (ranges[i].Id2 > ranges[merged - 1u].Id2)
+            {
+                ranges[merged - 1u].Id2 = ranges[i].Id2;
+            }
+        }
+        else
+        {
+            ranges[merged++] = ranges[i];
+        }
+    }
+
+    for (uint8_t i = 0; i < merged; i++)
+    {
+        if (ranges[i].Id1 != ranges[i].Id2)
+        {
+            status |= CanFilter_Emit(hfilter, CAN_FILTER_RANGE, idType, fifo, ranges[i].Id1, ranges[i].Id2);
+        }
+        else if (single != 0u)
+        {
+            status |= CanFilter_Emit(hfilter, CAN_FILTER_DUAL, idType, fifo, singleId, ranges[i].Id1);
+            single = 0;
+        }
+        else
+        {
+            singleId = ranges[i].Id1;
+            single = 1;
+        }
+    }
+
+    if (single != 0u)
+    {
+        status |= CanFilter_Emit(hfilter, CAN_FILTER_DUAL, idType, fifo, singleId, singleId);
+    }
+
+    return (status == CANFILTER_OK) ? CANFILTER_OK : CANFILTER_ERROR;
+}
+
+/**
+ * @brief Append an element to the standard or extended list
+ * @param hfilter Pointer to the filter table handle structure
+ * @param type CAN_FILTER_RANGE, CAN_FILTER_DUAL or CAN_FILTER_MASK
+ * @param idType CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED
+ * @param fifo RX FIFO, 0 or 1
+ * @param id1 First field of the element
+ * @param id2 Second field of the element
+ * @return CANFILTER_OK if appended, CANFILTER_ERROR if the list is full
+ */
+static uint8_t CanFilter_Emit(CanFilter_HandleTypeDef *hfilter, uint8_t type, uint8_t idType, uint8_t fifo, uint32_t id1, uint32_t id2)
+{
+    CanFilter_ElementTypeDef *element = NULL;
+    uint8_t status = CANFILTER_ERROR;
+
+    if ((idType == CAN_FILTER_STANDARD) && (hfilter->StdCount < CAN_FILTER_MAX_STD))
+    {
+        element = &hfilter->Std[hfilter->StdCount++];
+    }
+    else if ((idType == CAN_FILTER_EXTENDED) && (hfilter->ExtCount < CAN_FILTER_MAX_EXT))
+    {
+        element = &hfilter->Ext[hfilter->ExtCount++];
+    }
+
+    if (element != NULL)
+    {
+        element->Type = type;
+        element->IdType = idType;
+        element->Fifo = fifo;
+        element->Id1 = id1;
+        element->Id2 = id2;
+        status = CANFILTER_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Check an identifier against one element
+ * @param element Filter element
+ * @param id Identifier received
+ * @return 1 if it matches, 0 otherwise
+ */
+static uint8_t CanFilter_Matches(const CanFilter_ElementTypeDef *element, uint32_t id)
+{
+    uint8_t match;
+
+    switch (element->Type)
+    {
+        case CAN_FILTER_RANGE:
+            match = ((id >= element->Id1) && (id <= element->Id2)) ? 1u : 0u;
+            break;
+
+        case CAN_FILTER_DUAL:
+            match = ((id == element->Id1) || (id == element->Id2)) ? 1u : 0u;
+            break;
+
+        default:
+            match = ((id & element->Id2) == (element->Id1 & element->Id2)) ? 1u : 0u;
+            break;
+    }
+
+    return match;
+}
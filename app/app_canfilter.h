@@ -0,0 +1,134 @@
+#ifndef __APP_CANFILTER_H__
+#define __APP_CANFILTER_H__
+
+#include <stdint.h>
+
+/**
+ * @file app_canfilter.h
+ * @brief Table of the CAN identifiers to receive, compiled into FDCAN filter elements.
+ *
+ * The modules register the identifiers, ranges or masks they want with a
+ * priority, CanFilter_Build turns them into as few filter elements as the
+ * FDCAN needs: overlapping and adjacent ranges are merged, single
+ * identifiers are paired in dual elements, longer runs become range
+ * elements and masks are kept as they are. High priority elements go to RX
+ * FIFO 1 and come first in the list, the controller takes the first match,
+ * so an identifier registered with both priorities goes to FIFO 1. Frames
+ * matching no element are meant to be rejected by the hardware. The element
+ * types and FIFO numbers follow the FDCAN ones.
+ */
+
+/**
+ * @brief Number of registrations the table can hold.
+ */
+#ifndef CAN_FILTER_MAX_RULES
+#define CAN_FILTER_MAX_RULES 16u
+#endif
+
+/**
+ * @brief Filter elements of the message RAM, 28 standard and 8 extended on the STM32G0.
+ */
+#define CAN_FILTER_MAX_STD  28u
+#define CAN_FILTER_MAX_EXT  8u
+
+#define CANFILTER_OK      0x00U
+#define CANFILTER_ERROR   0x01U
+
+/* Identifier types */
+#define CAN_FILTER_STANDARD 0u  /**< 11 bits identifier */
+#define CAN_FILTER_EXTENDED 1u  /**< 29 bits identifier */
+
+/* Priorities */
+#define CAN_FILTER_PRIORITY_NORMAL  0u  /**< Received in RX FIFO 0 */
+#define CAN_FILTER_PRIORITY_HIGH    1u  /**< Received in RX FIFO 1 */
+
+/* Element types, same values as FDCAN_FILTER_RANGE, FDCAN_FILTER_DUAL and FDCAN_FILTER_MASK */
+#define CAN_FILTER_RANGE    0u  /**< Id1 to Id2 */
+#define CAN_FILTER_DUAL     1u  /**< Id1 or Id2 */
+#define CAN_FILTER_MASK     2u  /**< Id1 on the bits set in Id2 */
+
+/**
+ * @brief Registration or filter element.
+ */
+typedef struct
+{
+    uint32_t Id1;   /**< First identifier, or identifier for masks */
+    uint32_t Id2;   /**< Last or second identifier, or mask */
+    uint8_t Type;   /**< CAN_FILTER_RANGE, CAN_FILTER_DUAL or CAN_FILTER_MASK */
+    uint8_t IdType; /**< CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED */
+    uint8_t Fifo;   /**< RX FIFO receiving the frames, 0 or 1 */
+} CanFilter_ElementTypeDef;
+
+/**
+ * @brief Filter table handler structure.
+ */
+typedef struct
+{
+    CanFilter_ElementTypeDef Rules[CAN_FILTER_MAX_RULES];   /**< Registrations, ranges and masks */
+    uint8_t RuleCount;                                      /**< Number of registrations */
+    CanFilter_ElementTypeDef Std[CAN_FILTER_MAX_STD];       /**< Standard elements built */
+    uint8_t StdCount;                                       /**< Number of standard elements */
+    CanFilter_ElementTypeDef Ext[CAN_FILTER_MAX_EXT];       /**< Extended elements built */
+    uint8_t ExtCount;                                       /**< Number of extended elements */
+} CanFilter_HandleTypeDef;
+
+/**
+ * @brief Initialize the table without registrations nor elements.
+ * @param hfilter Pointer to the filter table handle structure.
+ */
+void CanFilter_Init(CanFilter_HandleTypeDef *hfilter);
+
+/**
+ * @brief Register one identifier.
+ * @param hfilter Pointer to the filter table handle structure.
+ * @param idType CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED.
+ * @param id Identifier to receive.
+ * @param priority CAN_FILTER_PRIORITY_NORMAL or CAN_FILTER_PRIORITY_HIGH.
+ * @return CANFILTER_OK if registered, CANFILTER_ERROR if invalid or the table is full.
+ */
+uint8_t CanFilter_AddId(CanFilter_HandleTypeDef *hfilter, uint8_t idType, uint32_t id, uint8_t priority);
+
+/**
+ * @brief Register a range of identifiers.
+ * @param hfilter Pointer to the filter table handle structure.
+ * @param idType CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED.
+ * @param first First identifier to receive.
+ * @param last Last identifier to receive, included.
+ * @param priority CAN_FILTER_PRIORITY_NORMAL or CAN_FILTER_PRIORITY_HIGH.
+ * @return CANFILTER_OK if registered, CANFILTER_ERROR if invalid or the table is full.
+ */
+uint8_t CanFilter_AddRange(CanFilter_HandleTypeDef *hfilter, uint8_t idType, uint32_t first, uint32_t last, uint8_t priority);
+
+/**
+ * @brief Register the identifiers equal to id on the bits set in mask.
+ * @param hfilter Pointer to the filter table handle structure.
+ * @param idType CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED.
+ * @param id Identifier to compare with.
+ * @param mask Bits compared, the others are don't care.
+ * @param priority CAN_FILTER_PRIORITY_NORMAL or CAN_FILTER_PRIORITY_HIGH.
+ * @return CANFILTER_OK if registered, CANFILTER_ERROR if invalid or the table is full.
+ */
+uint8_t CanFilter_AddMask(CanFilter_HandleTypeDef *hfilter, uint8_t idType, uint32_t id, uint32_t mask, uint8_t priority);
+
+/**
+ * @brief Compile the registrations into filter elements.
+ *
+ * The elements are left in Std and Ext, high priority ones first, ready to be
+ * written in the controller with their index in the array as filter index.
+ *
+ * @param hfilter Pointer to the filter table handle structure.
+ * @return CANFILTER_OK if built, CANFILTER_ERROR if more elements than the hardware has are needed.
+ */
+uint8_t CanFilter_Build(CanFilter_HandleTypeDef *hfilter);
+
+/**
+ * @brief Look up an identifier in the elements built, as the controller does.
+ * @param hfilter Pointer to the filter table handle structure.
+ * @param idType CAN_FILTER_STANDARD or CAN_FILTER_EXTENDED.
+ * @param id Identifier received.
+ * @param fifo Where the RX FIFO of the first matching element is written.
+ * @return CANFILTER_OK if an element matches, CANFILTER_ERROR if the frame would be rejected.
+ */
+uint8_t CanFilter_Match(const CanFilter_HandleTypeDef *hfilter, uint8_t idType, uint32_t id, uint8_t *fifo);
+
+#endif // __APP_CANFILTER_H__
@@ -0,0 +1,145 @@
+/**
+ * @file app_canring.c
+ * @brief Lock-free single-producer/single-consumer ring of CAN frames.
+ */
+
+#include "app_canring.h"
+#include <stddef.h>
+
+#define CAN_RING_MASK (CAN_RING_DEPTH - 1u)
+
+/* Keep the compiler from moving the frame accesses across the index updates */
+#define CAN_RING_BARRIER() __asm__ volatile ("" ::: "memory")
+
+/**
+ * @brief Initialize (empty) the ring and clear its counters.
+ * @param ring Pointer to the ring handle structure.
+ */
+void CanRing_Init(CanRing_HandleTypeDef *ring)
+{
+    ring->Head = 0;
+    ring->Tail = 0;
+    ring->Overflows = 0;
+    ring->HighWater = 0;
+}
+
+/**
+ * @brief Get the next free slot to be filled by the producer.
+ * @param ring Pointer to the ring handle structure.
+ * @return Pointer to the free slot, NULL if the ring is full.
+ */
+APP_CanFrameTypeDef *CanRing_Reserve(CanRing_HandleTypeDef *ring)
+{
+    APP_CanFrameTypeDef *slot = NULL;
+    uint32_t head = ring->Head;
+
+    if ((head - ring->Tail) < CAN_RING_DEPTH)
+    {
+        slot = &ring->Frames[head & CAN_RING_MASK];
+    }
+    else
+    {
+        ring->Overflows++; /* The newest frame is the one lost */
+    }
+
+    return slot;
+}
+
+/**
+ * @brief Publish the slot previously obtained with CanRing_Reserve.
+ * @param ring Pointer to the ring handle structure.
+ */
+void CanRing_Commit(CanRing_HandleTypeDef *ring)
+{
+    uint32_t head = ring->Head + 1u;
+    uint32_t count = head - ring->Tail;
+
+    CAN_RING_BARRIER(); /* Frame must be complete before it becomes visible */
+    ring->Head = head;
+
+    if (count > ring->HighWater)
+    {
+        ring->HighWater = count;
+    }
+}
+
+/**
+ * @brief Copy a frame into the ring (producer side).
+ * @param ring Pointer to the ring handle structure.
+ * @param frame Pointer to the frame to store.
+ * @return CANRING_OK if the frame was stored, CANRING_ERROR if the ring is full.
+ */
+uint8_t CanRing_Push(CanRing_HandleTypeDef *ring, const APP_CanFrameTypeDef *frame)
+{
+    uint8_t status = CANRING_ERROR;
+    APP_CanFrameTypeDef *slot = CanRing_Reserve(ring);
+
+    if (slot != NULL)
+    {
+        *slot = *frame;
+        CanRing_Commit(ring);
+        status = CANRING_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Get the oldest frame without removing it (consumer side).
+ * @param ring Pointer to the ring handle structure.
+ * @return Pointer to the oldest frame, NULL if the ring is empty.
+ */
+const APP_CanFrameTypeDef *CanRing_Peek(CanRing_HandleTypeDef *ring)
+{
+    const APP_CanFrameTypeDef *slot = NULL;
+    uint32_t tail = ring->Tail;
+
+    if (ring->Head != tail)
+    {
+        CAN_RING_BARRIER(); /* Do not read the frame before the head index */
+        slot = &ring->Frames[tail & CAN_RING_MASK];
+    }
+
+    return slot;
+}
+
+/**
+ * @brief Remove the frame previously obtained with CanRing_Peek.
+ * @param ring Pointer to the ring handle structure.
+ */
+void CanRing_Release(CanRing_HandleTypeDef *ring)
+{
+    CAN_RING_BARRIER(); /* Frame must be consumed before the slot is given back */
+    ring->Tail = ring->Tail + 1u;
+}
+
+/**
+ * @brief Copy the oldest frame out of the ring and remove it (consumer side).
+ * @param ring Pointer to the ring handle structure.
+ * @param frame Pointer where the frame is copied.
+ * @return CANRING_OK if a frame was read, CANRING_ERROR if the ring is empty.
+ */
+uint8_t CanRing_Pop(CanRing_HandleTypeDef *ring, APP_CanFrameTypeDef *frame)
+{
+    uint8_t status = CANRING_ERROR;
+    const APP_CanFrameTypeDef *slot = CanRing_Peek(ring);
+
+    if (slot != NULL)
+    {
+        *frame = *slot;
+        CanRing_Release(ring);
+        status = CANRING_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Number of frames currently stored.
+ * @param ring Pointer to the ring handle structure.
+ * @return Number of frames waiting to be read.
+ */
+uint32_t CanRing_Count(const CanRing_HandleTypeDef *ring)
+{
+    return ring->Head - ring->Tail;
+}
@@ -0,0 +1,133 @@
+#ifndef __APP_CANRING_H__
+#define __APP_CANRING_H__
+
+#include <stdint.h>
+
+/**
+ * @file app_canring.h
+ * @brief Lock-free single-producer/single-consumer ring of CAN frames.
+ *
+ * The producer (the FDCAN reception interrupt) only writes the head index and
+ * the consumer (Serial_Task) only writes the tail index, so no critical section
+ * is needed to move frames between both contexts.
+ */
+
+/**
+ * @brief Number of frames the ring can hold, must be a power of two.
+ *
+ * It can be overridden from the compiler command line (-DCAN_RING_DEPTH=32).
+ */
+#ifndef CAN_RING_DEPTH
+#define CAN_RING_DEPTH 16u
+#endif
+
+/**
+ * @brief Maximum payload stored per frame in bytes, 64 to hold CAN FD frames.
+ */
+#ifndef CAN_RING_PAYLOAD_SIZE
+#define CAN_RING_PAYLOAD_SIZE 64u
+#endif
+
+#if ((CAN_RING_DEPTH & (CAN_RING_DEPTH - 1u)) != 0u) || (CAN_RING_DEPTH < 2u)
+#error "CAN_RING_DEPTH must be a power of two greater than one"
+#endif
+
+#define CANRING_OK      0x00U
+#define CANRING_ERROR   0x01U
+
+/* Values of the Flags field */
+#define CAN_FRAME_FLAG_FD   0x01U   /**< CAN FD frame */
+#define CAN_FRAME_FLAG_BRS  0x02U   /**< Data phase sent with bit rate switching */
+
+/**
+ * @brief CAN frame as stored in the ring (header + payload + timestamp).
+ */
+typedef struct
+{
+    uint32_t Identifier;                    /**< CAN identifier, 11 or 29 bits */
+    uint32_t Timestamp;                     /**< Reception time stamp, start of frame in microseconds */
+    uint8_t IdType;                         /**< 0 for standard ID, 1 for extended ID */
+    uint8_t Length;                         /**< Number of valid bytes in Data */
+    uint8_t Flags;                          /**< Frame format flags (FD, bit rate switch) */
+    uint8_t Data[CAN_RING_PAYLOAD_SIZE];    /**< Frame payload */
+} APP_CanFrameTypeDef;
+
+/**
+ * @brief Ring handler structure.
+ *
+ * Head and Tail are free running counters, the slot is obtained masking them
+ * with the depth, so Head - Tail is always the number of frames stored.
+ */
+typedef struct
+{
+    APP_CanFrameTypeDef Frames[CAN_RING_DEPTH]; /**< Frame storage */
+    volatile uint32_t Head;                     /**< Next slot to write, owned by the producer */
+    volatile uint32_t Tail;                     /**< Next slot to read, owned by the consumer */
+    volatile uint32_t Overflows;                /**< Frames dropped because the ring was full */
+    volatile uint32_t HighWater;                /**< Maximum number of frames stored at once */
+} CanRing_HandleTypeDef;
+
+/**
+ * @brief Initialize (empty) the ring and clear its counters.
+ * @param ring Pointer to the ring handle structure.
+ */
+void CanRing_Init(CanRing_HandleTypeDef *ring);
+
+/**
+ * @brief Get the next free slot to be filled by the producer.
+ *
+ * The frame is not visible to the consumer until CanRing_Commit is called.
+ * When the ring is full the overflow counter is incremented.
+ *
+ * @param ring Pointer to the ring handle structure.
+ * @return Pointer to the free slot, NULL if the ring is full.
+ */
+APP_CanFrameTypeDef *CanRing_Reserve(CanRing_HandleTypeDef *ring);
+
+/**
+ * @brief Publish the slot previously obtained with CanRing_Reserve.
+ * @param ring Pointer to the ring handle structure.
+ */
+void CanRing_Commit(CanRing_HandleTypeDef *ring);
+
+/**
+ * @brief Copy a frame into the ring (producer side).
+ * @param ring Pointer to the ring handle structure.
+ * @param frame Pointer to the frame to store.
+ * @return CANRING_OK if the frame was stored, CANRING_ERROR if the ring is full.
+ */
+uint8_t CanRing_Push(CanRing_HandleTypeDef *ring, const APP_CanFrameTypeDef *frame);
+
+/**
+ * @brief Get the oldest frame without removing it (consumer side).
+ *
+ * The slot belongs to the consumer until CanRing_Release is called, the
+ * producer never writes it in the meantime.
+ *
+ * @param ring Pointer to the ring handle structure.
+ * @return Pointer to the oldest frame, NULL if the ring is empty.
+ */
+const APP_CanFrameTypeDef *CanRing_Peek(CanRing_HandleTypeDef *ring);
+
+/**
+ * @brief Remove the frame previously obtained with CanRing_Peek.
+ * @param ring Pointer to the ring handle structure.
+ */
+void CanRing_Release(CanRing_HandleTypeDef *ring);
+
+/**
+ * @brief Copy the oldest frame out of the ring and remove it (consumer side).
+ * @param ring Pointer to the ring handle structure.
+ * @param frame Pointer where the frame is copied.
+ * @return CANRING_OK if a frame was read, CANRING_ERROR if the ring is empty.
+ */
+uint8_t CanRing_Pop(CanRing_HandleTypeDef *ring, APP_CanFrameTypeDef *frame);
+
+/**
+ * @brief Number of frames currently stored.
+ * @param ring Pointer to the ring handle structure.
+ * @return Number of frames waiting to be read.
+ */
+uint32_t CanRing_Count(const CanRing_HandleTypeDef *ring);
+
+#endif // __APP_CANRING_H__
@@ -0,0 +1,758 @@
+/**
+ * @file app_cantp.c
+ * @brief ISO 15765-2 (ISO-TP) transport layer.
+ */
+
+#include "app_cantp.h"
+#include <stddef.h>
+
+#if (CANTP_BUFFER_SIZE > 4095u)
+#error "CANTP_BUFFER_SIZE can not exceed the 12 bits first frame length"
+#endif
+
+#define NIBBLE_LSB_EXTRACTOR 0x0F
+
+/* Protocol control information types (high nibble of the first byte) */
+#define CANTP_PCI_SINGLE_FRAME      0x00u
+#define CANTP_PCI_FIRST_FRAME       0x01u
+#define CANTP_PCI_CONSECUTIVE_FRAME 0x02u
+#define CANTP_PCI_FLOW_CONTROL      0x03u
+
+/* Flow status values of the flow control frame */
+#define CANTP_FS_CTS    0x00u   /* Continue to send */
+#define CANTP_FS_WAIT   0x01u   /* Wait for another flow control */
+#define CANTP_FS_OVFLW  0x02u   /* Message too long for the receiver */
+
+/* Payload of a single frame with the length in the first byte (classic CAN) */
+#define CANTP_SF_MAX_DATA (CANTP_FRAME_SIZE - 1u)
+
+/* Frame lengths allowed by CAN FD above 8 bytes (DLC 9 to 15) */
+static const uint8_t CanTp_FdLengths[] = {12u, 16u, 20u, 24u, 32u, 48u, 64u};
+
+/* Private function prototypes */
+static uint8_t CanTp_FrameLength(uint8_t used);
+static uint8_t CanTp_SingleFrameMax(uint8_t length);
+static uint8_t CanTp_SendFrame(CanTp_HandleTypeDef *htp, uint8_t *frame, uint8_t used);
+static uint8_t CanTp_SendFirstFrame(CanTp_HandleTypeDef *htp, uint32_t now);
+static void CanTp_SendConsecutiveFrames(CanTp_HandleTypeDef *htp, uint32_t now);
+static uint8_t CanTp_SendFlowControl(CanTp_HandleTypeDef *htp);
+static void CanTp_QueueFlowControl(CanTp_HandleTypeDef *htp, uint8_t flowStatus, uint32_t now);
+static void CanTp_RxSingleFrame(CanTp_HandleTypeDef *htp, const uint8_t *data, uint8_t size);
+static void CanTp_RxFirstFrame(CanTp_HandleTypeDef *htp, const uint8_t *data, uint8_t chunk, uint16_t size, uint32_t now);
+static void CanTp_RxConsecutiveFrame(CanTp_HandleTypeDef *htp, const uint8_t *data, uint8_t length, uint32_t now);
+static void CanTp_RxFlowControl(CanTp_HandleTypeDef *htp, const uint8_t *data, uint32_t now);
+static uint32_t CanTp_DecodeSTmin(uint8_t stmin);
+static uint32_t CanTp_TimeLeft(uint32_t start, uint32_t timeout, uint32_t now);
+static uint8_t CanTp_SeparationElapsed(const CanTp_HandleTypeDef *htp, uint32_t now);
+
+/* Functions */
+/**
+ * @brief Initialize the transport layer, both directions become idle.
+ * @param htp Pointer to the ISO-TP handle structure.
+ */
+void CanTp_Init(CanTp_HandleTypeDef *htp)
+{
+    /* Anything but a CAN FD length falls back to classic frames */
+    if ((htp->FrameSize <= CANTP_FRAME_SIZE) || (htp->FrameSize > CANTP_FD_FRAME_SIZE))
+    {
+        htp->FrameSize = CANTP_FRAME_SIZE;
+    }
+    htp->FrameSize = CanTp_FrameLength(htp->FrameSize);
+
+    htp->RxState = CANTP_RX_IDLE_STATE;
+    htp->RxResult = CANTP_RESULT_OK;
+    htp->RxMessage = htp->RxBuffer;
+    htp->RxSize = 0;
+    htp->RxIndex = 0;
+    htp->RxFcPending = 0;
+
+    htp->TxState = CANTP_TX_IDLE_STATE;
+    htp->TxResult = CANTP_RESULT_OK;
+    htp->TxSize = 0;
+    htp->TxIndex = 0;
+}
+
+/**
+ * @brief Process a received CAN frame.
+ * @param htp Pointer to the ISO-TP handle structure.
+ * @param data Frame payload.
+ * @param length Number of bytes in the frame.
+ * @param now Current time in milliseconds.
+ * @return CANTP_OK if the frame was a valid ISO-TP frame, CANTP_ERROR otherwise.
+ */
+uint8_t CanTp_RxIndication(CanTp_HandleTypeDef *htp, const uint8_t *data, uint8_t length, uint32_t now)
+{
+    uint8_t status = CANTP_ERROR;
+    uint8_t pciType;
+    uint16_t size;
+
+    if (length > 0u)
+    {
+        pciType = (data[0] >> 4) & NIBBLE_LSB_EXTRACTOR;
+
+        switch (pciType)
+        {
+        case CANTP_PCI_SINGLE_FRAME:
+            size = data[0] & NIBBLE_LSB_EXTRACTOR;
+
+            if ((size > 0u) && (size <= CANTP_SF_MAX_DATA) && (size < length))
+            {
+                CanTp_RxSingleFrame(htp, &data[1], (uint8_t)size);
+                status = CANTP_OK;
+            }
+            else if ((size == 0u) && (length > CANTP_FRAME_SIZE))
+            {
+                /* CAN FD single frame, the length escapes to the second byte */
+                size = data[1];
+
+                if ((size > 0u) && (size <= CanTp_SingleFrameMax(length)))
+                {
+                    CanTp_RxSingleFrame(htp, &data[2], (uint8_t)size);
+                    status = CANTP_OK;
+                }
+            }
+            break;
+
+        case CANTP_PCI_FIRST_FRAME:
+            size = (uint16_t)(((data[0] & NIBBLE_LSB_EXTRACTOR) << 8) | data[1]);
+
+            /* A first frame always fills the whole CAN frame and carries more than a single frame */
+            if ((length >= CANTP_FRAME_SIZE) && (size > CanTp_SingleFrameMax(length)))
+            {
+                CanTp_RxFirstFrame(htp, &data[2], (uint8_t)(length - 2u), size, now);
+                status = CANTP_OK;
+            }
+            break;
+
+        case CANTP_PCI_CONSECUTIVE_FRAME:
+            if (length > 1u)
+            {
+                CanTp_RxConsecutiveFrame(htp, data, length, now);
+                status = CANTP_OK;
+            }
+            break;
+
+        case CANTP_PCI_FLOW_CONTROL:
+            if (length >= 3u)
+            {
+                CanTp_RxFlowControl(htp, data, now);
+                status = CANTP_OK;
+            }
+            break;
+
+        default:
+            /* Unknown protocol control information, frame ignored */
+            break;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief Start the transmission of a message.
+ * @param htp Pointer to the ISO-TP handle structure.
+ * @param data Message to send, it is copied so the caller can reuse it.
+ * @param size Message length (1 to CANTP_BUFFER_SIZE).
+ * @param now Current time in milliseconds.
+ * @return CANTP_OK if accepted, CANTP_BUSY if a transmission is running, CANTP_ERROR on invalid size.
+ */
+uint8_t CanTp_Transmit(CanTp_HandleTypeDef *htp, const uint8_t *data, uint16_t size, uint32_t now)
+{
+    uint8_t status = CANTP_OK;
+
+    if (htp->TxState != CANTP_TX_IDLE_STATE)
+    {
+        status = CANTP_BUSY;
+    }
+    else if ((size == 0u) || (size > CANTP_BUFFER_SIZE))
+    {
+        status = CANTP_ERROR;
+    }
+    else
+    {
+        for (uint16_t i = 0; i < size; i++)
+        {
+            htp->TxBuffer[i] = data[i];
+        }
+
+        htp->TxSize = size;
+        htp->TxIndex = 0;
+        htp->TxSn = 1;
+        htp->TxWaitCount = 0;
+        htp->TxTimer = now;
+        htp->TxResult = CANTP_RESULT_IN_PROGRESS;
+        htp->TxState = CANTP_TX_SEND_FIRST_STATE;
+
+        (void)CanTp_SendFirstFrame(htp, now); /* Retried from CanTp_Task if not accepted */
+    }
+
+    return status;
+}
+
+/**
+ * @brief Run the pending transport layer work (consecutive frames, flow control and timeouts).
+ * @param htp Pointer to the ISO-TP handle structure.
+ * @param now Current time in milliseconds.
+ */
+void CanTp_Task(CanTp_HandleTypeDef *htp, uint32_t now)
+{
+    /* Receiver side */
+    if (htp->RxFcPending != 0u)
+    {
+        if (CanTp_SendFlowControl(htp) == CANTP_OK)
+        {
+            htp->RxTimer = now; /* N_Cr starts once the flow control is on its way */
+        }
+        else if ((now - htp->RxTimer) >= CANTP_N_AR_TIMEOUT)
+        {
+            htp->RxFcPending = 0;
+            htp->RxResult = CANTP_RESULT_TIMEOUT_A;
+            htp->RxState = CANTP_RX_IDLE_STATE;
+        }
+    }
+    else if ((htp->RxState == CANTP_RX_WAIT_CF_STATE) && ((now - htp->RxTimer) >= CANTP_N_CR_TIMEOUT))
+    {
+        htp->RxResult = CANTP_RESULT_TIMEOUT_CR;
+        htp->RxState = CANTP_RX_IDLE_STATE;
+    }
+
+    /* Sender side */
+    switch (htp->TxState)
+    {
+    case CANTP_TX_SEND_FIRST_STATE:
+        if ((CanTp_SendFirstFrame(htp, now) != CANTP_OK) && ((now - htp->TxTimer) >= CANTP_N_AS_TIMEOUT))
+        {
+            htp->TxResult = CANTP_RESULT_TIMEOUT_A;
+            htp->TxState = CANTP_TX_IDLE_STATE;
+        }
+        break;
+
+    case CANTP_TX_WAIT_FC_STATE:
+        if ((now - htp->TxTimer) >= CANTP_N_BS_TIMEOUT)
+        {
+            htp->TxResult = CANTP_RESULT_TIMEOUT_BS;
+            htp->TxState = CANTP_TX_IDLE_STATE;
+        }
+        break;
+
+    case CANTP_TX_SEND_CF_STATE:
+        CanTp_SendConsecutiveFrames(htp, now);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Time until CanTp_Task has something to do on its own.
+ * @param htp Pointer to the ISO-TP handle structure.
+ * @param now Current time in milliseconds.
+ * @return Milliseconds left (0 if already due), CANTP_NO_DEADLINE if both directions are waiting for nothing.
+ */
+uint32_t CanTp_NextDeadline(const CanTp_HandleTypeDef *htp, uint32_t now)
+{
+    uint32_t rxLeft = CANTP_NO_DEADLINE;
+    uint32_t txLeft = CANTP_NO_DEADLINE;
+    uint32_t stminLeft;
+
+    /* Receiver side */
+    if (htp->RxFcPending != 0u)
+    {
+        rxLeft = CanTp_TimeLeft(htp->RxTimer, CANTP_N_AR_TIMEOUT, now);
+    }
+    else if (htp->RxState == CANTP_RX_WAIT_CF_STATE)
+    {
+        rxLeft = CanTp_TimeLeft(htp->RxTimer, CANTP_N_CR_TIMEOUT, now);
+    }
+
+    /* Sender side */
+    switch (htp->TxState)
+    {
+    case CANTP_TX_SEND_FIRST_STATE:
+        txLeft = CanTp_TimeLeft(htp->TxTimer, CANTP_N_AS_TIMEOUT, now);
+        break;
+
+    case CANTP_TX_WAIT_FC_STATE:
+        txLeft = CanTp_TimeLeft(htp->TxTimer, CANTP_N_BS_TIMEOUT, now);
+        break;
+
+    case CANTP_TX_SEND_CF_STATE:
+        txLeft = CanTp_TimeLeft(htp->TxTimer, CANTP_N_AS_TIMEOUT, now);
+        if (CanTp_SeparationElapsed(htp, now) == 0u)
+        {
+            /* Next consecutive frame is due once the separation time is over */
+            stminLeft = CanTp_TimeLeft(htp->TxLastFrame, htp->TxSTmin + 1u, now);
+            txLeft = (stminLeft < txLeft) ? stminLeft : txLeft;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return (rxLeft < txLeft) ? rxLeft : txLeft;
+}
+
+/**
+ * @brief Get the last message received.
+ * @param htp Pointer to the ISO-TP handle structure.
+ * @param size Pointer where the message length is written.
+ * @return Pointer to the message, NULL if no complete message is available.
+ */
+const uint8_t *CanTp_GetRxMessage(CanTp_HandleTypeDef *htp, uint16_t *size)
+{
+    const uint8_t *message = NULL;
+
+    if (htp->RxState == CANTP_RX_DONE_STATE)
+    {
+        *size = htp->RxSize;
+        message = htp->RxMessage;
+    }
+
+    return message;
+}
+
+/**
+ * @brief Release the message obtained with CanTp_GetRxMessage.
+ * @param htp Pointer to the ISO-TP handle structure.
+ */
+void CanTp_ReleaseRxMessage(CanTp_HandleTypeDef *htp)
+{
+    if (htp->RxState == CANTP_RX_DONE_STATE)
+    {
+        htp->RxState = CANTP_RX_IDLE_STATE;
+    }
+}
+
+/* Private functions */
+/**
+ * @brief Length of the smallest frame able to carry the given bytes
+ *
+ * Frames up to 8 bytes are always padded to 8, longer ones to the next length
+ * a CAN FD DLC can encode.
+ *
+ * @param used Number of bytes to carry (up to CANTP_FD_FRAME_SIZE)
+ * @return Frame length to send
+ */
+static uint8_t CanTp_FrameLength(uint8_t used)
+{
+    uint8_t length = CANTP_FRAME_SIZE;
+
+    for (uint8_t i = 0; (used > length) && (i < sizeof(CanTp_FdLengths)); i++)
+    {
+        length = CanTp_FdLengths[i];
+    }
+
+    return length;
+}
+
+/**
+ * @brief Biggest single frame payload for a frame length
+ * @param length Frame length
+ * @return 7 for classic frames, length - 2 for CAN FD frames (escaped length)
+ */
+static uint8_t CanTp_SingleFrameMax(uint8_t length)
+{
+    return (length > CANTP_FRAME_SIZE) ? (uint8_t)(length - 2u) : (uint8_t)CANTP_SF_MAX_DATA;
+}
+
+/**
+ * @brief Pad a frame and hand it to the user transmit function
+ * @param htp Pointer to the ISO-TP handle structure
+ * @param frame Frame buffer of CANTP_FD_FRAME_SIZE bytes
+ * @param used Number of bytes already written in the frame
+ * @return CANTP_OK if the frame was accepted for transmission
+ */
+static uint8_t CanTp_SendFrame(CanTp_HandleTypeDef *htp, uint8_t *frame, uint8_t used)
+{
+    uint8_t status = CANTP_ERROR;
+    uint8_t length = CanTp_FrameLength(used);
+
+    for (uint8_t i = used; i < length; i++)
+    {
+        frame[i] = CANTP_PADDING_BYTE;
+    }
+
+    if (htp->TxFrame != NULL)
+    {
+        status = htp->TxFrame(frame, length);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Send the single frame or the first frame of the message in TxBuffer
+ * @param htp Pointer to the ISO-TP handle structure
+ * @param now Current time in milliseconds
+ * @return CANTP_OK if the frame was accepted for transmission
+ */
+static uint8_t CanTp_SendFirstFrame(CanTp_HandleTypeDef *htp, uint32_t now)
+{
+    uint8_t frame[CANTP_FD_FRAME_SIZE];
+    uint8_t single = (htp->TxSize <= CanTp_SingleFrameMax(htp->FrameSize)) ? 1u : 0u;
+    uint8_t header;
+    uint8_t used;
+    uint8_t status;
+
+    if (single != 0u)
+    {
+        if (htp->TxSize <= CANTP_SF_MAX_DATA)
+        {
+            frame[0] = (CANTP_PCI_SINGLE_FRAME << 4) | (uint8_t)htp->TxSize;
+            header = 1u;
+        }
+        else
+        {
+            frame[0] = CANTP_PCI_SINGLE_FRAME << 4;
+            frame[1] = (uint8_t)htp->TxSize;
+            header = 2u;
+        }
+        for (uint8_t i = 0; i < htp->TxSize; i++)
+        {
+            frame[i + header] = htp->TxBuffer[i];
+        }
+        used = (uint8_t)(htp->TxSize + header);
+    }
+    else
+    {
+        frame[0] = (CANTP_PCI_FIRST_FRAME << 4) | (uint8_t)((htp->TxSize >> 8) & NIBBLE_LSB_EXTRACTOR);
+        frame[1] = (uint8_t)(htp->TxSize & 0xFFu);
+        for (uint8_t i = 0; i < (htp->FrameSize - 2u); i++)
+        {
+            frame[i + 2u] = htp->TxBuffer[i];
+        }
+        used = htp->FrameSize;
+    }
+
+    status = CanTp_SendFrame(htp, frame, used);
+
+    if (status == CANTP_OK)
+    {
+        if (single != 0u)
+        {
+            htp->TxIndex = htp->TxSize;
+            htp->TxResult = CANTP_RESULT_OK;
+            htp->TxState = CANTP_TX_IDLE_STATE;
+        }
+        else
+        {
+            htp->TxIndex = htp->FrameSize - 2u;
+            htp->TxTimer = now; /* N_Bs: wait for the receiver flow control */
+            htp->TxState = CANTP_TX_WAIT_FC_STATE;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief Send as many consecutive frames as STmin, block size and the hardware allow
+ * @param htp Pointer to the ISO-TP handle structure
+ * @param now Current time in milliseconds
+ */
+static void CanTp_SendConsecutiveFrames(CanTp_HandleTypeDef *htp, uint32_t now)
+{
+    uint8_t frame[CANTP_FD_FRAME_SIZE];
+    uint8_t maxChunk = htp->FrameSize - 1u;
+    uint16_t remaining;
+    uint8_t chunk;
+    uint8_t sending = 1;
+
+    while ((sending != 0u) && (CanTp_SeparationElapsed(htp, now) != 0u))
+    {
+        remaining = htp->TxSize - htp->TxIndex;
+        chunk = (remaining > maxChunk) ? maxChunk : (uint8_t)remaining;
+
+        frame[0] = (CANTP_PCI_CONSECUTIVE_FRAME << 4) | htp->TxSn;
+        for (uint8_t i = 0; i < chunk; i++)
+        {
+            frame[i + 1u] = htp->TxBuffer[htp->TxIndex + i];
+        }
+
+        if (CanTp_SendFrame(htp, frame, (uint8_t)(chunk + 1u)) != CANTP_OK)
+        {
+            /* Hardware busy, retry on the next call until N_As expires */
+            if ((now - htp->TxTimer) >= CANTP_N_AS_TIMEOUT)
+            {
+                htp->TxResult = CANTP_RESULT_TIMEOUT_A;
+                htp->TxState = CANTP_TX_IDLE_STATE;
+            }
+            sending = 0;
+        }
+        else
+        {
+            htp->TxIndex += chunk;
+            htp->TxSn = (htp->TxSn + 1u) & NIBBLE_LSB_EXTRACTOR;
+            htp->TxLastFrame = now;
+            htp->TxTimer = now;
+
+            if (htp->TxIndex >= htp->TxSize)
+            {
+                htp->TxResult = CANTP_RESULT_OK;
+                htp->TxState = CANTP_TX_IDLE_STATE;
+                sending = 0;
+            }
+            else if ((htp->TxBlockSize != 0u) && (++htp->TxBlockCount >= htp->TxBlockSize))
+            {
+                htp->TxState = CANTP_TX_WAIT_FC_STATE; /* End of block, N_Bs starts */
+                sending = 0;
+            }
+            else if (htp->TxSTmin != 0u)
+            {
+                sending = 0; /* Next frame on a later call */
+            }
+        }
+    }
+}
+
+/**
+ * @brief Send the pending flow control frame
+ * @param htp Pointer to the ISO-TP handle structure
+ * @return CANTP_OK if the frame was accepted for transmission
+ */
+static uint8_t CanTp_SendFlowControl(CanTp_HandleTypeDef *htp)
+{
+    uint8_t frame[CANTP_FD_FRAME_SIZE];
+    uint8_t status;
+
+    frame[0] = (CANTP_PCI_FLOW_CONTROL << 4) | htp->RxFcStatus;
+    frame[1] = htp->BlockSize;
+    frame[2] = htp->STmin;
+
+    status = CanTp_SendFrame(htp, frame, 3);
+
+    if (status == CANTP_OK)
+    {
+        htp->RxFcPending = 0;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Queue a flow control frame and try to send it right away
+ * @param htp Pointer to the ISO-TP handle structure
+ * @param flowStatus Flow status to send
+ * @param now Current time in milliseconds
+ */
+static void CanTp_QueueFlowControl(CanTp_HandleTypeDef *htp, uint8_t flowStatus, uint32_t now)
+{
+    htp->RxFcStatus = flowStatus;
+    htp->RxFcPending = 1;
+    htp->RxTimer = now; /* N_Ar while pending, N_Cr once sent */
+
+    (void)CanTp_SendFlowControl(htp); /* Retried from CanTp_Task if not accepted */
+}
+
+/**
+ * @brief Handle a single frame, the message is left in the frame payload
+ * @param htp Pointer to the ISO-TP handle structure
+ * @param data Frame payload after the protocol control information
+ * @param size Payload length
+ */
+static void CanTp_RxSingleFrame(CanTp_HandleTypeDef *htp, const uint8_t *data, uint8_t size)
+{
+    /* The previous message has not been consumed yet, the new one is dropped */
+    if (htp->RxState != CANTP_RX_DONE_STATE)
+    {
+        /* A single frame in the middle of a segmented reception aborts it */
+        htp->RxFcPending = 0;
+
+        htp->RxMessage = data;
+        htp->RxSize = size;
+        htp->RxIndex = size;
+        htp->RxResult = CANTP_RESULT_OK;
+        htp->RxState = CANTP_RX_DONE_STATE;
+    }
+}
+
+/**
+ * @brief Handle a first frame, answering with a flow control
+ * @param htp Pointer to the ISO-TP handle structure
+ * @param data Frame payload after the protocol control information
+ * @param chunk Message bytes carried by the first frame
+ * @param size Length of the whole message
+ * @param now Current time in milliseconds
+ */
+static void CanTp_RxFirstFrame(CanTp_HandleTypeDef *htp, const uint8_t *data, uint8_t chunk, uint16_t size, uint32_t now)
+{
+    if (htp->RxState != CANTP_RX_DONE_STATE)
+    {
+        if (size > CANTP_BUFFER_SIZE)
+        {
+            htp->RxResult = CANTP_RESULT_BUFFER_OVFLW;
+            htp->RxState = CANTP_RX_IDLE_STATE;
+            CanTp_QueueFlowControl(htp, CANTP_FS_OVFLW, now);
+        }
+        else
+        {
+            for (uint8_t i = 0; i < chunk; i++)
+            {
+                htp->RxBuffer[i] = data[i];
+            }
+
+            htp->RxMessage = htp->RxBuffer;
+            htp->RxSize = size;
+            htp->RxIndex = chunk;
+            htp->RxSn = 1;
+            htp->RxBlockCount = 0;
+            htp->RxResult = CANTP_RESULT_IN_PROGRESS;
+            htp->RxState = CANTP_RX_WAIT_CF_STATE;
+            CanTp_QueueFlowControl(htp, CANTP_FS_CTS, now);
+        }
+    }
+}
+
+/**
+ * @brief Handle a consecutive frame
+ * @param htp Pointer to the ISO-TP handle structure
+ * @param data Whole frame payload
+ * @param length Frame length
+ * @param now Current time in milliseconds
+ */
+static void CanTp_RxConsecutiveFrame(CanTp_HandleTypeDef *htp, const uint8_t *data, uint8_t length, uint32_t now)
+{
+    uint16_t remaining;
+    uint8_t chunk;
+
+    /* Consecutive frames are only expected after our flow control was sent */
+    if ((htp->RxState == CANTP_RX_WAIT_CF_STATE) && (htp->RxFcPending == 0u))
+    {
+        if ((data[0] & NIBBLE_LSB_EXTRACTOR) != htp->RxSn)
+        {
+            htp->RxResult = CANTP_RESULT_WRONG_SN;
+            htp->RxState = CANTP_RX_IDLE_STATE;
+        }
+        else
+        {
+            remaining = htp->RxSize - htp->RxIndex;
+            chunk = (uint8_t)(length - 1u);
+            chunk = (remaining > chunk) ? chunk : (uint8_t)remaining;
+
+            for (uint8_t i = 0; i < chunk; i++)
+            {
+                htp->RxBuffer[htp->RxIndex + i] = data[i + 1u];
+            }
+
+            htp->RxIndex += chunk;
+            htp->RxSn = (htp->RxSn + 1u) & NIBBLE_LSB_EXTRACTOR;
+            htp->RxTimer = now;
+
+            if (htp->RxIndex >= htp->RxSize)
+            {
+                htp->RxResult = CANTP_RESULT_OK;
+                htp->RxState = CANTP_RX_DONE_STATE;
+            }
+            else if ((htp->BlockSize != 0u) && (++htp->RxBlockCount >= htp->BlockSize))
+            {
+                htp->RxBlockCount = 0;
+                CanTp_QueueFlowControl(htp, CANTP_FS_CTS, now);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Handle a flow control frame sent by the receiver of our message
+ * @param htp Pointer to the ISO-TP handle structure
+ * @param data Whole frame payload
+ * @param now Current time in milliseconds
+ */
+static void CanTp_RxFlowControl(CanTp_HandleTypeDef *htp, const uint8_t *data, uint32_t now)
+{
+    if (htp->TxState == CANTP_TX_WAIT_FC_STATE)
+    {
+        switch (data[0] & NIBBLE_LSB_EXTRACTOR)
+        {
+        case CANTP_FS_CTS:
+            htp->TxBlockSize = data[1];
+            htp->TxSTmin = CanTp_DecodeSTmin(data[2]);
+            htp->TxBlockCount = 0;
+            htp->TxWaitCount = 0;
+            htp->TxTimer = now;
+            htp->TxLastFrame = now - htp->TxSTmin - 1u; /* First frame of the block goes right away */
+            htp->TxState = CANTP_TX_SEND_CF_STATE;
+            break;
+
+        case CANTP_FS_WAIT:
+            if (++htp->TxWaitCount > CANTP_MAX_WFT)
+            {
+                htp->TxResult = CANTP_RESULT_WFT_OVRN;
+                htp->TxState = CANTP_TX_IDLE_STATE;
+            }
+            else
+            {
+                htp->TxTimer = now; /* N_Bs restarts */
+            }
+            break;
+
+        case CANTP_FS_OVFLW:
+            htp->TxResult = CANTP_RESULT_BUFFER_OVFLW;
+            htp->TxState = CANTP_TX_IDLE_STATE;
+            break;
+
+        default:
+            htp->TxResult = CANTP_RESULT_INVALID_FS;
+            htp->TxState = CANTP_TX_IDLE_STATE;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Convert the STmin parameter into milliseconds
+ *
+ * Values in the 100 us to 900 us range are rounded up to one millisecond, the
+ * resolution of the time base, and reserved values are treated as 127 ms.
+ *
+ * @param stmin STmin as received in the flow control frame
+ * @return Separation time in milliseconds
+ */
+static uint32_t CanTp_DecodeSTmin(uint8_t stmin)
+{
+    uint32_t milliseconds = 0x7Fu;
+
+    if (stmin <= 0x7Fu)
+    {
+        milliseconds = stmin;
+    }
+    else if ((stmin >= 0xF1u) && (stmin <= 0xF9u))
+    {
+        milliseconds = 1u;
+    }
+
+    return milliseconds;
+}
+
+/**
+ * @brief Milliseconds left before a timeout expires
+ * @param start Time the timeout was started
+ * @param timeout Timeout length in milliseconds
+ * @param now Current time in milliseconds
+ * @return Milliseconds left, 0 if already expired
+ */
+static uint32_t CanTp_TimeLeft(uint32_t start, uint32_t timeout, uint32_t now)
+{
+    uint32_t elapsed = now - start;
+
+    return (elapsed >= timeout) ? 0u : (timeout - elapsed);
+}
+
+/**
+ * @brief Check if the separation time requested by the receiver is over
+ *
+ * The tick is 1 ms, a frame sent late in a tick and the next one early in
+ * the tick STmin later would be less than STmin apart, so a non zero STmin
+ * waits one more tick.
+ *
+ * @param htp Pointer to the ISO-TP handle structure
+ * @param now Current time in milliseconds
+ * @return 1 if the next consecutive frame can be sent, 0 otherwise
+ */
+static uint8_t CanTp_SeparationElapsed(const CanTp_HandleTypeDef *htp, uint32_t now)
+{
+    return ((htp->TxSTmin == 0u) || ((now - htp->TxLastFrame) > htp->TxSTmin)) ? 1u : 0u;
+}
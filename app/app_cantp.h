@@ -0,0 +1,234 @@
+#ifndef __APP_CANTP_H__
+#define __APP_CANTP_H__
+
+#include <stdint.h>
+
+/**
+ * @file app_cantp.h
+ * @brief ISO 15765-2 (ISO-TP) transport layer.
+ *
+ * Segments and reassembles messages bigger than a single CAN frame using
+ * first frames, consecutive frames and flow control frames. The engine never
+ * blocks: received frames are handed over with CanTp_RxIndication and the
+ * pending work (consecutive frames, flow control, timeouts) is done every time
+ * CanTp_Task is called. Nothing polls it: the caller runs it when a frame
+ * arrives and when the time given by CanTp_NextDeadline is up (Serial_Task,
+ * woken by its SerialTpTimer software timer). The frames are sent through the
+ * TxFrame callback given by the user.
+ */
+
+/**
+ * @brief Size of the reception and transmission buffers (maximum message length).
+ */
+#ifndef CANTP_BUFFER_SIZE
+#define CANTP_BUFFER_SIZE 512u
+#endif
+
+/**
+ * @brief Length of a classic CAN frame, default frame length of the transport layer.
+ */
+#define CANTP_FRAME_SIZE 8u
+
+/**
+ * @brief Length of the biggest CAN FD frame.
+ */
+#define CANTP_FD_FRAME_SIZE 64u
+
+/**
+ * @brief Value used to fill the unused bytes of the frames.
+ */
+#ifndef CANTP_PADDING_BYTE
+#define CANTP_PADDING_BYTE 0x00u
+#endif
+
+/* Network layer timeouts in milliseconds (ISO 15765-2 default values) */
+#ifndef CANTP_N_AS_TIMEOUT
+#define CANTP_N_AS_TIMEOUT 1000u    /**< Sender: time to get a frame accepted for transmission */
+#endif
+#ifndef CANTP_N_AR_TIMEOUT
+#define CANTP_N_AR_TIMEOUT 1000u    /**< Receiver: time to get a flow control accepted for transmission */
+#endif
+#ifndef CANTP_N_BS_TIMEOUT
+#define CANTP_N_BS_TIMEOUT 1000u    /**< Sender: time waiting for a flow control frame */
+#endif
+#ifndef CANTP_N_CR_TIMEOUT
+#define CANTP_N_CR_TIMEOUT 1000u    /**< Receiver: time waiting for the next consecutive frame */
+#endif
+
+/**
+ * @brief Maximum number of consecutive WAIT flow control frames accepted.
+ */
+#ifndef CANTP_MAX_WFT
+#define CANTP_MAX_WFT 10u
+#endif
+
+#define CANTP_OK      0x00U
+#define CANTP_ERROR   0x01U
+#define CANTP_BUSY    0x02U
+
+/**
+ * @brief Value returned by CanTp_NextDeadline when no timeout is running.
+ */
+#define CANTP_NO_DEADLINE 0xFFFFFFFFUL
+
+/**
+ * @brief Function used by the engine to send one CAN frame.
+ * @param data Frame payload, including the protocol control information.
+ * @param length Number of bytes to send.
+ * @return CANTP_OK if the frame was accepted for transmission, CANTP_ERROR otherwise.
+ */
+typedef uint8_t (*CanTp_TxFrameCallback)(const uint8_t *data, uint8_t length);
+
+/**
+ * @brief Result of the last reception or transmission.
+ */
+typedef enum
+{
+    CANTP_RESULT_OK = 0,        /**< Message transferred */
+    CANTP_RESULT_IN_PROGRESS,   /**< Transfer still running */
+    CANTP_RESULT_TIMEOUT_A,     /**< Frame could not be sent in time (N_As / N_Ar) */
+    CANTP_RESULT_TIMEOUT_BS,    /**< No flow control received in time */
+    CANTP_RESULT_TIMEOUT_CR,    /**< No consecutive frame received in time */
+    CANTP_RESULT_WRONG_SN,      /**< Consecutive frame with unexpected sequence number */
+    CANTP_RESULT_INVALID_FS,    /**< Flow control with unknown flow status */
+    CANTP_RESULT_WFT_OVRN,      /**< Too many WAIT flow control frames */
+    CANTP_RESULT_BUFFER_OVFLW,  /**< Message does not fit in the buffer */
+    CANTP_RESULT_UNEXP_PDU      /**< Frame not expected in the current state */
+} CanTp_ResultTypeDef;
+
+/**
+ * @brief Reception states.
+ */
+typedef enum
+{
+    CANTP_RX_IDLE_STATE,        /**< Waiting for a single or first frame */
+    CANTP_RX_WAIT_CF_STATE,     /**< Receiving consecutive frames */
+    CANTP_RX_DONE_STATE         /**< Message complete, waiting to be released */
+} CanTp_RxStates;
+
+/**
+ * @brief Transmission states.
+ */
+typedef enum
+{
+    CANTP_TX_IDLE_STATE,        /**< Nothing to send */
+    CANTP_TX_SEND_FIRST_STATE,  /**< Single or first frame waiting to be accepted */
+    CANTP_TX_WAIT_FC_STATE,     /**< Waiting for a flow control frame */
+    CANTP_TX_SEND_CF_STATE      /**< Sending consecutive frames */
+} CanTp_TxStates;
+
+/**
+ * @brief ISO-TP handler structure.
+ *
+ * TxFrame, FrameSize, BlockSize and STmin are set by the user before calling
+ * CanTp_Init, the rest of the fields are internal to the engine.
+ */
+typedef struct
+{
+    CanTp_TxFrameCallback TxFrame;      /**< Function to send a frame */
+    uint8_t FrameSize;                  /**< Frames sent (TX_DL): 8 for classic CAN, 12 to 64 for CAN FD */
+    uint8_t BlockSize;                  /**< Block size announced in our flow control frames */
+    uint8_t STmin;                      /**< Separation time announced in our flow control frames */
+
+    CanTp_RxStates RxState;             /**< Reception state */
+    CanTp_ResultTypeDef RxResult;       /**< Result of the last reception */
+    uint8_t RxBuffer[CANTP_BUFFER_SIZE];/**< Reassembled message */
+    const uint8_t *RxMessage;           /**< Message delivered: RxBuffer, or the payload of its single frame */
+    uint16_t RxSize;                    /**< Length of the message being received */
+    uint16_t RxIndex;                   /**< Bytes received so far */
+    uint8_t RxSn;                       /**< Next expected sequence number */
+    uint8_t RxBlockCount;               /**< Consecutive frames received in the current block */
+    uint8_t RxFcPending;                /**< Flow control frame waiting to be sent */
+    uint8_t RxFcStatus;                 /**< Flow status of the pending flow control */
+    uint32_t RxTimer;                   /**< Start time of the running reception timeout */
+
+    CanTp_TxStates TxState;             /**< Transmission state */
+    CanTp_ResultTypeDef TxResult;       /**< Result of the last transmission */
+    uint8_t TxBuffer[CANTP_BUFFER_SIZE];/**< Message being sent */
+    uint16_t TxSize;                    /**< Length of the message being sent */
+    uint16_t TxIndex;                   /**< Bytes sent so far */
+    uint8_t TxSn;                       /**< Sequence number of the next consecutive frame */
+    uint8_t TxBlockSize;                /**< Block size requested by the receiver */
+    uint8_t TxBlockCount;               /**< Consecutive frames sent in the current block */
+    uint8_t TxWaitCount;                /**< WAIT flow control frames received in a row */
+    uint32_t TxSTmin;                   /**< Separation time requested by the receiver in ms */
+    uint32_t TxTimer;                   /**< Start time of the running transmission timeout */
+    uint32_t TxLastFrame;               /**< Time the last consecutive frame was sent */
+} CanTp_HandleTypeDef;
+
+/**
+ * @brief Initialize the transport layer, both directions become idle.
+ * @param htp Pointer to the ISO-TP handle structure.
+ */
+void CanTp_Init(CanTp_HandleTypeDef *htp);
+
+/**
+ * @brief Process a received CAN frame.
+ *
+ * A single frame is not copied, the message delivered points into its
+ * payload, so the frame must stay untouched until CanTp_ReleaseRxMessage.
+ *
+ * @param htp Pointer to the ISO-TP handle structure.
+ * @param data Frame payload.
+ * @param length Number of bytes in the frame.
+ * @param now Current time in milliseconds.
+ * @return CANTP_OK if the frame was a valid ISO-TP frame, CANTP_ERROR otherwise.
+ */
+uint8_t CanTp_RxIndication(CanTp_HandleTypeDef *htp, const uint8_t *data, uint8_t length, uint32_t now);
+
+/**
+ * @brief Start the transmission of a message.
+ *
+ * Messages that fit in one frame (7 bytes, or FrameSize - 2 with CAN FD) go in a
+ * single frame, longer ones are segmented and sent from CanTp_Task following
+ * the receiver flow control.
+ *
+ * @param htp Pointer to the ISO-TP handle structure.
+ * @param data Message to send, it is copied so the caller can reuse it.
+ * @param size Message length (1 to CANTP_BUFFER_SIZE).
+ * @param now Current time in milliseconds.
+ * @return CANTP_OK if accepted, CANTP_BUSY if a transmission is running, CANTP_ERROR on invalid size.
+ */
+uint8_t CanTp_Transmit(CanTp_HandleTypeDef *htp, const uint8_t *data, uint16_t size, uint32_t now);
+
+/**
+ * @brief Run the pending transport layer work (consecutive frames, flow control and timeouts).
+ * @param htp Pointer to the ISO-TP handle structure.
+ * @param now Current time in milliseconds.
+ */
+void CanTp_Task(CanTp_HandleTypeDef *htp, uint32_t now);
+
+/**
+ * @brief Time until CanTp_Task has something to do on its own.
+ *
+ * Covers the running timeouts (N_As, N_Ar, N_Bs, N_Cr) and the separation
+ * time between consecutive frames, and is meant to be asked right after
+ * CanTp_Task. Frames refused by the hardware are not included, the caller is
+ * expected to run CanTp_Task again once a transmit slot gets free.
+ *
+ * @param htp Pointer to the ISO-TP handle structure.
+ * @param now Current time in milliseconds.
+ * @return Milliseconds left (0 if already due), CANTP_NO_DEADLINE if both directions are waiting for nothing.
+ */
+uint32_t CanTp_NextDeadline(const CanTp_HandleTypeDef *htp, uint32_t now);
+
+/**
+ * @brief Get the last message received.
+ *
+ * The buffer belongs to the caller until CanTp_ReleaseRxMessage is called,
+ * new single or first frames are ignored meanwhile. For a message that came
+ * in a single frame it is the payload of that frame.
+ *
+ * @param htp Pointer to the ISO-TP handle structure.
+ * @param size Pointer where the message length is written.
+ * @return Pointer to the message, NULL if no complete message is available.
+ */
+const uint8_t *CanTp_GetRxMessage(CanTp_HandleTypeDef *htp, uint16_t *size);
+
+/**
+ * @brief Release the message obtained with CanTp_GetRxMessage.
+ * @param htp Pointer to the ISO-TP handle structure.
+ */
+void CanTp_ReleaseRxMessage(CanTp_HandleTypeDef *htp);
+
+#endif // __APP_CANTP_H__
@@ -0,0 +1,153 @@
+/**
+ * @file app_cantx.c
+ * @brief Software priority queue of CAN frames waiting for the TX FIFO.
+ */
+
+#include "app_cantx.h"
+#include <stddef.h>
+
+#define CAN_TX_EXT_ID_BITS 18u  /* Identifier extension of the extended frames */
+
+static uint32_t CanTx_Priority(const APP_CanFrameTypeDef *frame);
+
+/**
+ * @brief Initialize (empty) the queue and clear its statistics.
+ * @param htx Pointer to the queue handle structure.
+ */
+void CanTx_Init(CanTx_HandleTypeDef *htx)
+{
+    for (uint8_t i = 0; i < CAN_TX_QUEUE_SIZE; i++)
+    {
+        htx->Free[i] = i;
+    }
+
+    htx->Depth = 0;
+    htx->Stats.Queued = 0;
+    htx->Stats.Sent = 0;
+    htx->Stats.Dropped = 0;
+    htx->Stats.MaxDepth = 0;
+}
+
+/**
+ * @brief Copy a frame into the queue, behind the frames with the same or higher priority.
+ * @param htx Pointer to the queue handle structure.
+ * @param frame Pointer to the frame to send.
+ * @return CANTX_OK if queued, CANTX_ERROR if the queue is full.
+ */
+uint8_t CanTx_Push(CanTx_HandleTypeDef *htx, const APP_CanFrameTypeDef *frame)
+{
+    uint8_t status = CANTX_ERROR;
+    uint32_t priority;
+    uint8_t position;
+    uint8_t slot;
+
+    if (htx->Depth < CAN_TX_QUEUE_SIZE)
+    {
+        /* Free slots are taken from the end of the free table */
+        slot = htx->Free[CAN_TX_QUEUE_SIZE - 1u - htx->Depth];
+        htx->Frames[slot] = *frame;
+
+        /* Open a hole after the last frame that does not lose the arbitration against the new one */
+        priority = CanTx_Priority(frame);
+        position = htx->Depth;
+        while ((position > 0u) && (CanTx_Priority(&htx->Frames[htx->Order[position - 1u]]) > priority))
+        {
+            htx->Order[position] = htx->Order[position - 1u];
+            position--;
+        }
+
+        htx->Order[position] = slot;
+        htx->Depth++;
+        htx->Stats.Queued++;
+
+        if (htx->Depth > htx->Stats.MaxDepth)
+        {
+            htx->Stats.MaxDepth = htx->Depth;
+        }
+
+        status = CANTX_OK;
+    }
+    else
+    {
+        htx->Stats.Dropped++;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Get the frame with the highest priority without removing it.
+ * @param htx Pointer to the queue handle structure.
+ * @return Pointer to the frame, NULL if the queue is empty.
+ */
+const APP_CanFrameTypeDef *CanTx_Peek(const CanTx_HandleTypeDef *htx)
+{
+    const APP_CanFrameTypeDef *frame = NULL;
+
+    if (htx->Depth > 0u)
+    {
+        frame = &htx->Frames[htx->Order[0]];
+    }
+
+    return frame;
+}
+
+/**
+ * @brief Remove the frame returned by CanTx_Peek once the hardware took it.
+ * @param htx Pointer to the queue handle structure.
+ */
+void CanTx_Release(CanTx_HandleTypeDef *htx)
+{
+    uint8_t slot;
+
+    if (htx->Depth > 0u)
+    {
+        slot = htx->Order[0];
+
+        for (uint8_t i = 1; i < htx->Depth; i++)
+        {
+            htx->Order[i - 1u] = htx->Order[i];
+        }
+
+        htx->Depth--;
+        htx->Free[CAN_TX_QUEUE_SIZE - 1u - htx->Depth] = slot;
+        htx->Stats.Sent++;
+    }
+}
+
+/**
+ * @brief Number of frames waiting.
+ * @param htx Pointer to the queue handle structure.
+ * @return Number of frames in the queue.
+ */
+uint32_t CanTx_Depth(const CanTx_HandleTypeDef *htx)
+{
+    return htx->Depth;
+}
+
+/**
+ * @brief Arbitration field of a frame as a number, the lower one wins the bus
+ *
+ * The base identifier comes first, then the IDE bit (recessive for extended
+ * frames) and then the identifier extension.
+ *
+ * @param frame Frame
+ * @return Priority key
+ */
+static uint32_t CanTx_Priority(const APP_CanFrameTypeDef *frame)
+{
+    uint32_t key;
+
+    if (frame->IdType == 0u)
+    {
+        key = (frame->Identifier & 0x7FFu) << (CAN_TX_EXT_ID_BITS + 1u);
+    }
+    else
+    {
+        key = ((frame->Identifier >> CAN_TX_EXT_ID_BITS) & 0x7FFu) << (CAN_TX_EXT_ID_BITS + 1u);
+        key |= 1uL << CAN_TX_EXT_ID_BITS;
+        key |= frame->Identifier & ((1uL << CAN_TX_EXT_ID_BITS) - 1u);
+    }
+
+    return key;
+}
@@ -0,0 +1,100 @@
+#ifndef __APP_CANTX_H__
+#define __APP_CANTX_H__
+
+#include <stdint.h>
+#include "app_canring.h"
+
+/**
+ * @file app_cantx.h
+ * @brief Software priority queue of CAN frames waiting for the TX FIFO.
+ *
+ * The hardware TX FIFO only has three elements, the frames that do not fit
+ * wait here until the TX complete interrupt moves them to the FIFO. They come
+ * out in bus arbitration order, lowest identifier first (a standard frame
+ * before an extended one with the same base identifier), and frames with the
+ * same identifier keep the order they were queued in, so the segments of a
+ * transport layer message are never swapped. The frames stay in their slot,
+ * only a table of slot numbers is kept sorted.
+ *
+ * The queue is used from the tasks and from the TX interrupt, the caller must
+ * mask the interrupts around every call.
+ */
+
+/**
+ * @brief Number of frames the queue can hold.
+ *
+ * It can be overridden from the compiler command line (-DCAN_TX_QUEUE_SIZE=32).
+ */
+#ifndef CAN_TX_QUEUE_SIZE
+#define CAN_TX_QUEUE_SIZE 16u
+#endif
+
+#if (CAN_TX_QUEUE_SIZE < 1u) || (CAN_TX_QUEUE_SIZE > 255u)
+#error "CAN_TX_QUEUE_SIZE must be between 1 and 255"
+#endif
+
+#define CANTX_OK      0x00U
+#define CANTX_ERROR   0x01U
+
+/**
+ * @brief Queue statistics.
+ */
+typedef struct
+{
+    uint32_t Queued;    /**< Frames accepted */
+    uint32_t Sent;      /**< Frames handed to the hardware */
+    uint32_t Dropped;   /**< Pushes refused because the queue was full, a caller may retry the same frame */
+    uint32_t MaxDepth;  /**< Maximum number of frames waiting at once */
+} CanTx_StatsTypeDef;
+
+/**
+ * @brief Queue handler structure.
+ */
+typedef struct
+{
+    APP_CanFrameTypeDef Frames[CAN_TX_QUEUE_SIZE];  /**< Frame storage */
+    uint8_t Order[CAN_TX_QUEUE_SIZE];   /**< Slots in use, highest priority first */
+    uint8_t Free[CAN_TX_QUEUE_SIZE];    /**< Slots not in use */
+    uint8_t Depth;                      /**< Number of frames waiting */
+    CanTx_StatsTypeDef Stats;           /**< Queue statistics */
+} CanTx_HandleTypeDef;
+
+/**
+ * @brief Initialize (empty) the queue and clear its statistics.
+ * @param htx Pointer to the queue handle structure.
+ */
+void CanTx_Init(CanTx_HandleTypeDef *htx);
+
+/**
+ * @brief Copy a frame into the queue, behind the frames with the same or higher priority.
+ * @param htx Pointer to the queue handle structure.
+ * @param frame Pointer to the frame to send, the timestamp is not used.
+ * @return CANTX_OK if queued, CANTX_ERROR if the queue is full (counted as dropped).
+ */
+uint8_t CanTx_Push(CanTx_HandleTypeDef *htx, const APP_CanFrameTypeDef *frame);
+
+/**
+ * @brief Get the frame with the highest priority without removing it.
+ *
+ * The frame stays in the queue until CanTx_Release is called, so it is not
+ * lost if the hardware does not take it.
+ *
+ * @param htx Pointer to the queue handle structure.
+ * @return Pointer to the frame, NULL if the queue is empty.
+ */
+const APP_CanFrameTypeDef *CanTx_Peek(const CanTx_HandleTypeDef *htx);
+
+/**
+ * @brief Remove the frame returned by CanTx_Peek once the hardware took it.
+ * @param htx Pointer to the queue handle structure.
+ */
+void CanTx_Release(CanTx_HandleTypeDef *htx);
+
+/**
+ * @brief Number of frames waiting.
+ * @param htx Pointer to the queue handle structure.
+ * @return Number of frames in the queue.
+ */
+uint32_t CanTx_Depth(const CanTx_HandleTypeDef *htx);
+
+#endif // __APP_CANTX_H__
@@ -5,12 +5,24 @@
 
 #include "app_bsp.h"
 #include "app_clock.h"
+#include "app_sched.h"
+#include "app_bench.h"
+#include "app_serial.h"
+#include "app_queue.h"
 #include <stdio.h>
 
 #define PRESCALER_1 0x7F
 #define PRESCALER_2 0xFF
 
+#define CLOCK_SECONDS_PER_DAY 86400u
+#define CLOCK_WAKEUP_COUNTER 0u /* Wakeup every (0 + 1) ticks of the 1 Hz ck_spre clock */
+
 /* Function prototypes */
+static void Clock_CacheUpdate(void);
+static void Clock_UpdateTime(const APP_MsgTypeDef *message);
+static void Clock_UpdateDate(const APP_MsgTypeDef *message);
+static void Clock_UpdateAlarm(const APP_MsgTypeDef *message);
+static void Clock_PostAlarmEvent(void);
 /* static void Display_RTC_Data(RTC_TimeTypeDef *time, RTC_DateTypeDef *date, RTC_AlarmTypeDef *alarm); */
 
 /* RTC-related structures and variables */
@@ -21,11 +33,35 @@ RTC_AlarmTypeDef sAlarm = {0};         /* RTC alarm handler variable */
 
 /* Add more includes as needed */
 
-/* Application message structure */
-APP_MsgTypeDef Msg;
+/* Validated commands posted by Serial_Task */
+Queue_HandleTypeDef ClockQueue;
+static APP_MsgTypeDef ClockMessages[CLOCK_QUEUE_DEPTH];
+
+/* Messages applied, broadcast by CAN_Task */
+Queue_HandleTypeDef CANQueue;
+static APP_MsgTypeDef CANMessages[CAN_QUEUE_DEPTH];
+
+/* Current time and date for the display, refreshed every second */
+Queue_HandleTypeDef DisplayQueue;
+static APP_MsgTypeDef DisplayMessages[DISPLAY_QUEUE_DEPTH];
+
+extern Sched_HandleTypeDef Scheduler; /* Scheduler running the tasks */
+extern Bench_HandleTypeDef Bench;     /* Execution time probes */
 
-/* Application message structure for CAN application */
-APP_MsgTypeDef CANMsg;
+static volatile uint8_t ClockRefresh = 0; /* Set by the wakeup interrupt, served by Clock_Task */
+static volatile uint8_t ClockAlarm = 0;   /* Set by the alarm A interrupt, served by Clock_Task */
+
+/* Calendar read from the RTC on every second and after every change */
+static volatile APP_ClockTypeDef ClockCache;
+
+/* How each message type is applied, indexed by APP_Messages, NULL if the clock has nothing to do */
+static void (*const ClockUpdates[])(const APP_MsgTypeDef *message) =
+{
+    NULL,               /* SERIAL_MSG_NONE */
+    Clock_UpdateTime,   /* SERIAL_MSG_TIME */
+    Clock_UpdateDate,   /* SERIAL_MSG_DATE */
+    Clock_UpdateAlarm   /* SERIAL_MSG_ALARM */
+};
 
 /* Functions */
 /**
@@ -33,6 +69,10 @@ APP_MsgTypeDef CANMsg;
  */
 void Clock_Init(void)
 {
+   Queue_Init(&ClockQueue, ClockMessages, sizeof(ClockMessages[0]), CLOCK_QUEUE_DEPTH);
+   Queue_Init(&CANQueue, CANMessages, sizeof(CANMessages[0]), CAN_QUEUE_DEPTH);
+   Queue_Init(&DisplayQueue, DisplayMessages, sizeof(DisplayMessages[0]), DISPLAY_QUEUE_DEPTH);
+
    hrtc.Instance = RTC; /* Specify the RTC instance */
    hrtc.Init.HourFormat = RTC_HOURFORMAT_24; /* Use 24-hour format */
    hrtc.Init.AsynchPrediv = PRESCALER_1; /* Asynchronous prescaler value - for LSE: 127 */
@@ -52,6 +92,57 @@ void Clock_Init(void)
    sDate.WeekDay = RTC_WEEKDAY_WEDNESDAY;
    sDate.Year = 0x23;
    HAL_RTC_SetDate(&hrtc, &sDate, RTC_FORMAT_BCD);
+
+   /* Alarm A goes off every day at the hours and minutes of the alarm messages, second 0 */
+   sAlarm.Alarm = RTC_ALARM_A;
+   sAlarm.AlarmMask = RTC_ALARMMASK_DATEWEEKDAY;
+   sAlarm.AlarmSubSecondMask = RTC_ALARMSUBSECONDMASK_ALL;
+   sAlarm.AlarmDateWeekDaySel = RTC_ALARMDATEWEEKDAYSEL_DATE;
+   sAlarm.AlarmDateWeekDay = 1;
+   sAlarm.AlarmTime.TimeFormat = RTC_HOURFORMAT12_AM;
+   sAlarm.AlarmTime.Seconds = 0;
+   sAlarm.AlarmTime.SubSeconds = 0;
+
+   /* Read the calendar once, then on every second from the wakeup interrupt, which also
+      refreshes the display as the seconds change */
+   Clock_CacheUpdate();
+   HAL_RTCEx_SetWakeUpTimer_IT(&hrtc, CLOCK_WAKEUP_COUNTER, RTC_WAKEUPCLOCK_CK_SPRE_16BITS);
+}
+
+/**
+ * @brief Get the current calendar from the copy in RAM
+ *
+ * The copy and the sub-seconds are read with the interrupts masked: reading
+ * SSR freezes the calendar shadow registers until DR is read, a wakeup
+ * interrupt in between would refresh the copy with the previous second. A
+ * second that ended meanwhile leaves the wakeup flag set, the interrupt
+ * then runs once unmasked and the read is retried, so the seconds and the
+ * fraction always belong to each other.
+ *
+ * @param clock Where the date and time are copied
+ * @return Milliseconds into the current second, 0 to 999
+ */
+uint16_t Clock_GetCalendar(APP_ClockTypeDef *clock)
+{
+    uint32_t subSeconds; /* Sub-second register, counts down from the synchronous prescaler */
+    uint32_t rollover;   /* A second ended during the read, its wakeup interrupt is pending */
+
+    do
+    {
+        __disable_irq();
+
+        *clock = ClockCache;
+        subSeconds = READ_REG(hrtc.Instance->SSR);
+        (void)READ_REG(hrtc.Instance->DR); /* Unlock the shadow registers */
+        rollover = __HAL_RTC_WAKEUPTIMER_GET_FLAG(&hrtc, RTC_FLAG_WUTF);
+
+        __enable_irq(); /* A pending wakeup refreshes the copy here */
+    } while (rollover != 0u);
+
+    /* A synchronization shift still being absorbed leaves SSR above the prescaler */
+    subSeconds = (subSeconds <= PRESCALER_2) ? (PRESCALER_2 - subSeconds) : 0u;
+
+    return (uint16_t)((subSeconds * 1000u) / (PRESCALER_2 + 1u));
 }
 
 /**
@@ -60,85 +151,67 @@ void Clock_Init(void)
 void Clock_Task(void)
 {
     static Clock_States currentClockState = CLOCK_IDLE_STATE; /* Initialize the clock states variable */
-    static uint32_t ticker; /* Variable to handle the ticks */
+    static const APP_MsgTypeDef *applied = NULL; /* Command applied, read in place until broadcast */
+    const APP_MsgTypeDef *message = Queue_Peek(&ClockQueue); /* Oldest command */
+    APP_MsgTypeDef clock; /* Values for the display */
 
-    ticker = HAL_GetTick(); /* Get the first lecture of transcurred time */
+    BENCH_BEGIN(&Bench, APP_PROBE_CLOCK_TASK);
 
     switch (currentClockState)
     {
         case CLOCK_IDLE_STATE:
-            /* Check if there's a message */
-            if (Msg.msg != SERIAL_MSG_NONE)
-            {
-                currentClockState = CLOCK_VALID_DATA_STATE; /* Move to VALID_DATA_STATE */
-            }
-            if ((HAL_GetTick() - ticker) >= 1000)
+            /* An alarm that went off is broadcast first, the room left is checked again below */
+            if ((ClockAlarm != 0u) && (Queue_Space(&CANQueue) > 0u))
             {
-                ticker = HAL_GetTick(); /* Update the variable ticker */
-                currentClockState = CLOCK_DISPLAY_DATA_STATE; /* Move to DISPLAY_DATA_STATE */
+                ClockAlarm = 0;
+                Clock_PostAlarmEvent();
             }
-            break;
 
-        case CLOCK_VALID_DATA_STATE:
-            if (Msg.msg == SERIAL_MSG_TIME)
+            /* Check if there's a message, apply it and show the new values, once its broadcast has room */
+            if ((message != NULL) && (Queue_Space(&CANQueue) > 0u))
             {
-                currentClockState = CLOCK_UPDATE_TIME_STATE; /* Move to UPDATE_TIME_STATE */
-            }
-            else if (Msg.msg == SERIAL_MSG_DATE)
-            {
-                currentClockState = CLOCK_UPDATE_DATE_STATE; /* Move to UPDATE_DATE_STATE */
-            }
-            else if (Msg.msg == SERIAL_MSG_ALARM)
-            {
-                currentClockState = CLOCK_UPDATE_ALARM_STATE; /* Move to UPDATE_ALARM_STATE */
+                if ((message->msg < (sizeof(ClockUpdates) / sizeof(ClockUpdates[0]))) && (ClockUpdates[message->msg] != NULL))
+                {
+                    ClockUpdates[message->msg](message);
+
+                    /* The wakeup interrupt writes the copy too */
+                    __disable_irq();
+                    Clock_CacheUpdate();
+                    __enable_irq();
+                }
+
+                applied = message;
+
+                currentClockState = CLOCK_DISPLAY_DATA_STATE; /* Move to DISPLAY_DATA_STATE */
             }
-            else
+            else if (ClockRefresh != 0u)
             {
-                currentClockState = CLOCK_IDLE_STATE; /* Move to IDLE_CLOCK_STATE */
+                ClockRefresh = 0; /* Refresh served */
+                currentClockState = CLOCK_DISPLAY_DATA_STATE; /* Move to DISPLAY_DATA_STATE */
             }
-
-            break;
-        
-        case CLOCK_UPDATE_TIME_STATE:
-            sTime.Hours = Msg.tm.tm_hour;
-            sTime.Minutes = Msg.tm.tm_min;
-            sTime.Seconds = Msg.tm.tm_sec;
-            HAL_RTC_SetTime(&hrtc, &sTime, RTC_FORMAT_BIN);
-
-            currentClockState = CLOCK_DISPLAY_DATA_STATE; /* Move to DISPLAY_DATA_STATE */
             break;
 
-        case CLOCK_UPDATE_DATE_STATE:
-            sDate.Date = Msg.tm.tm_mday;
-            sDate.Month = Msg.tm.tm_mon;
-            sDate.WeekDay = Msg.tm.tm_wday;
-            sDate.Year = Msg.tm.tm_year;
-            HAL_RTC_SetDate(&hrtc, &sDate, RTC_FORMAT_BIN);
-
-            currentClockState = CLOCK_DISPLAY_DATA_STATE; /* Move to DISPLAY_DATA_STATE */
-            break;
+        case CLOCK_DISPLAY_DATA_STATE:
+            /* Current values, without reading the RTC */
+            (void)Clock_GetCalendar(&clock.data.clock);
+            clock.msg = SERIAL_MSG_NONE;
+            clock.rxTime = 0;
 
-        case CLOCK_UPDATE_ALARM_STATE:
-            sAlarm.AlarmTime.Hours = Msg.tm.tm_hour;
-            sAlarm.AlarmTime.Minutes = Msg.tm.tm_min;
-            HAL_RTC_SetAlarm(&hrtc, &sAlarm, RTC_FORMAT_BIN);
+            /* A display still busy with the previous values skips these, the drop is counted */
+            if (Queue_Post(&DisplayQueue, &clock) == QUEUE_OK)
+            {
+                Sched_SetEvent(&Scheduler, APP_EVENT_DISPLAY);
+            }
 
-            currentClockState = CLOCK_DISPLAY_DATA_STATE;
-            break;
+            /* Broadcast the values of a new message, the room was checked before applying it */
+            if (applied != NULL)
+            {
+                Queue_Post(&CANQueue, applied);
+                Queue_Release(&ClockQueue);
+                applied = NULL;
+                Sched_SetEvent(&Scheduler, APP_EVENT_CAN);
+            }
 
-        case CLOCK_DISPLAY_DATA_STATE:
-            CANMsg.msg = Msg.msg; /* Enabler for displaying the clock message */
-
-            CANMsg.tm.tm_hour = Msg.tm.tm_hour;
-            CANMsg.tm.tm_min = Msg.tm.tm_min;
-            CANMsg.tm.tm_sec = Msg.tm.tm_sec;
-            CANMsg.tm.tm_mday = Msg.tm.tm_mday;
-            CANMsg.tm.tm_mon = Msg.tm.tm_mon;
-            CANMsg.tm.tm_wday = Msg.tm.tm_wday;
-            CANMsg.tm.tm_year = Msg.tm.tm_year;
-
-            Msg.msg = SERIAL_MSG_NONE; /* Reset message indicator */
-            
             currentClockState = CLOCK_IDLE_STATE; /* Move to IDLE_CLOCK_STATE */
             break;
         
@@ -146,6 +219,14 @@ void Clock_Task(void)
             currentClockState = CLOCK_IDLE_STATE; /* Invalid state, return to IDLE_STATE */
             break;
     }
+
+    /* Keep running until the message is applied, the queue is empty and the alarm broadcast */
+    if ((currentClockState != CLOCK_IDLE_STATE) || (Queue_Count(&ClockQueue) > 0u) || (ClockAlarm != 0u))
+    {
+        Sched_SetEvent(&Scheduler, APP_EVENT_CLOCK);
+    }
+
+    BENCH_END(&Bench, APP_PROBE_CLOCK_TASK);
 }
 
 /**
@@ -165,3 +246,132 @@ void Clock_Task(void)
     printf("Alarm: %u:%u\n\r", alarm->AlarmTime.Hours, alarm->AlarmTime.Minutes);        
     printf("\n\r"); 
 }*/
+
+/**
+ * @brief RTC wakeup timer callback, called from RTC_TAMP_IRQHandler on every second
+ *
+ * Reads the new second into the copy and requests a display refresh.
+ *
+ * @param hrtc RTC handle
+ */
+void HAL_RTCEx_WakeUpTimerEventCallback(RTC_HandleTypeDef *hrtc)
+{
+    (void)hrtc;
+
+    Clock_CacheUpdate();
+    ClockRefresh = 1;
+    Sched_SetEvent(&Scheduler, APP_EVENT_CLOCK);
+}
+
+/**
+ * @brief Read the calendar from the RTC into the copy, with the RTC interrupt masked
+ *        when not called from it
+ */
+static void Clock_CacheUpdate(void)
+{
+    RTC_TimeTypeDef time;
+    RTC_DateTypeDef date;
+
+    /* The date after the time to unlock the shadow registers */
+    HAL_RTC_GetTime(&hrtc, &time, RTC_FORMAT_BIN);
+    HAL_RTC_GetDate(&hrtc, &date, RTC_FORMAT_BIN);
+
+    ClockCache.time.hour = time.Hours;
+    ClockCache.time.min = time.Minutes;
+    ClockCache.time.sec = time.Seconds;
+    ClockCache.date.mday = date.Date;
+    ClockCache.date.mon = date.Month;
+    ClockCache.date.wday = date.WeekDay;
+    ClockCache.date.year = 2000u + date.Year;
+}
+
+/**
+ * @brief RTC alarm A callback, called from RTC_TAMP_IRQHandler
+ *
+ * Only flags the alarm and wakes Clock_Task up, the broadcast is queued from
+ * the task on the next scheduler pass.
+ *
+ * @param hrtc RTC handle
+ */
+void HAL_RTC_AlarmAEventCallback(RTC_HandleTypeDef *hrtc)
+{
+    (void)hrtc;
+
+    ClockAlarm = 1;
+    Sched_SetEvent(&Scheduler, APP_EVENT_CLOCK);
+}
+
+/**
+ * @brief Set the time of a time message
+ *
+ * The time sent was right when its frame started, it is moved forward by the
+ * time spent since, a day rollover is not carried to the date.
+ *
+ * @param message Time message
+ */
+static void Clock_UpdateTime(const APP_MsgTypeDef *message)
+{
+    uint32_t delay = Serial_TimestampRead() - message->rxTime;  /* Microseconds since the frame started */
+    uint32_t seconds;                                           /* Time to set, in seconds of the day */
+
+    seconds = (((message->data.time.hour * 60u) + message->data.time.min) * 60u) + message->data.time.sec +
+              (delay / SERIAL_TIMESTAMP_FREQ);
+    seconds %= CLOCK_SECONDS_PER_DAY;
+
+    sTime.Hours = seconds / 3600u;
+    sTime.Minutes = (seconds / 60u) % 60u;
+    sTime.Seconds = seconds % 60u;
+    HAL_RTC_SetTime(&hrtc, &sTime, RTC_FORMAT_BIN);
+
+    /* Setting the time restarts the second, the fraction is added with a shift: one second
+       ahead and back the part of it not elapsed yet */
+    delay %= SERIAL_TIMESTAMP_FREQ;
+    if (delay != 0u)
+    {
+        HAL_RTCEx_SetSynchroShift(&hrtc, RTC_SHIFTADD1S_SET,
+                                  ((PRESCALER_2 + 1u) * (SERIAL_TIMESTAMP_FREQ - delay)) / SERIAL_TIMESTAMP_FREQ);
+    }
+}
+
+/**
+ * @brief Set the date of a date message
+ * @param message Date message
+ */
+static void Clock_UpdateDate(const APP_MsgTypeDef *message)
+{
+    sDate.Date = message->data.date.mday;
+    sDate.Month = message->data.date.mon;
+    /* WDU = 0 is forbidden, a Sunday counted from 0 still lands on the RTC Sunday */
+    sDate.WeekDay = (message->data.date.wday == 0u) ? RTC_WEEKDAY_SUNDAY : message->data.date.wday;
+    sDate.Year = message->data.date.year % 100u; /* The RTC only keeps the two last digits */
+    HAL_RTC_SetDate(&hrtc, &sDate, RTC_FORMAT_BIN);
+}
+
+/**
+ * @brief Set the alarm of an alarm message
+ * @param message Alarm message
+ */
+static void Clock_UpdateAlarm(const APP_MsgTypeDef *message)
+{
+    sAlarm.AlarmTime.Hours = message->data.alarm.hour;
+    sAlarm.AlarmTime.Minutes = message->data.alarm.min;
+    HAL_RTC_SetAlarm_IT(&hrtc, &sAlarm, RTC_FORMAT_BIN);
+}
+
+/**
+ * @brief Queue the broadcast of an alarm that went off, with the current time
+ */
+static void Clock_PostAlarmEvent(void)
+{
+    APP_ClockTypeDef clock; /* Time of the event */
+    APP_MsgTypeDef event;
+
+    (void)Clock_GetCalendar(&clock);
+
+    event.msg = SERIAL_MSG_ALARM_EVENT;
+    event.rxTime = 0;
+    event.data.time = clock.time;
+
+    Queue_Post(&CANQueue, &event);
+    Sched_SetEvent(&Scheduler, APP_EVENT_CAN);
+}
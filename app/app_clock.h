@@ -2,6 +2,7 @@
 #define __APP_CLOCK_H__
 
 #include <stdint.h>
+#include "app_bsp.h"
 
 /**
  * @file app_clock.h
@@ -12,22 +13,55 @@
  * used by other modules or the main application.
  */
 
+/**
+ * @brief Depth of the message queues between the tasks, they can be overridden
+ * from the compiler command line.
+ *
+ * ClockQueue takes the validated commands from Serial_Task, CANQueue the
+ * broadcasts of the applied messages and DisplayQueue the values read back
+ * from the RTC.
+ */
+#ifndef CLOCK_QUEUE_DEPTH
+#define CLOCK_QUEUE_DEPTH 4u
+#endif
+#ifndef CAN_QUEUE_DEPTH
+#define CAN_QUEUE_DEPTH 4u
+#endif
+#ifndef DISPLAY_QUEUE_DEPTH
+#define DISPLAY_QUEUE_DEPTH 2u
+#endif
+
 /* Function prototypes */
 
 /**
  * @brief Initializes the clock module.
  *
- * This function prepares the clock application for operation. It must be called 
- * before any other clock functions.
+ * This function prepares the clock application for operation and the message
+ * queues between the tasks. It must be called before any other clock functions.
  */
 void Clock_Init(void);
 
 /**
  * @brief Periodic clock task function.
  *
- * This function should be called periodically in the main application loop
- * or a dedicated task to maintain and update the clock functionalities.
+ * This function runs on the APP_EVENT_CLOCK event, set when a validated
+ * message arrives, when the alarm goes off and once per second by the RTC
+ * wakeup timer started in Clock_Init.
  */
 void Clock_Task(void);
 
+/**
+ * @brief Gets the current date and time without reading the calendar registers.
+ *
+ * The calendar is read from the RTC once per second by the wakeup interrupt
+ * and after every change, and kept in RAM; the fraction of the second comes
+ * from the sub-second register. There is no shadow register synchronization
+ * to wait for and no BCD conversion, so the consumers can call it as often as
+ * they need. It must be called with the RTC interrupt enabled, from the tasks.
+ *
+ * @param clock Where the date and time are copied.
+ * @return Milliseconds into the current second, 0 to 999.
+ */
+uint16_t Clock_GetCalendar(APP_ClockTypeDef *clock);
+
 #endif // __APP_CLOCK_H__
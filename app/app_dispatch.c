@@ -0,0 +1,105 @@
+/**
+ * @file app_dispatch.c
+ * @brief Table driven dispatcher of the command messages.
+ */
+
+#include "app_dispatch.h"
+#include <stddef.h>
+
+/**
+ * @brief Initialize the dispatcher without entries and clear its statistics.
+ * @param hdispatch Pointer to the dispatcher handle structure.
+ */
+void Dispatch_Init(Dispatch_HandleTypeDef *hdispatch)
+{
+    for (uint32_t i = 0; i < DISPATCH_MAX_TYPES; i++)
+    {
+        hdispatch->Entries[i] = NULL;
+    }
+
+    hdispatch->Stats.Handled = 0;
+    hdispatch->Stats.Unknown = 0;
+    hdispatch->Stats.Short = 0;
+    hdispatch->Stats.Invalid = 0;
+}
+
+/**
+ * @brief Register the entries of a table.
+ * @param hdispatch Pointer to the dispatcher handle structure.
+ * @param table Entries to register.
+ * @param count Number of entries in the table.
+ * @return DISPATCH_OK if all registered, DISPATCH_ERROR if an entry was refused.
+ */
+uint8_t Dispatch_Register(Dispatch_HandleTypeDef *hdispatch, const Dispatch_EntryTypeDef *table, uint32_t count)
+{
+    uint8_t status = DISPATCH_OK;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if ((table[i].Type < DISPATCH_MAX_TYPES) && (table[i].Handle != NULL))
+        {
+            hdispatch->Entries[table[i].Type] = &table[i];
+        }
+        else
+        {
+            status = DISPATCH_ERROR;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief Decode, validate and handle a request.
+ * @param hdispatch Pointer to the dispatcher handle structure.
+ * @param data Request payload, the message type in data[0].
+ * @param size Number of bytes in the payload.
+ * @param message Storage of the decoded message.
+ * @param response Buffer given to the handler for its response.
+ * @param responseSize Where the length written by the handler is stored.
+ * @return DISPATCH_OK if handled, DISPATCH_ERROR otherwise.
+ */
+uint8_t Dispatch_Process(Dispatch_HandleTypeDef *hdispatch, const uint8_t *data, uint16_t size, void *message,
+                         uint8_t *response, uint16_t *responseSize)
+{
+    const Dispatch_EntryTypeDef *entry = NULL;
+    const void *decoded = data;
+    uint8_t status = DISPATCH_ERROR;
+
+    *responseSize = 0;
+
+    if ((size > 0u) && (data[0] < DISPATCH_MAX_TYPES))
+    {
+        entry = hdispatch->Entries[data[0]];
+    }
+
+    if (entry == NULL)
+    {
+        hdispatch->Stats.Unknown++;
+    }
+    else if (size < entry->MinLength)
+    {
+        hdispatch->Stats.Short++;
+    }
+    else
+    {
+        if (entry->Decode != NULL)
+        {
+            entry->Decode(data, size, message);
+            decoded = message;
+        }
+
+        if ((entry->Validate != NULL) && (entry->Validate(decoded) != DISPATCH_OK))
+        {
+            hdispatch->Stats.Invalid++;
+        }
+        else
+        {
+            *responseSize = entry->Handle(decoded, response);
+            hdispatch->Stats.Handled++;
+            status = DISPATCH_OK;
+        }
+    }
+
+    return status;
+}
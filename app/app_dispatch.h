@@ -0,0 +1,117 @@
+#ifndef __APP_DISPATCH_H__
+#define __APP_DISPATCH_H__
+
+#include <stdint.h>
+
+/**
+ * @file app_dispatch.h
+ * @brief Table driven dispatcher of the command messages.
+ *
+ * Each message type is described by a constant entry: the minimum length of
+ * the request, a decoder turning the payload into a message, a validator and
+ * a handler. The modules register their entries and Dispatch_Process runs the
+ * four steps of a request in one call, the entry is found by indexing a table
+ * with the message type (first byte of the payload), so the cost does not
+ * grow with the number of types. The messages are opaque to the module, the
+ * caller gives the storage the decoder writes into.
+ */
+
+/**
+ * @brief Number of message types, the types go from 0 to DISPATCH_MAX_TYPES - 1.
+ */
+#ifndef DISPATCH_MAX_TYPES
+#define DISPATCH_MAX_TYPES 16u
+#endif
+
+#define DISPATCH_OK      0x00U
+#define DISPATCH_ERROR   0x01U
+
+/**
+ * @brief Turn a request payload into a message.
+ * @param data Request payload, the message type in data[0].
+ * @param size Number of bytes in the payload, at least the entry minimum length.
+ * @param message Message to fill.
+ */
+typedef void (*Dispatch_DecodeFunction)(const uint8_t *data, uint16_t size, void *message);
+
+/**
+ * @brief Check a decoded message.
+ * @param message Message decoded, the payload when the entry has no decoder.
+ * @return DISPATCH_OK if the message can be handled, DISPATCH_ERROR otherwise.
+ */
+typedef uint8_t (*Dispatch_ValidateFunction)(const void *message);
+
+/**
+ * @brief Act on a valid message.
+ * @param message Message decoded, the payload when the entry has no decoder.
+ * @param response Where a response other than the acknowledge can be written.
+ * @return Length of the response written, 0 to just acknowledge the request.
+ */
+typedef uint16_t (*Dispatch_HandleFunction)(const void *message, uint8_t *response);
+
+/**
+ * @brief Description of a message type.
+ */
+typedef struct
+{
+    uint8_t Type;                       /**< Message type, first byte of the payload */
+    uint8_t MinLength;                  /**< Shortest payload accepted, type included */
+    Dispatch_DecodeFunction Decode;     /**< NULL to give the payload as it is to the other steps */
+    Dispatch_ValidateFunction Validate; /**< NULL if every message decoded is valid */
+    Dispatch_HandleFunction Handle;     /**< Action, must not be NULL */
+} Dispatch_EntryTypeDef;
+
+/**
+ * @brief Dispatcher statistics.
+ */
+typedef struct
+{
+    uint32_t Handled;   /**< Requests that reached their handler */
+    uint32_t Unknown;   /**< Requests of a type without entry */
+    uint32_t Short;     /**< Requests shorter than the minimum length of their type */
+    uint32_t Invalid;   /**< Requests refused by the validator */
+} Dispatch_StatsTypeDef;
+
+/**
+ * @brief Dispatcher handler structure.
+ */
+typedef struct
+{
+    const Dispatch_EntryTypeDef *Entries[DISPATCH_MAX_TYPES];   /**< Entry of each message type, NULL if none */
+    Dispatch_StatsTypeDef Stats;                                /**< Dispatcher statistics */
+} Dispatch_HandleTypeDef;
+
+/**
+ * @brief Initialize the dispatcher without entries and clear its statistics.
+ * @param hdispatch Pointer to the dispatcher handle structure.
+ */
+void Dispatch_Init(Dispatch_HandleTypeDef *hdispatch);
+
+/**
+ * @brief Register the entries of a table.
+ *
+ * The entries are referenced, not copied, so the table must outlive the
+ * dispatcher (a const table at file scope). Registering a type again
+ * replaces its entry.
+ *
+ * @param hdispatch Pointer to the dispatcher handle structure.
+ * @param table Entries to register.
+ * @param count Number of entries in the table.
+ * @return DISPATCH_OK if all registered, DISPATCH_ERROR if an entry has a type out of range or no handler (not registered).
+ */
+uint8_t Dispatch_Register(Dispatch_HandleTypeDef *hdispatch, const Dispatch_EntryTypeDef *table, uint32_t count);
+
+/**
+ * @brief Decode, validate and handle a request.
+ * @param hdispatch Pointer to the dispatcher handle structure.
+ * @param data Request payload, the message type in data[0].
+ * @param size Number of bytes in the payload.
+ * @param message Storage of the decoded message, large enough for every registered type.
+ * @param response Buffer given to the handler for its response.
+ * @param responseSize Where the length written by the handler is stored, 0 for an acknowledge or an error.
+ * @return DISPATCH_OK if handled, DISPATCH_ERROR if the type is unknown, the request too short or invalid.
+ */
+uint8_t Dispatch_Process(Dispatch_HandleTypeDef *hdispatch, const uint8_t *data, uint16_t size, void *message,
+                         uint8_t *response, uint16_t *responseSize);
+
+#endif // __APP_DISPATCH_H__
@@ -8,11 +8,10 @@
 #include "app_clock.h"
 #include "hel_lcd.h"
 #include "app_display.h"
+#include "app_bench.h"
+#include "app_queue.h"
 #include <stdio.h>
 
-#define CLOCK_MESSAGE_ENABLED 1
-#define CLOCK_MESSAGE_DISABLED 0
-
 /* Function prototypes */
 
 
@@ -23,8 +22,11 @@ extern LCD_HandleTypeDef hlcd;
 /* Structure to handle the SPI interface */
 extern SPI_HandleTypeDef SpiHandle;
 
-/* Application clock message structure */
-extern APP_MsgTypeDef ClockMsg;
+/* Time and date read back by the clock task */
+extern Queue_HandleTypeDef DisplayQueue;
+
+/* Execution time probes */
+extern Bench_HandleTypeDef Bench;
 
 
 /* Functions */
@@ -53,7 +55,7 @@ void Display_Init(void)
     /* Set up SPI configuration parameters */
     SpiHandle.Instance = SPI1;
     SpiHandle.Init.Mode = SPI_MODE_MASTER;
-    SpiHandle.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_4;
+    SpiHandle.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_64; /* 250 kHz, a byte lasts longer than the LCD takes to execute it */
     SpiHandle.Init.Direction = SPI_DIRECTION_2LINES;
     SpiHandle.Init.CLKPhase = SPI_PHASE_2EDGE;
     SpiHandle.Init.CLKPolarity = SPI_POLARITY_HIGH;
@@ -95,20 +97,16 @@ void Display_Task(void)
     static Display_States currentDisplayState = DISPLAY_IDLE_STATE; /* Set the IDLE state for the display state variable */
     static Time time = {0, 0, 0}; /* Define a time structure */
     static Date date = {0, 0, 0, 0}; /* Define a date structure */
+    const APP_MsgTypeDef *clock = Queue_Peek(&DisplayQueue); /* Oldest values, released once shown */
 
-    HEL_LCD_SetCursor(&hlcd, 0, 0);
-
-    HEL_LCD_String(&hlcd, "H");
+    /* Ship what the previous states queued for the LCD */
+    HEL_LCD_Task(&hlcd);
 
     switch(currentDisplayState) 
     {
         case DISPLAY_IDLE_STATE:
-            HEL_LCD_SetCursor(&hlcd, 0, 0);
-
-            HEL_LCD_String(&hlcd, "H");
-
             /* Wait/check for a message from the Clock_Task() function */
-            if (ClockMsg.msg == CLOCK_MESSAGE_ENABLED) 
+            if (clock != NULL)
             {
                 currentDisplayState = DISPLAY_PROCESS_MESSAGE_STATE; /* Move to DISPLAY_PROCESS_MESSAGE_STATE */
             }
@@ -116,18 +114,18 @@ void Display_Task(void)
             break;
 
         case DISPLAY_PROCESS_MESSAGE_STATE:
-            /* Parse the ClockMsg to extract time and date */
+            /* Parse the clock values to extract time and date */
             
             /* Fill out the time structure */
-            time.hour = ClockMsg.tm.tm_hour;
-            time.min = ClockMsg.tm.tm_min;
-            time.sec = ClockMsg.tm.tm_sec;
+            time.hour = clock->data.clock.time.hour;
+            time.min = clock->data.clock.time.min;
+            time.sec = clock->data.clock.time.sec;
             
             /* Fill out the date structure */
-            date.day = ClockMsg.tm.tm_mday;
-            date.month = ClockMsg.tm.tm_mon;
-            date.year = ClockMsg.tm.tm_year;
-            date.weekday = ClockMsg.tm.tm_wday;
+            date.day = clock->data.clock.date.mday;
+            date.month = clock->data.clock.date.mon;
+            date.year = clock->data.clock.date.year;
+            date.weekday = clock->data.clock.date.wday;
 
             currentDisplayState = DISPLAY_UPDATE_DISPLAY_STATE; /* Move to DISPLAY_UPDATE_DISPLAY_STATE */
 
@@ -137,13 +135,16 @@ void Display_Task(void)
             /* Update the LCD with the time and date */
             data_string(date.weekday, date.month, date.day, date.year);
             time_string(time.hour, time.min, time.sec);
+
+            /* Send only the characters that changed, usually the seconds */
+            HEL_LCD_Flush(&hlcd);
             
             currentDisplayState = DISPLAY_CLEAR_MESSAGE_STATE; /* Move to DISPLAY_CLEAR_MESSAGE_STATE */
 
             break;
 
         case DISPLAY_CLEAR_MESSAGE_STATE:
-            ClockMsg.msg = CLOCK_MESSAGE_DISABLED; /* Clear the ClockMsg variable */
+            Queue_Release(&DisplayQueue); /* Values shown, the clock can post the next ones */
             currentDisplayState = DISPLAY_IDLE_STATE; /* Move to DISPLAY_IDLE_STATE */
 
             break;
@@ -156,6 +157,24 @@ void Display_Task(void)
     }
 }
 
+/**
+ * @brief End of an LCD transfer, the driver chains the next one
+ * @param hspi Pointer to the SPI handle structure
+ */
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    HEL_LCD_TxCpltCallback(&hlcd);
+}
+
+/**
+ * @brief Failed LCD transfer, its bytes are lost but the driver goes on with the queue
+ * @param hspi Pointer to the SPI handle structure
+ */
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    HEL_LCD_TxCpltCallback(&hlcd);
+}
+
 void data_string(uint8_t wday, uint8_t month, uint8_t mday, uint32_t year)
 {
     char date[15];
@@ -169,6 +188,7 @@ void data_string(uint8_t wday, uint8_t month, uint8_t mday, uint32_t year)
 
     date[4] = ((mday / (uint8_t)10) % (uint8_t)10) + (uint8_t)48;
     date[5] = (mday % (uint8_t)10) + (uint8_t)48;
+    date[3] = 32;
     date[6] = 32;
     date[7] = (year / (uint32_t)1000) + '0';
     date[8] = (year / (uint32_t)100) % (uint32_t)10 + '0';
@@ -185,9 +205,9 @@ void data_string(uint8_t wday, uint8_t month, uint8_t mday, uint32_t year)
     }
     date[14] = '\0';
 
-    HEL_LCD_SetCursor(&hlcd, 0, 1);
-    
-    HEL_LCD_String(&hlcd, date);
+    BENCH_BEGIN(&Bench, APP_PROBE_LCD_STRING);
+    HEL_LCD_Print(&hlcd, 0, 1, date);
+    BENCH_END(&Bench, APP_PROBE_LCD_STRING);
 }
 
 void time_string(uint32_t hours, uint32_t minutes, uint32_t seconds)
@@ -203,7 +223,7 @@ void time_string(uint32_t hours, uint32_t minutes, uint32_t seconds)
     time[7] = (seconds % (uint32_t)10) + (uint32_t)48;
     time[8] = '\0';
 
-    HEL_LCD_SetCursor(&hlcd, 1, 3);
-
-    HEL_LCD_String(&hlcd, time);
+    BENCH_BEGIN(&Bench, APP_PROBE_LCD_STRING);
+    HEL_LCD_Print(&hlcd, 1, 3, time);
+    BENCH_END(&Bench, APP_PROBE_LCD_STRING);
 }
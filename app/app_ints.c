@@ -53,4 +53,58 @@ void TIM16_FDCAN_IT0_IRQHandler(void)
 {
     /* HAL library functions that attend interrupt on CAN */
     HAL_FDCAN_IRQHandler(&CANHandler);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Declare CAN interrupt line 1 service rutine, only the RX FIFO 1 group is routed to it
+ *
+ * The FIFO 1 flags are served here instead of calling HAL_FDCAN_IRQHandler, it would also
+ * run the line 0 callbacks this interrupt may have preempted.
+ */
+void TIM17_FDCAN_IT1_IRQHandler(void)
+{
+    uint32_t rxFifo1ITs = __HAL_FDCAN_GET_FLAG(&CANHandler, FDCAN_FLAG_RX_FIFO1_NEW_MESSAGE | FDCAN_FLAG_RX_FIFO1_FULL | FDCAN_FLAG_RX_FIFO1_MESSAGE_LOST);
+
+    /* The interrupt enable bits are in the same positions as the flags */
+    rxFifo1ITs &= __HAL_FDCAN_GET_IT_SOURCE(&CANHandler, FDCAN_IT_RX_FIFO1_NEW_MESSAGE | FDCAN_IT_RX_FIFO1_FULL | FDCAN_IT_RX_FIFO1_MESSAGE_LOST);
+
+    if (rxFifo1ITs != 0u)
+    {
+        __HAL_FDCAN_CLEAR_FLAG(&CANHandler, rxFifo1ITs);
+        HAL_FDCAN_RxFifo1Callback(&CANHandler, rxFifo1ITs);
+    }
+}
+
+extern TIM_HandleTypeDef TimestampTimHandle;
+
+/**
+ * @brief Declare TIM3 interrupt service rutine, the wrap arounds of the CAN timestamp counter
+ */
+void TIM3_TIM4_IRQHandler(void)
+{
+    HAL_TIM_IRQHandler(&TimestampTimHandle);
+}
+
+extern DMA_HandleTypeDef SpiDmaHandle;
+
+/**
+ * @brief Declare DMA1 channel 1 interrupt service rutine, end of the LCD SPI transfers
+ */
+void DMA1_Channel1_IRQHandler(void)
+{
+    /* HAL library functions that attend interrupt on DMA, they end up in HAL_SPI_TxCpltCallback */
+    HAL_DMA_IRQHandler(&SpiDmaHandle);
+}
+
+extern RTC_HandleTypeDef hrtc;
+
+/**
+ * @brief Declare RTC and TAMP interrupt service rutine, the alarm A and the wakeup timer through EXTI line 19
+ */
+void RTC_TAMP_IRQHandler(void)
+{
+    /* HAL library functions that attend interrupt on RTC, they end up in HAL_RTC_AlarmAEventCallback
+       and HAL_RTCEx_WakeUpTimerEventCallback, each one checks its own flag */
+    HAL_RTC_AlarmIRQHandler(&hrtc);
+    HAL_RTCEx_WakeUpTimerIRQHandler(&hrtc);
+}
@@ -5,6 +5,14 @@
 
 #include "app_bsp.h"
 #include "hel_lcd.h"
+#include "app_bench.h"
+#include "app_serial.h"
+
+DMA_HandleTypeDef SpiDmaHandle; /* DMA channel feeding the SPI1 transmitter (LCD) */
+TIM_HandleTypeDef BenchTimHandle; /* TIM2 free running at the CPU clock for the benchmark probes */
+TIM_HandleTypeDef TimestampTimHandle; /* TIM3 counting microseconds, external timestamp counter of the FDCAN */
+
+static volatile uint32_t TimestampWraps; /* TIM3 wrap arounds, the 16 high bits of the timestamps */
 
 /**
  * @brief HAL MspInit function override
@@ -46,6 +54,10 @@ void HAL_FDCAN_MspInit(FDCAN_HandleTypeDef *hfdcan)
     /* Enable vector interrupt to handle CAN IRQs */
     HAL_NVIC_SetPriority(TIM16_FDCAN_IT0_IRQn, 2, 0);
     HAL_NVIC_EnableIRQ(TIM16_FDCAN_IT0_IRQn);
+
+    /* Line 1 only carries the urgent frames of RX FIFO 1, it preempts line 0 */
+    HAL_NVIC_SetPriority(TIM17_FDCAN_IT1_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(TIM17_FDCAN_IT1_IRQn);
 }
 
 /**
@@ -84,6 +96,130 @@ void HAL_RTC_MspInit(RTC_HandleTypeDef *hrtc)
     /* Peripheral clock enable */
     __HAL_RCC_RTC_ENABLE();
     __HAL_RCC_RTCAPB_CLK_ENABLE();
+
+    /* Alarm and wakeup timer interrupts, EXTI line 19 is a direct line unmasked at reset so only the NVIC is set */
+    HAL_NVIC_SetPriority(RTC_TAMP_IRQn, 3, 0);
+    HAL_NVIC_EnableIRQ(RTC_TAMP_IRQn);
+}
+
+/**
+ * @brief HAL_TIM_Base MspInit function override
+ * @param htim TIM handle
+ */
+void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim)
+{
+    if (htim->Instance == TIM2)
+    {
+        /* Free running counter polled by the benchmark probes, no interrupts */
+        __HAL_RCC_TIM2_CLK_ENABLE();
+    }
+    else if (htim->Instance == TIM3)
+    {
+        /* The wrap around interrupt preempts every other one, so a reader can not miss it for long */
+        __HAL_RCC_TIM3_CLK_ENABLE();
+        HAL_NVIC_SetPriority(TIM3_TIM4_IRQn, 0, 0);
+        HAL_NVIC_EnableIRQ(TIM3_TIM4_IRQn);
+    }
+}
+
+/**
+ * @brief Count the TIM3 wrap arounds
+ * @param htim TIM handle
+ */
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    if (htim->Instance == TIM3)
+    {
+        TimestampWraps++;
+    }
+}
+
+/**
+ * @brief Start TIM2 as the free running counter of the benchmark probes
+ *
+ * The Cortex-M0+ has no DWT cycle counter, TIM2 is the only 32 bit timer and
+ * counts every cycle of its clock (the CPU clock with the APB prescaler at 1),
+ * so it wraps around after 268 s at 16 MHz.
+ *
+ * @return Counter ticks per second
+ */
+uint32_t Bench_CounterStart(void)
+{
+    BenchTimHandle.Instance = TIM2;
+    BenchTimHandle.Init.Prescaler = 0;
+    BenchTimHandle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    BenchTimHandle.Init.Period = 0xFFFFFFFFU;
+    BenchTimHandle.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    BenchTimHandle.Init.RepetitionCounter = 0;
+    BenchTimHandle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    HAL_TIM_Base_Init(&BenchTimHandle);
+    HAL_TIM_Base_Start(&BenchTimHandle);
+
+    return HAL_RCC_GetPCLK1Freq();
+}
+
+/**
+ * @brief Read the benchmark counter
+ * @return TIM2 counter value
+ */
+uint32_t Bench_CounterRead(void)
+{
+    return TIM2->CNT;
+}
+
+/**
+ * @brief Start TIM3 counting microseconds as the external timestamp counter of the FDCAN
+ *
+ * The FDCAN samples the 16 bits of TIM3 at the start of every frame, the update
+ * interrupt counts the wrap arounds to extend the counter to 32 bits. As with
+ * TIM2 the APB prescaler is expected at 1.
+ */
+void Serial_TimestampStart(void)
+{
+    TimestampTimHandle.Instance = TIM3;
+    TimestampTimHandle.Init.Prescaler = (HAL_RCC_GetPCLK1Freq() / SERIAL_TIMESTAMP_FREQ) - 1u;
+    TimestampTimHandle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    TimestampTimHandle.Init.Period = 0xFFFFU;
+    TimestampTimHandle.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    TimestampTimHandle.Init.RepetitionCounter = 0;
+    TimestampTimHandle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    HAL_TIM_Base_Init(&TimestampTimHandle);
+
+    /* The update event loading the prescaler is not a wrap around */
+    __HAL_TIM_CLEAR_FLAG(&TimestampTimHandle, TIM_FLAG_UPDATE);
+    TimestampWraps = 0;
+    HAL_TIM_Base_Start_IT(&TimestampTimHandle);
+}
+
+/**
+ * @brief Read TIM3 extended to 32 bits with its wrap arounds
+ *
+ * Callable from any priority: the read is retried if the update interrupt ran
+ * in between, and a wrap around it did not serve yet (the caller masks the
+ * interrupts) is found in the pending flag.
+ *
+ * @return Microseconds
+ */
+uint32_t Serial_TimestampRead(void)
+{
+    uint32_t wraps;
+    uint32_t count;
+    uint32_t pending;
+
+    do
+    {
+        wraps = TimestampWraps;
+        count = TIM3->CNT;
+        pending = __HAL_TIM_GET_FLAG(&TimestampTimHandle, TIM_FLAG_UPDATE);
+    } while (wraps != TimestampWraps);
+
+    /* A low count with the flag set wrapped before being read, a high one is about to */
+    if ((pending != 0u) && (count < 0x8000u))
+    {
+        wraps++;
+    }
+
+    return (wraps << 16) | count;
 }
 
 /**
@@ -118,6 +254,24 @@ void HAL_SPI_MspInit(SPI_HandleTypeDef* hspi)
 
     /* Use the configuration structure to initialize and configure the pins on GPIOC for SPI1 functionality */
     HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
+
+    /* DMA1 channel 1 moves the LCD queue to the SPI1 transmitter, one byte per request */
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    SpiDmaHandle.Instance = DMA1_Channel1;
+    SpiDmaHandle.Init.Request = DMA_REQUEST_SPI1_TX;
+    SpiDmaHandle.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    SpiDmaHandle.Init.PeriphInc = DMA_PINC_DISABLE;
+    SpiDmaHandle.Init.MemInc = DMA_MINC_ENABLE;
+    SpiDmaHandle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    SpiDmaHandle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    SpiDmaHandle.Init.Mode = DMA_NORMAL;
+    SpiDmaHandle.Init.Priority = DMA_PRIORITY_LOW;
+    HAL_DMA_Init(&SpiDmaHandle);
+    __HAL_LINKDMA(hspi, hdmatx, SpiDmaHandle);
+
+    /* Enable vector interrupt to handle the end of the LCD transfers, below the CAN one */
+    HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 3, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
 }
 
 /**
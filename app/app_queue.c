@@ -0,0 +1,131 @@
+/**
+ * @file app_queue.c
+ * @brief Bounded queue of fixed size messages between tasks.
+ */
+
+#include "app_queue.h"
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief Initialize (empty) the queue and clear its counters.
+ * @param hqueue Pointer to the queue handle structure.
+ * @param storage Array of depth messages.
+ * @param size Size of a message in bytes.
+ * @param depth Number of messages in the array.
+ */
+void Queue_Init(Queue_HandleTypeDef *hqueue, void *storage, uint32_t size, uint32_t depth)
+{
+    hqueue->Storage = storage;
+    hqueue->Size = size;
+    hqueue->Depth = depth;
+    hqueue->Head = 0;
+    hqueue->Tail = 0;
+    hqueue->Count = 0;
+    hqueue->Posted = 0;
+    hqueue->Drops = 0;
+    hqueue->HighWater = 0;
+}
+
+/**
+ * @brief Copy a message at the end of the queue.
+ * @param hqueue Pointer to the queue handle structure.
+ * @param message Message to post.
+ * @return QUEUE_OK if stored, QUEUE_ERROR if the queue is full.
+ */
+uint8_t Queue_Post(Queue_HandleTypeDef *hqueue, const void *message)
+{
+    uint8_t status = QUEUE_ERROR;
+
+    if (hqueue->Count < hqueue->Depth)
+    {
+        memcpy(&hqueue->Storage[hqueue->Head * hqueue->Size], message, hqueue->Size);
+        hqueue->Head = ((hqueue->Head + 1u) < hqueue->Depth) ? (hqueue->Head + 1u) : 0u;
+        hqueue->Count++;
+        hqueue->Posted++;
+
+        if (hqueue->Count > hqueue->HighWater)
+        {
+            hqueue->HighWater = hqueue->Count;
+        }
+
+        status = QUEUE_OK;
+    }
+    else
+    {
+        hqueue->Drops++; /* The newest message is the one lost */
+    }
+
+    return status;
+}
+
+/**
+ * @brief Get the oldest message without removing it.
+ * @param hqueue Pointer to the queue handle structure.
+ * @return Pointer to the oldest message, NULL if the queue is empty.
+ */
+const void *Queue_Peek(const Queue_HandleTypeDef *hqueue)
+{
+    const void *message = NULL;
+
+    if (hqueue->Count > 0u)
+    {
+        message = &hqueue->Storage[hqueue->Tail * hqueue->Size];
+    }
+
+    return message;
+}
+
+/**
+ * @brief Remove the message previously obtained with Queue_Peek.
+ * @param hqueue Pointer to the queue handle structure.
+ */
+void Queue_Release(Queue_HandleTypeDef *hqueue)
+{
+    if (hqueue->Count > 0u)
+    {
+        hqueue->Tail = ((hqueue->Tail + 1u) < hqueue->Depth) ? (hqueue->Tail + 1u) : 0u;
+        hqueue->Count--;
+    }
+}
+
+/**
+ * @brief Copy the oldest message out of the queue and remove it.
+ * @param hqueue Pointer to the queue handle structure.
+ * @param message Where the message is copied.
+ * @return QUEUE_OK if a message was read, QUEUE_ERROR if the queue is empty.
+ */
+uint8_t Queue_Get(Queue_HandleTypeDef *hqueue, void *message)
+{
+    uint8_t status = QUEUE_ERROR;
+    const void *oldest = Queue_Peek(hqueue);
+
+    if (oldest != NULL)
+    {
+        memcpy(message, oldest, hqueue->Size);
+        Queue_Release(hqueue);
+        status = QUEUE_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Number of messages waiting in the queue.
+ * @param hqueue Pointer to the queue handle structure.
+ * @return Messages stored.
+ */
+uint32_t Queue_Count(const Queue_HandleTypeDef *hqueue)
+{
+    return hqueue->Count;
+}
+
+/**
+ * @brief Room left in the queue.
+ * @param hqueue Pointer to the queue handle structure.
+ * @return Messages that can still be posted.
+ */
+uint32_t Queue_Space(const Queue_HandleTypeDef *hqueue)
+{
+    return hqueue->Depth - hqueue->Count;
+}
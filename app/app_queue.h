@@ -0,0 +1,97 @@
+#ifndef __APP_QUEUE_H__
+#define __APP_QUEUE_H__
+
+#include <stdint.h>
+
+/**
+ * @file app_queue.h
+ * @brief Bounded queue of fixed size messages between tasks.
+ *
+ * The messages are copied into a storage array given by the user, sized for
+ * Depth elements of the message type, so the queue is typed by that array and
+ * several producers can post without sharing a global. A message posted to a
+ * full queue is dropped and counted, the number of messages stored at once is
+ * recorded as a high water mark so the depth can be tuned. The producers are
+ * tasks of the cooperative scheduler, each one runs to completion, so no
+ * critical section is taken: an interrupt must not post.
+ */
+
+#define QUEUE_OK      0x00U
+#define QUEUE_ERROR   0x01U
+
+/**
+ * @brief Queue handler structure.
+ *
+ * Storage, Size and Depth are set by Queue_Init, Head and Tail go from 0 to
+ * Depth - 1 so any depth can be used.
+ */
+typedef struct
+{
+    uint8_t *Storage;       /**< Depth elements of Size bytes */
+    uint32_t Size;          /**< Size of a message in bytes */
+    uint32_t Depth;         /**< Number of messages the queue can hold */
+    uint32_t Head;          /**< Next element to write */
+    uint32_t Tail;          /**< Next element to read */
+    uint32_t Count;         /**< Messages stored */
+    uint32_t Posted;        /**< Messages accepted */
+    uint32_t Drops;         /**< Messages dropped because the queue was full */
+    uint32_t HighWater;     /**< Maximum number of messages stored at once */
+} Queue_HandleTypeDef;
+
+/**
+ * @brief Initialize (empty) the queue and clear its counters.
+ * @param hqueue Pointer to the queue handle structure.
+ * @param storage Array of depth messages, it must outlive the queue.
+ * @param size Size of a message in bytes (sizeof of the array element).
+ * @param depth Number of messages in the array.
+ */
+void Queue_Init(Queue_HandleTypeDef *hqueue, void *storage, uint32_t size, uint32_t depth);
+
+/**
+ * @brief Copy a message at the end of the queue.
+ * @param hqueue Pointer to the queue handle structure.
+ * @param message Message to post, of the size given to Queue_Init.
+ * @return QUEUE_OK if stored, QUEUE_ERROR if the queue is full (the message is dropped).
+ */
+uint8_t Queue_Post(Queue_HandleTypeDef *hqueue, const void *message);
+
+/**
+ * @brief Get the oldest message without removing it.
+ *
+ * The element belongs to the consumer until Queue_Release is called, so the
+ * message can be read in place.
+ *
+ * @param hqueue Pointer to the queue handle structure.
+ * @return Pointer to the oldest message, NULL if the queue is empty.
+ */
+const void *Queue_Peek(const Queue_HandleTypeDef *hqueue);
+
+/**
+ * @brief Remove the message previously obtained with Queue_Peek.
+ * @param hqueue Pointer to the queue handle structure.
+ */
+void Queue_Release(Queue_HandleTypeDef *hqueue);
+
+/**
+ * @brief Copy the oldest message out of the queue and remove it.
+ * @param hqueue Pointer to the queue handle structure.
+ * @param message Where the message is copied.
+ * @return QUEUE_OK if a message was read, QUEUE_ERROR if the queue is empty.
+ */
+uint8_t Queue_Get(Queue_HandleTypeDef *hqueue, void *message);
+
+/**
+ * @brief Number of messages waiting in the queue.
+ * @param hqueue Pointer to the queue handle structure.
+ * @return Messages stored.
+ */
+uint32_t Queue_Count(const Queue_HandleTypeDef *hqueue);
+
+/**
+ * @brief Room left in the queue.
+ * @param hqueue Pointer to the queue handle structure.
+ * @return Messages that can still be posted.
+ */
+uint32_t Queue_Space(const Queue_HandleTypeDef *hqueue);
+
+#endif // __APP_QUEUE_H__
@@ -0,0 +1,181 @@
+/**
+ * @file app_sched.c
+ * @brief Event driven cooperative scheduler.
+ */
+
+#include "app_sched.h"
+#include <stddef.h>
+
+/**
+ * @brief Initialize the scheduler without tasks nor pending events.
+ * @param hsched Pointer to the scheduler handle structure.
+ * @param getTick Function returning the current tick.
+ * @param idle Function called when no task is ready, NULL to keep polling.
+ */
+void Sched_Init(Sched_HandleTypeDef *hsched, uint32_t (*getTick)(void), void (*idle)(void))
+{
+    hsched->TaskCount = 0;
+    hsched->GetTick = getTick;
+    hsched->Idle = idle;
+    hsched->IdleCount = 0;
+
+    for (uint8_t i = 0; i < SCHED_MAX_EVENTS; i++)
+    {
+        hsched->Events[i] = 0;
+    }
+}
+
+/**
+ * @brief Register a task.
+ * @param hsched Pointer to the scheduler handle structure.
+ * @param function Task entry.
+ * @param period Period in ticks, 0 if the task only runs on events.
+ * @param eventMask Events that make the task ready (SCHED_EVENT_MASK), 0 for none.
+ * @return SCHED_OK if registered, SCHED_ERROR if the table is full or the task never runs.
+ */
+uint8_t Sched_AddTask(Sched_HandleTypeDef *hsched, Sched_TaskFunction function, uint32_t period, uint32_t eventMask)
+{
+    uint8_t status = SCHED_ERROR;
+    Sched_TaskTypeDef *task;
+
+    if ((hsched->TaskCount < SCHED_MAX_TASKS) && (function != NULL) && ((period != 0u) || (eventMask != 0u)))
+    {
+        task = &hsched->Tasks[hsched->TaskCount];
+        task->Function = function;
+        task->Period = period;
+        task->EventMask = eventMask;
+        task->NextRun = hsched->GetTick() + period;
+        task->Runs = 0;
+
+        hsched->TaskCount++;
+        status = SCHED_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Change the period of a registered task, it can be called from tasks only.
+ * @param hsched Pointer to the scheduler handle structure.
+ * @param function Task entry given to Sched_AddTask.
+ * @param period Period in ticks, 0 to stop the periodic runs.
+ * @return SCHED_OK if changed, SCHED_ERROR if the task is not registered.
+ */
+uint8_t Sched_SetPeriod(Sched_HandleTypeDef *hsched, Sched_TaskFunction function, uint32_t period)
+{
+    uint8_t status = SCHED_ERROR;
+    Sched_TaskTypeDef *task;
+
+    for (uint8_t i = 0; (i < hsched->TaskCount) && (status != SCHED_OK); i++)
+    {
+        task = &hsched->Tasks[i];
+
+        if (task->Function == function)
+        {
+            task->Period = period;
+            task->NextRun = hsched->GetTick() + period;
+            status = SCHED_OK;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief Set an event, it can be called from interrupts and from tasks.
+ * @param hsched Pointer to the scheduler handle structure.
+ * @param event Event identifier (0 to SCHED_MAX_EVENTS - 1).
+ */
+void Sched_SetEvent(Sched_HandleTypeDef *hsched, uint8_t event)
+{
+    if (event < SCHED_MAX_EVENTS)
+    {
+        hsched->Events[event] = 1; /* Single store, no read-modify-write to protect */
+    }
+}
+
+/**
+ * @brief Check if any event is waiting to be served.
+ * @param hsched Pointer to the scheduler handle structure.
+ * @return 1 if an event is pending, 0 otherwise.
+ */
+uint8_t Sched_EventPending(const Sched_HandleTypeDef *hsched)
+{
+    uint8_t pending = 0;
+
+    for (uint8_t i = 0; i < SCHED_MAX_EVENTS; i++)
+    {
+        pending |= hsched->Events[i];
+    }
+
+    return (pending != 0u) ? 1u : 0u;
+}
+
+/**
+ * @brief Run every ready task once, or the idle hook if none is ready.
+ * @param hsched Pointer to the scheduler handle structure.
+ * @return Number of tasks run.
+ */
+uint32_t Sched_RunOnce(Sched_HandleTypeDef *hsched)
+{
+    Sched_TaskTypeDef *task;
+    uint32_t now = hsched->GetTick();
+    uint32_t events = 0;
+    uint32_t ran = 0;
+    uint8_t ready;
+
+    /* Take the pending events before running the tasks: one set meanwhile is served
+       on the next pass, and one set right before being cleared is covered by this run */
+    for (uint8_t i = 0; i < SCHED_MAX_EVENTS; i++)
+    {
+        if (hsched->Events[i] != 0u)
+        {
+            hsched->Events[i] = 0;
+            events |= SCHED_EVENT_MASK(i);
+        }
+    }
+
+    for (uint8_t i = 0; i < hsched->TaskCount; i++)
+    {
+        task = &hsched->Tasks[i];
+        ready = ((task->EventMask & events) != 0u) ? 1u : 0u;
+
+        if ((task->Period != 0u) && ((int32_t)(now - task->NextRun) >= 0))
+        {
+            ready = 1;
+            task->NextRun += task->Period; /* From the ideal activation time, no drift */
+
+            if ((int32_t)(now - task->NextRun) >= 0)
+            {
+                task->NextRun = now + task->Period; /* Too late, skip the missed periods instead of bursting */
+            }
+        }
+
+        if (ready != 0u)
+        {
+            task->Function();
+            task->Runs++;
+            ran++;
+        }
+    }
+
+    if ((ran == 0u) && (hsched->Idle != NULL))
+    {
+        hsched->IdleCount++;
+        hsched->Idle();
+    }
+
+    return ran;
+}
+
+/**
+ * @brief Run the scheduler forever.
+ * @param hsched Pointer to the scheduler handle structure.
+ */
+void Sched_Run(Sched_HandleTypeDef *hsched)
+{
+    for (;;)
+    {
+        (void)Sched_RunOnce(hsched);
+    }
+}
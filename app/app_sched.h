@@ -0,0 +1,144 @@
+#ifndef __APP_SCHED_H__
+#define __APP_SCHED_H__
+
+#include <stdint.h>
+
+/**
+ * @file app_sched.h
+ * @brief Event driven cooperative scheduler.
+ *
+ * Tasks run to completion in registration order (the first registered has the
+ * highest priority) when their period expires or when one of the events they
+ * wait for is set. Events are one byte flags written by a single store, so
+ * they can be set from interrupts without critical sections. When no task is
+ * ready the idle hook is called, on the target it puts the core to sleep until
+ * the next interrupt. The time base and the idle hook are given by the user.
+ */
+
+/**
+ * @brief Maximum number of tasks.
+ */
+#ifndef SCHED_MAX_TASKS
+#define SCHED_MAX_TASKS 8u
+#endif
+
+/**
+ * @brief Number of event flags (event identifiers go from 0 to SCHED_MAX_EVENTS - 1).
+ */
+#ifndef SCHED_MAX_EVENTS
+#define SCHED_MAX_EVENTS 8u
+#endif
+
+#if (SCHED_MAX_EVENTS > 32u)
+#error "SCHED_MAX_EVENTS can not exceed the 32 bits of the task event masks"
+#endif
+
+#define SCHED_OK      0x00U
+#define SCHED_ERROR   0x01U
+
+/**
+ * @brief Build the event mask of a task from an event identifier.
+ */
+#define SCHED_EVENT_MASK(event) (1UL << (event))
+
+/**
+ * @brief Task entry, it must return as soon as it has nothing else to do.
+ */
+typedef void (*Sched_TaskFunction)(void);
+
+/**
+ * @brief Task control block.
+ */
+typedef struct
+{
+    Sched_TaskFunction Function;    /**< Task entry */
+    uint32_t Period;                /**< Period in ticks, 0 for tasks run only by events */
+    uint32_t EventMask;             /**< Events that make the task ready */
+    uint32_t NextRun;               /**< Tick of the next periodic activation */
+    uint32_t Runs;                  /**< Number of times the task has run */
+} Sched_TaskTypeDef;
+
+/**
+ * @brief Scheduler handler structure.
+ */
+typedef struct
+{
+    Sched_TaskTypeDef Tasks[SCHED_MAX_TASKS];   /**< Registered tasks, in priority order */
+    uint8_t TaskCount;                          /**< Number of registered tasks */
+    volatile uint8_t Events[SCHED_MAX_EVENTS];  /**< Pending events, set to 1 by the producers */
+    uint32_t (*GetTick)(void);                  /**< Time base */
+    void (*Idle)(void);                         /**< Called when no task is ready, may be NULL */
+    uint32_t IdleCount;                         /**< Number of times the idle hook was called */
+} Sched_HandleTypeDef;
+
+/**
+ * @brief Initialize the scheduler without tasks nor pending events.
+ * @param hsched Pointer to the scheduler handle structure.
+ * @param getTick Function returning the current tick.
+ * @param idle Function called when no task is ready, NULL to keep polling.
+ */
+void Sched_Init(Sched_HandleTypeDef *hsched, uint32_t (*getTick)(void), void (*idle)(void));
+
+/**
+ * @brief Register a task.
+ *
+ * Periodic tasks run for the first time one period after being registered.
+ *
+ * @param hsched Pointer to the scheduler handle structure.
+ * @param function Task entry.
+ * @param period Period in ticks, 0 if the task only runs on events.
+ * @param eventMask Events that make the task ready (SCHED_EVENT_MASK), 0 for none.
+ * @return SCHED_OK if registered, SCHED_ERROR if the table is full or the task never runs.
+ */
+uint8_t Sched_AddTask(Sched_HandleTypeDef *hsched, Sched_TaskFunction function, uint32_t period, uint32_t eventMask);
+
+/**
+ * @brief Change the period of a registered task, it can be called from tasks only.
+ *
+ * The next periodic run is one new period from now. A period of 0 leaves the
+ * task to its events, a task without events then sleeps until its period is
+ * set again.
+ *
+ * @param hsched Pointer to the scheduler handle structure.
+ * @param function Task entry given to Sched_AddTask.
+ * @param period Period in ticks, 0 to stop the periodic runs.
+ * @return SCHED_OK if changed, SCHED_ERROR if the task is not registered.
+ */
+uint8_t Sched_SetPeriod(Sched_HandleTypeDef *hsched, Sched_TaskFunction function, uint32_t period);
+
+/**
+ * @brief Set an event, it can be called from interrupts and from tasks.
+ *
+ * Setting an event already pending has no effect, tasks must consume all the
+ * work available every time they run.
+ *
+ * @param hsched Pointer to the scheduler handle structure.
+ * @param event Event identifier (0 to SCHED_MAX_EVENTS - 1).
+ */
+void Sched_SetEvent(Sched_HandleTypeDef *hsched, uint8_t event);
+
+/**
+ * @brief Check if any event is waiting to be served.
+ *
+ * The idle hook must check it with interrupts disabled right before sleeping,
+ * so an event set after the scheduler decided to go idle is never missed.
+ *
+ * @param hsched Pointer to the scheduler handle structure.
+ * @return 1 if an event is pending, 0 otherwise.
+ */
+uint8_t Sched_EventPending(const Sched_HandleTypeDef *hsched);
+
+/**
+ * @brief Run every ready task once, or the idle hook if none is ready.
+ * @param hsched Pointer to the scheduler handle structure.
+ * @return Number of tasks run.
+ */
+uint32_t Sched_RunOnce(Sched_HandleTypeDef *hsched);
+
+/**
+ * @brief Run the scheduler forever.
+ * @param hsched Pointer to the scheduler handle structure.
+ */
+void Sched_Run(Sched_HandleTypeDef *hsched);
+
+#endif // __APP_SCHED_H__
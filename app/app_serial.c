@@ -6,262 +6,1225 @@
 /* Add more includes as needed */
 #include "app_bsp.h"
 #include "app_serial.h"
+#include "app_canring.h"
+#include "app_cantx.h"
+#include "app_canfilter.h"
+#include "app_cantp.h"
+#include "app_bittiming.h"
+#include "app_sched.h"
+#include "app_bench.h"
+#include "app_dispatch.h"
+#include "app_queue.h"
+#include "app_timer.h"
 
 #define NIBBLE_LSB_EXTRACTOR 0x0F
 #define CAN_FILTER_ID 0x111
 #define CAN_MESSAGE_ID 0x122
+#define CAN_URGENT_ID 0x110          /* Urgent commands, received in RX FIFO 1 */
+#define CAN_URGENT_MESSAGE_ID 0x121  /* Responses to the urgent commands */
 #define CAN_OK_MESSAGE_BYTE 0x55
 #define CAN_ERROR_MESSAGE_BYTE 0xAA
+#define CAN_SELFTEST_ID 0x7FF
+#define CAN_SELFTEST_TIMEOUT 10u /* Milliseconds to get the loopback frame back */
+#define SERIAL_RX_CHANNELS 2u    /* Urgent and command channels */
+#define SERIAL_RX_URGENT 0u      /* Channel of RX FIFO 1 */
+#define SERIAL_RX_COMMAND 1u     /* Channel of RX FIFO 0 */
+#define SERIAL_ACK_SIZE 7u       /* Longest OK/ERROR response, shorter requests get a response as long as them */
+
+/* Longest response, the probe records of the benchmark dump */
+#if (BENCH_ENABLED != 0u)
+#define SERIAL_RESPONSE_SIZE BENCH_RECORD_SIZE
+#else
+#define SERIAL_RESPONSE_SIZE SERIAL_ACK_SIZE
+#endif
+
+/* The HAL copies the whole payload straight into the ring slots */
+#if (SERIAL_CAN_FD != 0u) && (CAN_RING_PAYLOAD_SIZE < CANTP_FD_FRAME_SIZE)
+#error "CAN_RING_PAYLOAD_SIZE must hold 64 bytes CAN FD frames"
+#endif
 
 /* Add more global variables, definitions, and/or prototypes as needed */
+/* Reception channel: the ring its RX FIFO interrupt fills and the transport layer reassembling its messages */
+typedef struct
+{
+    uint32_t Fifo;                  /* FDCAN_RX_FIFO0 or FDCAN_RX_FIFO1 */
+    CanRing_HandleTypeDef *Ring;    /* Frames queued by the interrupt */
+    CanTp_HandleTypeDef *Tp;        /* Transport layer of the channel */
+    uint32_t Timestamp;             /* Start of the last frame handed to the transport layer, in microseconds */
+    uint8_t Held;                   /* Ring slot kept until the request it completed is answered */
+    volatile uint8_t DrainPending;  /* Budget spent with frames left in the FIFO, read by Serial_Task */
+} Serial_ChannelTypeDef;
+
 FDCAN_HandleTypeDef CANHandler;  /* Structure type variable for CAN initialization */
-FDCAN_RxHeaderTypeDef CANRxHeader; /* CAN Rx header structure */
 FDCAN_TxHeaderTypeDef CANTxHeader; /* CAN Tx header structure */
-FDCAN_FilterTypeDef CANFilter;     /* CAN filter structure */
+CanFilter_HandleTypeDef CANFilters; /* Identifiers received, compiled into the FDCAN filter elements */
 
-static uint8_t RxData[8] = {0}; /* Buffer to save the message to receive */
+CanRing_HandleTypeDef CANRxRing; /* Frames received by the ISR waiting for Serial_Task */
+CanRing_HandleTypeDef CANUrgentRing; /* Frames received in RX FIFO 1, served before CANRxRing */
+CanTx_HandleTypeDef CANTxQueue;   /* Frames waiting for room in the TX FIFO */
+CanTp_HandleTypeDef CANTpHandle;  /* ISO-TP transport layer for the command/response channel */
+CanTp_HandleTypeDef CANTpUrgent;  /* ISO-TP transport layer for the urgent command/response channel */
 
-uint8_t message; /* Auxiliary flag to handle CAN message reception */
-
-extern APP_MsgTypeDef Msg; /* Application message structure */
+/* Reception channels in service order, the urgent commands first */
+static Serial_ChannelTypeDef RxChannels[SERIAL_RX_CHANNELS] =
+{
+    {FDCAN_RX_FIFO1, &CANUrgentRing, &CANTpUrgent, 0, 0, 0},
+    {FDCAN_RX_FIFO0, &CANRxRing, &CANTpHandle, 0, 0, 0}
+};
+static Serial_ChannelTypeDef *RxChannel = &RxChannels[SERIAL_RX_COMMAND]; /* Channel the message being processed came from */
+static const uint8_t *RxData;   /* Message being processed, read in place until released */
+static uint8_t RxDiscard[CAN_RING_PAYLOAD_SIZE]; /* Scratch buffer to flush the FIFO when the ring is full */
+static Dispatch_HandleTypeDef Dispatcher;       /* Command messages by type */
+static uint8_t Response[SERIAL_RESPONSE_SIZE];  /* Response to the message being processed */
+static uint16_t ResponseSize;                   /* Length of the response */
+static States SerialState = IDLE_STATE;         /* Request processing state */
+
+extern Queue_HandleTypeDef ClockQueue; /* Validated commands for the clock task */
+
+extern Sched_HandleTypeDef Scheduler; /* Scheduler running the tasks */
+
+extern Bench_HandleTypeDef Bench; /* Execution time probes */
+
+extern Timer_HandleTypeDef Timers; /* Software timers */
+
+static Timer_TypeDef SerialTpTimer; /* Wakes Serial_Task when a transport layer deadline is due */
+
+static Serial_RxStatsTypeDef CANRxStats; /* Reception interrupt statistics */
+
+static volatile uint8_t TxRefused; /* A transmission was refused because the queue was full */
+
+static uint32_t CANBitRate = SERIAL_CAN_BITRATE;          /* Nominal bit rate in use */
+static uint32_t CANDataBitRate = SERIAL_CAN_DATA_BITRATE; /* CAN FD data phase bit rate in use */
+
+/* Private function prototypes */
+static uint8_t Serial_ConfigFdcan(uint32_t mode, uint32_t frameFormat);
+static void Serial_StartFdcan(void);
+static void Serial_ConfigFilters(uint32_t mode);
+static void Serial_LockRx(void);
+static void Serial_UnlockRx(void);
+static uint32_t Serial_DrainRxFifo(FDCAN_HandleTypeDef *hfdcan, Serial_ChannelTypeDef *channel);
+static void Serial_ReadRxFifo(FDCAN_HandleTypeDef *hfdcan, uint32_t fifo, CanRing_HandleTypeDef *ring);
+static void Serial_FillTxFifo(FDCAN_HandleTypeDef *hfdcan);
+static void Serial_DrainPending(void);
+static void Serial_ArmTpTimer(void);
+static void Serial_TpTimerCallback(void *context);
+static void Serial_ReleaseRequest(void);
+static uint8_t Serial_ServeFrame(void);
+static void Serial_SendResponse(void);
+static void Serial_ProcessRequest(uint16_t size);
+static void Serial_SetResponse(uint8_t code, uint16_t length);
+static void Serial_DecodeTime(const uint8_t *data, uint16_t size, void *message);
+static uint8_t Serial_ValidateTime(const void *message);
+static void Serial_DecodeDate(const uint8_t *data, uint16_t size, void *message);
+static uint8_t Serial_ValidateDate(const void *message);
+static uint16_t Serial_HandleDate(const void *message, uint8_t *response);
+static void Serial_DecodeAlarm(const uint8_t *data, uint16_t size, void *message);
+static uint8_t Serial_ValidateAlarm(const void *message);
+static uint16_t Serial_PostToClock(const void *message, uint8_t *response);
+#if (BENCH_ENABLED != 0u)
+static uint8_t Serial_ValidateBench(const void *message);
+static uint16_t Serial_HandleBench(const void *message, uint8_t *response);
+#endif
+static uint8_t Serial_CanTpTxFrame(const uint8_t *data, uint8_t length);
+static uint8_t Serial_CanTpUrgentTxFrame(const uint8_t *data, uint8_t length);
+static uint8_t CanDlcToBytes(uint32_t dlc);
+static uint32_t CanBytesToDlc(uint8_t bytes);
+
+/* Command messages: type, shortest payload (type included), decoder, validator and handler */
+static const Dispatch_EntryTypeDef SerialCommands[] =
+{
+    {SERIAL_MSG_TIME, 4u, Serial_DecodeTime, Serial_ValidateTime, Serial_PostToClock},
+    {SERIAL_MSG_DATE, 5u, Serial_DecodeDate, Serial_ValidateDate, Serial_HandleDate},
+    {SERIAL_MSG_ALARM, 3u, Serial_DecodeAlarm, Serial_ValidateAlarm, Serial_PostToClock},
+#if (BENCH_ENABLED != 0u)
+    {SERIAL_MSG_BENCH, 2u, NULL, Serial_ValidateBench, Serial_HandleBench},
+#endif
+};
 
 /* Functions */
 /**
  * @brief Callback for CAN FIFO 0 message reception
+ *
+ * Every element pending in the hardware FIFO is moved to the reception ring,
+ * up to SERIAL_RX_DRAIN_BUDGET frames per interrupt, the frames left are read
+ * by Serial_Task.
+ *
  * @param hfdcan FDCAN handle
  * @param RxFifo0ITs FIFO 0 interrupt status
  */
 void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
 {
-    /* Retrieve Rx messages from RX FIFO 0 */
-    HAL_FDCAN_GetRxMessage(hfdcan, FDCAN_RX_FIFO0, &CANRxHeader, RxData);
+    uint32_t batch; /* Frames read during this interrupt */
+
+    BENCH_BEGIN(&Bench, APP_PROBE_FDCAN_ISR);
+
+    if ((RxFifo0ITs & FDCAN_IT_RX_FIFO0_FULL) != 0u)
+    {
+        CANRxStats.FifoFull++;
+    }
+
+    if ((RxFifo0ITs & FDCAN_IT_RX_FIFO0_MESSAGE_LOST) != 0u)
+    {
+        CANRxStats.FifoLost++;
+    }
+
+    Serial_LockRx();
+
+    /* Drain the FIFO instead of reading only the element that raised the interrupt */
+    batch = Serial_DrainRxFifo(hfdcan, &RxChannels[SERIAL_RX_COMMAND]);
+
+    if (RxChannels[SERIAL_RX_COMMAND].DrainPending != 0u)
+    {
+        CANRxStats.BudgetExhausted++;
+    }
+
+    Serial_UnlockRx();
+
+    /* Wake up Serial_Task right away instead of waiting for its next period */
+    if (batch > 0u)
+    {
+        Sched_SetEvent(&Scheduler, APP_EVENT_SERIAL);
+    }
+
+    /* Per interrupt batch statistics */
+    CANRxStats.Interrupts++;
+    CANRxStats.Frames += batch;
+    CANRxStats.BatchHistogram[batch]++;
+
+    if (batch > CANRxStats.MaxBatch)
+    {
+        CANRxStats.MaxBatch = batch;
+    }
+
+    BENCH_END(&Bench, APP_PROBE_FDCAN_ISR);
+}
+
+/**
+ * @brief Callback for CAN FIFO 1 message reception, the urgent commands
+ *
+ * Served on interrupt line 1, whose priority is above line 0, so an urgent
+ * frame does not wait for a burst in FIFO 0 to be moved. The callback may
+ * also run from HAL_FDCAN_IRQHandler on line 0 when it finds the FIFO 1 flags
+ * still set, the reception lock keeps line 1 from adding a frame halfway
+ * through. As in FIFO 0, the frames a spent budget leaves are read by Serial_Task.
+ *
+ * @param hfdcan FDCAN handle
+ * @param RxFifo1ITs FIFO 1 interrupt status
+ */
+void HAL_FDCAN_RxFifo1Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo1ITs)
+{
+    uint32_t batch; /* Frames read during this interrupt */
+
+    Serial_LockRx();
+
+    if ((RxFifo1ITs & FDCAN_IT_RX_FIFO1_MESSAGE_LOST) != 0u)
+    {
+        CANRxStats.UrgentLost++;
+    }
+
+    batch = Serial_DrainRxFifo(hfdcan, &RxChannels[SERIAL_RX_URGENT]);
+
+    if (RxChannels[SERIAL_RX_URGENT].DrainPending != 0u)
+    {
+        CANRxStats.BudgetExhausted++;
+    }
+
+    CANRxStats.UrgentFrames += batch;
+
+    Serial_UnlockRx();
+
+    if (batch > 0u)
+    {
+        Sched_SetEvent(&Scheduler, APP_EVENT_SERIAL);
+    }
+}
+
+/**
+ * @brief Callback for CAN transmission completed
+ *
+ * A TX FIFO element is free again, it is refilled from the transmission queue
+ * and the tasks whose frames were refused are woken up to try again.
+ *
+ * @param hfdcan FDCAN handle
+ * @param BufferIndexes Buffers whose transmission completed
+ */
+void HAL_FDCAN_TxBufferCompleteCallback(FDCAN_HandleTypeDef *hfdcan, uint32_t BufferIndexes)
+{
+    (void)BufferIndexes;
+
+    Serial_FillTxFifo(hfdcan);
+
+    if (TxRefused != 0u)
+    {
+        TxRefused = 0;
+        Sched_SetEvent(&Scheduler, APP_EVENT_SERIAL);
+        Sched_SetEvent(&Scheduler, APP_EVENT_CAN);
+    }
+}
+
+/**
+ * @brief Queue a frame for transmission
+ * @param identifier Standard CAN identifier, the lowest one is sent first
+ * @param data Frame payload, copied
+ * @param length Number of bytes to send, up to 8 (64 with CAN FD)
+ * @return SERIAL_OK if queued, SERIAL_ERROR if the queue is full or the length too long
+ */
+uint8_t Serial_CanTransmit(uint32_t identifier, const uint8_t *data, uint8_t length)
+{
+    APP_CanFrameTypeDef frame;
+    uint8_t status = SERIAL_ERROR;
 
-    message = 1u; /* Set flag after the message has been received */
+    if (length <= CAN_RING_PAYLOAD_SIZE)
+    {
+        frame.Identifier = identifier;
+        frame.Timestamp = 0;
+        frame.IdType = 0;
+        frame.Length = length;
+        frame.Flags = (CANTxHeader.FDFormat == FDCAN_FD_CAN) ? CAN_FRAME_FLAG_FD : 0u;
+        frame.Flags |= (CANTxHeader.BitRateSwitch == FDCAN_BRS_ON) ? CAN_FRAME_FLAG_BRS : 0u;
+
+        for (uint8_t i = 0; i < length; i++)
+        {
+            frame.Data[i] = data[i];
+        }
+
+        /* The TX complete interrupt takes frames out of the queue too */
+        __disable_irq();
+
+        if (CanTx_Push(&CANTxQueue, &frame) == CANTX_OK)
+        {
+            status = SERIAL_OK;
+        }
+        else
+        {
+            TxRefused = 1;
+        }
+
+        Serial_FillTxFifo(&CANHandler);
+
+        __enable_irq();
+    }
+
+    return status;
 }
 
 /**
- * @brief Handle the reception of single-frame CAN messages
- * @param data Pointer to received data
- * @param size Pointer to size of the payload
- * @return 1 if successful, 0 otherwise
+ * @brief Get the transmission queue statistics
+ * @return Pointer to the statistics, updated from the FDCAN interrupt
+ */
+const CanTx_StatsTypeDef *Serial_GetTxStats(void)
+{
+    return &CANTxQueue.Stats;
+}
+
+/**
+ * @brief Move the frames with the highest priority from the transmission queue to the TX FIFO
+ *
+ * The interrupts must be masked or the caller must be the FDCAN interrupt.
+ *
+ * @param hfdcan FDCAN handle
  */
-static uint8_t CanTp_SingleFrameRx(uint8_t *data, uint8_t *size)
+static void Serial_FillTxFifo(FDCAN_HandleTypeDef *hfdcan)
 {
-    uint8_t nibbleMSB = (data[0] >> 4) & NIBBLE_LSB_EXTRACTOR; /* MSB */
-    uint8_t nibbleLSB = data[0] & NIBBLE_LSB_EXTRACTOR; /* LSB */
-    uint8_t returnValue = 0;
-    size[0] = nibbleLSB;
+    FDCAN_TxHeaderTypeDef txHeader = {0};
+    const APP_CanFrameTypeDef *frame = CanTx_Peek(&CANTxQueue);
 
-    if ((nibbleMSB == 0) && ((nibbleLSB > 0) && (nibbleLSB <= 7)))
+    txHeader.TxFrameType = FDCAN_DATA_FRAME;
+
+    while ((frame != NULL) && (HAL_FDCAN_GetTxFifoFreeLevel(hfdcan) > 0u))
     {
-        for (uint8_t i = 0; i < size[0]; i++)
+        txHeader.Identifier = frame->Identifier;
+        txHeader.IdType = (frame->IdType != 0u) ? FDCAN_EXTENDED_ID : FDCAN_STANDARD_ID;
+        txHeader.DataLength = CanBytesToDlc(frame->Length);
+        txHeader.FDFormat = ((frame->Flags & CAN_FRAME_FLAG_FD) != 0u) ? FDCAN_FD_CAN : FDCAN_CLASSIC_CAN;
+        txHeader.BitRateSwitch = ((frame->Flags & CAN_FRAME_FLAG_BRS) != 0u) ? FDCAN_BRS_ON : FDCAN_BRS_OFF;
+
+        if (HAL_FDCAN_AddMessageToTxFifoQ(hfdcan, &txHeader, (uint8_t *)frame->Data) == HAL_OK)
         {
-            data[i] = data[i + 1]; /* Unpacking */
+            CanTx_Release(&CANTxQueue);
+            frame = CanTx_Peek(&CANTxQueue);
         }
+        else
+        {
+            /* Controller stopped, the frame waits for the next transmission or completion */
+            frame = NULL;
+        }
+    }
+}
+
+/**
+ * @brief Keep both FDCAN interrupt lines out while the reception rings are filled
+ *
+ * Line 0 may run the FIFO 1 callback too and Serial_Task reads the frames a spent
+ * budget left, so each ring has more than one producer. Only the two lines are
+ * masked in the NVIC, the timestamp timer and the other interrupts keep running.
+ */
+static void Serial_LockRx(void)
+{
+    HAL_NVIC_DisableIRQ(TIM17_FDCAN_IT1_IRQn);
+    HAL_NVIC_DisableIRQ(TIM16_FDCAN_IT0_IRQn);
+}
+
+/**
+ * @brief Let the FDCAN interrupt lines in again, the ones raised meanwhile are served now
+ */
+static void Serial_UnlockRx(void)
+{
+    HAL_NVIC_EnableIRQ(TIM16_FDCAN_IT0_IRQn);
+    HAL_NVIC_EnableIRQ(TIM17_FDCAN_IT1_IRQn);
+}
+
+/**
+ * @brief Move the elements of a channel RX FIFO to its ring, up to SERIAL_RX_DRAIN_BUDGET
+ *
+ * Called with the reception lock held. The new message flag was cleared before the
+ * callbacks run, so pending the line again would not come back: when the budget is
+ * spent with frames left, DrainPending asks Serial_Task to read them.
+ *
+ * @param hfdcan FDCAN handle
+ * @param channel Reception channel of the FIFO
+ * @return Number of frames read
+ */
+static uint32_t Serial_DrainRxFifo(FDCAN_HandleTypeDef *hfdcan, Serial_ChannelTypeDef *channel)
+{
+    uint32_t batch = 0; /* Frames read during this call */
+
+    channel->DrainPending = 0;
+
+    while ((batch < SERIAL_RX_DRAIN_BUDGET) && (HAL_FDCAN_GetRxFifoFillLevel(hfdcan, channel->Fifo) > 0u))
+    {
+        Serial_ReadRxFifo(hfdcan, channel->Fifo, channel->Ring);
+        batch++;
+    }
+
+    if (HAL_FDCAN_GetRxFifoFillLevel(hfdcan, channel->Fifo) > 0u)
+    {
+        channel->DrainPending = 1; /* Budget spent, Serial_Task reads the rest */
+    }
+
+    return batch;
+}
+
+/**
+ * @brief Move one element from an RX FIFO to its reception ring
+ *
+ * The header is local, both FIFO callbacks run at different interrupt priorities.
+ *
+ * @param hfdcan FDCAN handle
+ * @param fifo FDCAN_RX_FIFO0 or FDCAN_RX_FIFO1
+ * @param ring Reception ring of the FIFO
+ */
+static void Serial_ReadRxFifo(FDCAN_HandleTypeDef *hfdcan, uint32_t fifo, CanRing_HandleTypeDef *ring)
+{
+    FDCAN_RxHeaderTypeDef rxHeader;
+    APP_CanFrameTypeDef *frame = CanRing_Reserve(ring);
+    uint32_t now;
+
+    if (frame != NULL)
+    {
+        /* Retrieve Rx messages from the RX FIFO straight into the ring slot */
+        HAL_FDCAN_GetRxMessage(hfdcan, fifo, &rxHeader, frame->Data);
+
+        frame->Identifier = rxHeader.Identifier;
+        frame->IdType = (rxHeader.IdType == FDCAN_EXTENDED_ID) ? 1u : 0u;
+        frame->Length = CanDlcToBytes(rxHeader.DataLength);
+        frame->Flags = (rxHeader.FDFormat == FDCAN_FD_CAN) ? CAN_FRAME_FLAG_FD : 0u;
+        frame->Flags |= (rxHeader.BitRateSwitch == FDCAN_BRS_ON) ? CAN_FRAME_FLAG_BRS : 0u;
+        /* The controller captured the 16 low bits of the counter at the start of frame, the frame
+           is younger than a wrap around (65 ms), so its age is enough to rebuild the whole value */
+        now = Serial_TimestampRead();
+        frame->Timestamp = now - ((now - rxHeader.RxTimestamp) & 0xFFFFu);
+
+        CanRing_Commit(ring); /* Make the frame visible to Serial_Task */
+    }
+    else
+    {
+        /* Ring is full (already counted as overflow), release the FIFO element anyway */
+        HAL_FDCAN_GetRxMessage(hfdcan, fifo, &rxHeader, RxDiscard);
+    }
+}
+
+/**
+ * @brief Convert an FDCAN data length code into a number of bytes
+ * @param dlc Data length code as found in the FDCAN headers
+ * @return Number of payload bytes
+ */
+static uint8_t CanDlcToBytes(uint32_t dlc)
+{
+    static const uint8_t dlcBytes[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+    return dlcBytes[(dlc >> 16) & 0x0F];
+}
+
+/**
+ * @brief Convert a number of bytes into the FDCAN data length code able to carry them
+ * @param bytes Number of payload bytes (up to 64)
+ * @return Data length code as expected in the FDCAN headers
+ */
+static uint32_t CanBytesToDlc(uint8_t bytes)
+{
+    uint32_t dlc = 0;
 
-        returnValue = 1;
+    while ((dlc < 15u) && (CanDlcToBytes(dlc << 16) < bytes))
+    {
+        dlc++;
     }
 
-    return returnValue;
+    return dlc << 16;
 }
 
+/**
+ * @brief Send one transport layer frame as a response message
+ * @param data Frame payload
+ * @param length Number of bytes to send, the transport layer only uses valid FD lengths
+ * @return CANTP_OK if the frame is queued, CANTP_ERROR if the queue is full (retried by the transport layer)
+ */
+static uint8_t Serial_CanTpTxFrame(const uint8_t *data, uint8_t length)
+{
+    uint8_t status = CANTP_ERROR;
+
+    if (Serial_CanTransmit(CAN_MESSAGE_ID, data, length) == SERIAL_OK)
+    {
+        status = CANTP_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Send one transport layer frame as a response to an urgent command
+ * @param data Frame payload
+ * @param length Number of bytes to send
+ * @return CANTP_OK if the frame is queued, CANTP_ERROR if the queue is full (retried by the transport layer)
+ */
+static uint8_t Serial_CanTpUrgentTxFrame(const uint8_t *data, uint8_t length)
+{
+    uint8_t status = CANTP_ERROR;
+
+    if (Serial_CanTransmit(CAN_URGENT_MESSAGE_ID, data, length) == SERIAL_OK)
+    {
+        status = CANTP_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Configure the FDCAN bit timing and operating mode
+ *
+ * The time segments are computed from the FDCAN kernel clock for the current
+ * bit rates and sample points, with the reset values (16MHz HSI, 100Kbps at 75%)
+ * the nominal phase gets 160 time quanta of 62.5ns: prescaler 1, seg1 119 and
+ * seg2 40, and the 2Mbps data phase 8 quanta: prescaler 1, seg1 5 and seg2 2.
+ *
+ * @param mode FDCAN operating mode (FDCAN_MODE_NORMAL, FDCAN_MODE_INTERNAL_LOOPBACK, ...)
+ * @param frameFormat FDCAN_FRAME_CLASSIC or FDCAN_FRAME_FD_BRS
+ * @return SERIAL_OK if configured, SERIAL_ERROR if a bit rate can not be reached (FDCAN untouched)
+ */
+static uint8_t Serial_ConfigFdcan(uint32_t mode, uint32_t frameFormat)
+{
+    APP_BitTimingTypeDef nominal;
+    APP_BitTimingTypeDef data;
+    uint32_t clock = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_FDCAN);
+    uint8_t status = SERIAL_ERROR;
+
+    if ((BitTiming_Calculate(clock, CANBitRate, SERIAL_CAN_SAMPLE_POINT, BITTIMING_NOMINAL, &nominal) == BITTIMING_OK) &&
+        (BitTiming_Calculate(clock, CANDataBitRate, SERIAL_CAN_DATA_SAMPLE_POINT, BITTIMING_DATA, &data) == BITTIMING_OK))
+    {
+        CANHandler.Instance = FDCAN1;
+        CANHandler.Init.Mode = mode;
+        CANHandler.Init.FrameFormat = frameFormat;
+        CANHandler.Init.ClockDivider = FDCAN_CLOCK_DIV1;             /* No APB divider for FDCAN module */
+        CANHandler.Init.TxFifoQueueMode = FDCAN_TX_FIFO_OPERATION;   /* Tx buffer in Fifo mode */
+        CANHandler.Init.NominalPrescaler = nominal.Prescaler;
+        CANHandler.Init.NominalSyncJumpWidth = nominal.SyncJumpWidth;
+        CANHandler.Init.NominalTimeSeg1 = nominal.TimeSeg1;          /* Phase time seg1 + prop seg */
+        CANHandler.Init.NominalTimeSeg2 = nominal.TimeSeg2;          /* Phase time seg2 */
+        CANHandler.Init.DataPrescaler = data.Prescaler;
+        CANHandler.Init.DataSyncJumpWidth = data.SyncJumpWidth;
+        CANHandler.Init.DataTimeSeg1 = data.TimeSeg1;
+        CANHandler.Init.DataTimeSeg2 = data.TimeSeg2;
+        CANHandler.Init.StdFiltersNbr = (mode == FDCAN_MODE_INTERNAL_LOOPBACK) ? 0u : CANFilters.StdCount;
+        CANHandler.Init.ExtFiltersNbr = (mode == FDCAN_MODE_INTERNAL_LOOPBACK) ? 0u : CANFilters.ExtCount;
+        HAL_FDCAN_Init(&CANHandler);
+        Serial_ConfigFilters(mode);
+
+        /* Frames timestamped with the TIM3 microsecond counter, the prescaler only applies to the internal one */
+        HAL_FDCAN_ConfigTimestampCounter(&CANHandler, FDCAN_TIMESTAMP_PRESC_1);
+        HAL_FDCAN_EnableTimestampCounter(&CANHandler, FDCAN_TIMESTAMP_EXTERNAL);
+
+        if (frameFormat == FDCAN_FRAME_FD_BRS)
+        {
+            /* At data phase bit rates the transceiver loop delay is a big part of the bit, the
+               secondary sample point is placed at the data phase sample point plus the measured delay */
+            HAL_FDCAN_ConfigTxDelayCompensation(&CANHandler, CANHandler.Init.DataPrescaler * CANHandler.Init.DataTimeSeg1, 0);
+            HAL_FDCAN_EnableTxDelayCompensation(&CANHandler);
+        }
+
+        status = SERIAL_OK;
+    }
+
+    return status;
+}
 
 /**
- * @brief Handle the transmission of single-frame CAN messages
- * @param data Pointer to data to be transmitted
- * @param size Size of the data to be transmitted
+ * @brief Write the filter elements of the table and reject the frames matching none of them
+ *
+ * In internal loopback mode every frame is accepted in FIFO 0 instead, the
+ * self test frame must come back whatever its identifier.
+ *
+ * @param mode FDCAN operating mode the controller was initialized with
  */
-static void CanTp_SingleFrameTx(uint8_t *data, uint8_t size)
+static void Serial_ConfigFilters(uint32_t mode)
 {
-    data[0] = (0 << 4) | (size & NIBBLE_LSB_EXTRACTOR); /* Packing */
+    FDCAN_FilterTypeDef filter;
+    const CanFilter_ElementTypeDef *element;
+
+    if (mode == FDCAN_MODE_INTERNAL_LOOPBACK)
+    {
+        HAL_FDCAN_ConfigGlobalFilter(&CANHandler, FDCAN_ACCEPT_IN_RX_FIFO0, FDCAN_ACCEPT_IN_RX_FIFO0, FDCAN_REJECT_REMOTE, FDCAN_REJECT_REMOTE);
+    }
+    else
+    {
+        /* The element types of the table have the values of the FDCAN ones */
+        for (uint8_t i = 0; i < (CANFilters.StdCount + CANFilters.ExtCount); i++)
+        {
+            element = (i < CANFilters.StdCount) ? &CANFilters.Std[i] : &CANFilters.Ext[i - CANFilters.StdCount];
+            filter.IdType = (element->IdType == CAN_FILTER_EXTENDED) ? FDCAN_EXTENDED_ID : FDCAN_STANDARD_ID;
+            filter.FilterIndex = (i < CANFilters.StdCount) ? i : (uint32_t)(i - CANFilters.StdCount);
+            filter.FilterType = element->Type;
+            filter.FilterConfig = (element->Fifo == 1u) ? FDCAN_FILTER_TO_RXFIFO1 : FDCAN_FILTER_TO_RXFIFO0;
+            filter.FilterID1 = element->Id1;
+            filter.FilterID2 = element->Id2;
+            HAL_FDCAN_ConfigFilter(&CANHandler, &filter);
+        }
 
-    HAL_FDCAN_AddMessageToTxFifoQ(&CANHandler, &CANTxHeader, data);
+        /* Frames nobody registered never reach the message RAM, nor the CPU */
+        HAL_FDCAN_ConfigGlobalFilter(&CANHandler, FDCAN_REJECT, FDCAN_REJECT, FDCAN_REJECT_REMOTE, FDCAN_REJECT_REMOTE);
+    }
 }
 
+/**
+ * @brief Leave initialization mode and enable the reception and transmission interrupts
+ */
+static void Serial_StartFdcan(void)
+{
+    /* Change FDCAN instance from initialization mode to normal mode */
+    HAL_FDCAN_Start(&CANHandler);
+
+    /* Enable reception interrupts when a message arrives on FIFO 0, when it gets full
+       and when a message is lost because it was already full */
+    HAL_FDCAN_ActivateNotification(&CANHandler, FDCAN_IT_RX_FIFO0_NEW_MESSAGE | FDCAN_IT_RX_FIFO0_FULL | FDCAN_IT_RX_FIFO0_MESSAGE_LOST, 0);
+
+    /* The urgent frames of FIFO 1 get interrupt line 1, it has its own higher NVIC priority */
+    HAL_FDCAN_ConfigInterruptLines(&CANHandler, FDCAN_IT_GROUP_RX_FIFO1, FDCAN_INTERRUPT_LINE1);
+    HAL_FDCAN_ActivateNotification(&CANHandler, FDCAN_IT_RX_FIFO1_NEW_MESSAGE | FDCAN_IT_RX_FIFO1_MESSAGE_LOST, 0);
+
+    /* Refill the TX FIFO from the transmission queue every time one of its elements is sent */
+    HAL_FDCAN_ActivateNotification(&CANHandler, FDCAN_IT_TX_COMPLETE, FDCAN_TX_BUFFER0 | FDCAN_TX_BUFFER1 | FDCAN_TX_BUFFER2);
+}
 
 /**
  * @brief Initialize the CAN bus
  */
 void Serial_Init(void)
 {
-    /* FDCAN1 module to transmit up to 100Kbps and sample point of 75% */
-    /* fCAN = fHSI / CANHandler.Init.ClockDivider / CANHandler.Init.NominalPrescaler */
-    /* fCAN = 16MHz / 1 / 10 = 1.6MHz */
-    /* Time quantas: */
-    /* Ntq = fCAN / CANbaudrate */
-    /* Ntq = 1.6MHz / 100Kbps = 16 */
-    /* Sample point: */
-    /* Sp = (CANHandler.Init.NominalTimeSeg1 + 1 / Ntq) * 100 */
-    /* Sp = ((11 + 1) / 16) * 100 = 75% */
-    CANHandler.Instance = FDCAN1;
-    CANHandler.Init.Mode = FDCAN_MODE_NORMAL;                    /* CAN Classic mode */
-    CANHandler.Init.FrameFormat = FDCAN_FRAME_CLASSIC;           /* Classic frame */
-    CANHandler.Init.ClockDivider = FDCAN_CLOCK_DIV1;             /* No APB divider for FDCAN module */
-    CANHandler.Init.TxFifoQueueMode = FDCAN_TX_FIFO_OPERATION;   /* Tx buffer in Fifo mode */
-    CANHandler.Init.NominalPrescaler = 10;                       /* CAN clock divider by 10 */
-    CANHandler.Init.NominalSyncJumpWidth = 1;                    /* SWJ of 1 */
-    CANHandler.Init.NominalTimeSeg1 = 11;                        /* Phase time seg1 + prop seg */
-    CANHandler.Init.NominalTimeSeg2 = 4;                         /* Phase time seg2 */
-    HAL_FDCAN_Init(&CANHandler);
+    uint32_t frameFormat = FDCAN_FRAME_CLASSIC;
+
+    /* The timestamp counter must run before the controller samples it */
+    Serial_TimestampStart();
+
+    /* Reception filters: the command channel ID 0x111 gets to RX FIFO 0, the urgent one 0x110 to RX FIFO 1 */
+    CanFilter_Init(&CANFilters);
+    CanFilter_AddId(&CANFilters, CAN_FILTER_STANDARD, CAN_FILTER_ID, CAN_FILTER_PRIORITY_NORMAL);
+    CanFilter_AddId(&CANFilters, CAN_FILTER_STANDARD, CAN_URGENT_ID, CAN_FILTER_PRIORITY_HIGH);
+    CanFilter_Build(&CANFilters);
+
+    /* Command messages, a new type only needs its entry in SerialCommands */
+    Dispatch_Init(&Dispatcher);
+    Dispatch_Register(&Dispatcher, SerialCommands, sizeof(SerialCommands) / sizeof(SerialCommands[0]));
+
+#if (SERIAL_CAN_FD != 0u)
+    /* Only join the bus with FD frames if they survive the loopback round trip,
+       otherwise stay with classic frames every node understands */
+    if (Serial_FdSelfTest() == SERIAL_OK)
+    {
+        frameFormat = FDCAN_FRAME_FD_BRS;
+    }
+#endif
+
+    Serial_ConfigFdcan(FDCAN_MODE_NORMAL, frameFormat);
 
     /* Set option to transmit the messages */
     CANTxHeader.IdType = FDCAN_STANDARD_ID;  /* 11 bits CAN ID */
-    CANTxHeader.FDFormat = FDCAN_CLASSIC_CAN; /* Classic CAN format up to 8 bytes */
     CANTxHeader.TxFrameType = FDCAN_DATA_FRAME; /* Type of frame data */
     CANTxHeader.Identifier = CAN_MESSAGE_ID; /* CAN message ID */
     CANTxHeader.DataLength = FDCAN_DLC_BYTES_8; /* 8 bytes to transmit */
 
-    /* Configure reception filters to Rx FIFO 0, the filter will only accept ID 0x111 */
-    CANFilter.IdType = FDCAN_STANDARD_ID;       /* 11 bits ID */
-    CANFilter.FilterIndex = 0;
-    CANFilter.FilterType = FDCAN_FILTER_MASK;
-    CANFilter.FilterConfig = FDCAN_FILTER_TO_RXFIFO0; /* Filter on FIFO 0 */
-    CANFilter.FilterID1 = CAN_FILTER_ID; /* Filter ID */
+    if (frameFormat == FDCAN_FRAME_FD_BRS)
+    {
+        CANTxHeader.FDFormat = FDCAN_FD_CAN;        /* CAN FD format up to 64 bytes */
+        CANTxHeader.BitRateSwitch = FDCAN_BRS_ON;   /* Data phase at the data bit rate */
+    }
+    else
+    {
+        CANTxHeader.FDFormat = FDCAN_CLASSIC_CAN;   /* Classic CAN format up to 8 bytes */
+        CANTxHeader.BitRateSwitch = FDCAN_BRS_OFF;
+    }
 
-    /* Change FDCAN instance from initialization mode to normal mode */
+    /* Empty the reception rings and the transmission queue before any interrupt can use them */
+    CanRing_Init(&CANRxRing);
+    CanRing_Init(&CANUrgentRing);
+    CanTx_Init(&CANTxQueue);
+
+    /* Transport layer: no block size limit and no separation time requested to the sender,
+       with CAN FD the segments use whole 64 bytes frames */
+    CANTpHandle.TxFrame = Serial_CanTpTxFrame;
+    CANTpHandle.FrameSize = (frameFormat == FDCAN_FRAME_FD_BRS) ? CANTP_FD_FRAME_SIZE : CANTP_FRAME_SIZE;
+    CANTpHandle.BlockSize = 0;
+    CANTpHandle.STmin = 0;
+    CanTp_Init(&CANTpHandle);
+
+    /* Same settings for the urgent channel, its responses have their own ID */
+    CANTpUrgent.TxFrame = Serial_CanTpUrgentTxFrame;
+    CANTpUrgent.FrameSize = CANTpHandle.FrameSize;
+    CANTpUrgent.BlockSize = 0;
+    CANTpUrgent.STmin = 0;
+    CanTp_Init(&CANTpUrgent);
+
+    /* Serial_Task only runs on events, this timer raises one for the transport layer timeouts */
+    Timer_Create(&SerialTpTimer, Serial_TpTimerCallback, NULL);
+
+    Serial_StartFdcan();
+}
+
+/**
+ * @brief Change the CAN bit rates at runtime
+ * @param bitrate Nominal (arbitration) bit rate in bits per second
+ * @param dataBitrate Data phase bit rate in bits per second
+ * @return SERIAL_OK if applied, SERIAL_ERROR if the bit rates can not be reached
+ */
+uint8_t Serial_SetBitRate(uint32_t bitrate, uint32_t dataBitrate)
+{
+    uint32_t previousBitRate = CANBitRate;
+    uint32_t previousDataBitRate = CANDataBitRate;
+    uint8_t status;
+
+    HAL_FDCAN_Stop(&CANHandler);
+
+    CANBitRate = bitrate;
+    CANDataBitRate = dataBitrate;
+    status = Serial_ConfigFdcan(FDCAN_MODE_NORMAL, CANHandler.Init.FrameFormat);
+
+    if (status != SERIAL_OK)
+    {
+        CANBitRate = previousBitRate;
+        CANDataBitRate = previousDataBitRate;
+        (void)Serial_ConfigFdcan(FDCAN_MODE_NORMAL, CANHandler.Init.FrameFormat);
+    }
+
+    Serial_StartFdcan();
+
+    return status;
+}
+
+/**
+ * @brief Write the filter table in the controller
+ * @return SERIAL_OK if applied, SERIAL_ERROR if the table needs too many elements (controller untouched)
+ */
+uint8_t Serial_ApplyFilters(void)
+{
+    uint8_t status = SERIAL_ERROR;
+
+    if (CanFilter_Build(&CANFilters) == CANFILTER_OK)
+    {
+        /* The element counts are only taken in initialization mode */
+        HAL_FDCAN_Stop(&CANHandler);
+        (void)Serial_ConfigFdcan(FDCAN_MODE_NORMAL, CANHandler.Init.FrameFormat);
+        Serial_StartFdcan();
+        status = SERIAL_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Check the CAN FD configuration with an internal loopback round trip
+ * @return SERIAL_OK if the frame came back intact, SERIAL_ERROR otherwise
+ */
+uint8_t Serial_FdSelfTest(void)
+{
+    FDCAN_TxHeaderTypeDef txHeader = {0};
+    FDCAN_RxHeaderTypeDef rxHeader;
+    uint8_t txData[CANTP_FD_FRAME_SIZE];
+    uint8_t rxData[CANTP_FD_FRAME_SIZE] = {0};
+    uint8_t status = SERIAL_ERROR;
+    uint32_t tickstart;
+
+    for (uint8_t i = 0; i < CANTP_FD_FRAME_SIZE; i++)
+    {
+        txData[i] = (uint8_t)((i * 3u) + 1u);
+    }
+
+    /* The frame never reaches the bus, the controller acknowledges it by itself */
+    Serial_ConfigFdcan(FDCAN_MODE_INTERNAL_LOOPBACK, FDCAN_FRAME_FD_BRS);
     HAL_FDCAN_Start(&CANHandler);
 
-    /* Enable reception interrupts when a message arrives on FIFO 0 */
-    HAL_FDCAN_ActivateNotification(&CANHandler, FDCAN_IT_RX_FIFO0_NEW_MESSAGE, 0);
+    txHeader.Identifier = CAN_SELFTEST_ID;
+    txHeader.IdType = FDCAN_STANDARD_ID;
+    txHeader.TxFrameType = FDCAN_DATA_FRAME;
+    txHeader.DataLength = FDCAN_DLC_BYTES_64;
+    txHeader.FDFormat = FDCAN_FD_CAN;
+    txHeader.BitRateSwitch = FDCAN_BRS_ON;
+
+    if (HAL_FDCAN_AddMessageToTxFifoQ(&CANHandler, &txHeader, txData) == HAL_OK)
+    {
+        tickstart = HAL_GetTick();
+        while ((HAL_FDCAN_GetRxFifoFillLevel(&CANHandler, FDCAN_RX_FIFO0) == 0u) &&
+               ((HAL_GetTick() - tickstart) < CAN_SELFTEST_TIMEOUT))
+        {
+        }
+
+        if ((HAL_FDCAN_GetRxMessage(&CANHandler, FDCAN_RX_FIFO0, &rxHeader, rxData) == HAL_OK) &&
+            (rxHeader.Identifier == CAN_SELFTEST_ID) && (rxHeader.DataLength == FDCAN_DLC_BYTES_64) &&
+            (rxHeader.FDFormat == FDCAN_FD_CAN) && (rxHeader.BitRateSwitch == FDCAN_BRS_ON))
+        {
+            status = SERIAL_OK;
+            for (uint8_t i = 0; i < CANTP_FD_FRAME_SIZE; i++)
+            {
+                if (rxData[i] != txData[i])
+                {
+                    status = SERIAL_ERROR;
+                }
+            }
+        }
+    }
+
+    HAL_FDCAN_Stop(&CANHandler);
+
+    return status;
+}
+
+/**
+ * @brief Get the reception interrupt statistics
+ * @return Pointer to the statistics, updated from the FDCAN interrupt
+ */
+const Serial_RxStatsTypeDef *Serial_GetRxStats(void)
+{
+    return &CANRxStats;
 }
 
 /**
  * @brief Handle the serial communication state machine
+ *
+ * A request is decoded, validated, handled and answered in the call that
+ * takes its last frame, only a response the transport layer can not take
+ * yet is kept for the next calls. The queued frames are served in a batch,
+ * until the rings are empty or SERIAL_BATCH_FRAMES frames were taken or
+ * SERIAL_BATCH_TIME microseconds went by.
  */
 void Serial_Task(void)
 {
-    static States currentState = IDLE_STATE; /* Variable of type States to handle the states in the state machines */
+    uint32_t start = Serial_TimestampRead(); /* Start of the batch */
+    uint32_t frames = 0;                     /* Frames taken in this batch */
+    uint8_t served;
+
+    BENCH_BEGIN(&Bench, APP_PROBE_SERIAL_TASK);
+
+    /* Keep segmented transfers and their timeouts running */
+    CanTp_Task(&CANTpUrgent, HAL_GetTick());
+    CanTp_Task(&CANTpHandle, HAL_GetTick());
+
+    Serial_DrainPending();
+
+    do
+    {
+        served = Serial_ServeFrame();
+        frames += served;
+    } while ((served != 0u) && (frames < SERIAL_BATCH_FRAMES) && ((Serial_TimestampRead() - start) < SERIAL_BATCH_TIME));
+
+    if (frames > CANRxStats.MaxTaskBatch)
+    {
+        CANRxStats.MaxTaskBatch = frames;
+    }
+
+    /* Send the consecutive frames a flow control served in the batch asked for */
+    CanTp_Task(&CANTpUrgent, HAL_GetTick());
+    CanTp_Task(&CANTpHandle, HAL_GetTick());
+
+    /* Run again on the next pass while frames are queued or a response can go out, a response
+       waiting for a running transfer is retried from its deadline or the TX complete interrupt */
+    if (((SerialState != IDLE_STATE) && (RxChannel->Tp->TxState == CANTP_TX_IDLE_STATE)) ||
+        (CanRing_Count(&CANUrgentRing) > 0u) || (CanRing_Count(&CANRxRing) > 0u) ||
+        (RxChannels[SERIAL_RX_URGENT].DrainPending != 0u) || (RxChannels[SERIAL_RX_COMMAND].DrainPending != 0u))
+    {
+        Sched_SetEvent(&Scheduler, APP_EVENT_SERIAL);
+    }
+
+    Serial_ArmTpTimer();
+
+    BENCH_END(&Bench, APP_PROBE_SERIAL_TASK);
+}
+
+/* Add more auxiliary private functions as needed */
+
+/**
+ * @brief Schedule the next Serial_Task run for the closest transport layer deadline
+ */
+static void Serial_ArmTpTimer(void)
+{
+    uint32_t now = HAL_GetTick();
+    uint32_t urgent = CanTp_NextDeadline(&CANTpUrgent, now);
+    uint32_t left = CanTp_NextDeadline(&CANTpHandle, now);
+
+    left = (urgent < left) ? urgent : left;
+
+    if (left == CANTP_NO_DEADLINE)
+    {
+        Timer_Stop(&Timers, &SerialTpTimer);
+    }
+    else if (left == 0u)
+    {
+        Sched_SetEvent(&Scheduler, APP_EVENT_SERIAL);
+    }
+    else
+    {
+        (void)Timer_Start(&Timers, &SerialTpTimer, now, left, 0);
+    }
+}
 
-    static uint8_t messageType; /* Variable to handle the message type */
-    static uint8_t size = 0;    /* Variable to handle the size of the payloads of the received messages */
+/**
+ * @brief Transport layer deadline reached, let Serial_Task run it
+ * @param context Not used
+ */
+static void Serial_TpTimerCallback(void *context)
+{
+    (void)context;
+    Sched_SetEvent(&Scheduler, APP_EVENT_SERIAL);
+}
 
-    static uint8_t okMessage[8] = {0x00, CAN_OK_MESSAGE_BYTE, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; /* OK state message */
-    static uint8_t errorMessage[8] = {0x00, CAN_ERROR_MESSAGE_BYTE, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; /* ERROR state message */
+/**
+ * @brief Read the frames a spent budget left in the RX FIFOs, up to the same budget per FIFO and call
+ */
+static void Serial_DrainPending(void)
+{
+    uint32_t batch; /* Frames read from one FIFO */
 
-    uint8_t hour, minutes, seconds, day, month, yearMSB, yearLSB = 0; /* Validation message variables */
+    Serial_LockRx();
 
-    switch (currentState)
+    for (uint32_t i = 0; i < SERIAL_RX_CHANNELS; i++)
     {
-    case IDLE_STATE:
-        if (message == 1)
+        if (RxChannels[i].DrainPending != 0u)
         {
-            if (CanTp_SingleFrameRx(RxData, &size) == 1)
+            batch = Serial_DrainRxFifo(&CANHandler, &RxChannels[i]);
+            CANRxStats.DeferredFrames += batch;
+
+            if (i == SERIAL_RX_URGENT)
             {
-                currentState = MESSAGE_STATE; /* Move to MESSAGE_STATE */
-                message = 0;
+                CANRxStats.UrgentFrames += batch;
             }
             else
             {
-                currentState = ERROR_STATE; /* Move to ERROR_STATE */
+                CANRxStats.Frames += batch;
             }
-
-            message = 0;
         }
-        break;
+    }
 
-    case MESSAGE_STATE:
-        messageType = RxData[0]; /* Extract the message type from the Rx buffer (byte 1) */
+    Serial_UnlockRx();
+}
 
-        if (messageType == SERIAL_MSG_TIME)
-        {   
-            Msg.msg = SERIAL_MSG_TIME; /* Set the message type in the message structure */
-            currentState = TIME_STATE; /* Move to TIME state */
-        }
-        else if (messageType == SERIAL_MSG_DATE)
-        {   
-            Msg.msg = SERIAL_MSG_DATE; /* Set the message type in the message structure */
-            currentState = DATE_STATE; /* Move to DATE state */
-        }
-        else if (messageType == SERIAL_MSG_ALARM)
+/**
+ * @brief Take one queued frame and answer the request it completes
+ *
+ * The frames wait in their rings while the clock queue is full, so a command
+ * is never dropped, and while the previous response is not on its way. The
+ * frame completing a request stays in its ring slot until the response is
+ * queued, a single frame request is decoded in place from it.
+ *
+ * @return 1 if a frame was taken, 0 if there was none or it has to wait
+ */
+static uint8_t Serial_ServeFrame(void)
+{
+    const APP_CanFrameTypeDef *rxFrame = NULL; /* Frame taken from a reception ring */
+    uint16_t size = 0;  /* Size of the payload of the received message */
+    uint8_t served = 0;
+    uint32_t i;
+
+    if (SerialState == RESPONSE_STATE)
+    {
+        Serial_SendResponse();
+    }
+
+    if ((SerialState == IDLE_STATE) && (Queue_Space(&ClockQueue) > 0u))
+    {
+        /* Hand the oldest frame queued by the ISRs to its transport layer, the urgent ones
+           first, a command frame is only taken when no urgent frame is waiting */
+        for (i = 0; (i < SERIAL_RX_CHANNELS) && (rxFrame == NULL); i++)
         {
-            Msg.msg = SERIAL_MSG_ALARM; /* Set the message type in the message structure */
-            currentState = ALARM_STATE; /* Move to ALARM state */
+            RxChannel = &RxChannels[i];
+            rxFrame = CanRing_Peek(RxChannel->Ring);
         }
-        else
+
+        if (rxFrame != NULL)
         {
-            currentState = ERROR_STATE; /* Move to ERROR state */
+            RxChannel->Timestamp = rxFrame->Timestamp;
+            served = 1;
+
+            if (CanTp_RxIndication(RxChannel->Tp, rxFrame->Data, rxFrame->Length, HAL_GetTick()) != CANTP_OK)
+            {
+                Serial_SetResponse(CAN_ERROR_MESSAGE_BYTE, 1);
+                SerialState = RESPONSE_STATE; /* Move to RESPONSE_STATE */
+            }
+            else
+            {
+                /* A message is ready once its single frame or last consecutive frame arrived */
+                RxData = CanTp_GetRxMessage(RxChannel->Tp, &size);
+            }
+
+            if ((SerialState == IDLE_STATE) && (RxData != NULL))
+            {
+                RxChannel->Held = 1;  /* Released with the request */
+                Serial_ProcessRequest(size);
+                SerialState = RESPONSE_STATE; /* Move to RESPONSE_STATE */
+            }
+            else
+            {
+                CanRing_Release(RxChannel->Ring); /* Give the slot back to the ISR */
+            }
         }
-        break;
+    }
 
-    case TIME_STATE:
-        hour = BCDtoDecimal(RxData[1]);     /* Extract the parameter 1 (byte 2) */
-        minutes = BCDtoDecimal(RxData[2]);  /* Extract the parameter 2 (byte 3) */
-        seconds = BCDtoDecimal(RxData[3]);  /* Extract the parameter 3 (byte 4) */
+    if (SerialState == RESPONSE_STATE)
+    {
+        Serial_SendResponse();
+    }
 
-        if (Validate_Time(hour, minutes, seconds))
-        {
-            Msg.tm.tm_hour = hour;
-            Msg.tm.tm_min = minutes;
-            Msg.tm.tm_sec = seconds;
+    return served;
+}
 
-            currentState = OK_STATE; /* Move to OK state */
-        }
-        else
-        {
-            currentState = ERROR_STATE; /* Move to ERROR state */
-        }
-        
-        break;
+/**
+ * @brief Send the response, it is retried on the next calls while a transfer is running
+ */
+static void Serial_SendResponse(void)
+{
+    if (CanTp_Transmit(RxChannel->Tp, Response, ResponseSize, HAL_GetTick()) != CANTP_BUSY)
+    {
+        Serial_ReleaseRequest();              /* Request buffer can take the next message */
+        SerialState = IDLE_STATE;             /* Return to IDLE state */
+    }
+}
 
-    case DATE_STATE:
-        day = BCDtoDecimal(RxData[1]);      /* Extract the parameter 1 (byte 2) */
-        month = BCDtoDecimal(RxData[2]);    /* Extract the parameter 2 (byte 3) */
-        yearMSB = BCDtoDecimal(RxData[3]);  /* Extract the parameter 3 (byte 4) */
-        yearLSB = BCDtoDecimal(RxData[4]);  /* Extract the parameter 4 (byte 5) */
+/**
+ * @brief Run the request through the dispatcher and prepare its response
+ *
+ * The request is decoded in a local message, it is only posted to the clock
+ * once it is valid.
+ *
+ * @param size Size of the request payload
+ */
+static void Serial_ProcessRequest(uint16_t size)
+{
+    APP_MsgTypeDef message;       /* Decoded request, its type selects the member of data */
+    uint16_t length = (size < SERIAL_ACK_SIZE) ? size : SERIAL_ACK_SIZE; /* Same as the request up to a single frame */
 
-        if (Validate_Date(day, month, yearMSB, yearLSB))
-        {
-            Msg.tm.tm_mday = day;
-            Msg.tm.tm_mon = month;
-            Msg.tm.tm_year = yearMSB * 100 + yearLSB;
-            Msg.tm.tm_wday = WeekDay(day, month, Msg.tm.tm_year);
+    message.rxTime = RxChannel->Timestamp;
 
-            currentState = OK_STATE; /* Move to OK state */
-        }
-        else
-        {
-            currentState = ERROR_STATE; /* Move to ERROR state */
-        }
-        
-        break;
+    if (Dispatch_Process(&Dispatcher, RxData, size, &message, Response, &ResponseSize) != DISPATCH_OK)
+    {
+        Serial_SetResponse(CAN_ERROR_MESSAGE_BYTE, length);
+    }
+    else if (ResponseSize == 0u)
+    {
+        Serial_SetResponse(CAN_OK_MESSAGE_BYTE, length);
+    }
+}
 
-    case ALARM_STATE:
-        hour = BCDtoDecimal(RxData[1]);    /* Extract the parameter 1 (byte 2) */
-        minutes = BCDtoDecimal(RxData[2]); /* Extract the parameter 2 (byte 3) */
+/**
+ * @brief Prepare an acknowledge or error response
+ * @param code CAN_OK_MESSAGE_BYTE or CAN_ERROR_MESSAGE_BYTE
+ * @param length Response length, the bytes after the code are 0
+ */
+static void Serial_SetResponse(uint8_t code, uint16_t length)
+{
+    Response[0] = code;
 
-        if (Validate_Alarm(hour, minutes))
-        {
-            Msg.tm.tm_hour = hour;
-            Msg.tm.tm_min = minutes;
+    for (uint16_t i = 1; i < length; i++)
+    {
+        Response[i] = 0;
+    }
 
-            currentState = OK_STATE; /* Move to OK state */
-        }
-        else
-        {
-            currentState = ERROR_STATE; /* Move to ERROR state */
-        }
-        
-        break;
+    ResponseSize = length;
+}
 
-    case OK_STATE:
-        CanTp_SingleFrameTx(okMessage, size); /* Send message for OK state */
-        
-        currentState = IDLE_STATE;           /* Return to IDLE state */
-        break;
+/**
+ * @brief Decode a time setting request, hours, minutes and seconds in BCD
+ * @param data Request payload
+ * @param size Payload size
+ * @param message APP_MsgTypeDef to fill
+ */
+static void Serial_DecodeTime(const uint8_t *data, uint16_t size, void *message)
+{
+    APP_MsgTypeDef *msg = message;
 
-    case ERROR_STATE:
-        CanTp_SingleFrameTx(errorMessage, size); /* Send message for ERROR state */
-        
-        currentState = IDLE_STATE;              /* Return to IDLE state */
-        break;
+    (void)size;
 
-    default:
-        currentState = IDLE_STATE;              /* Return to IDLE state */
-        break;
-    }
+    msg->msg = SERIAL_MSG_TIME;
+    msg->data.time.hour = (uint8_t)BCDtoDecimal(data[1]);
+    msg->data.time.min = (uint8_t)BCDtoDecimal(data[2]);
+    msg->data.time.sec = (uint8_t)BCDtoDecimal(data[3]);
 }
 
-/* Add more auxiliary private functions as needed */
+/**
+ * @brief Check a decoded time setting
+ * @param message Decoded APP_MsgTypeDef
+ * @return DISPATCH_OK if valid, DISPATCH_ERROR otherwise
+ */
+static uint8_t Serial_ValidateTime(const void *message)
+{
+    const APP_MsgTypeDef *msg = message;
+
+    return (Validate_Time(msg->data.time.hour, msg->data.time.min, msg->data.time.sec) != 0u) ? DISPATCH_OK : DISPATCH_ERROR;
+}
+
+/**
+ * @brief Decode a date setting request, day, month and the two halves of the year in BCD
+ * @param data Request payload
+ * @param size Payload size
+ * @param message APP_MsgTypeDef to fill
+ */
+static void Serial_DecodeDate(const uint8_t *data, uint16_t size, void *message)
+{
+    APP_MsgTypeDef *msg = message;
+
+    (void)size;
+
+    msg->msg = SERIAL_MSG_DATE;
+    msg->data.date.mday = (uint8_t)BCDtoDecimal(data[1]);
+    msg->data.date.mon = (uint8_t)BCDtoDecimal(data[2]);
+    msg->data.date.year = (uint16_t)((BCDtoDecimal(data[3]) * 100u) + BCDtoDecimal(data[4]));
+}
+
+/**
+ * @brief Check a decoded date setting
+ * @param message Decoded APP_MsgTypeDef
+ * @return DISPATCH_OK if valid, DISPATCH_ERROR otherwise
+ */
+static uint8_t Serial_ValidateDate(const void *message)
+{
+    const APP_MsgTypeDef *msg = message;
+
+    return (Validate_Date(msg->data.date.mday, msg->data.date.mon, msg->data.date.year / 100u, msg->data.date.year % 100u) != 0u) ?
+           DISPATCH_OK : DISPATCH_ERROR;
+}
+
+/**
+ * @brief Complete a valid date with its day of the week and post it to the clock
+ * @param message Decoded APP_MsgTypeDef
+ * @param response Not used
+ * @return 0, the request is acknowledged
+ */
+static uint16_t Serial_HandleDate(const void *message, uint8_t *response)
+{
+    APP_MsgTypeDef date = *(const APP_MsgTypeDef *)message;
+    uint8_t wday = WeekDay(date.data.date.mday, date.data.date.mon, date.data.date.year);
+
+    /* WeekDay counts from Sunday = 0, the message carries the RTC 1 (Monday) to 7 (Sunday) */
+    date.data.date.wday = (wday == 0u) ? RTC_WEEKDAY_SUNDAY : wday;
+
+    return Serial_PostToClock(&date, response);
+}
+
+/**
+ * @brief Decode an alarm setting request, hours and minutes in BCD
+ * @param data Request payload
+ * @param size Payload size
+ * @param message APP_MsgTypeDef to fill
+ */
+static void Serial_DecodeAlarm(const uint8_t *data, uint16_t size, void *message)
+{
+    APP_MsgTypeDef *msg = message;
+
+    (void)size;
+
+    msg->msg = SERIAL_MSG_ALARM;
+    msg->data.alarm.hour = (uint8_t)BCDtoDecimal(data[1]);
+    msg->data.alarm.min = (uint8_t)BCDtoDecimal(data[2]);
+}
+
+/**
+ * @brief Check a decoded alarm setting
+ * @param message Decoded APP_MsgTypeDef
+ * @return DISPATCH_OK if valid, DISPATCH_ERROR otherwise
+ */
+static uint8_t Serial_ValidateAlarm(const void *message)
+{
+    const APP_MsgTypeDef *msg = message;
+
+    return (Validate_Alarm(msg->data.alarm.hour, msg->data.alarm.min) != 0u) ? DISPATCH_OK : DISPATCH_ERROR;
+}
+
+/**
+ * @brief Hand a valid message to the clock, it applies it and broadcasts the new values
+ * @param message Decoded APP_MsgTypeDef
+ * @param response Not used
+ * @return 0, the request is acknowledged
+ */
+static uint16_t Serial_PostToClock(const void *message, uint8_t *response)
+{
+    (void)response;
+
+    Queue_Post(&ClockQueue, message); /* Room checked before the request frame was taken */
+    Sched_SetEvent(&Scheduler, APP_EVENT_CLOCK);
+
+    return 0;
+}
+
+#if (BENCH_ENABLED != 0u)
+/**
+ * @brief Check the probe number of a probe dump request (byte 2)
+ * @param message Request payload
+ * @return DISPATCH_OK if the probe exists, DISPATCH_ERROR otherwise
+ */
+static uint8_t Serial_ValidateBench(const void *message)
+{
+    return (((const uint8_t *)message)[1] < BENCH_MAX_PROBES) ? DISPATCH_OK : DISPATCH_ERROR;
+}
+
+/**
+ * @brief Answer with the statistics of the requested probe, longer than a frame so they go segmented
+ * @param message Request payload
+ * @param response Where the probe record is written
+ * @return Length of the probe record
+ */
+static uint16_t Serial_HandleBench(const void *message, uint8_t *response)
+{
+    return Bench_Serialize(&Bench, ((const uint8_t *)message)[1], response);
+}
+#endif
+
+/**
+ * @brief Give the request buffer back to its transport layer once the response is queued
+ *
+ * The time from the start of the request frame is the latency of the command.
+ */
+static void Serial_ReleaseRequest(void)
+{
+    CANRxStats.LastLatency = Serial_TimestampRead() - RxChannel->Timestamp;
+
+    if (CANRxStats.LastLatency > CANRxStats.MaxLatency)
+    {
+        CANRxStats.MaxLatency = CANRxStats.LastLatency;
+    }
+
+    CanTp_ReleaseRxMessage(RxChannel->Tp);
+    RxData = NULL;
+
+    if (RxChannel->Held != 0u)
+    {
+        CanRing_Release(RxChannel->Ring); /* Give the request frame back to the ISR */
+        RxChannel->Held = 0;
+    }
+}
 
 /**
  * @brief Converts a BCD (Binary-Coded Decimal) value to its decimal equivalent.
@@ -314,27 +1277,29 @@ uint8_t Validate_Date(uint8_t day, uint8_t month, uint8_t yearMSB, uint8_t yearL
     /* Array representing the number of days in each month (non-leap year) */
     uint8_t days_Month[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
 
-    /* Checks if the year is outside the 1901-2099 range and month is outside the 1-12 range. 
+    /* Checks if the year is outside the 1901-2099 range or the month is outside the 1-12 range.
     If either condition is met, the function will return 0, indicating the date is invalid */
-    if ((year < 1901 || year > 2099) && (month < 1 || month > 12))
+    if ((year < 1901 || year > 2099) || (month < 1 || month > 12))
     {
         status = 0;
     }
-
-    /* Checks if the year is a leap year. A leap year is divisible by 4 but not divisible by 100, unless it's divisible by 400 */
-    int leap_year = ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
-
-    /* If the year is a leap year, update February's days to 29 */
-    if (leap_year)
+    else
     {
-        days_Month[1] = 29;
-    }
+        /* Checks if the year is a leap year. A leap year is divisible by 4 but not divisible by 100, unless it's divisible by 400 */
+        int leap_year = ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
 
-    /* Checks if the day is outside the valid range for the given month. 
-    If it is, the function will return 0, indicating the date is invalid */
-    if (day < 1 || day > days_Month[month - 1])
-    {
-        status = 0;
+        /* If the year is a leap year, update February's days to 29 */
+        if (leap_year)
+        {
+            days_Month[1] = 29;
+        }
+
+        /* Checks if the day is outside the valid range for the given month, only once the month
+        is known to index the table. If it is, the function will return 0, indicating the date is invalid */
+        if (day < 1 || day > days_Month[month - 1])
+        {
+            status = 0;
+        }
     }
     
     return status;
@@ -343,50 +1308,41 @@ uint8_t Validate_Date(uint8_t day, uint8_t month, uint8_t yearMSB, uint8_t yearL
 /**
  * @brief Calculates the day of the week for a given date.
  *
+ * Closed form (Sakamoto's method): January and February are counted as months
+ * of the previous year so the leap day falls at the end of the year, then the
+ * number of leap years is added with three divisions instead of walking every
+ * year since year 0.
+ *
  * @param day Day value.
- * @param month Month value.
+ * @param month Month value (1 to 12).
  * @param year Year value.
- * @return Day of the week (e.g., 0 for Sunday, 1 for Monday, ...).
+ * @return Day of the week (e.g., 0 for Sunday, 1 for Monday, ...), SERIAL_WEEKDAY_INVALID for an invalid month.
  */
 uint8_t WeekDay(uint8_t day, uint8_t month, uint16_t year)
 {
-    /* Array representing the number of days in each month (non-leap year) */ 
-    uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-
-    /* Array representing the days of the week */ 
-    uint8_t weekdays[] = {0, 1, 2, 3, 4, 5, 6};
-
-    /* Checks if the year is a leap year. A leap year is divisible by 4 but not divisible by 100, unless it's divisible by 400 */
-    int leap_year = ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
+    /* Day of the week shift of the first day of each month relative to March */
+    static const uint8_t monthOffset[12] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
 
-    /* If the year is a leap year, update February's days to 29 */
-    if (leap_year)
-    {
-        daysInMonth[1] = 29;
-    }
+    uint32_t y = year;
+    uint8_t weekDay = SERIAL_WEEKDAY_INVALID;
 
-    /* Variable to calculate the total number of days since January 1st, 0000 until the given date */
-    uint32_t totalDays = 0;
+    BENCH_BEGIN(&Bench, APP_PROBE_WEEKDAY);
 
-    /* Adds the number of days for each year from year 0 until the specified year */
-    for (uint16_t y = 0; y < year; y++)
+    /* The month indexes the offsets, anything else than 1 to 12 has no day of the week */
+    if ((month >= 1u) && (month <= 12u))
     {
-        totalDays += leap_year ? 366 : 365;
-    }
+        /* January and February belong to the previous year */
+        if (month < 3u)
+        {
+            y -= 1u;
+        }
 
-    /* Adds the number of days for each month from January until the specified month */
-    for (uint8_t m = 1; m < month; m++)
-    {
-        totalDays += daysInMonth[m - 1];
+        weekDay = (uint8_t)((y + (y / 4u) - (y / 100u) + (y / 400u) + monthOffset[month - 1u] + day) % 7u);
     }
 
-    /* Adds the remaining days in the current month */
-    totalDays += day - 1;
-
-    /* Calculates the day of the week */
-    uint8_t weekday = (totalDays % 7);
+    BENCH_END(&Bench, APP_PROBE_WEEKDAY);
 
-    return weekdays[weekday];
+    return weekDay;
 }
 
 /**
@@ -2,6 +2,8 @@
 #define __APP_SERIAL_H__
 
 #include <stdint.h>
+#include "app_cantx.h"
+#include "app_canfilter.h"
 
 /**
  * @file app_serial.h
@@ -12,6 +14,94 @@
  * communication initialization and task management.
  */
 
+/**
+ * @brief Maximum number of frames read from the RX FIFO on each interrupt.
+ *
+ * A value of 1 restores the one frame per interrupt behaviour. The frames
+ * left in RX FIFO 0 by a spent budget are read by Serial_Task, the line 0
+ * interrupt only comes back with a new frame.
+ */
+#ifndef SERIAL_RX_DRAIN_BUDGET
+#define SERIAL_RX_DRAIN_BUDGET 8u
+#endif
+
+/**
+ * @brief Budget of a Serial_Task call: frames taken and microseconds spent.
+ *
+ * Serial_Task serves the queued frames until the rings are empty or one of
+ * the budgets is spent, the frames left wait for the next call. A frame
+ * count of 1 restores the one frame per call behaviour.
+ */
+#ifndef SERIAL_BATCH_FRAMES
+#define SERIAL_BATCH_FRAMES 16u
+#endif
+#ifndef SERIAL_BATCH_TIME
+#define SERIAL_BATCH_TIME 1000u
+#endif
+
+/**
+ * @brief Use CAN FD frames on the command channel and the broadcasts.
+ *
+ * When enabled the frames carry up to 64 bytes and the data phase is sent at
+ * 2 Mbps (bit rate switching), a value of 0 keeps classic CAN 2.0 frames.
+ */
+#ifndef SERIAL_CAN_FD
+#define SERIAL_CAN_FD 0u
+#endif
+
+/**
+ * @brief Bit rates used after reset (bits per second), see Serial_SetBitRate to change them.
+ */
+#ifndef SERIAL_CAN_BITRATE
+#define SERIAL_CAN_BITRATE 100000u
+#endif
+#ifndef SERIAL_CAN_DATA_BITRATE
+#define SERIAL_CAN_DATA_BITRATE 2000000u    /**< Data phase of CAN FD frames */
+#endif
+
+/**
+ * @brief Sample points in tenths of percent (750 = 75.0%).
+ */
+#ifndef SERIAL_CAN_SAMPLE_POINT
+#define SERIAL_CAN_SAMPLE_POINT 750u
+#endif
+#ifndef SERIAL_CAN_DATA_SAMPLE_POINT
+#define SERIAL_CAN_DATA_SAMPLE_POINT 750u
+#endif
+
+/**
+ * @brief Ticks per second of the reception timestamps (see Serial_TimestampRead).
+ */
+#define SERIAL_TIMESTAMP_FREQ 1000000u
+
+#define SERIAL_OK      0x00U
+#define SERIAL_ERROR   0x01U
+
+/**
+ * @brief Value returned by WeekDay for a month outside 1 to 12.
+ */
+#define SERIAL_WEEKDAY_INVALID 0xFFU
+
+/**
+ * @brief Statistics of the FDCAN reception interrupts, the batches are the RX FIFO 0 ones.
+ */
+typedef struct
+{
+    uint32_t Interrupts;        /**< Number of RX FIFO 0 interrupts served */
+    uint32_t Frames;            /**< Frames read from the hardware FIFO */
+    uint32_t MaxBatch;          /**< Maximum number of frames read in one interrupt */
+    uint32_t BudgetExhausted;   /**< Interrupts of either FIFO that left frames pending because of the budget */
+    uint32_t DeferredFrames;    /**< Frames left in either FIFO by a spent budget, read by Serial_Task */
+    uint32_t FifoFull;          /**< Times the hardware FIFO was found full */
+    uint32_t FifoLost;          /**< Times the hardware FIFO reported a lost message */
+    uint32_t UrgentFrames;      /**< Frames read from RX FIFO 1, the urgent commands */
+    uint32_t UrgentLost;        /**< Times RX FIFO 1 reported a lost message */
+    uint32_t LastLatency;       /**< Microseconds from the start of the last request frame to its response queued */
+    uint32_t MaxLatency;        /**< Highest LastLatency seen */
+    uint32_t MaxTaskBatch;      /**< Most frames served by one Serial_Task call */
+    uint32_t BatchHistogram[SERIAL_RX_DRAIN_BUDGET + 1u]; /**< Interrupts per number of frames read */
+} Serial_RxStatsTypeDef;
+
 /* Function prototypes */
 
 /**
@@ -55,10 +145,13 @@ uint8_t Validate_Alarm(uint8_t hour,uint8_t minutes);
 /**
  * @brief Calculates the day of the week for a given date.
  *
+ * The date is expected to be validated first (Validate_Date), an invalid
+ * month only gets SERIAL_WEEKDAY_INVALID back.
+ *
  * @param day Day value.
- * @param month Month value.
+ * @param month Month value (1 to 12).
  * @param year Year value.
- * @return Day of the week (e.g., 0 for Sunday, 1 for Monday, ...).
+ * @return Day of the week (e.g., 0 for Sunday, 1 for Monday, ...), SERIAL_WEEKDAY_INVALID for an invalid month.
  */
 uint8_t WeekDay(uint8_t day, uint8_t month, uint16_t year);
 
@@ -71,11 +164,111 @@ uint8_t WeekDay(uint8_t day, uint8_t month, uint16_t year);
 void Serial_Init(void);
 
 /**
- * @brief Periodic serial communication task function.
+ * @brief Serial communication task function.
  *
- * This function should be called periodically in the main application loop
- * or a dedicated task to maintain and manage serial communication functionalities.
+ * This function runs on APP_EVENT_SERIAL, raised by the reception interrupts,
+ * the TX complete interrupt and a software timer started for the next
+ * transport layer deadline, so Serial_Init needs the timers (Timers) ready.
+ * The urgent commands (ID 0x110, RX FIFO 1) are always taken before the ones
+ * of the command channel (ID 0x111) and answered on their own ID (0x121).
  */
 void Serial_Task(void);
 
+/**
+ * @brief Change the CAN bit rates at runtime.
+ *
+ * The bit timing is computed from the FDCAN kernel clock, the controller is
+ * stopped, reconfigured and started again, so frames in flight are lost. The
+ * data bit rate only matters with CAN FD frames but it must be reachable too.
+ *
+ * @param bitrate Nominal (arbitration) bit rate in bits per second.
+ * @param dataBitrate Data phase bit rate in bits per second.
+ * @return SERIAL_OK if applied, SERIAL_ERROR if the bit rates can not be reached (previous ones are kept).
+ */
+uint8_t Serial_SetBitRate(uint32_t bitrate, uint32_t dataBitrate);
+
+/**
+ * @brief Write the reception filter table in the controller.
+ *
+ * The modules register the identifiers they want to receive in CANFilters
+ * with the CanFilter_Add functions and call this function to compile the
+ * table and write its elements. Frames matching no element are rejected by
+ * the controller. Serial_Init registers the command channel in RX FIFO 0 and
+ * the urgent command channel in RX FIFO 1, the frames registered with
+ * CAN_FILTER_PRIORITY_HIGH end up with the urgent commands. As with
+ * Serial_SetBitRate, the controller is stopped and started again, so frames
+ * in flight are lost.
+ *
+ * @return SERIAL_OK if applied, SERIAL_ERROR if the table needs more elements than the controller has.
+ */
+uint8_t Serial_ApplyFilters(void);
+
+/**
+ * @brief Check the CAN FD configuration with an internal loopback round trip.
+ *
+ * The FDCAN is set in internal loopback mode, a 64 bytes frame with bit rate
+ * switching is sent and read back from RX FIFO 0 and compared with the one sent.
+ * The controller is left stopped, so it must be called before the FDCAN is
+ * started (Serial_Init does it when SERIAL_CAN_FD is enabled).
+ *
+ * @return SERIAL_OK if the frame came back intact, SERIAL_ERROR otherwise.
+ */
+uint8_t Serial_FdSelfTest(void);
+
+/**
+ * @brief Get the reception interrupt statistics.
+ *
+ * Useful to see how bursty the bus is: BatchHistogram[n] counts the interrupts
+ * that moved n frames from the hardware FIFO to the reception ring.
+ *
+ * @return Pointer to the statistics structure.
+ */
+const Serial_RxStatsTypeDef *Serial_GetRxStats(void);
+
+/**
+ * @brief Queue a standard frame for transmission.
+ *
+ * The frame goes through the transmission queue (see app_cantx.h), the TX
+ * complete interrupt moves the frames with the lowest identifiers to the
+ * hardware TX FIFO as its elements get free. When the queue is full the
+ * frame is refused, the caller keeps it and is woken up with its scheduler
+ * event once a transmission completes. Only to be called from the tasks.
+ *
+ * @param identifier Standard CAN identifier.
+ * @param data Frame payload, copied.
+ * @param length Number of bytes to send, up to 8 (64 with CAN FD).
+ * @return SERIAL_OK if queued, SERIAL_ERROR if the queue is full or the length too long.
+ */
+uint8_t Serial_CanTransmit(uint32_t identifier, const uint8_t *data, uint8_t length);
+
+/**
+ * @brief Get the transmission queue statistics.
+ *
+ * Queued - Sent is the number of frames waiting, MaxDepth shows how close
+ * the queue came to CAN_TX_QUEUE_SIZE and Dropped how often it was full.
+ *
+ * @return Pointer to the statistics structure.
+ */
+const CanTx_StatsTypeDef *Serial_GetTxStats(void);
+
+/**
+ * @brief Start the microsecond counter the FDCAN timestamps the frames with.
+ *
+ * Provided by the board support (TIM3 on the target, the external timestamp
+ * counter of the FDCAN, the virtual time on the host), not by this module.
+ * Serial_Init calls it before configuring the controller.
+ */
+void Serial_TimestampStart(void);
+
+/**
+ * @brief Read the timestamp counter extended to 32 bits.
+ *
+ * The controller only captures the 16 low bits at the start of each frame,
+ * Serial_Task gives the frames the full value and the time of the last
+ * request frame is passed to the clock in the rxTime field of the message.
+ *
+ * @return Microseconds, wrapping around after 71 minutes.
+ */
+uint32_t Serial_TimestampRead(void);
+
 #endif // __APP_SERIAL_H__
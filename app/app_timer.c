@@ -0,0 +1,191 @@
+/**
+ * @file app_timer.c
+ * @brief Software timer service.
+ */
+
+#include "app_timer.h"
+#include <stddef.h>
+
+static void Timer_Insert(Timer_HandleTypeDef *htimer, Timer_TypeDef *timer);
+static void Timer_Unlink(Timer_HandleTypeDef *htimer, Timer_TypeDef *timer);
+
+/**
+ * @brief Initialize the service without running timers.
+ * @param htimer Pointer to the timer service handle structure.
+ * @param rearm Function called by Timer_Start when the first expiry changes, NULL if not needed.
+ */
+void Timer_Init(Timer_HandleTypeDef *htimer, void (*rearm)(void))
+{
+    htimer->Head = NULL;
+    htimer->Expired = 0;
+    htimer->Skipped = 0;
+    htimer->Rearm = rearm;
+}
+
+/**
+ * @brief Set the callback of a timer, it must be called once before starting it.
+ * @param timer Timer to set up.
+ * @param callback Function called on expiry.
+ * @param context User pointer given to the callback.
+ */
+void Timer_Create(Timer_TypeDef *timer, Timer_Callback callback, void *context)
+{
+    timer->Next = NULL;
+    timer->Callback = callback;
+    timer->Context = context;
+    timer->Expiry = 0;
+    timer->Period = 0;
+    timer->Active = 0;
+}
+
+/**
+ * @brief Start or restart a timer.
+ * @param htimer Pointer to the timer service handle structure.
+ * @param timer Timer to start.
+ * @param now Current tick.
+ * @param delay Ticks to the first expiry.
+ * @param period Ticks between the next expiries, 0 for a one-shot timer.
+ * @return TIMER_OK if started, TIMER_ERROR if the timer has no callback.
+ */
+uint8_t Timer_Start(Timer_HandleTypeDef *htimer, Timer_TypeDef *timer, uint32_t now, uint32_t delay, uint32_t period)
+{
+    uint8_t status = TIMER_ERROR;
+
+    if (timer->Callback != NULL)
+    {
+        Timer_Stop(htimer, timer);
+
+        timer->Expiry = now + ((delay > 0u) ? delay : 1u);
+        timer->Period = period;
+        Timer_Insert(htimer, timer);
+
+        if ((htimer->Head == timer) && (htimer->Rearm != NULL))
+        {
+            htimer->Rearm();
+        }
+
+        status = TIMER_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Stop a timer, nothing is done if it is not running.
+ * @param htimer Pointer to the timer service handle structure.
+ * @param timer Timer to stop.
+ */
+void Timer_Stop(Timer_HandleTypeDef *htimer, Timer_TypeDef *timer)
+{
+    if (timer->Active != 0u)
+    {
+        Timer_Unlink(htimer, timer);
+    }
+}
+
+/**
+ * @brief Check if a timer is running.
+ * @param timer Timer to check.
+ * @return 1 if running, 0 otherwise.
+ */
+uint8_t Timer_IsActive(const Timer_TypeDef *timer)
+{
+    return timer->Active;
+}
+
+/**
+ * @brief Run the callbacks of the expired timers, in expiry order.
+ * @param htimer Pointer to the timer service handle structure.
+ * @param now Current tick.
+ * @return Number of callbacks run.
+ */
+uint32_t Timer_Process(Timer_HandleTypeDef *htimer, uint32_t now)
+{
+    Timer_TypeDef *timer;
+    uint32_t missed;
+    uint32_t ran = 0;
+
+    /* Restarted timers always expire after now, so the loop ends even if every callback restarts its timer */
+    while ((htimer->Head != NULL) && ((int32_t)(now - htimer->Head->Expiry) >= 0))
+    {
+        timer = htimer->Head;
+        Timer_Unlink(htimer, timer);
+
+        if (timer->Period != 0u)
+        {
+            /* Next expiry from the previous one, not from now, so the phase is kept */
+            missed = (now - timer->Expiry) / timer->Period;
+            timer->Expiry += (missed + 1u) * timer->Period;
+            htimer->Skipped += missed;
+            Timer_Insert(htimer, timer);
+        }
+
+        /* Relinked before the callback, so it can stop or restart its own timer */
+        htimer->Expired++;
+        timer->Callback(timer->Context);
+        ran++;
+    }
+
+    return ran;
+}
+
+/**
+ * @brief Get the ticks left until the first expiry.
+ * @param htimer Pointer to the timer service handle structure.
+ * @param now Current tick.
+ * @return Ticks left, 0 if a timer already expired, TIMER_NO_EXPIRY if none is running.
+ */
+uint32_t Timer_NextExpiry(const Timer_HandleTypeDef *htimer, uint32_t now)
+{
+    uint32_t left = TIMER_NO_EXPIRY;
+
+    if (htimer->Head != NULL)
+    {
+        left = ((int32_t)(htimer->Head->Expiry - now) > 0) ? (htimer->Head->Expiry - now) : 0u;
+    }
+
+    return left;
+}
+
+/**
+ * @brief Link a timer in the list, after the timers expiring at the same tick or before.
+ * @param htimer Pointer to the timer service handle structure.
+ * @param timer Timer to link, its expiry must be set.
+ */
+static void Timer_Insert(Timer_HandleTypeDef *htimer, Timer_TypeDef *timer)
+{
+    Timer_TypeDef **link = &htimer->Head;
+
+    /* Signed differences keep the order right across the tick wrap around */
+    while ((*link != NULL) && ((int32_t)(timer->Expiry - (*link)->Expiry) >= 0))
+    {
+        link = &(*link)->Next;
+    }
+
+    timer->Next = *link;
+    *link = timer;
+    timer->Active = 1;
+}
+
+/**
+ * @brief Remove a running timer from the list.
+ * @param htimer Pointer to the timer service handle structure.
+ * @param timer Timer to remove.
+ */
+static void Timer_Unlink(Timer_HandleTypeDef *htimer, Timer_TypeDef *timer)
+{
+    Timer_TypeDef **link = &htimer->Head;
+
+    while ((*link != NULL) && (*link != timer))
+    {
+        link = &(*link)->Next;
+    }
+
+    if (*link != NULL)
+    {
+        *link = timer->Next;
+    }
+
+    timer->Next = NULL;
+    timer->Active = 0;
+}
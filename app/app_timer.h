@@ -0,0 +1,125 @@
+#ifndef __APP_TIMER_H__
+#define __APP_TIMER_H__
+
+#include <stdint.h>
+
+/**
+ * @file app_timer.h
+ * @brief Software timer service.
+ *
+ * One-shot and periodic timers kept in a list sorted by expiry, so checking
+ * for expired timers only looks at the head. Timers are allocated by their
+ * owners, the service only links them. Callbacks run in the context of the
+ * task calling Timer_Process, never from interrupts, and they can start or
+ * stop any timer, themselves included. Periodic timers are rescheduled from
+ * their previous expiry so they do not drift. The time base is given on every
+ * call. The rearm hook tells the owner of the service when the first expiry
+ * moves closer, so Timer_Process only has to run at the expiries instead of on
+ * every tick.
+ */
+
+#define TIMER_OK      0x00U
+#define TIMER_ERROR   0x01U
+
+/**
+ * @brief Value returned by Timer_NextExpiry when no timer is running.
+ */
+#define TIMER_NO_EXPIRY 0xFFFFFFFFUL
+
+/**
+ * @brief Timer expiry callback.
+ * @param context User pointer given to Timer_Create.
+ */
+typedef void (*Timer_Callback)(void *context);
+
+/**
+ * @brief Software timer, owned by the module using it.
+ */
+typedef struct Timer_TypeDef
+{
+    struct Timer_TypeDef *Next; /**< Next timer in the expiry list */
+    Timer_Callback Callback;    /**< Function called on expiry */
+    void *Context;              /**< User pointer given to the callback */
+    uint32_t Expiry;            /**< Tick of the next expiry */
+    uint32_t Period;            /**< Reload in ticks, 0 for one-shot timers */
+    uint8_t Active;             /**< 1 while linked in the expiry list */
+} Timer_TypeDef;
+
+/**
+ * @brief Timer service handler structure.
+ */
+typedef struct
+{
+    Timer_TypeDef *Head;    /**< Running timers, the first one expires first */
+    uint32_t Expired;       /**< Number of expiries served */
+    uint32_t Skipped;       /**< Periods of periodic timers lost because the service ran late */
+    void (*Rearm)(void);    /**< Called when a started timer becomes the first to expire, may be NULL */
+} Timer_HandleTypeDef;
+
+/**
+ * @brief Initialize the service without running timers.
+ * @param htimer Pointer to the timer service handle structure.
+ * @param rearm Function called by Timer_Start when the first expiry changes, NULL if not needed.
+ */
+void Timer_Init(Timer_HandleTypeDef *htimer, void (*rearm)(void));
+
+/**
+ * @brief Set the callback of a timer, it must be called once before starting it.
+ * @param timer Timer to set up.
+ * @param callback Function called on expiry.
+ * @param context User pointer given to the callback.
+ */
+void Timer_Create(Timer_TypeDef *timer, Timer_Callback callback, void *context);
+
+/**
+ * @brief Start or restart a timer.
+ *
+ * A running timer is stopped first. The minimum delay is one tick, a timer
+ * restarted from its own callback waits for the next tick instead of running
+ * again in the same Timer_Process call. The rearm hook is called when the
+ * timer ends up first in the expiry list.
+ *
+ * @param htimer Pointer to the timer service handle structure.
+ * @param timer Timer to start.
+ * @param now Current tick.
+ * @param delay Ticks to the first expiry.
+ * @param period Ticks between the next expiries, 0 for a one-shot timer.
+ * @return TIMER_OK if started, TIMER_ERROR if the timer has no callback.
+ */
+uint8_t Timer_Start(Timer_HandleTypeDef *htimer, Timer_TypeDef *timer, uint32_t now, uint32_t delay, uint32_t period);
+
+/**
+ * @brief Stop a timer, nothing is done if it is not running.
+ * @param htimer Pointer to the timer service handle structure.
+ * @param timer Timer to stop.
+ */
+void Timer_Stop(Timer_HandleTypeDef *htimer, Timer_TypeDef *timer);
+
+/**
+ * @brief Check if a timer is running.
+ * @param timer Timer to check.
+ * @return 1 if running, 0 otherwise.
+ */
+uint8_t Timer_IsActive(const Timer_TypeDef *timer);
+
+/**
+ * @brief Run the callbacks of the expired timers, in expiry order.
+ *
+ * A periodic timer late by more than one period runs once and its missed
+ * expiries are skipped, keeping its original phase.
+ *
+ * @param htimer Pointer to the timer service handle structure.
+ * @param now Current tick.
+ * @return Number of callbacks run.
+ */
+uint32_t Timer_Process(Timer_HandleTypeDef *htimer, uint32_t now);
+
+/**
+ * @brief Get the ticks left until the first expiry.
+ * @param htimer Pointer to the timer service handle structure.
+ * @param now Current tick.
+ * @return Ticks left, 0 if a timer already expired, TIMER_NO_EXPIRY if none is running.
+ */
+uint32_t Timer_NextExpiry(const Timer_HandleTypeDef *htimer, uint32_t now);
+
+#endif // __APP_TIMER_H__
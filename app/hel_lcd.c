@@ -6,6 +6,12 @@
 #include "hel_lcd.h"
 #include "stm32g0xx_hal.h"
 
+#define HEL_LCD_QUEUE_MASK (HEL_LCD_QUEUE_SIZE - 1u)
+
+static uint8_t HEL_LCD_Push(LCD_HandleTypeDef *hlcd, uint8_t byte, uint8_t isData, uint8_t wait);
+static void HEL_LCD_StartNext(LCD_HandleTypeDef *hlcd);
+static void HEL_LCD_TrackCursor(LCD_HandleTypeDef *hlcd, uint8_t byte, uint8_t isData);
+
 /**
  * @brief  Initialize the LCD display.
  * @param  hlcd: Pointer to the LCD handle structure.
@@ -20,42 +26,59 @@ uint8_t HEL_LCD_Init(LCD_HandleTypeDef *hlcd)
     {
         status = HEL_ERROR;
     }
-
-    /* Initialize the LCD with platform-specific settings */
-    HEL_LCD_MspInit(hlcd);
-
-    /* Begin LCD RESET sequence */
-    /* Set the LCD backlight pin to a high state */
-    HAL_GPIO_WritePin(hlcd->BklPort, hlcd->BklPin, GPIO_PIN_SET);
-    /* Set the LCD chip select pin to a high state */
-    HAL_GPIO_WritePin(hlcd->CsPort, hlcd->CsPin, GPIO_PIN_SET);
-    /* Set the LCD reset pin to a low state */
-    HAL_GPIO_WritePin(hlcd->RstPort, hlcd->RstPin, GPIO_PIN_RESET);
-    /* Wait for 2 ms before changing the reset pin state */
-    HAL_Delay(2);
-    /* Set the LCD reset pin to a high state, ending the reset sequence */
-    HAL_GPIO_WritePin(hlcd->RstPort, hlcd->RstPin, GPIO_PIN_SET);
-    /* Wait for 20 ms to ensure the LCD is ready after the reset */
-    HAL_Delay(20);
-
-    /* Send initialization commands to the LCD */
-    if (HEL_LCD_Command(hlcd, 0x30) != HEL_OK) status = HEL_ERROR; /* Wake up command */
-
-    HAL_Delay(2); /* Wait for 2 ms between commands */
-    
-    if (HEL_LCD_Command(hlcd, 0x30) != HEL_OK) status = HEL_ERROR; /* Another wake up command */
-    if (HEL_LCD_Command(hlcd, 0x30) != HEL_OK) status = HEL_ERROR; /* Yet another wake up command */
-    if (HEL_LCD_Command(hlcd, 0x39) != HEL_OK) status = HEL_ERROR; /* Function set command */
-    if (HEL_LCD_Command(hlcd, 0x14) != HEL_OK) status = HEL_ERROR; /* Set internal oscillator frequency */
-    if (HEL_LCD_Command(hlcd, 0x56) != HEL_OK) status = HEL_ERROR; /* Power control command */
-    if (HEL_LCD_Command(hlcd, 0x6D) != HEL_OK) status = HEL_ERROR; /* Follower control command */
-    if (HEL_LCD_Command(hlcd, 0x70) != HEL_OK) status = HEL_ERROR; /* Set contrast command */
-    if (HEL_LCD_Command(hlcd, 0x0C) != HEL_OK) status = HEL_ERROR; /* Display on command */
-    if (HEL_LCD_Command(hlcd, 0x06) != HEL_OK) status = HEL_ERROR; /* Set entry mode */
-    if (HEL_LCD_Command(hlcd, 0x01) != HEL_OK) status = HEL_ERROR; /* Clear display command */
-
-    /* Wait for 10 ms to ensure commands are processed by the LCD */
-    HAL_Delay(10);
+    else
+    {
+        /* Start with an empty queue */
+        hlcd->Head = 0;
+        hlcd->Tail = 0;
+        hlcd->Run = 0;
+        hlcd->State = HEL_LCD_STATE_IDLE;
+        hlcd->Errors = 0;
+        hlcd->Cursor = HEL_LCD_CURSOR_UNKNOWN;
+
+        /* The clear command below leaves the screen blank, as the shadow */
+        for (uint8_t row = 0; row < HEL_LCD_ROWS; row++)
+        {
+            for (uint8_t col = 0; col < HEL_LCD_COLS; col++)
+            {
+                hlcd->Frame[row][col] = ' ';
+            }
+            hlcd->Dirty[row] = 0;
+        }
+
+        /* Initialize the LCD with platform-specific settings */
+        HEL_LCD_MspInit(hlcd);
+
+        /* Begin LCD RESET sequence, the only blocking part, done once at startup */
+        /* Set the LCD backlight pin to a high state */
+        HAL_GPIO_WritePin(hlcd->BklPort, hlcd->BklPin, GPIO_PIN_SET);
+        /* Set the LCD chip select pin to a high state */
+        HAL_GPIO_WritePin(hlcd->CsPort, hlcd->CsPin, GPIO_PIN_SET);
+        /* Set the LCD reset pin to a low state */
+        HAL_GPIO_WritePin(hlcd->RstPort, hlcd->RstPin, GPIO_PIN_RESET);
+        /* Wait for 2 ms before changing the reset pin state */
+        HAL_Delay(2);
+        /* Set the LCD reset pin to a high state, ending the reset sequence */
+        HAL_GPIO_WritePin(hlcd->RstPort, hlcd->RstPin, GPIO_PIN_SET);
+        /* Wait for 20 ms to ensure the LCD is ready after the reset */
+        HAL_Delay(20);
+
+        /* Queue the initialization commands, with the waits the controller needs */
+        status |= HEL_LCD_Push(hlcd, 0x30, 0, HEL_LCD_WAIT_WAKEUP);   /* Wake up command */
+        status |= HEL_LCD_Push(hlcd, 0x30, 0, HEL_LCD_WAIT_NONE);     /* Another wake up command */
+        status |= HEL_LCD_Push(hlcd, 0x30, 0, HEL_LCD_WAIT_NONE);     /* Yet another wake up command */
+        status |= HEL_LCD_Push(hlcd, 0x39, 0, HEL_LCD_WAIT_NONE);     /* Function set command */
+        status |= HEL_LCD_Push(hlcd, 0x14, 0, HEL_LCD_WAIT_NONE);     /* Set internal oscillator frequency */
+        status |= HEL_LCD_Push(hlcd, 0x56, 0, HEL_LCD_WAIT_NONE);     /* Power control command */
+        status |= HEL_LCD_Push(hlcd, 0x6D, 0, HEL_LCD_WAIT_FOLLOWER); /* Follower control command */
+        status |= HEL_LCD_Push(hlcd, 0x70, 0, HEL_LCD_WAIT_NONE);     /* Set contrast command */
+        status |= HEL_LCD_Push(hlcd, 0x0C, 0, HEL_LCD_WAIT_NONE);     /* Display on command */
+        status |= HEL_LCD_Push(hlcd, 0x06, 0, HEL_LCD_WAIT_NONE);     /* Set entry mode */
+        status |= HEL_LCD_Push(hlcd, 0x01, 0, HEL_LCD_WAIT_CLEAR);    /* Clear display command */
+
+        /* Start sending, the rest goes on in the background */
+        HEL_LCD_Task(hlcd);
+    }
 
     return status;
 }
@@ -70,43 +93,42 @@ __weak void HEL_LCD_MspInit(LCD_HandleTypeDef *hlcd)
 }
 
 /**
- * @brief  Send a command to the LCD display.
+ * @brief  Queue a command for the LCD display.
  * @param  hlcd: Pointer to the LCD handle structure.
  * @param  cmd: The command to send.
- * @retval Status: HEL_OK if the command is sent successfully, HEL_ERROR otherwise.
+ * @retval Status: HEL_OK if the command is queued, HEL_ERROR if the queue is full.
  */
 uint8_t HEL_LCD_Command(LCD_HandleTypeDef *hlcd, uint8_t cmd) 
 {
     uint8_t status = HEL_OK;
+    uint8_t wait = HEL_LCD_WAIT_NONE;
 
-    HAL_GPIO_WritePin(hlcd->RsPort, hlcd->RsPin, GPIO_PIN_RESET);
-    HAL_GPIO_WritePin(hlcd->CsPort, hlcd->CsPin, GPIO_PIN_RESET);
+    /* Clear display (0x01) and return home (0x02, 0x03) take much longer than a byte */
+    if ((cmd == 0x01) || ((cmd & 0xFE) == 0x02))
+    {
+        wait = HEL_LCD_WAIT_CLEAR;
+    }
 
-    status = HAL_SPI_Transmit(hlcd->SpiHandler, &cmd, 1, 5000);
+    status = HEL_LCD_Push(hlcd, cmd, 0, wait);
 
-    HAL_GPIO_WritePin(hlcd->CsPort, hlcd->CsPin, GPIO_PIN_SET);
+    HEL_LCD_Task(hlcd);
 
     return status;
 }
 
 /**
- * @brief  Send data to the LCD display.
+ * @brief  Queue data for the LCD display.
  * @param  hlcd: Pointer to the LCD handle structure.
  * @param  data: The data to send.
- * @retval Status: HEL_OK if data is sent successfully, HEL_ERROR otherwise.
+ * @retval Status: HEL_OK if data is queued, HEL_ERROR if the queue is full.
  */
 uint8_t HEL_LCD_Data(LCD_HandleTypeDef *hlcd, uint8_t data) 
 {
     uint8_t status = HEL_OK;
 
-    HAL_GPIO_WritePin(hlcd->RsPort, hlcd->RsPin, GPIO_PIN_SET);
-    HAL_GPIO_WritePin(hlcd->CsPort, hlcd->CsPin, GPIO_PIN_RESET);
-
-    status = HAL_SPI_Transmit(hlcd->SpiHandler, &data, 1, 5000);
-
-    HAL_GPIO_WritePin(hlcd->CsPort, hlcd->CsPin, GPIO_PIN_SET);
+    status = HEL_LCD_Push(hlcd, data, 1, HEL_LCD_WAIT_NONE);
 
-    HAL_Delay(2); /* Wait for 2 ms between commands */
+    HEL_LCD_Task(hlcd);
 
     return status;
 }
@@ -115,17 +137,34 @@ uint8_t HEL_LCD_Data(LCD_HandleTypeDef *hlcd, uint8_t data)
  * @brief  Display a string on the LCD.
  * @param  hlcd: Pointer to the LCD handle structure.
  * @param  str: Pointer to the string to display.
- * @retval Status: HEL_OK if the string is displayed successfully, HEL_ERROR otherwise.
+ * @retval Status: HEL_OK if the whole string is queued, HEL_ERROR if it does not fit (nothing is queued).
  */
 uint8_t HEL_LCD_String(LCD_HandleTypeDef *hlcd, char *str) 
 {
     uint8_t status = HEL_OK;
     char *ptr = str;
+    uint16_t length = 0;
 
-    while (*ptr != '\0')
+    while (ptr[length] != '\0')
     {
-        status = HEL_LCD_Data(hlcd, *ptr);
-        ptr++;
+        length++;
+    }
+
+    /* All or nothing, a half written string would be worse than a late one */
+    if (length > (uint16_t)(HEL_LCD_QUEUE_SIZE - (uint16_t)(hlcd->Head - hlcd->Tail)))
+    {
+        status = HEL_ERROR;
+    }
+    else
+    {
+        while (*ptr != '\0')
+        {
+            (void)HEL_LCD_Push(hlcd, (uint8_t)*ptr, 1, HEL_LCD_WAIT_NONE);
+            ptr++;
+        }
+
+        /* Queued in one go so the string leaves in a single transfer */
+        HEL_LCD_Task(hlcd);
     }
 
     return status;
@@ -136,7 +175,7 @@ uint8_t HEL_LCD_String(LCD_HandleTypeDef *hlcd, char *str)
  * @param  hlcd: Pointer to the LCD handle structure.
  * @param  row: Row number (0 or 1).
  * @param  col: Column number (0 to 15).
- * @retval Status: HEL_OK if the cursor position is set successfully, HEL_ERROR otherwise.
+ * @retval Status: HEL_OK if the command is queued, HEL_ERROR if the position is invalid or the queue is full.
  */
 uint8_t HEL_LCD_SetCursor(LCD_HandleTypeDef *hlcd, uint8_t row, uint8_t col)
 {
@@ -146,10 +185,12 @@ uint8_t HEL_LCD_SetCursor(LCD_HandleTypeDef *hlcd, uint8_t row, uint8_t col)
     {
         status = HEL_ERROR;
     }
+    else
+    {
+        uint8_t address = (row * 0x40) + col;
 
-    uint8_t address = (row * 0x40) + col;
-
-    status = HEL_LCD_Command(hlcd, 0x80 | address);
+        status = HEL_LCD_Command(hlcd, 0x80 | address);
+    }
 
     return status;
 }
@@ -196,3 +237,277 @@ uint8_t HEL_LCD_Contrast(LCD_HandleTypeDef *hlcd, uint8_t contrast)
     
     return status;
 }
+
+/**
+ * @brief  Write a string in the shadow screen, nothing is sent until HEL_LCD_Flush.
+ * @param  hlcd: Pointer to the LCD handle structure.
+ * @param  row: Row number (0 or 1).
+ * @param  col: Column of the first character (0 to 15).
+ * @param  str: String to write, clipped at the end of the row.
+ * @retval Status: HEL_OK if written, HEL_ERROR if the position is invalid or the string was clipped.
+ */
+uint8_t HEL_LCD_Print(LCD_HandleTypeDef *hlcd, uint8_t row, uint8_t col, const char *str)
+{
+    uint8_t status = HEL_OK;
+
+    if ((row >= HEL_LCD_ROWS) || (col >= HEL_LCD_COLS))
+    {
+        status = HEL_ERROR;
+    }
+    else
+    {
+        while ((*str != '\0') && (col < HEL_LCD_COLS))
+        {
+            /* Only real changes are marked, rewriting the same text costs nothing */
+            if (hlcd->Frame[row][col] != *str)
+            {
+                hlcd->Frame[row][col] = *str;
+                hlcd->Dirty[row] |= (uint16_t)(1u << col);
+            }
+            str++;
+            col++;
+        }
+
+        if (*str != '\0')
+        {
+            status = HEL_ERROR;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief  Queue the cells of the shadow screen that changed since the last flush.
+ * @param  hlcd: Pointer to the LCD handle structure.
+ * @retval Status: HEL_OK if everything is queued, HEL_ERROR if the queue filled up (the rest goes in the next flush).
+ */
+uint8_t HEL_LCD_Flush(LCD_HandleTypeDef *hlcd)
+{
+    uint8_t status = HEL_OK;
+    uint8_t address;
+
+    for (uint8_t row = 0; (row < HEL_LCD_ROWS) && (status == HEL_OK); row++)
+    {
+        for (uint8_t col = 0; (col < HEL_LCD_COLS) && (status == HEL_OK); col++)
+        {
+            if ((hlcd->Dirty[row] & (1u << col)) != 0u)
+            {
+                address = (row * HEL_LCD_ROW_ADDRESS) + col;
+
+                if ((col > 0u) && (hlcd->Cursor == (address - 1u)))
+                {
+                    /* One clean cell behind: rewriting it costs the same byte as a cursor
+                       move and keeps the data in the same transfer */
+                    status = HEL_LCD_Push(hlcd, (uint8_t)hlcd->Frame[row][col - 1u], 1, HEL_LCD_WAIT_NONE);
+                }
+                else if (hlcd->Cursor != address)
+                {
+                    status = HEL_LCD_Push(hlcd, 0x80 | address, 0, HEL_LCD_WAIT_NONE);
+                }
+
+                if (status == HEL_OK)
+                {
+                    status = HEL_LCD_Push(hlcd, (uint8_t)hlcd->Frame[row][col], 1, HEL_LCD_WAIT_NONE);
+                }
+
+                if (status == HEL_OK)
+                {
+                    hlcd->Dirty[row] &= (uint16_t)~(1u << col);
+                }
+            }
+        }
+    }
+
+    HEL_LCD_Task(hlcd);
+
+    return status;
+}
+
+/**
+ * @brief  Ship the queued bytes, call it periodically (every 1 ms keeps the waits accurate).
+ * @param  hlcd: Pointer to the LCD handle structure.
+ */
+void HEL_LCD_Task(LCD_HandleTypeDef *hlcd)
+{
+    /* The DMA interrupt only touches the handle while a transfer runs, so no critical section */
+    if ((hlcd->State == HEL_LCD_STATE_WAIT) && ((HAL_GetTick() - hlcd->WaitStart) >= hlcd->Wait))
+    {
+        hlcd->State = HEL_LCD_STATE_IDLE;
+    }
+
+    if (hlcd->State == HEL_LCD_STATE_IDLE)
+    {
+        HEL_LCD_StartNext(hlcd);
+    }
+}
+
+/**
+ * @brief  Check if everything queued has been sent and executed.
+ * @param  hlcd: Pointer to the LCD handle structure.
+ * @retval 1 if the driver is idle with an empty queue, 0 otherwise.
+ */
+uint8_t HEL_LCD_IsIdle(const LCD_HandleTypeDef *hlcd)
+{
+    return ((hlcd->State == HEL_LCD_STATE_IDLE) && (hlcd->Head == hlcd->Tail)) ? 1u : 0u;
+}
+
+/**
+ * @brief  End of transfer, to be called from HAL_SPI_TxCpltCallback and HAL_SPI_ErrorCallback.
+ * @param  hlcd: Pointer to the LCD handle structure.
+ */
+void HEL_LCD_TxCpltCallback(LCD_HandleTypeDef *hlcd)
+{
+    uint16_t last;
+
+    if (hlcd->State == HEL_LCD_STATE_BUSY)
+    {
+        HAL_GPIO_WritePin(hlcd->CsPort, hlcd->CsPin, GPIO_PIN_SET);
+
+        last = (uint16_t)(hlcd->Tail + hlcd->Run - 1u) & HEL_LCD_QUEUE_MASK;
+        hlcd->Tail += hlcd->Run;
+        hlcd->Run = 0;
+
+        if (hlcd->Waits[last] != HEL_LCD_WAIT_NONE)
+        {
+            /* Slow command, HEL_LCD_Task sends the rest once it is done */
+            hlcd->Wait = hlcd->Waits[last];
+            hlcd->WaitStart = HAL_GetTick();
+            hlcd->State = HEL_LCD_STATE_WAIT;
+        }
+        else
+        {
+            /* Chain the next transfer right away, the byte time already covers the execution */
+            HEL_LCD_StartNext(hlcd);
+        }
+    }
+}
+
+/**
+ * @brief  Append a byte to the queue.
+ * @param  hlcd: Pointer to the LCD handle structure.
+ * @param  byte: Command or data byte.
+ * @param  isData: 1 for data, 0 for commands.
+ * @param  wait: Time in ms the controller needs after the byte.
+ * @retval Status: HEL_OK if queued, HEL_ERROR if the queue is full.
+ */
+static uint8_t HEL_LCD_Push(LCD_HandleTypeDef *hlcd, uint8_t byte, uint8_t isData, uint8_t wait)
+{
+    uint8_t status = HEL_ERROR;
+    uint16_t index;
+
+    if ((uint16_t)(hlcd->Head - hlcd->Tail) < HEL_LCD_QUEUE_SIZE)
+    {
+        index = hlcd->Head & HEL_LCD_QUEUE_MASK;
+        hlcd->Bytes[index] = byte;
+        hlcd->IsData[index] = isData;
+        hlcd->Waits[index] = wait;
+        hlcd->Head++; /* Published last, the slot is complete when the driver sees it */
+
+        HEL_LCD_TrackCursor(hlcd, byte, isData);
+        status = HEL_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief  Start the DMA transfer of the next run of bytes, or go idle if the queue is empty.
+ *
+ * A run holds consecutive bytes of the same kind, so RS and CS are set once for all
+ * of them, and ends at the end of the buffer or after a byte that needs a wait.
+ *
+ * @param  hlcd: Pointer to the LCD handle structure.
+ */
+static void HEL_LCD_StartNext(LCD_HandleTypeDef *hlcd)
+{
+    uint16_t index = hlcd->Tail & HEL_LCD_QUEUE_MASK;
+    uint16_t pending = hlcd->Head - hlcd->Tail;
+    uint16_t run = 0;
+    uint8_t isData;
+
+    if (pending == 0u)
+    {
+        hlcd->State = HEL_LCD_STATE_IDLE;
+    }
+    else
+    {
+        isData = hlcd->IsData[index];
+
+        do
+        {
+            run++;
+        } while ((run < pending) && ((index + run) < HEL_LCD_QUEUE_SIZE) &&
+                 (hlcd->IsData[index + run] == isData) && (hlcd->Waits[index + run - 1u] == HEL_LCD_WAIT_NONE));
+
+        hlcd->Run = run;
+        hlcd->State = HEL_LCD_STATE_BUSY;
+
+        HAL_GPIO_WritePin(hlcd->RsPort, hlcd->RsPin, (isData != 0u) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+        HAL_GPIO_WritePin(hlcd->CsPort, hlcd->CsPin, GPIO_PIN_RESET);
+
+        if (HAL_SPI_Transmit_DMA(hlcd->SpiHandler, &hlcd->Bytes[index], run) != HAL_OK)
+        {
+            /* Drop the run instead of retrying forever, the next call goes on with the queue */
+            HAL_GPIO_WritePin(hlcd->CsPort, hlcd->CsPin, GPIO_PIN_SET);
+            hlcd->Tail += run;
+            hlcd->Run = 0;
+            hlcd->Errors++;
+            hlcd->State = HEL_LCD_STATE_IDLE;
+        }
+    }
+}
+
+/**
+ * @brief  Follow the address counter of the controller as bytes are queued.
+ * @param  hlcd: Pointer to the LCD handle structure.
+ * @param  byte: Command or data byte queued.
+ * @param  isData: 1 for data, 0 for commands.
+ */
+static void HEL_LCD_TrackCursor(LCD_HandleTypeDef *hlcd, uint8_t byte, uint8_t isData)
+{
+    if (isData != 0u)
+    {
+        /* Increment entry mode, each line holds 40 addresses and the second one wraps to the first */
+        if (hlcd->Cursor == 0x27u)
+        {
+            hlcd->Cursor = HEL_LCD_ROW_ADDRESS;
+        }
+        else if (hlcd->Cursor == (HEL_LCD_ROW_ADDRESS + 0x27u))
+        {
+            hlcd->Cursor = 0x00u;
+        }
+        else if (hlcd->Cursor != HEL_LCD_CURSOR_UNKNOWN)
+        {
+            hlcd->Cursor++;
+        }
+    }
+    else if ((byte & 0x80u) != 0u)
+    {
+        hlcd->Cursor = byte & 0x7Fu; /* Set DDRAM address */
+    }
+    else if ((byte == 0x01u) || ((byte & 0xFEu) == 0x02u))
+    {
+        hlcd->Cursor = 0x00u; /* Clear display or return home */
+
+        /* A clear blanks the screen, every cell of the shadow not blank has to be written again */
+        if (byte == 0x01u)
+        {
+            for (uint8_t row = 0; row < HEL_LCD_ROWS; row++)
+            {
+                for (uint8_t col = 0; col < HEL_LCD_COLS; col++)
+                {
+                    if (hlcd->Frame[row][col] != ' ')
+                    {
+                        hlcd->Dirty[row] |= (uint16_t)(1u << col);
+                    }
+                }
+            }
+        }
+    }
+    else
+    {
+        /* Other commands may switch the counter to CGRAM, play safe */
+        hlcd->Cursor = HEL_LCD_CURSOR_UNKNOWN;
+    }
+}
@@ -15,21 +15,76 @@
 #define HEL_OK      0x00U
 #define HEL_ERROR   0x01U
 
+/**
+ * @brief Bytes the driver can hold waiting to be sent, power of two.
+ */
+#ifndef HEL_LCD_QUEUE_SIZE
+#define HEL_LCD_QUEUE_SIZE 64u
+#endif
+
+#if ((HEL_LCD_QUEUE_SIZE & (HEL_LCD_QUEUE_SIZE - 1u)) != 0u) || (HEL_LCD_QUEUE_SIZE > 256u)
+#error "HEL_LCD_QUEUE_SIZE must be a power of two up to 256"
+#endif
+
+/* Execution times of the controller longer than a byte on the SPI, in ms rounded up
+   plus one tick, so a wait measured with HAL_GetTick is never shorter */
+#define HEL_LCD_WAIT_NONE       0u
+#define HEL_LCD_WAIT_CLEAR      3u      /**< Clear display and return home, 1.08 ms */
+#define HEL_LCD_WAIT_WAKEUP     3u      /**< First wake up command after reset */
+#define HEL_LCD_WAIT_FOLLOWER   201u    /**< Follower control, voltage settles in 200 ms */
+
+#define HEL_LCD_ROWS        2u      /**< Visible rows */
+#define HEL_LCD_COLS        16u     /**< Visible characters per row */
+#define HEL_LCD_ROW_ADDRESS 0x40u   /**< DDRAM address of the second row */
+
+#define HEL_LCD_CURSOR_UNKNOWN 0xFFU /**< Address counter position not known by the driver */
+
+#define HEL_LCD_STATE_IDLE  0x00U   /**< Nothing being sent */
+#define HEL_LCD_STATE_BUSY  0x01U   /**< SPI transfer running */
+#define HEL_LCD_STATE_WAIT  0x02U   /**< Waiting for a slow command to finish */
+
 /**
  * @brief LCD handler structure.
  * 
  * Defines a structure to handle LCD properties and configurations like SPI interface, 
  * pin assignments, and GPIO ports.
+ *
+ * Commands and data are queued and shipped in the background: consecutive bytes of
+ * the same kind go in one DMA transfer with chip select held low, and commands slower
+ * than a byte time are followed by a wait checked by HEL_LCD_Task instead of a delay.
+ * The SPI clock must give every byte at least the 26.3 us the controller takes to
+ * execute it, 250 kHz or less (SPI_BAUDRATEPRESCALER_64 at 16 MHz).
+ *
+ * HEL_LCD_Print only writes a shadow copy of the screen and marks the cells that
+ * changed, HEL_LCD_Flush then queues just those cells, moving the cursor only when
+ * the address counter is not already on the next cell to write.
  */
 typedef struct
 {
-    SPI_HandleTypeDef *SpiHandler;  /**< SPI handler for communication */
+    SPI_HandleTypeDef *SpiHandler;  /**< SPI handler for communication, with a DMA channel linked for TX */
     GPIO_TypeDef *RstPort, *RsPort, *CsPort, *BklPort;  /**< GPIO ports for Reset, RS, CS, and Backlight */
     uint32_t RstPin, RsPin, CsPin, BklPin;  /**< GPIO pins for Reset, RS, CS, and Backlight */
+    uint8_t Bytes[HEL_LCD_QUEUE_SIZE];  /**< Queued bytes, sent from here by the DMA */
+    uint8_t IsData[HEL_LCD_QUEUE_SIZE]; /**< 1 for data bytes (RS high), 0 for commands */
+    uint8_t Waits[HEL_LCD_QUEUE_SIZE];  /**< Wait in ms after each byte */
+    volatile uint16_t Head;         /**< Free running write index, only moved by the writers */
+    volatile uint16_t Tail;         /**< Free running read index, only moved by the driver */
+    volatile uint16_t Run;          /**< Bytes in the running transfer */
+    volatile uint8_t State;         /**< HEL_LCD_STATE_x */
+    volatile uint32_t WaitStart;    /**< Tick the running wait started at */
+    volatile uint8_t Wait;          /**< Length of the running wait in ms */
+    uint32_t Errors;                /**< Transfers the SPI refused, their bytes are dropped */
+    char Frame[HEL_LCD_ROWS][HEL_LCD_COLS]; /**< Shadow of the screen, as it must look after the next flush */
+    uint16_t Dirty[HEL_LCD_ROWS];   /**< One bit per column, set for the cells changed since the last flush */
+    uint8_t Cursor;                 /**< DDRAM address the next data byte goes to, HEL_LCD_CURSOR_UNKNOWN if not known */
 } LCD_HandleTypeDef;
 
 /**
  * @brief Initialize the LCD display.
+ *
+ * Only the reset pulse blocks, the initialization commands are queued and sent by
+ * HEL_LCD_Task, so the interrupts of the DMA channel must be enabled.
+ *
  * @param hlcd: Pointer to the LCD handle structure.
  * @retval Status: HEL_OK if initialization succeeds, HEL_ERROR otherwise.
  */
@@ -42,18 +97,18 @@ uint8_t HEL_LCD_Init(LCD_HandleTypeDef *hlcd);
 void HEL_LCD_MspInit(LCD_HandleTypeDef *hlcd);
 
 /**
- * @brief Send a command to the LCD display.
+ * @brief Queue a command for the LCD display.
  * @param hlcd: Pointer to the LCD handle structure.
  * @param cmd: The command to send.
- * @retval Status: HEL_OK if the command is sent successfully, HEL_ERROR otherwise.
+ * @retval Status: HEL_OK if the command is queued, HEL_ERROR if the queue is full.
  */
 uint8_t HEL_LCD_Command(LCD_HandleTypeDef *hlcd, uint8_t cmd);
 
 /**
- * @brief Send data to the LCD display.
+ * @brief Queue data for the LCD display.
  * @param hlcd: Pointer to the LCD handle structure.
  * @param data: The data to send.
- * @retval Status: HEL_OK if data is sent successfully, HEL_ERROR otherwise.
+ * @retval Status: HEL_OK if data is queued, HEL_ERROR if the queue is full.
  */
 uint8_t HEL_LCD_Data(LCD_HandleTypeDef *hlcd, uint8_t data);
 
@@ -61,7 +116,7 @@ uint8_t HEL_LCD_Data(LCD_HandleTypeDef *hlcd, uint8_t data);
  * @brief Display a string on the LCD.
  * @param hlcd: Pointer to the LCD handle structure.
  * @param str: Pointer to the string to display.
- * @retval Status: HEL_OK if the string is displayed successfully, HEL_ERROR otherwise.
+ * @retval Status: HEL_OK if the whole string is queued, HEL_ERROR if it does not fit (nothing is queued).
  */
 uint8_t HEL_LCD_String(LCD_HandleTypeDef *hlcd, char *str);
 
@@ -70,7 +125,7 @@ uint8_t HEL_LCD_String(LCD_HandleTypeDef *hlcd, char *str);
  * @param hlcd: Pointer to the LCD handle structure.
  * @param row: Row number (0 or 1).
  * @param col: Column number (0 to 15).
- * @retval Status: HEL_OK if the cursor position is set successfully, HEL_ERROR otherwise.
+ * @retval Status: HEL_OK if the command is queued, HEL_ERROR if the position is invalid or the queue is full.
  */
 uint8_t HEL_LCD_SetCursor(LCD_HandleTypeDef *hlcd, uint8_t row, uint8_t col);
 
@@ -89,4 +144,40 @@ void HEL_LCD_Backlight(LCD_HandleTypeDef *hlcd, uint8_t state);
  */
 uint8_t HEL_LCD_Contrast(LCD_HandleTypeDef *hlcd, uint8_t contrast);
 
+/**
+ * @brief Write a string in the shadow screen, nothing is sent until HEL_LCD_Flush.
+ * @param hlcd: Pointer to the LCD handle structure.
+ * @param row: Row number (0 or 1).
+ * @param col: Column of the first character (0 to 15).
+ * @param str: String to write, clipped at the end of the row.
+ * @retval Status: HEL_OK if written, HEL_ERROR if the position is invalid or the string was clipped.
+ */
+uint8_t HEL_LCD_Print(LCD_HandleTypeDef *hlcd, uint8_t row, uint8_t col, const char *str);
+
+/**
+ * @brief Queue the cells of the shadow screen that changed since the last flush.
+ * @param hlcd: Pointer to the LCD handle structure.
+ * @retval Status: HEL_OK if everything is queued, HEL_ERROR if the queue filled up (the rest goes in the next flush).
+ */
+uint8_t HEL_LCD_Flush(LCD_HandleTypeDef *hlcd);
+
+/**
+ * @brief Ship the queued bytes, call it periodically (every 1 ms keeps the waits accurate).
+ * @param hlcd: Pointer to the LCD handle structure.
+ */
+void HEL_LCD_Task(LCD_HandleTypeDef *hlcd);
+
+/**
+ * @brief Check if everything queued has been sent and executed.
+ * @param hlcd: Pointer to the LCD handle structure.
+ * @retval 1 if the driver is idle with an empty queue, 0 otherwise.
+ */
+uint8_t HEL_LCD_IsIdle(const LCD_HandleTypeDef *hlcd);
+
+/**
+ * @brief End of transfer, to be called from HAL_SPI_TxCpltCallback and HAL_SPI_ErrorCallback.
+ * @param hlcd: Pointer to the LCD handle structure.
+ */
+void HEL_LCD_TxCpltCallback(LCD_HandleTypeDef *hlcd);
+
 #endif // __HEL_LCD_H__
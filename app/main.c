@@ -3,6 +3,9 @@
 #include "app_clock.h"
 #include "hel_lcd.h"
 #include "app_can.h"
+#include "app_sched.h"
+#include "app_timer.h"
+#include "app_bench.h"
 
 /* Add more includes as needed */
 
@@ -13,6 +16,17 @@
 
 // LCD_HandleTypeDef hlcd; /* Structure to handle the LCD */
 
+#define TIMER_TASK_PERIOD  1u /* ms to the first run, then the task only wakes up at the timer expiries */
+
+Sched_HandleTypeDef Scheduler; /* Cooperative scheduler, the tasks and ISRs set its events */
+Timer_HandleTypeDef Timers;    /* Software timers, their callbacks run in Timer_Task */
+#if (BENCH_ENABLED != 0u)
+Bench_HandleTypeDef Bench;     /* Execution time probes of the hot paths (APP_Probes) */
+#endif
+
+static void Timer_Task(void);
+static void Timer_Rearm(void);
+static void Idle_Hook(void);
 
 int main(void)
 {
@@ -22,6 +36,14 @@ int main(void)
     /* Initialize hardware abstraction layer */
     HAL_Init();
 
+#if (BENCH_ENABLED != 0u)
+    /* Start the benchmark counter before any probed code can run */
+    Bench_Init(&Bench, Bench_CounterRead, Bench_CounterStart());
+#endif
+
+    /* Initialize the software timers, before the modules starting them */
+    Timer_Init(&Timers, Timer_Rearm);
+
     /* Initialize serial communication */
     Serial_Init();
 
@@ -33,20 +55,61 @@ int main(void)
     
     /* Add more initializations as needed */
 
-    while (1)
-    {
-        /* Execute serial communication task */
-        Serial_Task();
+    /* Tasks in priority order: serial answers the commands, the clock applies them
+       and the CAN task broadcasts the result, each one wakes up the next */
+    Sched_Init(&Scheduler, HAL_GetTick, Idle_Hook);
+    Sched_AddTask(&Scheduler, Timer_Task, TIMER_TASK_PERIOD, 0);
+    Sched_AddTask(&Scheduler, Serial_Task, 0, SCHED_EVENT_MASK(APP_EVENT_SERIAL));
+    Sched_AddTask(&Scheduler, Clock_Task, 0, SCHED_EVENT_MASK(APP_EVENT_CLOCK));
+    // Sched_AddTask(&Scheduler, Display_Task, 1, SCHED_EVENT_MASK(APP_EVENT_DISPLAY)); /* 1 ms for the LCD waits */
+    Sched_AddTask(&Scheduler, CAN_Task, 0, SCHED_EVENT_MASK(APP_EVENT_CAN));
 
-        /* Execute clock task */
-        Clock_Task();
+    /* Add and register other tasks as needed */
 
-        /* Execute the display task */
-        // Display_Task();
+    Sched_Run(&Scheduler);
+}
 
-        /* Execute the CAN task */
-        CAN_Task();
+/**
+ * @brief Run the callbacks of the expired software timers
+ */
+static void Timer_Task(void)
+{
+    (void)Timer_Process(&Timers, HAL_GetTick());
+    Timer_Rearm();
+}
 
-        /* Add and execute other tasks as needed */
+/**
+ * @brief Run Timer_Task again at the first expiry, it sleeps while no timer is running
+ */
+static void Timer_Rearm(void)
+{
+    uint32_t left = Timer_NextExpiry(&Timers, HAL_GetTick());
+
+    if (left == TIMER_NO_EXPIRY)
+    {
+        left = 0; /* No periodic runs, the next Timer_Start wakes it up */
     }
+    else if (left == 0u)
+    {
+        left = 1; /* Already late, on the next tick */
+    }
+
+    (void)Sched_SetPeriod(&Scheduler, Timer_Task, left);
+}
+
+/**
+ * @brief Sleep until the next interrupt when no task is ready
+ */
+static void Idle_Hook(void)
+{
+    /* An ISR may have set an event after the scheduler looked at them, check again with
+       the interrupts masked; a pending interrupt still wakes WFI and runs once unmasked */
+    __disable_irq();
+
+    if (Sched_EventPending(&Scheduler) == 0u)
+    {
+        __WFI();
+    }
+
+    __enable_irq();
 }
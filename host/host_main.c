@@ -0,0 +1,903 @@
+/**
+ * @file host_main.c
+ * @brief Soak and throughput test of the application on the simulated HAL.
+ *
+ * Runs the unchanged firmware (its main is renamed App_Main by the makefile)
+ * on a virtual CAN bus with two more nodes. The tester sends time, date,
+ * alarm and invalid commands as ISO-TP single frames, one at a time, and
+ * checks the response and the broadcast each one should produce. The time
+ * commands go on the urgent command ID and are answered on the urgent
+ * response ID, the others on the command ID. The load node sends higher priority frames periodically, so the
+ * firmware and the tester lose arbitrations. The display task is not
+ * scheduled, so the harness writes a string to an LCD of its own every time
+ * the driver is idle. After the commands the tester sets the time a second
+ * before an alarm and waits for the alarm event broadcast by the firmware from
+ * its RTC interrupt. Then it fills both RX FIFOs with command frames while the
+ * interrupts are masked, as a busy CPU would find it, and waits for all the
+ * responses with nothing else sent, so the frames a spent RX drain budget
+ * leaves in the FIFOs must be read without a new frame (make host-drain runs
+ * it with a budget of one frame). Every time the firmware sleeps, the calendar it keeps in
+ * RAM is compared with the simulated RTC. Arguments, all optional:
+ *
+ *     temp [commands] [errors per million frames] [load period in ms, 0 for none]
+ *
+ * After the commands the tester reads the execution time probes of the
+ * firmware over the bus, as it would on the target, with the benchmark dump
+ * command and its own ISO-TP channel. At the end the probes in wall clock
+ * nanoseconds, the latencies in virtual milliseconds, the bus and node
+ * counters and the wall clock throughput are printed, and the process exits
+ * with a failure status if any command or dump went wrong.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "sim_hal.h"
+#include "sim_canbus.h"
+#include "app_bsp.h"
+#include "app_serial.h"
+#include "app_cantp.h"
+#include "app_bench.h"
+#include "app_queue.h"
+#include "app_clock.h"
+#include "hel_lcd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HOST_DEFAULT_COMMANDS   1000u
+#define HOST_COMMAND_TIMEOUT    100u    /* ms to get the response and the broadcast */
+#define HOST_ERROR_SEED         12345u  /* Same errors on every run */
+#define HOST_ALARM_TIMEOUT      2000u   /* ms to get the alarm event once the alarm is set */
+#define HOST_BURST_FRAMES       3u      /* Commands per RX FIFO of the burst check, as many as its elements */
+#define HOST_BURST_TIMEOUT      500u    /* ms to get all the responses of the burst */
+#define HOST_STALL_MARGIN       5u      /* ms past N_Cr to drop the stalled request */
+
+#define HOST_LOAD_ID        0x100u  /* Wins the arbitration against the command and response IDs */
+#define HOST_COMMAND_ID     0x111u
+#define HOST_RESPONSE_ID    0x122u
+#define HOST_URGENT_ID      0x110u  /* Received by the firmware in RX FIFO 1 */
+#define HOST_URGENT_RESPONSE_ID 0x121u
+#define HOST_TIME_ID        0x130u
+#define HOST_DATE_ID        0x131u
+#define HOST_ALARM_ID       0x132u
+#define HOST_ALARM_EVENT_ID 0x133u
+#define HOST_ALARM_HOUR     12u     /* Alarm of the alarm check, the time is set a second before */
+#define HOST_ALARM_MINUTES  30u
+#define HOST_NO_BROADCAST   0u
+
+#define HOST_OK_BYTE        0x55u
+#define HOST_ERROR_BYTE     0xAAu
+#define HOST_BENCH_COMMAND  0x04u   /* Benchmark dump, the probe number follows */
+
+/**
+ * @brief Command in flight and what it should produce.
+ */
+typedef struct
+{
+    uint32_t RequestId;     /* Command or urgent command ID */
+    uint32_t ResponseId;    /* Response ID matching the request one */
+    uint8_t Request[8];     /* Single frame, PCI and payload */
+    uint8_t Response;       /* Expected first response byte */
+    uint32_t BroadcastId;   /* Expected broadcast, HOST_NO_BROADCAST if none */
+    uint8_t Broadcast[4];   /* Expected first broadcast bytes */
+    uint8_t BroadcastSize;
+    uint32_t Sent;          /* Tick the request was queued on the bus */
+    uint8_t Responded;
+    uint8_t Broadcasted;
+} Host_CommandTypeDef;
+
+/**
+ * @brief Latency statistics in virtual milliseconds.
+ */
+typedef struct
+{
+    uint32_t Count;
+    uint32_t Min;
+    uint32_t Max;
+    uint64_t Sum;
+} Host_LatencyTypeDef;
+
+int App_Main(void);
+
+static void Host_Idle(void);
+static void Host_Lcd(void);
+static void Host_Dump(void);
+static void Host_PrintRecord(const uint8_t *record, uint16_t size);
+static uint8_t Host_TesterTxFrame(const uint8_t *data, uint8_t length);
+static uint32_t Host_Get32(const uint8_t *buffer);
+static void Host_Prepare(Host_CommandTypeDef *cmd, uint32_t index);
+static uint8_t Host_AlarmCheck(void);
+static uint8_t Host_BurstCheck(void);
+static uint8_t Host_StallCheck(void);
+static void Host_Send(void);
+static void Host_CheckCalendar(void);
+static void Host_TesterRx(SimBus_NodeTypeDef *node, const Sim_CanFrameTypeDef *frame);
+static void Host_Frame(Sim_CanFrameTypeDef *frame, uint32_t id);
+static void Host_ReportNode(const SimBus_NodeTypeDef *node);
+static void Host_Record(Host_LatencyTypeDef *latency, uint32_t value);
+static void Host_Report(void);
+static uint8_t Host_Bcd(uint32_t value);
+static double Host_WallClock(void);
+
+static SimBus_HandleTypeDef Bus;
+static SimBus_NodeTypeDef Tester;
+static SimBus_NodeTypeDef Load;
+
+static uint32_t Commands = HOST_DEFAULT_COMMANDS;
+static uint32_t ErrorRate;
+static uint32_t LoadPeriod;
+static uint32_t LoadLast;
+static uint32_t Issued;
+static uint32_t Passed;
+static uint32_t Failed;
+static uint32_t Unsolicited;
+static uint32_t AlarmEvents;            /* Alarm events seen, the commands may match an alarm too */
+static uint8_t AlarmStep;               /* Step of the alarm check */
+static uint8_t AlarmSeen;               /* Event of the alarm check received */
+static uint32_t AlarmSet;               /* Tick the alarm of the alarm check was sent */
+static uint8_t BurstStep;               /* Step of the burst check */
+static uint32_t BurstResponses;         /* Responses to the burst received */
+static uint32_t BurstSent;              /* Tick the burst was sent */
+static uint8_t StallStep;               /* Step of the stalled request check */
+static uint8_t StallFlowControl;        /* Flow control of the stalled request received */
+static uint32_t StallSent;              /* Tick the first frame of the stalled request was sent */
+static uint32_t CalendarReads;          /* Calendar copies of the firmware compared with the RTC */
+static uint32_t CalendarMismatches;
+static uint8_t InFlight;
+static Host_CommandTypeDef Command;
+static Host_LatencyTypeDef ResponseLatency;
+static Host_LatencyTypeDef UrgentLatency;
+static Host_LatencyTypeDef BroadcastLatency;
+static double WallStart;
+
+static CanTp_HandleTypeDef TesterTp;    /* Tester side of the command channel for the dump */
+static uint8_t Dumping;                 /* 1 once the commands are done */
+static uint8_t DumpProbe;               /* Probe being read */
+static uint8_t DumpPending;             /* Request sent, waiting for the record */
+static uint32_t DumpSent;
+static uint32_t DumpFailed;
+
+static LCD_HandleTypeDef Lcd;           /* LCD written by the harness, never initialized */
+static SPI_HandleTypeDef LcdSpi;
+static SPI_TypeDef LcdSpiInstance;
+
+extern Bench_HandleTypeDef Bench;       /* Probes of the firmware */
+extern Queue_HandleTypeDef ClockQueue;  /* Message queues between the tasks */
+extern Queue_HandleTypeDef CANQueue;
+extern Queue_HandleTypeDef DisplayQueue;
+extern CanTp_HandleTypeDef CANTpHandle; /* Transport layer of the command channel */
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+    {
+        Commands = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2)
+    {
+        ErrorRate = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+
+    if (argc > 3)
+    {
+        LoadPeriod = (uint32_t)strtoul(argv[3], NULL, 0);
+    }
+
+    ResponseLatency.Min = UINT32_MAX;
+    UrgentLatency.Min = UINT32_MAX;
+    BroadcastLatency.Min = UINT32_MAX;
+
+    /* Same bit rates as the firmware, its node gets errors if its bit timing is wrong */
+    Sim_Init();
+    SimBus_Init(&Bus, SERIAL_CAN_BITRATE, SERIAL_CAN_DATA_BITRATE);
+    SimBus_SetErrorRate(&Bus, ErrorRate, HOST_ERROR_SEED);
+    Sim_FdcanAttach(&Bus);
+    SimBus_AddNode(&Bus, &Tester, "tester", Host_TesterRx, NULL);
+    SimBus_AddNode(&Bus, &Load, "load", NULL, NULL);
+    Sim_SetIdleHook(Host_Idle);
+
+    /* Classic frames, no flow control limits, as the firmware */
+    TesterTp.TxFrame = Host_TesterTxFrame;
+    TesterTp.FrameSize = CANTP_FRAME_SIZE;
+    TesterTp.BlockSize = 0;
+    TesterTp.STmin = 0;
+    CanTp_Init(&TesterTp);
+
+    LcdSpi.Instance = &LcdSpiInstance;
+    Lcd.SpiHandler = &LcdSpi;
+    Lcd.CsPort = GPIOB;
+    Lcd.CsPin = GPIO_PIN_0;
+    Lcd.RsPort = GPIOB;
+    Lcd.RsPin = GPIO_PIN_1;
+    Lcd.Cursor = HEL_LCD_CURSOR_UNKNOWN;
+
+    WallStart = Host_WallClock();
+
+    /* Only returns through exit() from the idle hook */
+    (void)App_Main();
+
+    return EXIT_FAILURE;
+}
+
+/**
+ * @brief Peer side, runs every time the firmware goes to sleep
+ */
+static void Host_Idle(void)
+{
+    Sim_CanFrameTypeDef frame;
+    uint8_t done;
+
+    if ((LoadPeriod > 0u) && ((Sim_Now() - LoadLast) >= LoadPeriod))
+    {
+        LoadLast = Sim_Now();
+        Host_Frame(&frame, HOST_LOAD_ID);
+        (void)SimBus_Send(&Load, &frame);
+    }
+
+    Host_Lcd();
+    Host_CheckCalendar();
+
+    if (Dumping != 0u)
+    {
+        Host_Dump();
+        return;
+    }
+
+    if (InFlight != 0u)
+    {
+        done = (Command.Responded != 0u) &&
+               ((Command.BroadcastId == HOST_NO_BROADCAST) || (Command.Broadcasted != 0u));
+
+        if (done != 0u)
+        {
+            Passed++;
+            InFlight = 0;
+        }
+        else if ((Sim_Now() - Command.Sent) > HOST_COMMAND_TIMEOUT)
+        {
+            printf("command %u timed out: response %u broadcast %u\n",
+                   (unsigned)Issued, (unsigned)Command.Responded, (unsigned)Command.Broadcasted);
+            Failed++;
+            InFlight = 0;
+        }
+    }
+
+    if (InFlight == 0u)
+    {
+        if (Issued == Commands)
+        {
+            if ((Host_AlarmCheck() != 0u) && (Host_BurstCheck() != 0u) && (Host_StallCheck() != 0u))
+            {
+                printf("%-12s %8s %10s %10s %10s  %s\n", "probe", "count", "min ns", "max ns", "mean ns", "histogram");
+                Dumping = 1;
+            }
+            return;
+        }
+
+        Host_Prepare(&Command, Issued);
+        Host_Send();
+        Issued++;
+    }
+}
+
+/**
+ * @brief Set the time a second before an alarm, then wait for its event, one step per call
+ * @return 1 once the check is over, 0 while it runs
+ */
+static uint8_t Host_AlarmCheck(void)
+{
+    uint8_t done = 0;
+
+    switch (AlarmStep)
+    {
+    case 0:
+        /* Urgent time command, 12:29:59 */
+        memset(&Command, 0, sizeof(Command));
+        Command.RequestId = HOST_URGENT_ID;
+        Command.ResponseId = HOST_URGENT_RESPONSE_ID;
+        Command.Response = HOST_OK_BYTE;
+        Command.Request[0] = 4;
+        Command.Request[1] = 1;
+        Command.Request[2] = Host_Bcd(HOST_ALARM_HOUR);
+        Command.Request[3] = Host_Bcd(HOST_ALARM_MINUTES - 1u);
+        Command.Request[4] = Host_Bcd(59u);
+        Command.BroadcastId = HOST_TIME_ID;
+        Command.Broadcast[0] = HOST_ALARM_HOUR;
+        Command.Broadcast[1] = HOST_ALARM_MINUTES - 1u;
+        Command.Broadcast[2] = 59u;
+        Command.BroadcastSize = 3;
+        Host_Send();
+        AlarmStep = 1;
+        break;
+
+    case 1:
+        /* Alarm command, 12:30, the event follows within a second */
+        memset(&Command, 0, sizeof(Command));
+        Command.RequestId = HOST_COMMAND_ID;
+        Command.ResponseId = HOST_RESPONSE_ID;
+        Command.Response = HOST_OK_BYTE;
+        Command.Request[0] = 3;
+        Command.Request[1] = 3;
+        Command.Request[2] = Host_Bcd(HOST_ALARM_HOUR);
+        Command.Request[3] = Host_Bcd(HOST_ALARM_MINUTES);
+        Command.BroadcastId = HOST_ALARM_ID;
+        Command.Broadcast[0] = HOST_ALARM_HOUR;
+        Command.Broadcast[1] = HOST_ALARM_MINUTES;
+        Command.BroadcastSize = 2;
+        AlarmSeen = 0;
+        AlarmSet = Sim_Now();
+        Host_Send();
+        AlarmStep = 2;
+        break;
+
+    case 2:
+        if (AlarmSeen != 0u)
+        {
+            Passed++;
+            AlarmStep = 3;
+        }
+        else if ((Sim_Now() - AlarmSet) > HOST_ALARM_TIMEOUT)
+        {
+            printf("alarm event timed out\n");
+            Failed++;
+            AlarmStep = 3;
+        }
+        break;
+
+    default:
+        done = 1;
+        break;
+    }
+
+    return done;
+}
+
+/**
+ * @brief Store invalid time commands in both RX FIFOs at once, then wait for all their error responses
+ * @return 1 once the check is over, 0 while it runs
+ */
+static uint8_t Host_BurstCheck(void)
+{
+    Sim_CanFrameTypeDef frame;
+    uint8_t done = 0;
+
+    switch (BurstStep)
+    {
+    case 0:
+        BurstResponses = 0;
+        BurstSent = Sim_Now();
+
+        /* The interrupt finds every frame in the FIFO, only one interrupt for all of them */
+        __disable_irq();
+
+        for (uint32_t i = 0; i < (2u * HOST_BURST_FRAMES); i++)
+        {
+            Host_Frame(&frame, (i < HOST_BURST_FRAMES) ? HOST_COMMAND_ID : HOST_URGENT_ID);
+            frame.Data[0] = 4;      /* Time with an hour out of range */
+            frame.Data[1] = 1;
+            frame.Data[2] = 0x25;
+            frame.Data[3] = Host_Bcd(i);
+            frame.Start = Serial_TimestampRead(); /* Received now, as the timestamp counter sees it */
+
+            if (Sim_FdcanInject(&frame) != SIM_OK)
+            {
+                printf("burst frame %u not stored: RX FIFO full\n", (unsigned)i);
+            }
+        }
+
+        __enable_irq();
+
+        BurstStep = 1;
+        break;
+
+    case 1:
+        if (BurstResponses == (2u * HOST_BURST_FRAMES))
+        {
+            Passed++;
+            BurstStep = 2;
+        }
+        else if ((Sim_Now() - BurstSent) > HOST_BURST_TIMEOUT)
+        {
+            printf("burst timed out: %u of %u responses\n", (unsigned)BurstResponses, (unsigned)(2u * HOST_BURST_FRAMES));
+            Failed++;
+            BurstStep = 2;
+        }
+        break;
+
+    default:
+        done = 1;
+        break;
+    }
+
+    return done;
+}
+
+/**
+ * @brief Send the first frame of a request and never its consecutive frames
+ *
+ * Nothing but the N_Cr deadline wakes the serial task, the firmware must
+ * drop the request when it expires.
+ *
+ * @return 1 once the check is over
+ */
+static uint8_t Host_StallCheck(void)
+{
+    Sim_CanFrameTypeDef frame;
+    uint8_t done = 0;
+
+    switch (StallStep)
+    {
+    case 0:
+        Host_Frame(&frame, HOST_COMMAND_ID);
+        frame.Data[0] = 0x10;   /* First frame of a 20 bytes request */
+        frame.Data[1] = 20;
+        (void)SimBus_Send(&Tester, &frame);
+
+        StallFlowControl = 0;
+        StallSent = Sim_Now();
+        StallStep = 1;
+        break;
+
+    case 1:
+        if ((CANTpHandle.RxState == CANTP_RX_IDLE_STATE) && (CANTpHandle.RxResult == CANTP_RESULT_TIMEOUT_CR) &&
+            (StallFlowControl != 0u))
+        {
+            Passed++;
+            StallStep = 2;
+        }
+        else if ((Sim_Now() - StallSent) > (CANTP_N_CR_TIMEOUT + HOST_STALL_MARGIN))
+        {
+            printf("stalled request not dropped: flow control %u, rx state %u\n",
+                   (unsigned)StallFlowControl, (unsigned)CANTpHandle.RxState);
+            Failed++;
+            StallStep = 2;
+        }
+        break;
+
+    default:
+        done = 1;
+        break;
+    }
+
+    return done;
+}
+
+/**
+ * @brief Compare the calendar kept by the firmware with the one of the simulated RTC
+ *
+ * The week day written to the RTC must be 1 (Monday) to 7 (Sunday), the
+ * hardware forbids 0. Every second one read is preempted by the wakeup
+ * interrupt between its SSR and DR reads.
+ */
+static void Host_CheckCalendar(void)
+{
+    APP_ClockTypeDef clock;
+    RTC_TimeTypeDef time;
+    RTC_DateTypeDef date;
+    uint16_t millis;
+    uint16_t expected;
+
+    /* Read as a task does, with the interrupts the idle hook masked enabled */
+    Sim_RtcPreemptAtSsr();
+    __enable_irq();
+    millis = Clock_GetCalendar(&clock);
+    __disable_irq();
+
+    (void)HAL_RTC_GetTime(NULL, &time, RTC_FORMAT_BIN);
+    (void)HAL_RTC_GetDate(NULL, &date, RTC_FORMAT_BIN);
+    expected = (uint16_t)(((time.SecondFraction - time.SubSeconds) * 1000u) / (time.SecondFraction + 1u));
+
+    CalendarReads++;
+
+    if ((clock.time.hour != time.Hours) || (clock.time.min != time.Minutes) || (clock.time.sec != time.Seconds) ||
+        (clock.date.mday != date.Date) || (clock.date.mon != date.Month) || (clock.date.wday != date.WeekDay) ||
+        (clock.date.year != (2000u + date.Year)) || (millis != expected) ||
+        (date.WeekDay < RTC_WEEKDAY_MONDAY) || (date.WeekDay > RTC_WEEKDAY_SUNDAY))
+    {
+        CalendarMismatches++;
+    }
+}
+
+/**
+ * @brief Queue the request of the command prepared on the bus
+ */
+static void Host_Send(void)
+{
+    Sim_CanFrameTypeDef frame;
+
+    Host_Frame(&frame, Command.RequestId);
+    memcpy(frame.Data, Command.Request, sizeof(Command.Request));
+
+    if (SimBus_Send(&Tester, &frame) == SIMBUS_OK)
+    {
+        Command.Sent = Sim_Now();
+        InFlight = 1;
+    }
+    else
+    {
+        /* Earlier requests never won the bus, a saturated bus must not hang the run */
+        printf("command %u not sent: tester queue full\n", (unsigned)Issued);
+        Failed++;
+    }
+}
+
+/**
+ * @brief Build the next command, the four kinds in turn with changing values
+ * @param cmd Command to fill
+ * @param index Command number
+ */
+static void Host_Prepare(Host_CommandTypeDef *cmd, uint32_t index)
+{
+    uint32_t hour = index % 24u;
+    uint32_t minutes = (index / 24u) % 60u;
+    uint32_t seconds = index % 60u;
+    uint32_t day = 1u + (index % 28u);
+    uint32_t month = 1u + (index % 12u);
+    uint32_t year = 2000u + (index % 100u);
+
+    memset(cmd, 0, sizeof(*cmd));
+    cmd->RequestId = HOST_COMMAND_ID;
+    cmd->ResponseId = HOST_RESPONSE_ID;
+    cmd->Response = HOST_OK_BYTE;
+
+    switch (index % 4u)
+    {
+    case 0:
+        cmd->RequestId = HOST_URGENT_ID;
+        cmd->ResponseId = HOST_URGENT_RESPONSE_ID;
+        cmd->Request[0] = 4;    /* Single frame, 4 bytes */
+        cmd->Request[1] = 1;    /* Time */
+        cmd->Request[2] = Host_Bcd(hour);
+        cmd->Request[3] = Host_Bcd(minutes);
+        cmd->Request[4] = Host_Bcd(seconds);
+        cmd->BroadcastId = HOST_TIME_ID;
+        cmd->Broadcast[0] = (uint8_t)hour;
+        cmd->Broadcast[1] = (uint8_t)minutes;
+        cmd->Broadcast[2] = (uint8_t)seconds;
+        cmd->BroadcastSize = 3;
+        break;
+
+    case 1:
+        cmd->Request[0] = 5;    /* Single frame, 5 bytes */
+        cmd->Request[1] = 2;    /* Date */
+        cmd->Request[2] = Host_Bcd(day);
+        cmd->Request[3] = Host_Bcd(month);
+        cmd->Request[4] = Host_Bcd(year / 100u);
+        cmd->Request[5] = Host_Bcd(year % 100u);
+        cmd->BroadcastId = HOST_DATE_ID;
+        cmd->Broadcast[0] = (uint8_t)day;
+        cmd->Broadcast[1] = (uint8_t)month;
+        cmd->Broadcast[2] = (uint8_t)(year / 100u);
+        cmd->Broadcast[3] = (uint8_t)(year % 100u);
+        cmd->BroadcastSize = 4;
+        break;
+
+    case 2:
+        cmd->Request[0] = 3;    /* Single frame, 3 bytes */
+        cmd->Request[1] = 3;    /* Alarm */
+        cmd->Request[2] = Host_Bcd(hour);
+        cmd->Request[3] = Host_Bcd(minutes);
+        cmd->BroadcastId = HOST_ALARM_ID;
+        cmd->Broadcast[0] = (uint8_t)hour;
+        cmd->Broadcast[1] = (uint8_t)minutes;
+        cmd->BroadcastSize = 2;
+        break;
+
+    default:
+        cmd->Request[0] = 4;    /* Time with an hour out of range */
+        cmd->Request[1] = 1;
+        cmd->Request[2] = 0x25;
+        cmd->Request[3] = Host_Bcd(minutes);
+        cmd->Request[4] = Host_Bcd(seconds);
+        cmd->Response = HOST_ERROR_BYTE;
+        cmd->BroadcastId = HOST_NO_BROADCAST;
+        break;
+    }
+}
+
+/**
+ * @brief Classic 8 bytes data frame with a standard ID and an empty payload
+ * @param frame Frame to fill
+ * @param id CAN identifier
+ */
+static void Host_Frame(Sim_CanFrameTypeDef *frame, uint32_t id)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->Identifier = id;
+    frame->IdType = FDCAN_STANDARD_ID;
+    frame->DataLength = FDCAN_DLC_BYTES_8;
+    frame->FDFormat = FDCAN_CLASSIC_CAN;
+    frame->BitRateSwitch = FDCAN_BRS_OFF;
+}
+
+/**
+ * @brief Match a frame seen by the tester against the command in flight
+ * @param node Tester node
+ * @param frame Frame received
+ */
+static void Host_TesterRx(SimBus_NodeTypeDef *node, const Sim_CanFrameTypeDef *frame)
+{
+    Host_CommandTypeDef *cmd = &Command;
+
+    (void)node;
+
+    if (frame->Identifier == HOST_LOAD_ID)
+    {
+        return;
+    }
+
+    if (frame->Identifier == HOST_ALARM_EVENT_ID)
+    {
+        AlarmEvents++;
+
+        if ((AlarmStep == 2u) && (frame->Data[0] == HOST_ALARM_HOUR) &&
+            (frame->Data[1] == HOST_ALARM_MINUTES) && (frame->Data[2] == 0u))
+        {
+            AlarmSeen = 1;
+        }
+        return;
+    }
+
+    if (Dumping != 0u)
+    {
+        if (frame->Identifier == HOST_RESPONSE_ID)
+        {
+            (void)CanTp_RxIndication(&TesterTp, frame->Data, CANTP_FRAME_SIZE, frame->Tick);
+        }
+        return;
+    }
+
+    if ((BurstStep == 1u) && ((frame->Identifier == HOST_RESPONSE_ID) || (frame->Identifier == HOST_URGENT_RESPONSE_ID)) &&
+        (frame->Data[1] == HOST_ERROR_BYTE))
+    {
+        BurstResponses++;
+        return;
+    }
+
+    if ((StallStep == 1u) && (frame->Identifier == HOST_RESPONSE_ID) && ((frame->Data[0] & 0xF0u) == 0x30u))
+    {
+        StallFlowControl = 1;
+        return;
+    }
+
+    if ((InFlight != 0u) && (cmd->Responded == 0u) && (frame->Identifier == cmd->ResponseId) &&
+        ((frame->Data[0] & 0xF0u) == 0u) && (frame->Data[1] == cmd->Response))
+    {
+        cmd->Responded = 1;
+        Host_Record((cmd->ResponseId == HOST_URGENT_RESPONSE_ID) ? &UrgentLatency : &ResponseLatency, frame->Tick - cmd->Sent);
+    }
+    else if ((InFlight != 0u) && (cmd->Broadcasted == 0u) && (frame->Identifier == cmd->BroadcastId) &&
+             (memcmp(frame->Data, cmd->Broadcast, cmd->BroadcastSize) == 0))
+    {
+        cmd->Broadcasted = 1;
+        Host_Record(&BroadcastLatency, frame->Tick - cmd->Sent);
+    }
+    else
+    {
+        /* Late frames of a timed out command or broadcasts nobody asked for */
+        Unsolicited++;
+    }
+}
+
+/**
+ * @brief Write a string to the harness LCD when the driver is idle, the DMA ends on the next tick
+ */
+static void Host_Lcd(void)
+{
+    char text[] = "12:34:56";
+
+    if (HEL_LCD_IsIdle(&Lcd) != 0u)
+    {
+        text[7] = (char)('0' + (Sim_Now() % 10u));
+
+        /* Same cells every time, the cursor goes back to the start of the first row */
+        (void)HEL_LCD_Command(&Lcd, 0x80);
+        BENCH_BEGIN(&Bench, APP_PROBE_LCD_STRING);
+        (void)HEL_LCD_String(&Lcd, text);
+        BENCH_END(&Bench, APP_PROBE_LCD_STRING);
+    }
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+    HEL_LCD_TxCpltCallback(&Lcd);
+}
+
+/**
+ * @brief Read the probes one by one with the dump command, then report and exit
+ */
+static void Host_Dump(void)
+{
+    const uint8_t *record;
+    uint16_t size;
+    uint8_t request[2];
+
+    CanTp_Task(&TesterTp, Sim_Now());
+
+    if (DumpPending == 0u)
+    {
+        if (DumpProbe == APP_PROBES)
+        {
+            Host_Report();
+            exit(((Failed == 0u) && (DumpFailed == 0u) && (CalendarMismatches == 0u)) ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        request[0] = HOST_BENCH_COMMAND;
+        request[1] = DumpProbe;
+
+        if (CanTp_Transmit(&TesterTp, request, sizeof(request), Sim_Now()) == CANTP_OK)
+        {
+            DumpSent = Sim_Now();
+            DumpPending = 1;
+        }
+    }
+    else
+    {
+        record = CanTp_GetRxMessage(&TesterTp, &size);
+
+        if (record != NULL)
+        {
+            Host_PrintRecord(record, size);
+            CanTp_ReleaseRxMessage(&TesterTp);
+            DumpPending = 0;
+            DumpProbe++;
+        }
+        else if ((Sim_Now() - DumpSent) > HOST_COMMAND_TIMEOUT)
+        {
+            printf("probe %u dump timed out\n", (unsigned)DumpProbe);
+            DumpFailed++;
+            DumpPending = 0;
+            DumpProbe++;
+        }
+    }
+}
+
+/**
+ * @brief Print a probe record as sent by the firmware, in nanoseconds
+ * @param record Record received
+ * @param size Record length
+ */
+static void Host_PrintRecord(const uint8_t *record, uint16_t size)
+{
+    static const char *name[APP_PROBES] = {"serial task", "clock task", "can task", "fdcan isr", "weekday", "lcd string"};
+    double scale;
+    uint32_t bin;
+
+    if ((size != BENCH_RECORD_SIZE) || (record[0] != DumpProbe) || (Host_Get32(&record[1]) == 0u))
+    {
+        printf("probe %u: bad record of %u bytes\n", (unsigned)DumpProbe, (unsigned)size);
+        DumpFailed++;
+        return;
+    }
+
+    scale = 1e9 / (double)Host_Get32(&record[1]);
+
+    printf("%-12s %8u %10.0f %10.0f %10.0f ", name[record[0]], (unsigned)Host_Get32(&record[5]),
+           (double)Host_Get32(&record[9]) * scale, (double)Host_Get32(&record[13]) * scale,
+           (double)Host_Get32(&record[17]) * scale);
+
+    /* Samples below each power of two, empty bins left out */
+    for (uint32_t i = 0; i < BENCH_HISTOGRAM_BINS; i++)
+    {
+        bin = ((uint32_t)record[21u + (2u * i)] << 8) | record[22u + (2u * i)];
+
+        if (bin > 0u)
+        {
+            printf(" <%.0f:%u", (double)(1UL << i) * scale, (unsigned)bin);
+        }
+    }
+
+    printf("\n");
+}
+
+/**
+ * @brief Send a transport layer frame of the tester on the command ID
+ * @param data Frame payload
+ * @param length Number of bytes
+ * @return CANTP_OK if queued on the bus, CANTP_ERROR otherwise
+ */
+static uint8_t Host_TesterTxFrame(const uint8_t *data, uint8_t length)
+{
+    Sim_CanFrameTypeDef frame;
+
+    Host_Frame(&frame, HOST_COMMAND_ID);
+    memcpy(frame.Data, data, length);
+
+    return (SimBus_Send(&Tester, &frame) == SIMBUS_OK) ? CANTP_OK : CANTP_ERROR;
+}
+
+static uint32_t Host_Get32(const uint8_t *buffer)
+{
+    return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | buffer[3];
+}
+
+static void Host_Record(Host_LatencyTypeDef *latency, uint32_t value)
+{
+    latency->Count++;
+    latency->Sum += value;
+    latency->Min = (value < latency->Min) ? value : latency->Min;
+    latency->Max = (value > latency->Max) ? value : latency->Max;
+}
+
+/**
+ * @brief Print the results of the run
+ */
+static void Host_Report(void)
+{
+    const Sim_StatsTypeDef *stats = Sim_GetStats();
+    const CanTx_StatsTypeDef *txStats = Serial_GetTxStats();
+    const Serial_RxStatsTypeDef *rxStats = Serial_GetRxStats();
+    double wall = Host_WallClock() - WallStart;
+    const Host_LatencyTypeDef *latency[3] = {&ResponseLatency, &UrgentLatency, &BroadcastLatency};
+    const char *name[3] = {"response", "urgent", "broadcast"};
+
+    printf("commands:    %u passed, %u failed, %u unsolicited frames, %u alarm events\n",
+           (unsigned)Passed, (unsigned)Failed, (unsigned)Unsolicited, (unsigned)AlarmEvents);
+    printf("calendar:    %u reads, %u mismatches with the RTC, %u preempted by the wakeup\n", (unsigned)CalendarReads,
+           (unsigned)CalendarMismatches, (unsigned)Sim_GetStats()->RtcPreempts);
+
+    for (uint32_t i = 0; i < 3u; i++)
+    {
+        if (latency[i]->Count > 0u)
+        {
+            printf("%-12s min %u ms, max %u ms, mean %.2f ms over %u\n", name[i],
+                   (unsigned)latency[i]->Min, (unsigned)latency[i]->Max,
+                   (double)latency[i]->Sum / (double)latency[i]->Count, (unsigned)latency[i]->Count);
+        }
+    }
+
+    printf("in target:   last %u us, max %u us from the request frame start to the response queued\n",
+           (unsigned)rxStats->LastLatency, (unsigned)rxStats->MaxLatency);
+    printf("rx drain:    budget %u frames, spent %u times, %u frames left read by the serial task\n",
+           (unsigned)SERIAL_RX_DRAIN_BUDGET, (unsigned)rxStats->BudgetExhausted, (unsigned)rxStats->DeferredFrames);
+    printf("serial task: at most %u frames served in one call, budget %u frames %u us\n",
+           (unsigned)rxStats->MaxTaskBatch, (unsigned)SERIAL_BATCH_FRAMES, (unsigned)SERIAL_BATCH_TIME);
+    printf("task queues: clock %u posted, max %u of %u, %u dropped; can %u posted, max %u of %u, %u dropped\n",
+           (unsigned)ClockQueue.Posted, (unsigned)ClockQueue.HighWater, (unsigned)ClockQueue.Depth, (unsigned)ClockQueue.Drops,
+           (unsigned)CANQueue.Posted, (unsigned)CANQueue.HighWater, (unsigned)CANQueue.Depth, (unsigned)CANQueue.Drops);
+    printf("fdcan:       %u rx, %u filtered, %u lost, %u tx, %u tx errors, %u irqs\n",
+           (unsigned)stats->FdcanRxFrames, (unsigned)stats->FdcanRxFiltered, (unsigned)stats->FdcanRxLost, (unsigned)stats->FdcanTxFrames,
+           (unsigned)stats->FdcanTxErrors, (unsigned)stats->FdcanIrqs);
+    printf("tx queue:    %u queued, %u sent, %u dropped, max depth %u of %u\n",
+           (unsigned)txStats->Queued, (unsigned)txStats->Sent, (unsigned)txStats->Dropped,
+           (unsigned)txStats->MaxDepth, (unsigned)CAN_TX_QUEUE_SIZE);
+    printf("bus:         %u frames, %u error frames, %.1f %% load at %u bps\n",
+           (unsigned)Bus.Frames, (unsigned)Bus.ErrorFrames,
+           (Bus.Now > 0u) ? ((100.0 * (double)Bus.BusyTime) / (double)Bus.Now) : 0.0, (unsigned)Bus.BitRate);
+
+    for (const SimBus_NodeTypeDef *node = Bus.Nodes; node != NULL; node = node->Next)
+    {
+        Host_ReportNode(node);
+    }
+
+    printf("virtual:     %u ms, %u sleeps\n", (unsigned)Sim_Now(), (unsigned)stats->Sleeps);
+    printf("wall clock:  %.3f s, %.0f commands/s, %.0f virtual ms/s\n", wall,
+           (wall > 0.0) ? ((double)Issued / wall) : 0.0,
+           (wall > 0.0) ? ((double)Sim_Now() / wall) : 0.0);
+}
+
+static void Host_ReportNode(const SimBus_NodeTypeDef *node)
+{
+    static const char *state[3] = {"active", "passive", "bus off"};
+
+    printf("  %-10s %u tx, %u rx, %u arbitrations lost, %u tx errors, tec %u, rec %u, %s\n", node->Name,
+           (unsigned)node->TxFrames, (unsigned)node->RxFrames, (unsigned)node->ArbitrationLost,
+           (unsigned)node->TxErrors, (unsigned)node->Tec, (unsigned)node->Rec, state[node->State]);
+}
+
+static uint8_t Host_Bcd(uint32_t value)
+{
+    return (uint8_t)(((value / 10u) << 4) | (value % 10u));
+}
+
+static double Host_WallClock(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+}
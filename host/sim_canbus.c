@@ -0,0 +1,471 @@
+/**
+ * @file sim_canbus.c
+ * @brief Virtual CAN bus for the host build.
+ */
+
+#include "sim_canbus.h"
+#include <stddef.h>
+#include <string.h>
+
+#define SIMBUS_NS_PER_SECOND    1000000000ULL
+#define SIMBUS_NS_PER_MS        1000000ULL
+#define SIMBUS_NS_PER_US        1000ULL
+
+#define SIMBUS_ERROR_FRAME_BITS 17u     /* Error flag, delimiter and intermission */
+#define SIMBUS_SUSPEND_BITS     8u      /* Wait of error passive transmitters between frames */
+#define SIMBUS_PASSIVE_LIMIT    128u
+#define SIMBUS_BUS_OFF_LIMIT    255u
+
+#define SIMBUS_FRAME_OK         0x00U   /* Frame on the bus ends without error */
+#define SIMBUS_FRAME_ERROR      0x01U   /* Error frame */
+#define SIMBUS_FRAME_NO_ACK     0x02U   /* Nobody acknowledged the frame */
+
+/* Private function prototypes */
+static void SimBus_Start(SimBus_HandleTypeDef *hbus);
+static void SimBus_Complete(SimBus_HandleTypeDef *hbus);
+static uint32_t SimBus_Candidate(const SimBus_NodeTypeDef *node);
+static uint32_t SimBus_Arbitration(const Sim_CanFrameTypeDef *frame);
+static uint8_t SimBus_Listens(const SimBus_HandleTypeDef *hbus, const SimBus_NodeTypeDef *node);
+static void SimBus_UpdateState(SimBus_NodeTypeDef *node);
+static uint32_t SimBus_DlcToBytes(uint32_t dlc);
+static uint64_t SimBus_BitsTime(uint32_t bits, uint32_t bitrate);
+
+/**
+ * @brief Initialize an idle bus without nodes.
+ * @param hbus Pointer to the bus handle structure.
+ * @param bitrate Nominal bit rate in bits per second.
+ * @param dataBitrate Data phase bit rate in bits per second.
+ */
+void SimBus_Init(SimBus_HandleTypeDef *hbus, uint32_t bitrate, uint32_t dataBitrate)
+{
+    memset(hbus, 0, sizeof(*hbus));
+    hbus->BitRate = bitrate;
+    hbus->DataBitRate = dataBitrate;
+}
+
+/**
+ * @brief Attach a node to the bus, error active and without pending frames.
+ * @param hbus Pointer to the bus handle structure.
+ * @param node Node to attach.
+ * @param name Name for the reports.
+ * @param callback Reception callback, NULL to ignore the traffic.
+ * @param context User pointer for the callback.
+ */
+void SimBus_AddNode(SimBus_HandleTypeDef *hbus, SimBus_NodeTypeDef *node, const char *name, SimBus_RxCallback callback, void *context)
+{
+    SimBus_NodeTypeDef **link = &hbus->Nodes;
+
+    memset(node, 0, sizeof(*node));
+    node->Name = name;
+    node->RxCallback = callback;
+    node->Context = context;
+
+    /* At the end, on a tie the node attached first wins */
+    while (*link != NULL)
+    {
+        link = &(*link)->Next;
+    }
+
+    *link = node;
+}
+
+/**
+ * @brief Queue a frame to send.
+ * @param node Sending node.
+ * @param frame Frame to send, its tick is ignored.
+ * @return SIMBUS_OK if queued, SIMBUS_ERROR if the queue is full or the node is bus off.
+ */
+uint8_t SimBus_Send(SimBus_NodeTypeDef *node, const Sim_CanFrameTypeDef *frame)
+{
+    uint8_t status = SIMBUS_ERROR;
+
+    if ((node->TxCount < SIMBUS_TX_DEPTH) && (node->State != SIMBUS_BUS_OFF))
+    {
+        node->Tx[node->TxCount] = *frame;
+        node->TxCount++;
+        status = SIMBUS_OK;
+    }
+
+    return status;
+}
+
+/**
+ * @brief Get the number of frames a node has waiting, the one on the bus included.
+ * @param node Node to check.
+ * @return Number of pending frames.
+ */
+uint32_t SimBus_Pending(const SimBus_NodeTypeDef *node)
+{
+    return node->TxCount;
+}
+
+/**
+ * @brief Destroy frames at random, the same seed gives the same errors.
+ * @param hbus Pointer to the bus handle structure.
+ * @param perMillion Frames destroyed per million, 0 to stop.
+ * @param seed Random generator seed.
+ */
+void SimBus_SetErrorRate(SimBus_HandleTypeDef *hbus, uint32_t perMillion, uint32_t seed)
+{
+    hbus->ErrorRate = perMillion;
+    hbus->Seed = seed;
+}
+
+/**
+ * @brief Destroy the next frames sent, whatever the error rate.
+ * @param hbus Pointer to the bus handle structure.
+ * @param count Number of frames.
+ */
+void SimBus_CorruptNext(SimBus_HandleTypeDef *hbus, uint32_t count)
+{
+    hbus->ErrorBurst += count;
+}
+
+/**
+ * @brief Get the time a frame takes on the bus, interframe space included.
+ *
+ * Classic frames use the worst case length of Davis et al. with stuff bits
+ * in the 34 (standard) or 54 (extended) stuffed header bits and the payload.
+ * CAN FD frames add the fixed stuff bits of the CRC field, the data phase
+ * (ESI to CRC delimiter) runs at the data bit rate when BRS is set.
+ *
+ * @param hbus Pointer to the bus handle structure.
+ * @param frame Frame to measure.
+ * @return Nanoseconds.
+ */
+uint64_t SimBus_FrameTime(const SimBus_HandleTypeDef *hbus, const Sim_CanFrameTypeDef *frame)
+{
+    uint32_t bytes = SimBus_DlcToBytes(frame->DataLength);
+    uint8_t extended = (frame->IdType == FDCAN_EXTENDED_ID) ? 1u : 0u;
+    uint32_t arbitration;
+    uint32_t data;
+    uint32_t crc;
+    uint32_t stuffed;
+    uint64_t time;
+
+    if (frame->FDFormat != FDCAN_FD_CAN)
+    {
+        stuffed = (extended != 0u) ? (54u + (8u * bytes)) : (34u + (8u * bytes));
+        arbitration = ((extended != 0u) ? 67u : 47u) + (8u * bytes) + ((stuffed - 1u) / 4u);
+        time = SimBus_BitsTime(arbitration, hbus->BitRate);
+    }
+    else
+    {
+        /* SOF to BRS, then ACK to intermission at the nominal bit rate */
+        arbitration = (extended != 0u) ? 36u : 17u;
+        arbitration += ((arbitration - 1u) / 4u) + 12u;
+
+        /* ESI, DLC and payload with dynamic stuffing, stuff count, CRC and its fixed stuff bits, CRC delimiter */
+        crc = (bytes > 16u) ? 21u : 17u;
+        data = 5u + (8u * bytes);
+        data += ((data - 1u) / 4u) + 4u + crc + ((crc + 4u) / 4u) + 1u;
+
+        time = SimBus_BitsTime(arbitration, hbus->BitRate);
+        time += SimBus_BitsTime(data, (frame->BitRateSwitch == FDCAN_BRS_ON) ? hbus->DataBitRate : hbus->BitRate);
+    }
+
+    return time;
+}
+
+/**
+ * @brief Run the bus for some time, sending frames and calling the reception callbacks.
+ * @param hbus Pointer to the bus handle structure.
+ * @param ns Nanoseconds to run.
+ */
+void SimBus_Advance(SimBus_HandleTypeDef *hbus, uint64_t ns)
+{
+    uint64_t end = hbus->Now + ns;
+
+    for (;;)
+    {
+        if (hbus->Sender == NULL)
+        {
+            /* Frames queued from the reception callbacks start as soon as the bus is idle */
+            SimBus_Start(hbus);
+
+            if (hbus->Sender == NULL)
+            {
+                break;
+            }
+        }
+
+        if (hbus->BusyUntil > end)
+        {
+            break;
+        }
+
+        hbus->Now = hbus->BusyUntil;
+        SimBus_Complete(hbus);
+    }
+
+    hbus->Now = end;
+}
+
+/**
+ * @brief Arbitration between the pending frames, the winner takes the bus
+ * @param hbus Pointer to the bus handle structure.
+ */
+static void SimBus_Start(SimBus_HandleTypeDef *hbus)
+{
+    SimBus_NodeTypeDef *node;
+    SimBus_NodeTypeDef *winner = NULL;
+    uint32_t slot = 0;
+    uint32_t key = 0;
+    uint32_t candidate;
+    uint32_t receivers = 0;
+    uint64_t time;
+
+    for (node = hbus->Nodes; node != NULL; node = node->Next)
+    {
+        if ((node->TxCount > 0u) && (node->State != SIMBUS_BUS_OFF))
+        {
+            candidate = SimBus_Candidate(node);
+
+            /* A dominant bit overwrites a recessive one, the lowest field wins */
+            if ((winner == NULL) || (SimBus_Arbitration(&node->Tx[candidate]) < key))
+            {
+                if (winner != NULL)
+                {
+                    winner->ArbitrationLost++;
+                }
+                winner = node;
+                slot = candidate;
+                key = SimBus_Arbitration(&node->Tx[candidate]);
+            }
+            else
+            {
+                node->ArbitrationLost++;
+            }
+        }
+    }
+
+    if (winner != NULL)
+    {
+        for (node = hbus->Nodes; node != NULL; node = node->Next)
+        {
+            if ((node != winner) && (SimBus_Listens(hbus, node) != 0u))
+            {
+                receivers++;
+            }
+        }
+
+        /* Injected errors, a sender off the bus bit rate or nobody to acknowledge the frame */
+        hbus->Corrupted = SIMBUS_FRAME_OK;
+
+        if (hbus->ErrorBurst > 0u)
+        {
+            hbus->ErrorBurst--;
+            hbus->Corrupted = SIMBUS_FRAME_ERROR;
+        }
+        else if (hbus->ErrorRate > 0u)
+        {
+            hbus->Seed = (hbus->Seed * 1664525UL) + 1013904223UL;
+            hbus->Corrupted = (((hbus->Seed >> 8) % 1000000UL) < hbus->ErrorRate) ? SIMBUS_FRAME_ERROR : SIMBUS_FRAME_OK;
+        }
+
+        if (SimBus_Listens(hbus, winner) == 0u)
+        {
+            hbus->Corrupted = SIMBUS_FRAME_ERROR;
+        }
+        else if ((receivers == 0u) && (hbus->Corrupted == SIMBUS_FRAME_OK))
+        {
+            hbus->Corrupted = SIMBUS_FRAME_NO_ACK;
+        }
+
+        time = SimBus_FrameTime(hbus, &winner->Tx[slot]);
+
+        if (hbus->Corrupted != SIMBUS_FRAME_OK)
+        {
+            /* Detected on average half way, then the error frame */
+            time = (time / 2u) + SimBus_BitsTime(SIMBUS_ERROR_FRAME_BITS, hbus->BitRate);
+        }
+
+        if (winner->State == SIMBUS_ERROR_PASSIVE)
+        {
+            time += SimBus_BitsTime(SIMBUS_SUSPEND_BITS, hbus->BitRate);
+        }
+
+        hbus->Sender = winner;
+        hbus->Slot = slot;
+        hbus->BusySince = hbus->Now;
+        hbus->BusyUntil = hbus->Now + time;
+        hbus->BusyTime += time;
+    }
+}
+
+/**
+ * @brief End of the frame on the bus, deliver it or count the error
+ * @param hbus Pointer to the bus handle structure.
+ */
+static void SimBus_Complete(SimBus_HandleTypeDef *hbus)
+{
+    SimBus_NodeTypeDef *sender = hbus->Sender;
+    SimBus_NodeTypeDef *node;
+    Sim_CanFrameTypeDef frame = sender->Tx[hbus->Slot];
+
+    hbus->Sender = NULL;
+
+    if (hbus->Corrupted != SIMBUS_FRAME_OK)
+    {
+        /* The frame stays queued, the controller sends it again */
+        hbus->ErrorFrames++;
+        sender->TxErrors++;
+
+        /* An error passive sender without acknowledge keeps its counter */
+        if ((hbus->Corrupted != SIMBUS_FRAME_NO_ACK) || (sender->State != SIMBUS_ERROR_PASSIVE))
+        {
+            sender->Tec += 8u;
+        }
+
+        SimBus_UpdateState(sender);
+
+        for (node = hbus->Nodes; node != NULL; node = node->Next)
+        {
+            if ((node != sender) && (node->State != SIMBUS_BUS_OFF) && (node->Rec < SIMBUS_BUS_OFF_LIMIT))
+            {
+                node->Rec++;
+                SimBus_UpdateState(node);
+            }
+        }
+    }
+    else
+    {
+        /* Sent, out of the queue before the callbacks may queue an answer */
+        memmove(&sender->Tx[hbus->Slot], &sender->Tx[hbus->Slot + 1u], (sender->TxCount - hbus->Slot - 1u) * sizeof(Sim_CanFrameTypeDef));
+        sender->TxCount--;
+        sender->TxFrames++;
+        sender->Tec = (sender->Tec > 0u) ? (sender->Tec - 1u) : 0u;
+        SimBus_UpdateState(sender);
+        hbus->Frames++;
+
+        frame.Tick = (uint32_t)(hbus->Now / SIMBUS_NS_PER_MS);
+        frame.Start = (uint32_t)(hbus->BusySince / SIMBUS_NS_PER_US);
+
+        for (node = hbus->Nodes; node != NULL; node = node->Next)
+        {
+            if (node == sender)
+            {
+                continue;
+            }
+
+            if (SimBus_Listens(hbus, node) != 0u)
+            {
+                node->RxFrames++;
+                node->Rec = (node->Rec > (SIMBUS_PASSIVE_LIMIT - 1u)) ? 120u : ((node->Rec > 0u) ? (node->Rec - 1u) : 0u);
+                SimBus_UpdateState(node);
+
+                if (node->RxCallback != NULL)
+                {
+                    node->RxCallback(node, &frame);
+                }
+            }
+            else if ((node->State != SIMBUS_BUS_OFF) && (node->Rec < SIMBUS_BUS_OFF_LIMIT))
+            {
+                /* Sampling at the wrong bit rate, the node sees an error */
+                node->Rec++;
+                SimBus_UpdateState(node);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Frame a node puts in arbitration
+ * @param node Node with pending frames
+ * @return Index in the node queue
+ */
+static uint32_t SimBus_Candidate(const SimBus_NodeTypeDef *node)
+{
+    uint32_t best = 0;
+
+    if (node->PriorityQueue != 0u)
+    {
+        for (uint32_t i = 1; i < node->TxCount; i++)
+        {
+            if (SimBus_Arbitration(&node->Tx[i]) < SimBus_Arbitration(&node->Tx[best]))
+            {
+                best = i;
+            }
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief Arbitration field as sent on the wire, base ID, SRR/RTR and IDE then the extended ID
+ * @param frame Frame to send
+ * @return Field value, the lowest one wins the bus
+ */
+static uint32_t SimBus_Arbitration(const Sim_CanFrameTypeDef *frame)
+{
+    uint32_t key;
+
+    if (frame->IdType == FDCAN_EXTENDED_ID)
+    {
+        /* Recessive SRR and IDE, a standard frame with the same base ID wins */
+        key = ((frame->Identifier >> 18) << 20) | (3UL << 18) | (frame->Identifier & 0x3FFFFUL);
+    }
+    else
+    {
+        key = (frame->Identifier & 0x7FFUL) << 20;
+    }
+
+    return key;
+}
+
+/**
+ * @brief Check if a node takes part in the traffic
+ * @param hbus Pointer to the bus handle structure.
+ * @param node Node to check
+ * @return 1 if on line at the bus bit rate, 0 otherwise
+ */
+static uint8_t SimBus_Listens(const SimBus_HandleTypeDef *hbus, const SimBus_NodeTypeDef *node)
+{
+    return ((node->State != SIMBUS_BUS_OFF) && ((node->BitRate == 0u) || (node->BitRate == hbus->BitRate))) ? 1u : 0u;
+}
+
+/**
+ * @brief Fault confinement state from the error counters
+ * @param node Node to update
+ */
+static void SimBus_UpdateState(SimBus_NodeTypeDef *node)
+{
+    if (node->Tec > SIMBUS_BUS_OFF_LIMIT)
+    {
+        /* Silent from now on, its pending frames are lost */
+        node->State = SIMBUS_BUS_OFF;
+        node->TxCount = 0;
+    }
+    else if ((node->Tec >= SIMBUS_PASSIVE_LIMIT) || (node->Rec >= SIMBUS_PASSIVE_LIMIT))
+    {
+        node->State = SIMBUS_ERROR_PASSIVE;
+    }
+    else
+    {
+        node->State = SIMBUS_ERROR_ACTIVE;
+    }
+}
+
+/**
+ * @brief Convert an FDCAN data length code into a number of bytes
+ * @param dlc Data length code as found in the FDCAN headers
+ * @return Number of payload bytes
+ */
+static uint32_t SimBus_DlcToBytes(uint32_t dlc)
+{
+    static const uint8_t dlcBytes[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+    return dlcBytes[(dlc >> 16) & 0x0Fu];
+}
+
+/**
+ * @brief Duration of some bits
+ * @param bits Number of bits
+ * @param bitrate Bits per second
+ * @return Nanoseconds, rounded up
+ */
+static uint64_t SimBus_BitsTime(uint32_t bits, uint32_t bitrate)
+{
+    return (((uint64_t)bits * SIMBUS_NS_PER_SECOND) + bitrate - 1u) / bitrate;
+}
@@ -0,0 +1,162 @@
+#ifndef __SIM_CANBUS_H__
+#define __SIM_CANBUS_H__
+
+#include "stm32g0xx.h"
+
+/**
+ * @file sim_canbus.h
+ * @brief Virtual CAN bus for the host build.
+ *
+ * Nodes queue frames and the bus sends them one at a time in virtual time:
+ * when idle, the pending frame with the lowest arbitration field wins, as a
+ * dominant bit does on a real bus, and it takes the time of its bits at the
+ * nominal and data bit rates, worst case bit stuffing included. Once sent the
+ * frame is delivered to every other node. Errors are injected either at a
+ * rate or on the next frames: an error frame is sent instead, the error
+ * counters move as in ISO 11898-1 and the sender tries again. Nodes with a
+ * bit rate different from the bus only see errors. Everything runs from
+ * SimBus_Advance, the same inputs always give the same traffic.
+ */
+
+#define SIMBUS_OK      0x00U
+#define SIMBUS_ERROR   0x01U
+
+#define SIMBUS_TX_DEPTH         16u /**< Frames a node can have pending */
+#define SIMBUS_PAYLOAD_SIZE     64u /**< Largest CAN FD payload */
+
+#define SIMBUS_ERROR_ACTIVE     0x00U
+#define SIMBUS_ERROR_PASSIVE    0x01U   /**< An error counter reached 128 */
+#define SIMBUS_BUS_OFF          0x02U   /**< The transmit error counter went over 255, the node is silent */
+
+/**
+ * @brief CAN frame as seen on the bus.
+ */
+typedef struct
+{
+    uint32_t Identifier;    /**< CAN identifier, 11 or 29 bits */
+    uint32_t IdType;        /**< FDCAN_STANDARD_ID or FDCAN_EXTENDED_ID */
+    uint32_t DataLength;    /**< FDCAN_DLC_BYTES_x data length code */
+    uint32_t FDFormat;      /**< FDCAN_CLASSIC_CAN or FDCAN_FD_CAN */
+    uint32_t BitRateSwitch; /**< FDCAN_BRS_OFF or FDCAN_BRS_ON */
+    uint32_t Tick;          /**< Millisecond the frame ended on the bus */
+    uint32_t Start;         /**< Microsecond the frame started on the bus, what the FDCAN timestamps */
+    uint8_t Data[SIMBUS_PAYLOAD_SIZE];  /**< Frame payload */
+} Sim_CanFrameTypeDef;
+
+struct SimBus_NodeTypeDef;
+
+/**
+ * @brief Called when a frame sent by another node ended without error.
+ * @param node Receiving node.
+ * @param frame Frame received.
+ */
+typedef void (*SimBus_RxCallback)(struct SimBus_NodeTypeDef *node, const Sim_CanFrameTypeDef *frame);
+
+/**
+ * @brief Node attached to the bus, owned by the module using it.
+ */
+typedef struct SimBus_NodeTypeDef
+{
+    struct SimBus_NodeTypeDef *Next;    /**< Next node on the bus */
+    const char *Name;                   /**< Name for the reports */
+    SimBus_RxCallback RxCallback;       /**< Reception callback, NULL to ignore the traffic */
+    void *Context;                      /**< User pointer for the callback */
+    uint32_t BitRate;                   /**< Nominal bit rate of the node, 0 to follow the bus */
+    uint8_t PriorityQueue;              /**< 1 to send the lowest ID first, 0 for FIFO order */
+    Sim_CanFrameTypeDef Tx[SIMBUS_TX_DEPTH];    /**< Pending frames, oldest first */
+    uint32_t TxCount;                   /**< Number of pending frames */
+    uint32_t Tec;                       /**< Transmit error counter */
+    uint32_t Rec;                       /**< Receive error counter */
+    uint8_t State;                      /**< SIMBUS_ERROR_ACTIVE, SIMBUS_ERROR_PASSIVE or SIMBUS_BUS_OFF */
+    uint32_t TxFrames;                  /**< Frames sent */
+    uint32_t RxFrames;                  /**< Frames received */
+    uint32_t ArbitrationLost;           /**< Times another node won the bus */
+    uint32_t TxErrors;                  /**< Frames of this node destroyed by an error frame */
+} SimBus_NodeTypeDef;
+
+/**
+ * @brief Bus handler structure.
+ */
+typedef struct
+{
+    SimBus_NodeTypeDef *Nodes;  /**< Attached nodes, in attach order */
+    uint32_t BitRate;           /**< Nominal (arbitration) bit rate */
+    uint32_t DataBitRate;       /**< Data phase bit rate of CAN FD frames with bit rate switching */
+    uint64_t Now;               /**< Bus time in nanoseconds */
+    uint64_t BusyUntil;         /**< End of the frame on the bus */
+    uint64_t BusySince;         /**< Start of the frame on the bus */
+    SimBus_NodeTypeDef *Sender; /**< Node sending, NULL when the bus is idle */
+    uint32_t Slot;              /**< Index of the frame being sent in the sender queue */
+    uint8_t Corrupted;          /**< How the frame on the bus ends, private to the bus */
+    uint32_t ErrorRate;         /**< Frames destroyed per million */
+    uint32_t ErrorBurst;        /**< Next frames to destroy */
+    uint32_t Seed;              /**< Random generator state for the error rate */
+    uint32_t Frames;            /**< Frames sent without error */
+    uint32_t ErrorFrames;       /**< Error frames */
+    uint64_t BusyTime;          /**< Nanoseconds the bus was not idle */
+} SimBus_HandleTypeDef;
+
+/**
+ * @brief Initialize an idle bus without nodes.
+ * @param hbus Pointer to the bus handle structure.
+ * @param bitrate Nominal bit rate in bits per second.
+ * @param dataBitrate Data phase bit rate in bits per second.
+ */
+void SimBus_Init(SimBus_HandleTypeDef *hbus, uint32_t bitrate, uint32_t dataBitrate);
+
+/**
+ * @brief Attach a node to the bus, error active and without pending frames.
+ * @param hbus Pointer to the bus handle structure.
+ * @param node Node to attach.
+ * @param name Name for the reports.
+ * @param callback Reception callback, NULL to ignore the traffic.
+ * @param context User pointer for the callback.
+ */
+void SimBus_AddNode(SimBus_HandleTypeDef *hbus, SimBus_NodeTypeDef *node, const char *name, SimBus_RxCallback callback, void *context);
+
+/**
+ * @brief Queue a frame to send.
+ * @param node Sending node.
+ * @param frame Frame to send, its tick is ignored.
+ * @return SIMBUS_OK if queued, SIMBUS_ERROR if the queue is full or the node is bus off.
+ */
+uint8_t SimBus_Send(SimBus_NodeTypeDef *node, const Sim_CanFrameTypeDef *frame);
+
+/**
+ * @brief Get the number of frames a node has waiting, the one on the bus included.
+ * @param node Node to check.
+ * @return Number of pending frames.
+ */
+uint32_t SimBus_Pending(const SimBus_NodeTypeDef *node);
+
+/**
+ * @brief Destroy frames at random, the same seed gives the same errors.
+ * @param hbus Pointer to the bus handle structure.
+ * @param perMillion Frames destroyed per million, 0 to stop.
+ * @param seed Random generator seed.
+ */
+void SimBus_SetErrorRate(SimBus_HandleTypeDef *hbus, uint32_t perMillion, uint32_t seed);
+
+/**
+ * @brief Destroy the next frames sent, whatever the error rate.
+ * @param hbus Pointer to the bus handle structure.
+ * @param count Number of frames.
+ */
+void SimBus_CorruptNext(SimBus_HandleTypeDef *hbus, uint32_t count);
+
+/**
+ * @brief Get the time a frame takes on the bus, interframe space included.
+ * @param hbus Pointer to the bus handle structure.
+ * @param frame Frame to measure.
+ * @return Nanoseconds.
+ */
+uint64_t SimBus_FrameTime(const SimBus_HandleTypeDef *hbus, const Sim_CanFrameTypeDef *frame);
+
+/**
+ * @brief Run the bus for some time, sending frames and calling the reception callbacks.
+ * @param hbus Pointer to the bus handle structure.
+ * @param ns Nanoseconds to run.
+ */
+void SimBus_Advance(SimBus_HandleTypeDef *hbus, uint64_t ns);
+
+#endif // __SIM_CANBUS_H__
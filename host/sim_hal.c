@@ -0,0 +1,1366 @@
+/**
+ * @file sim_hal.c
+ * @brief Simulated HAL for the host build.
+ *
+ * Implements the HAL functions used by the application on top of a virtual
+ * millisecond tick. The FDCAN keeps the 3 elements RX FIFOs and TX FIFO of
+ * the real controller, its interrupt flags (transmission completed is
+ * raised on the tick the bus sent the frames) and its two interrupt lines,
+ * it sends and receives through a node of the virtual bus, the received frames
+ * are timestamped at their start with the virtual time in microseconds. The RTC calendar
+ * counts in RAM, its alarm A interrupt is raised on the second the alarm time matches
+ * and its wakeup timer interrupt on every second, only the sub-second and the flags
+ * registers are kept. The SPI DMA transfers complete on the next tick.
+ * Interrupt handlers run when the interrupts are unmasked, never nested,
+ * the pending ones in priority order: FDCAN line 1, FDCAN line 0, DMA, RTC. The
+ * benchmark counter is the only thing running on the wall clock.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "sim_hal.h"
+#include "app_bench.h"
+#include "app_serial.h"
+#include <string.h>
+#include <time.h>
+
+#define SIM_FDCAN_CLOCK 16000000UL  /* HSI, the FDCAN kernel clock after reset */
+
+#define SIM_NS_PER_TICK 1000000ULL  /* Bus time run on every tick */
+#define SIM_US_PER_TICK 1000u       /* Timestamp counter microseconds per tick */
+#define SIM_BUSY_READS  1000u       /* HAL_GetTick calls worth a millisecond of a CPU that never sleeps */
+
+#define SIM_IRQ_FDCAN   0x01U   /* TIM16_FDCAN_IT0_IRQn pending */
+#define SIM_IRQ_DMA     0x02U   /* DMA1_Channel1_IRQn pending */
+#define SIM_IRQ_FDCAN1  0x04U   /* TIM17_FDCAN_IT1_IRQn pending */
+#define SIM_IRQ_RTC     0x08U   /* RTC_TAMP_IRQn pending */
+
+#define SIM_FDCAN_STD_FILTERS   28u /* Filter elements of the message RAM */
+#define SIM_FDCAN_EXT_FILTERS   8u
+
+/* Interrupts reported to HAL_FDCAN_RxFifo0Callback and HAL_FDCAN_RxFifo1Callback */
+#define SIM_FDCAN_RX_FIFO0_ITS (FDCAN_IT_RX_FIFO0_NEW_MESSAGE | FDCAN_IT_RX_FIFO0_FULL | FDCAN_IT_RX_FIFO0_MESSAGE_LOST)
+#define SIM_FDCAN_RX_FIFO1_ITS (FDCAN_IT_RX_FIFO1_NEW_MESSAGE | FDCAN_IT_RX_FIFO1_FULL | FDCAN_IT_RX_FIFO1_MESSAGE_LOST)
+
+/* Private types */
+typedef struct
+{
+    FDCAN_HandleTypeDef *Handle;    /* Handle given to the interrupt callbacks */
+    uint8_t Started;                /* 1 between HAL_FDCAN_Start and HAL_FDCAN_Stop */
+    uint32_t Notifications;         /* Interrupts enabled with HAL_FDCAN_ActivateNotification */
+    uint32_t Flags;                 /* Interrupt flags raised and not served yet */
+    uint32_t Line1Groups;           /* Interrupt groups routed to line 1 with HAL_FDCAN_ConfigInterruptLines */
+    Sim_CanFrameTypeDef Rx[2][SIM_FDCAN_RX_FIFO_SIZE];  /* RX FIFO 0 and 1 */
+    uint32_t RxHead[2];
+    uint32_t RxTail[2];
+    SimBus_HandleTypeDef *Bus;      /* Bus the controller is wired to, NULL if none */
+    SimBus_NodeTypeDef Node;        /* Controller side of the bus, its queue is the TX FIFO */
+    uint32_t TxReported;            /* Frames sent by the node already flagged as complete */
+    FDCAN_FilterTypeDef StdFilters[SIM_FDCAN_STD_FILTERS];  /* Standard filter elements */
+    FDCAN_FilterTypeDef ExtFilters[SIM_FDCAN_EXT_FILTERS];  /* Extended filter elements */
+    uint32_t NonMatchingStd;        /* Global filter, FDCAN_ACCEPT_IN_RX_FIFO0 after reset */
+    uint32_t NonMatchingExt;
+    uint32_t Timestamps;            /* FDCAN_TIMESTAMP_EXTERNAL to capture the timestamp counter, 0 for none */
+    uint32_t BusEpoch;              /* Timestamp counter value when the bus time was 0 */
+} Sim_FdcanTypeDef;
+
+typedef struct
+{
+    uint8_t Hours;
+    uint8_t Minutes;
+    uint8_t Seconds;
+    uint8_t WeekDay;    /* 1 (Monday) to 7 (Sunday) */
+    uint8_t Date;
+    uint8_t Month;
+    uint8_t Year;       /* 0 to 99 */
+    uint32_t Millis;    /* Milliseconds into the current second */
+    uint32_t SynchPrediv;
+    RTC_AlarmTypeDef Alarm;
+    RTC_HandleTypeDef *AlarmHandle; /* Set by HAL_RTC_SetAlarm_IT, NULL while the interrupt is disabled */
+    RTC_HandleTypeDef *WakeupHandle; /* Set by HAL_RTCEx_SetWakeUpTimer_IT, NULL while disabled */
+    uint8_t Locked;     /* SSR read, time and date frozen in Shadow until DR is read */
+    uint8_t Preempt;    /* Sim_RtcPreemptAtSsr armed */
+} Sim_RtcTypeDef;
+
+typedef struct
+{
+    SPI_HandleTypeDef *Handle;  /* Transfer running, NULL if none */
+    uint16_t Size;
+} Sim_SpiTypeDef;
+
+/* Peripheral instances, the application only compares their addresses */
+GPIO_TypeDef Sim_GpioA;
+GPIO_TypeDef Sim_GpioB;
+GPIO_TypeDef Sim_GpioC;
+GPIO_TypeDef Sim_GpioD;
+FDCAN_GlobalTypeDef Sim_Fdcan1;
+RTC_TypeDef Sim_Rtc;
+
+static volatile uint32_t Tick;
+static uint8_t IrqMasked;       /* PRIMASK */
+static uint8_t InHandler;       /* An interrupt handler is running */
+static uint32_t IrqPending;     /* SIM_IRQ_x bits */
+static uint32_t IrqDisabled;    /* SIM_IRQ_x bits of the lines disabled in the NVIC */
+static uint32_t BusyReads;      /* HAL_GetTick calls since the last tick */
+static uint8_t Advancing;       /* Sim_Advance running */
+static Sim_IdleHook IdleHook;
+static Sim_StatsTypeDef Stats;
+static Sim_FdcanTypeDef Fdcan;
+static Sim_RtcTypeDef Calendar;
+static Sim_RtcTypeDef Shadow;   /* Calendar seen through the shadow registers while locked */
+static Sim_SpiTypeDef Spi;
+
+/* Private function prototypes */
+static void Sim_Dispatch(void);
+static uint32_t Sim_IrqLine(IRQn_Type IRQn);
+static void Sim_FdcanIrqHandler(void);
+static void Sim_FdcanIrq1Handler(void);
+static void Sim_FdcanRaise(void);
+static uint32_t Sim_FdcanLine1Its(void);
+static void Sim_FdcanTxComplete(void);
+static uint32_t Sim_FdcanFilter(const Sim_CanFrameTypeDef *frame);
+static uint8_t Sim_FdcanFilterMatch(const FDCAN_FilterTypeDef *filter, uint32_t id);
+static void Sim_FdcanBusRx(SimBus_NodeTypeDef *node, const Sim_CanFrameTypeDef *frame);
+static uint32_t Sim_FdcanBitRate(void);
+static void Sim_RtcTick(void);
+static void Sim_RtcLock(void);
+static uint8_t Sim_RtcAlarmMatch(void);
+static uint32_t Sim_RtcSubSeconds(void);
+static uint8_t Sim_DaysInMonth(uint8_t month, uint8_t year);
+static uint32_t Sim_DlcToBytes(uint32_t dlc);
+static uint8_t Sim_ToBcd(uint8_t value);
+static uint8_t Sim_FromBcd(uint8_t value);
+
+/* Simulation control ---------------------------------------------------------------------------*/
+/**
+ * @brief Reset the simulated peripherals, the tick and the counters.
+ */
+void Sim_Init(void)
+{
+    Tick = 0;
+    IrqMasked = 0;
+    InHandler = 0;
+    IrqPending = 0;
+    IrqDisabled = 0;
+    BusyReads = 0;
+    Advancing = 0;
+    IdleHook = NULL;
+    memset(&Stats, 0, sizeof(Stats));
+    memset(&Fdcan, 0, sizeof(Fdcan));
+    memset(&Spi, 0, sizeof(Spi));
+
+    /* RTC reset value: 00:00:00 Monday 1 January 2000 */
+    memset(&Calendar, 0, sizeof(Calendar));
+    Calendar.WeekDay = 1;
+    Calendar.Date = 1;
+    Calendar.Month = 1;
+    Calendar.SynchPrediv = 0xFF;
+    memset(&Sim_Rtc, 0, sizeof(Sim_Rtc));
+    Sim_Rtc.SSR = Sim_RtcSubSeconds();
+}
+
+/**
+ * @brief Set the function called on every __WFI, NULL for none.
+ * @param hook Harness function.
+ */
+void Sim_SetIdleHook(Sim_IdleHook hook)
+{
+    IdleHook = hook;
+}
+
+/**
+ * @brief Get the virtual tick.
+ * @return Milliseconds since Sim_Init.
+ */
+uint32_t Sim_Now(void)
+{
+    return Tick;
+}
+
+/**
+ * @brief Advance the virtual time, running the peripherals on every tick.
+ * @param ms Milliseconds to advance.
+ */
+void Sim_Advance(uint32_t ms)
+{
+    Advancing = 1;
+
+    for (uint32_t i = 0; i < ms; i++)
+    {
+        BusyReads = 0;
+        HAL_IncTick();
+        Sim_RtcTick();
+
+        /* Frames ending on the bus during this millisecond reach the RX FIFOs */
+        if (Fdcan.Bus != NULL)
+        {
+            SimBus_Advance(Fdcan.Bus, SIM_NS_PER_TICK);
+            Sim_FdcanTxComplete();
+        }
+
+        /* DMA transfers started during the previous millisecond are done by now */
+        if (Spi.Handle != NULL)
+        {
+            IrqPending |= SIM_IRQ_DMA;
+        }
+
+        Sim_Dispatch();
+    }
+
+    Advancing = 0;
+}
+
+/**
+ * @brief Pass a frame received from the bus through the acceptance filters, store it in its RX FIFO and raise its interrupts.
+ * @param frame Frame to receive, its tick is ignored.
+ * @return SIM_OK if stored or rejected by the filters, SIM_ERROR if the controller is stopped or the FIFO was full.
+ */
+uint8_t Sim_FdcanInject(const Sim_CanFrameTypeDef *frame)
+{
+    uint8_t status = SIM_ERROR;
+    uint32_t destination;
+    uint32_t fifo;
+    uint32_t shift;     /* The FIFO 1 flags are the FIFO 0 ones three bits up */
+
+    if (Fdcan.Started != 0u)
+    {
+        destination = Sim_FdcanFilter(frame);
+        fifo = (destination == FDCAN_FILTER_TO_RXFIFO1) ? 1u : 0u;
+        shift = fifo * 3u;
+
+        if (destination == FDCAN_FILTER_REJECT)
+        {
+            /* Acknowledged on the bus but never stored, the CPU does not see it */
+            Stats.FdcanRxFiltered++;
+            status = SIM_OK;
+        }
+        else if ((Fdcan.RxHead[fifo] - Fdcan.RxTail[fifo]) < SIM_FDCAN_RX_FIFO_SIZE)
+        {
+            Fdcan.Rx[fifo][Fdcan.RxHead[fifo] % SIM_FDCAN_RX_FIFO_SIZE] = *frame;
+            Fdcan.Rx[fifo][Fdcan.RxHead[fifo] % SIM_FDCAN_RX_FIFO_SIZE].Tick = Tick;
+            Fdcan.RxHead[fifo]++;
+            Fdcan.Flags |= FDCAN_IT_RX_FIFO0_NEW_MESSAGE << shift;
+            Stats.FdcanRxFrames++;
+            status = SIM_OK;
+
+            if ((Fdcan.RxHead[fifo] - Fdcan.RxTail[fifo]) == SIM_FDCAN_RX_FIFO_SIZE)
+            {
+                Fdcan.Flags |= FDCAN_IT_RX_FIFO0_FULL << shift;
+            }
+        }
+        else
+        {
+            /* Blocking mode: the new frame is the one lost */
+            Fdcan.Flags |= FDCAN_IT_RX_FIFO0_MESSAGE_LOST << shift;
+            Stats.FdcanRxLost++;
+        }
+
+        Sim_FdcanRaise();
+        Sim_Dispatch();
+    }
+
+    return status;
+}
+
+/**
+ * @brief Attach the FDCAN to a virtual bus, it runs with the tick from now on.
+ * @param hbus Pointer to the bus handle structure.
+ */
+void Sim_FdcanAttach(SimBus_HandleTypeDef *hbus)
+{
+    Fdcan.Bus = hbus;
+    Fdcan.BusEpoch = (Tick * SIM_US_PER_TICK) - (uint32_t)(hbus->Now / (SIM_NS_PER_TICK / SIM_US_PER_TICK));
+    SimBus_AddNode(hbus, &Fdcan.Node, "fdcan1", Sim_FdcanBusRx, NULL);
+    Fdcan.Node.BitRate = Sim_FdcanBitRate();
+}
+
+/**
+ * @brief Get the bus node of the FDCAN, for its error counters.
+ * @return Pointer to the node.
+ */
+const SimBus_NodeTypeDef *Sim_FdcanNode(void)
+{
+    return &Fdcan.Node;
+}
+
+/**
+ * @brief Get the simulation counters.
+ * @return Pointer to the counters.
+ */
+const Sim_StatsTypeDef *Sim_GetStats(void)
+{
+    return &Stats;
+}
+
+/**
+ * @brief Preempt the next SSR read made in the last millisecond of a second.
+ */
+void Sim_RtcPreemptAtSsr(void)
+{
+    Calendar.Preempt = 1;
+}
+
+/**
+ * @brief Read a peripheral register, READ_REG of the host build
+ *
+ * Reading SSR locks the RTC shadow registers and reading DR releases them,
+ * an armed preemption runs right after the SSR read.
+ *
+ * @param reg Register to read
+ * @return Register value
+ */
+uint32_t Sim_ReadReg(const volatile uint32_t *reg)
+{
+    uint32_t value = *reg;
+
+    if (reg == &Sim_Rtc.SSR)
+    {
+        Sim_RtcLock();
+
+        if ((Calendar.Preempt != 0u) && (Calendar.Millis == 999u))
+        {
+            Calendar.Preempt = 0;
+            Stats.RtcPreempts++;
+            Sim_RtcTick();
+            Sim_Dispatch();
+        }
+    }
+    else if (reg == &Sim_Rtc.DR)
+    {
+        Calendar.Locked = 0;
+    }
+
+    return value;
+}
+
+/**
+ * @brief Run the pending interrupt handlers, unless masked or already in one
+ *
+ * The lines disabled in the NVIC stay pending until enabled again.
+ */
+static void Sim_Dispatch(void)
+{
+    uint32_t pending;
+    SPI_HandleTypeDef *hspi;
+
+    if ((IrqMasked == 0u) && (InHandler == 0u))
+    {
+        InHandler = 1;
+
+        /* A handler may pend its own line again, serve it until nothing is left */
+        while (((IrqPending & ~IrqDisabled) != 0u) && (IrqMasked == 0u))
+        {
+            pending = IrqPending & ~IrqDisabled;
+            IrqPending &= IrqDisabled;
+
+            if ((pending & SIM_IRQ_FDCAN1) != 0u)
+            {
+                Sim_FdcanIrq1Handler();
+            }
+
+            if ((pending & SIM_IRQ_FDCAN) != 0u)
+            {
+                Sim_FdcanIrqHandler();
+            }
+
+            if (((pending & SIM_IRQ_DMA) != 0u) && (Spi.Handle != NULL))
+            {
+                hspi = Spi.Handle;
+                Stats.SpiBytes += Spi.Size;
+                Spi.Handle = NULL;
+                HAL_SPI_TxCpltCallback(hspi);
+            }
+
+            /* As the HAL handlers, each event checks and clears its flag before its callback */
+            if (((pending & SIM_IRQ_RTC) != 0u) && ((Sim_Rtc.SR & RTC_FLAG_ALRAF) != 0u))
+            {
+                Sim_Rtc.SR &= ~RTC_FLAG_ALRAF;
+                HAL_RTC_AlarmAEventCallback(Calendar.AlarmHandle);
+            }
+
+            if (((pending & SIM_IRQ_RTC) != 0u) && ((Sim_Rtc.SR & RTC_FLAG_WUTF) != 0u))
+            {
+                Sim_Rtc.SR &= ~RTC_FLAG_WUTF;
+                HAL_RTCEx_WakeUpTimerEventCallback(Calendar.WakeupHandle);
+            }
+        }
+
+        InHandler = 0;
+    }
+}
+
+/**
+ * @brief FDCAN interrupt line 0, as HAL_FDCAN_IRQHandler: clear the enabled flags and report them
+ *
+ * As on the target, where HAL_FDCAN_IRQHandler does not look at the lines,
+ * the flags routed to line 1 are served too if line 1 has not done it yet.
+ */
+static void Sim_FdcanIrqHandler(void)
+{
+    uint32_t its = Fdcan.Flags & Fdcan.Notifications;
+    uint32_t rxIts = its & SIM_FDCAN_RX_FIFO0_ITS;
+    uint32_t rx1Its = its & SIM_FDCAN_RX_FIFO1_ITS;
+
+    Fdcan.Flags &= ~its;
+
+    if ((its != 0u) && (Fdcan.Handle != NULL))
+    {
+        Stats.FdcanIrqs++;
+
+        if (rxIts != 0u)
+        {
+            HAL_FDCAN_RxFifo0Callback(Fdcan.Handle, rxIts);
+        }
+
+        if (rx1Its != 0u)
+        {
+            HAL_FDCAN_RxFifo1Callback(Fdcan.Handle, rx1Its);
+        }
+
+        /* The buffers are not tracked, the TX FIFO elements are interchangeable */
+        if ((its & FDCAN_IT_TX_COMPLETE) != 0u)
+        {
+            HAL_FDCAN_TxBufferCompleteCallback(Fdcan.Handle, FDCAN_TX_BUFFER0);
+        }
+    }
+}
+
+/**
+ * @brief FDCAN interrupt line 1, as the application handler: only the RX FIFO 1 flags routed to it
+ */
+static void Sim_FdcanIrq1Handler(void)
+{
+    uint32_t its = Sim_FdcanLine1Its();
+
+    Fdcan.Flags &= ~its;
+
+    if ((its != 0u) && (Fdcan.Handle != NULL))
+    {
+        Stats.FdcanIrqs++;
+        HAL_FDCAN_RxFifo1Callback(Fdcan.Handle, its);
+    }
+}
+
+/**
+ * @brief Pend the interrupt lines of the enabled flags raised
+ */
+static void Sim_FdcanRaise(void)
+{
+    uint32_t line1 = Sim_FdcanLine1Its();
+
+    if (line1 != 0u)
+    {
+        IrqPending |= SIM_IRQ_FDCAN1;
+    }
+
+    if (((Fdcan.Flags & Fdcan.Notifications) & ~line1) != 0u)
+    {
+        IrqPending |= SIM_IRQ_FDCAN;
+    }
+}
+
+/**
+ * @brief Enabled flags raised that go to interrupt line 1
+ * @return Interrupt flags
+ */
+static uint32_t Sim_FdcanLine1Its(void)
+{
+    uint32_t its = 0;
+
+    if ((Fdcan.Line1Groups & FDCAN_IT_GROUP_RX_FIFO1) != 0u)
+    {
+        its = Fdcan.Flags & Fdcan.Notifications & SIM_FDCAN_RX_FIFO1_ITS;
+    }
+
+    return its;
+}
+
+/**
+ * @brief Raise the transmission completed flag if the node sent frames since the last check
+ */
+static void Sim_FdcanTxComplete(void)
+{
+    if (Fdcan.Node.TxFrames != Fdcan.TxReported)
+    {
+        Fdcan.TxReported = Fdcan.Node.TxFrames;
+        Fdcan.Flags |= FDCAN_IT_TX_COMPLETE;
+        Sim_FdcanRaise();
+    }
+}
+
+/**
+ * @brief Acceptance filtering: the first enabled element matching the identifier decides, then the global filter
+ * @param frame Frame received
+ * @return FDCAN_FILTER_TO_RXFIFO0, FDCAN_FILTER_TO_RXFIFO1 or FDCAN_FILTER_REJECT
+ */
+static uint32_t Sim_FdcanFilter(const Sim_CanFrameTypeDef *frame)
+{
+    uint8_t extended = (frame->IdType == FDCAN_EXTENDED_ID) ? 1u : 0u;
+    const FDCAN_FilterTypeDef *filters = (extended != 0u) ? Fdcan.ExtFilters : Fdcan.StdFilters;
+    uint32_t count = (extended != 0u) ? Fdcan.Handle->Init.ExtFiltersNbr : Fdcan.Handle->Init.StdFiltersNbr;
+    uint32_t nonMatching = (extended != 0u) ? Fdcan.NonMatchingExt : Fdcan.NonMatchingStd;
+    uint32_t destination;
+    uint32_t i;
+
+    for (i = 0; (i < count) && (Sim_FdcanFilterMatch(&filters[i], frame->Identifier) == 0u); i++)
+    {
+    }
+
+    if (i < count)
+    {
+        switch (filters[i].FilterConfig)
+        {
+            case FDCAN_FILTER_TO_RXFIFO1:
+            case FDCAN_FILTER_TO_RXFIFO1_HP:
+                destination = FDCAN_FILTER_TO_RXFIFO1;
+                break;
+
+            case FDCAN_FILTER_REJECT:
+                destination = FDCAN_FILTER_REJECT;
+                break;
+
+            default:
+                destination = FDCAN_FILTER_TO_RXFIFO0;
+                break;
+        }
+    }
+    else if (nonMatching == FDCAN_ACCEPT_IN_RX_FIFO1)
+    {
+        destination = FDCAN_FILTER_TO_RXFIFO1;
+    }
+    else if (nonMatching == FDCAN_REJECT)
+    {
+        destination = FDCAN_FILTER_REJECT;
+    }
+    else
+    {
+        destination = FDCAN_FILTER_TO_RXFIFO0;
+    }
+
+    return destination;
+}
+
+/**
+ * @brief Check an identifier against one filter element
+ * @param filter Filter element, disabled ones never match
+ * @param id Identifier received
+ * @return 1 if it matches, 0 otherwise
+ */
+static uint8_t Sim_FdcanFilterMatch(const FDCAN_FilterTypeDef *filter, uint32_t id)
+{
+    uint8_t match = 0;
+
+    if ((filter->FilterConfig != FDCAN_FILTER_DISABLE) && (filter->FilterConfig != FDCAN_FILTER_HP))
+    {
+        switch (filter->FilterType)
+        {
+            case FDCAN_FILTER_RANGE:
+            case FDCAN_FILTER_RANGE_NO_EIDM:
+                match = ((id >= filter->FilterID1) && (id <= filter->FilterID2)) ? 1u : 0u;
+                break;
+
+            case FDCAN_FILTER_DUAL:
+                match = ((id == filter->FilterID1) || (id == filter->FilterID2)) ? 1u : 0u;
+                break;
+
+            default:
+                match = ((id & filter->FilterID2) == (filter->FilterID1 & filter->FilterID2)) ? 1u : 0u;
+                break;
+        }
+    }
+
+    return match;
+}
+
+/**
+ * @brief Frame received from the bus, lost if the controller is stopped
+ * @param node FDCAN node
+ * @param frame Frame received
+ */
+static void Sim_FdcanBusRx(SimBus_NodeTypeDef *node, const Sim_CanFrameTypeDef *frame)
+{
+    Sim_CanFrameTypeDef received = *frame;
+
+    (void)node;
+
+    /* Start of frame from the bus time to the timestamp counter */
+    received.Start += Fdcan.BusEpoch;
+    (void)Sim_FdcanInject(&received);
+}
+
+/**
+ * @brief Nominal bit rate programmed in the FDCAN
+ * @return Bits per second, 0 before HAL_FDCAN_Init
+ */
+static uint32_t Sim_FdcanBitRate(void)
+{
+    const FDCAN_InitTypeDef *init;
+    uint32_t rate = 0;
+
+    if (Fdcan.Handle != NULL)
+    {
+        init = &Fdcan.Handle->Init;
+        rate = SIM_FDCAN_CLOCK / (init->NominalPrescaler * (1u + init->NominalTimeSeg1 + init->NominalTimeSeg2));
+    }
+
+    return rate;
+}
+
+/* Core -----------------------------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_Init(void)
+{
+    return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    /* The time goes by for a CPU that never sleeps too, the loops polling the
+       tick or spinning on a busy resource would hang the simulation otherwise */
+    if ((++BusyReads >= SIM_BUSY_READS) && (Advancing == 0u))
+    {
+        Sim_Advance(1);
+    }
+
+    return Tick;
+}
+
+void HAL_IncTick(void)
+{
+    Tick++;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    /* Same minimum wait as the HAL, one more tick to make sure a whole period elapsed */
+    Sim_Advance(Delay + 1u);
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+    (void)IRQn;
+    (void)PreemptPriority;
+    (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    IrqDisabled &= ~Sim_IrqLine(IRQn);
+    Sim_Dispatch();
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    IrqDisabled |= Sim_IrqLine(IRQn);
+}
+
+void HAL_NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+    IrqPending |= Sim_IrqLine(IRQn);
+    Sim_Dispatch();
+}
+
+/**
+ * @brief Simulated line of an interrupt number
+ * @param IRQn Interrupt number
+ * @return SIM_IRQ_x bit, 0 for the lines not simulated
+ */
+static uint32_t Sim_IrqLine(IRQn_Type IRQn)
+{
+    uint32_t line = 0;
+
+    if (IRQn == TIM16_FDCAN_IT0_IRQn)
+    {
+        line = SIM_IRQ_FDCAN;
+    }
+    else if (IRQn == TIM17_FDCAN_IT1_IRQn)
+    {
+        line = SIM_IRQ_FDCAN1;
+    }
+    else if (IRQn == DMA1_Channel1_IRQn)
+    {
+        line = SIM_IRQ_DMA;
+    }
+    else if (IRQn == RTC_TAMP_IRQn)
+    {
+        line = SIM_IRQ_RTC;
+    }
+
+    return line;
+}
+
+void __disable_irq(void)
+{
+    IrqMasked = 1;
+}
+
+void __enable_irq(void)
+{
+    IrqMasked = 0;
+    Sim_Dispatch();
+}
+
+void __WFI(void)
+{
+    /* The harness plays the rest of the world while the CPU sleeps, then the next
+       SysTick wakes it up; interrupts raised meanwhile stay pending while masked */
+    Stats.Sleeps++;
+
+    if (IdleHook != NULL)
+    {
+        IdleHook();
+    }
+
+    Sim_Advance(1);
+}
+
+uint32_t HAL_RCCEx_GetPeriphCLKFreq(uint32_t PeriphClk)
+{
+    return (PeriphClk == RCC_PERIPHCLK_FDCAN) ? SIM_FDCAN_CLOCK : 0u;
+}
+
+/* GPIO -----------------------------------------------------------------------------------------*/
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+    (void)GPIOx;
+    (void)GPIO_Init;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    if (PinState == GPIO_PIN_SET)
+    {
+        GPIOx->ODR |= GPIO_Pin;
+    }
+    else
+    {
+        GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+    }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    GPIOx->ODR ^= GPIO_Pin;
+}
+
+/* FDCAN ----------------------------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_FDCAN_Init(FDCAN_HandleTypeDef *hfdcan)
+{
+    /* The message RAM is cleared on initialization */
+    Fdcan.Handle = hfdcan;
+    Fdcan.Started = 0;
+    Fdcan.Flags = 0;
+    memset(Fdcan.RxHead, 0, sizeof(Fdcan.RxHead));
+    memset(Fdcan.RxTail, 0, sizeof(Fdcan.RxTail));
+    memset(Fdcan.StdFilters, 0, sizeof(Fdcan.StdFilters));
+    memset(Fdcan.ExtFilters, 0, sizeof(Fdcan.ExtFilters));
+    Fdcan.Node.PriorityQueue = (hfdcan->Init.TxFifoQueueMode != FDCAN_TX_FIFO_OPERATION) ? 1u : 0u;
+    Fdcan.Node.BitRate = Sim_FdcanBitRate();
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_ConfigFilter(FDCAN_HandleTypeDef *hfdcan, FDCAN_FilterTypeDef *sFilterConfig)
+{
+    HAL_StatusTypeDef status = HAL_ERROR;
+
+    /* Only the elements given to HAL_FDCAN_Init exist in the message RAM */
+    if ((sFilterConfig->IdType == FDCAN_STANDARD_ID) && (sFilterConfig->FilterIndex < hfdcan->Init.StdFiltersNbr) &&
+        (sFilterConfig->FilterIndex < SIM_FDCAN_STD_FILTERS))
+    {
+        Fdcan.StdFilters[sFilterConfig->FilterIndex] = *sFilterConfig;
+        status = HAL_OK;
+    }
+    else if ((sFilterConfig->IdType == FDCAN_EXTENDED_ID) && (sFilterConfig->FilterIndex < hfdcan->Init.ExtFiltersNbr) &&
+             (sFilterConfig->FilterIndex < SIM_FDCAN_EXT_FILTERS))
+    {
+        Fdcan.ExtFilters[sFilterConfig->FilterIndex] = *sFilterConfig;
+        status = HAL_OK;
+    }
+
+    return status;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_ConfigGlobalFilter(FDCAN_HandleTypeDef *hfdcan, uint32_t NonMatchingStd,
+                                               uint32_t NonMatchingExt, uint32_t RejectRemoteStd,
+                                               uint32_t RejectRemoteExt)
+{
+    /* The bus carries no remote frames */
+    (void)hfdcan;
+    (void)RejectRemoteStd;
+    (void)RejectRemoteExt;
+
+    Fdcan.NonMatchingStd = NonMatchingStd;
+    Fdcan.NonMatchingExt = NonMatchingExt;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_ConfigTxDelayCompensation(FDCAN_HandleTypeDef *hfdcan, uint32_t TdcOffset, uint32_t TdcFilter)
+{
+    (void)hfdcan;
+    (void)TdcOffset;
+    (void)TdcFilter;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_EnableTxDelayCompensation(FDCAN_HandleTypeDef *hfdcan)
+{
+    (void)hfdcan;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_ConfigTimestampCounter(FDCAN_HandleTypeDef *hfdcan, uint32_t TimestampPrescaler)
+{
+    (void)hfdcan;
+    (void)TimestampPrescaler;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_EnableTimestampCounter(FDCAN_HandleTypeDef *hfdcan, uint32_t TimestampOperation)
+{
+    (void)hfdcan;
+
+    /* Only the external counter is modelled, the internal one counts bit times */
+    Fdcan.Timestamps = TimestampOperation;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_Start(FDCAN_HandleTypeDef *hfdcan)
+{
+    Fdcan.Handle = hfdcan;
+    Fdcan.Started = 1;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_Stop(FDCAN_HandleTypeDef *hfdcan)
+{
+    (void)hfdcan;
+    Fdcan.Started = 0;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_AddMessageToTxFifoQ(FDCAN_HandleTypeDef *hfdcan, FDCAN_TxHeaderTypeDef *pTxHeader, uint8_t *pTxData)
+{
+    Sim_CanFrameTypeDef frame = {0};
+    HAL_StatusTypeDef status = HAL_ERROR;
+
+    frame.Identifier = pTxHeader->Identifier;
+    frame.IdType = pTxHeader->IdType;
+    frame.DataLength = pTxHeader->DataLength;
+    frame.FDFormat = pTxHeader->FDFormat;
+    frame.BitRateSwitch = pTxHeader->BitRateSwitch;
+    frame.Tick = Tick;
+    frame.Start = Tick * SIM_US_PER_TICK;
+    memcpy(frame.Data, pTxData, Sim_DlcToBytes(pTxHeader->DataLength));
+
+    if (Fdcan.Started == 0u)
+    {
+        Stats.FdcanTxErrors++;
+    }
+    else if (hfdcan->Init.Mode == FDCAN_MODE_INTERNAL_LOOPBACK)
+    {
+        /* The frame never leaves the controller, it comes back on the RX FIFO of its filter */
+        status = (Sim_FdcanInject(&frame) == SIM_OK) ? HAL_OK : HAL_ERROR;
+    }
+    else if ((SimBus_Pending(&Fdcan.Node) < SIM_FDCAN_TX_FIFO_SIZE) && (SimBus_Send(&Fdcan.Node, &frame) == SIMBUS_OK))
+    {
+        /* Goes out once it wins the arbitration, the bus retries it after errors */
+        Stats.FdcanTxFrames++;
+        status = HAL_OK;
+    }
+    else
+    {
+        /* TX FIFO full, or bus off */
+        Stats.FdcanTxErrors++;
+    }
+
+    return status;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_GetRxMessage(FDCAN_HandleTypeDef *hfdcan, uint32_t RxLocation, FDCAN_RxHeaderTypeDef *pRxHeader, uint8_t *pRxData)
+{
+    const Sim_CanFrameTypeDef *frame;
+    HAL_StatusTypeDef status = HAL_ERROR;
+    uint32_t fifo = (RxLocation == FDCAN_RX_FIFO1) ? 1u : 0u;
+
+    (void)hfdcan;
+
+    if (((RxLocation == FDCAN_RX_FIFO0) || (RxLocation == FDCAN_RX_FIFO1)) && (Fdcan.RxHead[fifo] != Fdcan.RxTail[fifo]))
+    {
+        frame = &Fdcan.Rx[fifo][Fdcan.RxTail[fifo] % SIM_FDCAN_RX_FIFO_SIZE];
+
+        pRxHeader->Identifier = frame->Identifier;
+        pRxHeader->IdType = frame->IdType;
+        pRxHeader->RxFrameType = FDCAN_DATA_FRAME;
+        pRxHeader->DataLength = frame->DataLength;
+        pRxHeader->ErrorStateIndicator = 0;
+        pRxHeader->BitRateSwitch = frame->BitRateSwitch;
+        pRxHeader->FDFormat = frame->FDFormat;
+        pRxHeader->RxTimestamp = (Fdcan.Timestamps == FDCAN_TIMESTAMP_EXTERNAL) ? (frame->Start & 0xFFFFU) : 0u;
+        pRxHeader->FilterIndex = 0;
+        pRxHeader->IsFilterMatchingFrame = 0;
+        memcpy(pRxData, frame->Data, Sim_DlcToBytes(frame->DataLength));
+
+        Fdcan.RxTail[fifo]++;
+        status = HAL_OK;
+    }
+
+    return status;
+}
+
+uint32_t HAL_FDCAN_GetTxFifoFreeLevel(FDCAN_HandleTypeDef *hfdcan)
+{
+    (void)hfdcan;
+
+    return SIM_FDCAN_TX_FIFO_SIZE - SimBus_Pending(&Fdcan.Node);
+}
+
+uint32_t HAL_FDCAN_GetRxFifoFillLevel(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo)
+{
+    uint32_t level = 0;
+
+    (void)hfdcan;
+
+    if (RxFifo == FDCAN_RX_FIFO0)
+    {
+        level = Fdcan.RxHead[0] - Fdcan.RxTail[0];
+    }
+    else if (RxFifo == FDCAN_RX_FIFO1)
+    {
+        level = Fdcan.RxHead[1] - Fdcan.RxTail[1];
+    }
+
+    return level;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_ConfigInterruptLines(FDCAN_HandleTypeDef *hfdcan, uint32_t ITList, uint32_t InterruptLine)
+{
+    (void)hfdcan;
+
+    if (InterruptLine == FDCAN_INTERRUPT_LINE1)
+    {
+        Fdcan.Line1Groups |= ITList;
+    }
+    else
+    {
+        Fdcan.Line1Groups &= ~ITList;
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FDCAN_ActivateNotification(FDCAN_HandleTypeDef *hfdcan, uint32_t ActiveITs, uint32_t BufferIndexes)
+{
+    (void)BufferIndexes;
+
+    Fdcan.Handle = hfdcan;
+    Fdcan.Notifications |= ActiveITs;
+
+    /* Flags raised before the interrupts were enabled are served now */
+    Sim_FdcanRaise();
+    Sim_Dispatch();
+
+    return HAL_OK;
+}
+
+__weak void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
+{
+    (void)hfdcan;
+    (void)RxFifo0ITs;
+}
+
+__weak void HAL_FDCAN_RxFifo1Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo1ITs)
+{
+    (void)hfdcan;
+    (void)RxFifo1ITs;
+}
+
+__weak void HAL_FDCAN_TxBufferCompleteCallback(FDCAN_HandleTypeDef *hfdcan, uint32_t BufferIndexes)
+{
+    (void)hfdcan;
+    (void)BufferIndexes;
+}
+
+/* RTC ------------------------------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_RTC_Init(RTC_HandleTypeDef *hrtc)
+{
+    Calendar.SynchPrediv = hrtc->Init.SynchPrediv;
+    Sim_Rtc.SSR = Sim_RtcSubSeconds();
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_SetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format)
+{
+    (void)hrtc;
+
+    Calendar.Hours = (Format == RTC_FORMAT_BCD) ? Sim_FromBcd(sTime->Hours) : sTime->Hours;
+    Calendar.Minutes = (Format == RTC_FORMAT_BCD) ? Sim_FromBcd(sTime->Minutes) : sTime->Minutes;
+    Calendar.Seconds = (Format == RTC_FORMAT_BCD) ? Sim_FromBcd(sTime->Seconds) : sTime->Seconds;
+    Calendar.Millis = 0;    /* Writing the time resets the prescalers */
+    Calendar.Locked = 0;    /* The HAL waits for the shadow registers to resynchronize */
+    Sim_Rtc.SSR = Sim_RtcSubSeconds();
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format)
+{
+    (void)hrtc;
+
+    /* As the HAL: SSR then TR, the shadow registers stay locked until HAL_RTC_GetDate */
+    Sim_RtcLock();
+
+    sTime->Hours = (Format == RTC_FORMAT_BCD) ? Sim_ToBcd(Shadow.Hours) : Shadow.Hours;
+    sTime->Minutes = (Format == RTC_FORMAT_BCD) ? Sim_ToBcd(Shadow.Minutes) : Shadow.Minutes;
+    sTime->Seconds = (Format == RTC_FORMAT_BCD) ? Sim_ToBcd(Shadow.Seconds) : Shadow.Seconds;
+    sTime->TimeFormat = 0;
+
+    sTime->SubSeconds = Shadow.SynchPrediv - ((Shadow.Millis * (Shadow.SynchPrediv + 1u)) / 1000u);
+    sTime->SecondFraction = Calendar.SynchPrediv;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_SetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format)
+{
+    (void)hrtc;
+
+    Calendar.WeekDay = sDate->WeekDay;
+    Calendar.Date = (Format == RTC_FORMAT_BCD) ? Sim_FromBcd(sDate->Date) : sDate->Date;
+    Calendar.Month = (Format == RTC_FORMAT_BCD) ? Sim_FromBcd(sDate->Month) : sDate->Month;
+    Calendar.Year = (Format == RTC_FORMAT_BCD) ? Sim_FromBcd(sDate->Year) : sDate->Year;
+    Calendar.Locked = 0;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format)
+{
+    (void)hrtc;
+
+    /* Reading DR releases the shadow registers */
+    Sim_RtcLock();
+    Calendar.Locked = 0;
+
+    sDate->WeekDay = Shadow.WeekDay;
+    sDate->Date = (Format == RTC_FORMAT_BCD) ? Sim_ToBcd(Shadow.Date) : Shadow.Date;
+    sDate->Month = (Format == RTC_FORMAT_BCD) ? Sim_ToBcd(Shadow.Month) : Shadow.Month;
+    sDate->Year = (Format == RTC_FORMAT_BCD) ? Sim_ToBcd(Shadow.Year) : Shadow.Year;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_SetAlarm(RTC_HandleTypeDef *hrtc, RTC_AlarmTypeDef *sAlarm, uint32_t Format)
+{
+    (void)hrtc;
+
+    Calendar.Alarm = *sAlarm;
+
+    if (Format == RTC_FORMAT_BCD)
+    {
+        Calendar.Alarm.AlarmTime.Hours = Sim_FromBcd(sAlarm->AlarmTime.Hours);
+        Calendar.Alarm.AlarmTime.Minutes = Sim_FromBcd(sAlarm->AlarmTime.Minutes);
+        Calendar.Alarm.AlarmTime.Seconds = Sim_FromBcd(sAlarm->AlarmTime.Seconds);
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_SetAlarm_IT(RTC_HandleTypeDef *hrtc, RTC_AlarmTypeDef *sAlarm, uint32_t Format)
+{
+    HAL_StatusTypeDef status = HAL_RTC_SetAlarm(hrtc, sAlarm, Format);
+
+    Calendar.AlarmHandle = hrtc;
+
+    return status;
+}
+
+HAL_StatusTypeDef HAL_RTC_GetAlarm(RTC_HandleTypeDef *hrtc, RTC_AlarmTypeDef *sAlarm, uint32_t Alarm, uint32_t Format)
+{
+    (void)hrtc;
+
+    *sAlarm = Calendar.Alarm;
+    sAlarm->Alarm = Alarm;
+
+    if (Format == RTC_FORMAT_BCD)
+    {
+        sAlarm->AlarmTime.Hours = Sim_ToBcd(Calendar.Alarm.AlarmTime.Hours);
+        sAlarm->AlarmTime.Minutes = Sim_ToBcd(Calendar.Alarm.AlarmTime.Minutes);
+        sAlarm->AlarmTime.Seconds = Sim_ToBcd(Calendar.Alarm.AlarmTime.Seconds);
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTCEx_SetSynchroShift(RTC_HandleTypeDef *hrtc, uint32_t ShiftAdd1S, uint32_t ShiftSubFS)
+{
+    uint32_t back = (ShiftSubFS * 1000u) / (Calendar.SynchPrediv + 1u);
+
+    (void)hrtc;
+
+    /* One second ahead, carried as the counters would, then the fraction back */
+    if (ShiftAdd1S == RTC_SHIFTADD1S_SET)
+    {
+        for (uint32_t i = 0; i < (1000u - back); i++)
+        {
+            Sim_RtcTick();
+        }
+    }
+    else
+    {
+        /* Not going back over the previous second, the application never does */
+        Calendar.Millis = (Calendar.Millis > back) ? (Calendar.Millis - back) : 0u;
+        Sim_Rtc.SSR = Sim_RtcSubSeconds();
+    }
+
+    return HAL_OK;
+}
+
+/* Only the 1 Hz wakeup is modelled, from the ck_spre clock with a counter of 0 */
+HAL_StatusTypeDef HAL_RTCEx_SetWakeUpTimer_IT(RTC_HandleTypeDef *hrtc, uint32_t WakeUpCounter, uint32_t WakeUpClock)
+{
+    HAL_StatusTypeDef status = HAL_ERROR;
+
+    if ((WakeUpCounter == 0u) && (WakeUpClock == RTC_WAKEUPCLOCK_CK_SPRE_16BITS))
+    {
+        Calendar.WakeupHandle = hrtc;
+        status = HAL_OK;
+    }
+
+    return status;
+}
+
+__weak void HAL_RTC_AlarmAEventCallback(RTC_HandleTypeDef *hrtc)
+{
+    (void)hrtc;
+}
+
+__weak void HAL_RTCEx_WakeUpTimerEventCallback(RTC_HandleTypeDef *hrtc)
+{
+    (void)hrtc;
+}
+
+/**
+ * @brief Advance the calendar by one millisecond
+ */
+static void Sim_RtcTick(void)
+{
+    Calendar.Millis++;
+
+    if (Calendar.Millis == 1000u)
+    {
+        Calendar.Millis = 0;
+
+        if (++Calendar.Seconds == 60u)
+        {
+            Calendar.Seconds = 0;
+
+            if (++Calendar.Minutes == 60u)
+            {
+                Calendar.Minutes = 0;
+
+                if (++Calendar.Hours == 24u)
+                {
+                    Calendar.Hours = 0;
+                    Calendar.WeekDay = (Calendar.WeekDay % 7u) + 1u;
+
+                    if (++Calendar.Date > Sim_DaysInMonth(Calendar.Month, Calendar.Year))
+                    {
+                        Calendar.Date = 1;
+
+                        if (++Calendar.Month > 12u)
+                        {
+                            Calendar.Month = 1;
+                            Calendar.Year = (Calendar.Year + 1u) % 100u;
+                        }
+                    }
+                }
+            }
+        }
+
+        /* The alarm flag is set on the second the calendar reaches the alarm time */
+        if ((Calendar.AlarmHandle != NULL) && (Sim_RtcAlarmMatch() != 0u))
+        {
+            Sim_Rtc.SR |= RTC_FLAG_ALRAF;
+            IrqPending |= SIM_IRQ_RTC;
+        }
+
+        if (Calendar.WakeupHandle != NULL)
+        {
+            Sim_Rtc.SR |= RTC_FLAG_WUTF;
+            IrqPending |= SIM_IRQ_RTC;
+        }
+    }
+
+    Sim_Rtc.SSR = Sim_RtcSubSeconds();
+}
+
+/**
+ * @brief Freeze the time and date in the shadow registers, unless already frozen
+ */
+static void Sim_RtcLock(void)
+{
+    if (Calendar.Locked == 0u)
+    {
+        Shadow = Calendar;
+        Calendar.Locked = 1;
+    }
+}
+
+/**
+ * @brief Sub-second register, counts down from the synchronous prescaler
+ * @return Value of SSR for the current millisecond
+ */
+static uint32_t Sim_RtcSubSeconds(void)
+{
+    return Calendar.SynchPrediv - ((Calendar.Millis * (Calendar.SynchPrediv + 1u)) / 1000u);
+}
+
+/**
+ * @brief Compare the calendar with the alarm, the masked fields always match
+ * @return 1 if the alarm time is reached, 0 otherwise
+ */
+static uint8_t Sim_RtcAlarmMatch(void)
+{
+    const RTC_AlarmTypeDef *alarm = &Calendar.Alarm;
+    uint8_t match = 1;
+
+    if (((alarm->AlarmMask & RTC_ALARMMASK_DATEWEEKDAY) == 0u) && (alarm->AlarmDateWeekDay != Calendar.Date))
+    {
+        match = 0;
+    }
+
+    if (((alarm->AlarmMask & RTC_ALARMMASK_HOURS) == 0u) && (alarm->AlarmTime.Hours != Calendar.Hours))
+    {
+        match = 0;
+    }
+
+    if (((alarm->AlarmMask & RTC_ALARMMASK_MINUTES) == 0u) && (alarm->AlarmTime.Minutes != Calendar.Minutes))
+    {
+        match = 0;
+    }
+
+    if (((alarm->AlarmMask & RTC_ALARMMASK_SECONDS) == 0u) && (alarm->AlarmTime.Seconds != Calendar.Seconds))
+    {
+        match = 0;
+    }
+
+    return match;
+}
+
+/**
+ * @brief Days in a month, the RTC takes every year multiple of 4 as a leap year
+ * @param month Month, 1 to 12
+ * @param year Year, 0 to 99
+ * @return Number of days
+ */
+static uint8_t Sim_DaysInMonth(uint8_t month, uint8_t year)
+{
+    static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    uint8_t count = days[(month - 1u) % 12u];
+
+    if ((month == 2u) && ((year % 4u) == 0u))
+    {
+        count++;
+    }
+
+    return count;
+}
+
+/* SPI ------------------------------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+    HAL_StatusTypeDef status = HAL_BUSY;
+
+    (void)pData;
+
+    if (Spi.Handle == NULL)
+    {
+        /* Completes on the next tick, the interrupt comes from the DMA channel */
+        Spi.Handle = hspi;
+        Spi.Size = Size;
+        status = HAL_OK;
+    }
+
+    return status;
+}
+
+__weak void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+}
+
+__weak void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+}
+
+/* Timestamp counter ---------------------------------------------------------------------------*/
+/**
+ * @brief Nothing to start, the timestamps follow the virtual time
+ */
+void Serial_TimestampStart(void)
+{
+}
+
+/**
+ * @brief Read the virtual time in microseconds, the frames start between two ticks
+ * @return Timestamp counter value
+ */
+uint32_t Serial_TimestampRead(void)
+{
+    return Tick * SIM_US_PER_TICK;
+}
+
+/* Benchmark counter ----------------------------------------------------------------------------*/
+/**
+ * @brief Nothing to start, the probes read the monotonic clock
+ * @return Counter ticks per second, nanoseconds
+ */
+uint32_t Bench_CounterStart(void)
+{
+    return 1000000000UL;
+}
+
+/**
+ * @brief Read the monotonic clock as a 32 bit nanosecond counter, it wraps around every 4.29 s
+ * @return Counter value
+ */
+uint32_t Bench_CounterRead(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)(((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec);
+}
+
+/* Helpers --------------------------------------------------------------------------------------*/
+/**
+ * @brief Convert an FDCAN data length code into a number of bytes
+ * @param dlc Data length code as found in the FDCAN headers
+ * @return Number of payload bytes
+ */
+static uint32_t Sim_DlcToBytes(uint32_t dlc)
+{
+    static const uint8_t dlcBytes[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+    return dlcBytes[(dlc >> 16) & 0x0Fu];
+}
+
+static uint8_t Sim_ToBcd(uint8_t value)
+{
+    return (uint8_t)(((value / 10u) << 4) | (value % 10u));
+}
+
+static uint8_t Sim_FromBcd(uint8_t value)
+{
+    return (uint8_t)(((value >> 4) * 10u) + (value & 0x0Fu));
+}
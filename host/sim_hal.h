@@ -0,0 +1,110 @@
+#ifndef __SIM_HAL_H__
+#define __SIM_HAL_H__
+
+#include "stm32g0xx.h"
+#include "sim_canbus.h"
+
+/**
+ * @file sim_hal.h
+ * @brief Control interface of the simulated HAL used by the host build.
+ *
+ * Time only moves when the harness or the application asks for it: __WFI and
+ * HAL_Delay advance the virtual millisecond tick, so a run is deterministic
+ * and goes as fast as the host allows. Every tick the RTC calendar advances,
+ * pending SPI DMA transfers complete and the pending interrupts are delivered
+ * unless masked with __disable_irq. The harness runs from the idle hook,
+ * called on every __WFI before the tick advances. The FDCAN is a node of the
+ * virtual bus given to Sim_FdcanAttach, the bus runs with the tick; frames
+ * can also be put straight in its RX FIFO with Sim_FdcanInject.
+ */
+
+#define SIM_OK      0x00U
+#define SIM_ERROR   0x01U
+
+#define SIM_FDCAN_RX_FIFO_SIZE  3u  /**< Elements of each RX FIFO, as in the STM32G0 message RAM */
+#define SIM_FDCAN_TX_FIFO_SIZE  3u  /**< Elements of the TX FIFO */
+
+/**
+ * @brief Simulation counters.
+ */
+typedef struct
+{
+    uint32_t FdcanRxFrames; /**< Frames stored in RX FIFO 0 or 1 */
+    uint32_t FdcanRxLost;   /**< Frames dropped because their RX FIFO was full */
+    uint32_t FdcanRxFiltered;   /**< Frames rejected by the acceptance filters */
+    uint32_t FdcanTxFrames; /**< Frames queued by the application */
+    uint32_t FdcanTxErrors; /**< Frames refused, controller stopped or TX FIFO full */
+    uint32_t FdcanIrqs;     /**< FDCAN interrupts delivered, both lines */
+    uint32_t SpiBytes;      /**< Bytes sent with SPI DMA transfers */
+    uint32_t Sleeps;        /**< Calls to __WFI */
+    uint32_t RtcPreempts;   /**< RTC interrupts delivered between an SSR read and its DR read */
+} Sim_StatsTypeDef;
+
+/**
+ * @brief Harness function called on every __WFI.
+ */
+typedef void (*Sim_IdleHook)(void);
+
+/**
+ * @brief Reset the simulated peripherals, the tick and the counters.
+ */
+void Sim_Init(void);
+
+/**
+ * @brief Set the function called on every __WFI, NULL for none.
+ * @param hook Harness function.
+ */
+void Sim_SetIdleHook(Sim_IdleHook hook);
+
+/**
+ * @brief Get the virtual tick.
+ * @return Milliseconds since Sim_Init.
+ */
+uint32_t Sim_Now(void);
+
+/**
+ * @brief Advance the virtual time, running the peripherals on every tick.
+ * @param ms Milliseconds to advance.
+ */
+void Sim_Advance(uint32_t ms);
+
+/**
+ * @brief Preempt the next SSR read made in the last millisecond of a second.
+ *
+ * Right after that read the RTC moves one millisecond forward, into the next
+ * second, and its interrupts are delivered unless masked, as if the wakeup
+ * fired between the SSR read and the DR read releasing the shadow registers.
+ * The RTC ends up one millisecond ahead of the tick.
+ */
+void Sim_RtcPreemptAtSsr(void);
+
+/**
+ * @brief Pass a frame received from the bus through the acceptance filters, store it in its RX FIFO and raise its interrupts.
+ * @param frame Frame to receive, its tick is ignored.
+ * @return SIM_OK if stored or rejected by the filters, SIM_ERROR if the controller is stopped or the FIFO was full.
+ */
+uint8_t Sim_FdcanInject(const Sim_CanFrameTypeDef *frame);
+
+/**
+ * @brief Attach the FDCAN to a virtual bus, it runs with the tick from now on.
+ *
+ * The node bit rate follows the FDCAN nominal bit timing, a wrong one only
+ * gets errors. Without a bus the transmitted frames stay in the TX FIFO.
+ *
+ * @param hbus Pointer to the bus handle structure.
+ */
+void Sim_FdcanAttach(SimBus_HandleTypeDef *hbus);
+
+/**
+ * @brief Get the bus node of the FDCAN, for its error counters.
+ * @return Pointer to the node.
+ */
+const SimBus_NodeTypeDef *Sim_FdcanNode(void);
+
+/**
+ * @brief Get the simulation counters.
+ * @return Pointer to the counters.
+ */
+const Sim_StatsTypeDef *Sim_GetStats(void);
+
+#endif // __SIM_HAL_H__
@@ -0,0 +1,392 @@
+#ifndef __STM32G0XX_H__
+#define __STM32G0XX_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file stm32g0xx.h
+ * @brief Simulated device and HAL header for the host build.
+ *
+ * Stands in for the CMSIS device header and the STM32G0 HAL when the app
+ * sources are compiled for Linux (make host). Only the types, constants and
+ * functions the application uses are declared, with the same names, fields
+ * and values as the real HAL so the sources compile unchanged. The functions
+ * are implemented by sim_hal.c on top of a virtual millisecond tick, FDCAN,
+ * RTC, SPI and interrupt controller.
+ */
+
+#define __weak __attribute__((weak))
+
+#define assert_param(expr) ((void)0U)
+
+/* Generic --------------------------------------------------------------------------------------*/
+typedef enum
+{
+    HAL_OK       = 0x00U,
+    HAL_ERROR    = 0x01U,
+    HAL_BUSY     = 0x02U,
+    HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+    DISABLE = 0U,
+    ENABLE = !DISABLE
+} FunctionalState;
+
+typedef enum
+{
+    RTC_TAMP_IRQn           = 2,
+    DMA1_Channel1_IRQn      = 9,
+    TIM16_FDCAN_IT0_IRQn    = 21,
+    TIM17_FDCAN_IT1_IRQn    = 22
+} IRQn_Type;
+
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+void HAL_IncTick(void);
+void HAL_Delay(uint32_t Delay);
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_SetPendingIRQ(IRQn_Type IRQn);
+
+/* Core instructions, interrupts are simulated so these are functions */
+void __disable_irq(void);
+void __enable_irq(void);
+void __WFI(void);
+
+/* RCC ------------------------------------------------------------------------------------------*/
+#define RCC_PERIPHCLK_FDCAN 0x02000000U
+
+uint32_t HAL_RCCEx_GetPeriphCLKFreq(uint32_t PeriphClk);
+
+/* GPIO -----------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t ODR;   /**< Output data register, the only one simulated */
+} GPIO_TypeDef;
+
+typedef enum
+{
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct
+{
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+extern GPIO_TypeDef Sim_GpioA;
+extern GPIO_TypeDef Sim_GpioB;
+extern GPIO_TypeDef Sim_GpioC;
+extern GPIO_TypeDef Sim_GpioD;
+
+#define GPIOA (&Sim_GpioA)
+#define GPIOB (&Sim_GpioB)
+#define GPIOC (&Sim_GpioC)
+#define GPIOD (&Sim_GpioD)
+
+#define GPIO_PIN_0  ((uint16_t)0x0001)
+#define GPIO_PIN_1  ((uint16_t)0x0002)
+#define GPIO_PIN_2  ((uint16_t)0x0004)
+#define GPIO_PIN_3  ((uint16_t)0x0008)
+#define GPIO_PIN_4  ((uint16_t)0x0010)
+#define GPIO_PIN_5  ((uint16_t)0x0020)
+#define GPIO_PIN_6  ((uint16_t)0x0040)
+#define GPIO_PIN_7  ((uint16_t)0x0080)
+#define GPIO_PIN_8  ((uint16_t)0x0100)
+#define GPIO_PIN_9  ((uint16_t)0x0200)
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+/* FDCAN ----------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Reserved;  /**< No registers, the controller is modelled by sim_hal.c */
+} FDCAN_GlobalTypeDef;
+
+extern FDCAN_GlobalTypeDef Sim_Fdcan1;
+
+#define FDCAN1 (&Sim_Fdcan1)
+
+typedef struct
+{
+    uint32_t ClockDivider;
+    uint32_t FrameFormat;
+    uint32_t Mode;
+    FunctionalState AutoRetransmission;
+    FunctionalState TransmitPause;
+    FunctionalState ProtocolException;
+    uint32_t NominalPrescaler;
+    uint32_t NominalSyncJumpWidth;
+    uint32_t NominalTimeSeg1;
+    uint32_t NominalTimeSeg2;
+    uint32_t DataPrescaler;
+    uint32_t DataSyncJumpWidth;
+    uint32_t DataTimeSeg1;
+    uint32_t DataTimeSeg2;
+    uint32_t StdFiltersNbr;
+    uint32_t ExtFiltersNbr;
+    uint32_t TxFifoQueueMode;
+} FDCAN_InitTypeDef;
+
+typedef struct
+{
+    FDCAN_GlobalTypeDef *Instance;
+    FDCAN_InitTypeDef Init;
+} FDCAN_HandleTypeDef;
+
+typedef struct
+{
+    uint32_t IdType;
+    uint32_t FilterIndex;
+    uint32_t FilterType;
+    uint32_t FilterConfig;
+    uint32_t FilterID1;
+    uint32_t FilterID2;
+} FDCAN_FilterTypeDef;
+
+typedef struct
+{
+    uint32_t Identifier;
+    uint32_t IdType;
+    uint32_t TxFrameType;
+    uint32_t DataLength;
+    uint32_t ErrorStateIndicator;
+    uint32_t BitRateSwitch;
+    uint32_t FDFormat;
+    uint32_t TxEventFifoControl;
+    uint32_t MessageMarker;
+} FDCAN_TxHeaderTypeDef;
+
+typedef struct
+{
+    uint32_t Identifier;
+    uint32_t IdType;
+    uint32_t RxFrameType;
+    uint32_t DataLength;
+    uint32_t ErrorStateIndicator;
+    uint32_t BitRateSwitch;
+    uint32_t FDFormat;
+    uint32_t RxTimestamp;
+    uint32_t FilterIndex;
+    uint32_t IsFilterMatchingFrame;
+} FDCAN_RxHeaderTypeDef;
+
+#define FDCAN_FRAME_CLASSIC     ((uint32_t)0x00000000U)
+#define FDCAN_FRAME_FD_NO_BRS   ((uint32_t)0x00000100U)
+#define FDCAN_FRAME_FD_BRS      ((uint32_t)0x00000300U)
+
+#define FDCAN_MODE_NORMAL               ((uint32_t)0x00000000U)
+#define FDCAN_MODE_INTERNAL_LOOPBACK    ((uint32_t)0x00000003U)
+
+#define FDCAN_CLOCK_DIV1        ((uint32_t)0x00000000U)
+#define FDCAN_TX_FIFO_OPERATION ((uint32_t)0x00000000U)
+
+#define FDCAN_STANDARD_ID       ((uint32_t)0x00000000U)
+#define FDCAN_EXTENDED_ID       ((uint32_t)0x40000000U)
+#define FDCAN_DATA_FRAME        ((uint32_t)0x00000000U)
+
+#define FDCAN_DLC_BYTES_0       ((uint32_t)0x00000000U)
+#define FDCAN_DLC_BYTES_8       ((uint32_t)0x00080000U)
+#define FDCAN_DLC_BYTES_64      ((uint32_t)0x000F0000U)
+
+#define FDCAN_BRS_OFF           ((uint32_t)0x00000000U)
+#define FDCAN_BRS_ON            ((uint32_t)0x00100000U)
+#define FDCAN_CLASSIC_CAN       ((uint32_t)0x00000000U)
+#define FDCAN_FD_CAN            ((uint32_t)0x00200000U)
+
+#define FDCAN_FILTER_RANGE          ((uint32_t)0x00000000U)
+#define FDCAN_FILTER_DUAL           ((uint32_t)0x00000001U)
+#define FDCAN_FILTER_MASK           ((uint32_t)0x00000002U)
+#define FDCAN_FILTER_RANGE_NO_EIDM  ((uint32_t)0x00000003U)
+
+#define FDCAN_FILTER_DISABLE        ((uint32_t)0x00000000U)
+#define FDCAN_FILTER_TO_RXFIFO0     ((uint32_t)0x00000001U)
+#define FDCAN_FILTER_TO_RXFIFO1     ((uint32_t)0x00000002U)
+#define FDCAN_FILTER_REJECT         ((uint32_t)0x00000003U)
+#define FDCAN_FILTER_HP             ((uint32_t)0x00000004U)
+#define FDCAN_FILTER_TO_RXFIFO0_HP  ((uint32_t)0x00000005U)
+#define FDCAN_FILTER_TO_RXFIFO1_HP  ((uint32_t)0x00000006U)
+
+#define FDCAN_ACCEPT_IN_RX_FIFO0    ((uint32_t)0x00000000U)
+#define FDCAN_ACCEPT_IN_RX_FIFO1    ((uint32_t)0x00000001U)
+#define FDCAN_REJECT                ((uint32_t)0x00000002U)
+
+#define FDCAN_FILTER_REMOTE         ((uint32_t)0x00000000U)
+#define FDCAN_REJECT_REMOTE         ((uint32_t)0x00000001U)
+
+#define FDCAN_RX_FIFO0          ((uint32_t)0x00000040U)
+#define FDCAN_RX_FIFO1          ((uint32_t)0x00000041U)
+
+#define FDCAN_IT_RX_FIFO0_NEW_MESSAGE   ((uint32_t)0x00000001U)
+#define FDCAN_IT_RX_FIFO0_FULL          ((uint32_t)0x00000002U)
+#define FDCAN_IT_RX_FIFO0_MESSAGE_LOST  ((uint32_t)0x00000004U)
+#define FDCAN_IT_RX_FIFO1_NEW_MESSAGE   ((uint32_t)0x00000008U)
+#define FDCAN_IT_RX_FIFO1_FULL          ((uint32_t)0x00000010U)
+#define FDCAN_IT_RX_FIFO1_MESSAGE_LOST  ((uint32_t)0x00000020U)
+#define FDCAN_IT_TX_COMPLETE            ((uint32_t)0x00000080U)
+
+#define FDCAN_IT_GROUP_RX_FIFO0 ((uint32_t)0x00000001U)
+#define FDCAN_IT_GROUP_RX_FIFO1 ((uint32_t)0x00000002U)
+
+#define FDCAN_INTERRUPT_LINE0   ((uint32_t)0x00000001U)
+#define FDCAN_INTERRUPT_LINE1   ((uint32_t)0x00000002U)
+
+#define FDCAN_TIMESTAMP_INTERNAL ((uint32_t)0x00000001U)
+#define FDCAN_TIMESTAMP_EXTERNAL ((uint32_t)0x00000002U)  /**< TIM3 counter, the host virtual microseconds */
+#define FDCAN_TIMESTAMP_PRESC_1  ((uint32_t)0x00000000U)
+
+#define FDCAN_TX_BUFFER0        ((uint32_t)0x00000001U)
+#define FDCAN_TX_BUFFER1        ((uint32_t)0x00000002U)
+#define FDCAN_TX_BUFFER2        ((uint32_t)0x00000004U)
+
+HAL_StatusTypeDef HAL_FDCAN_Init(FDCAN_HandleTypeDef *hfdcan);
+HAL_StatusTypeDef HAL_FDCAN_ConfigFilter(FDCAN_HandleTypeDef *hfdcan, FDCAN_FilterTypeDef *sFilterConfig);
+HAL_StatusTypeDef HAL_FDCAN_ConfigGlobalFilter(FDCAN_HandleTypeDef *hfdcan, uint32_t NonMatchingStd,
+                                               uint32_t NonMatchingExt, uint32_t RejectRemoteStd,
+                                               uint32_t RejectRemoteExt);
+HAL_StatusTypeDef HAL_FDCAN_ConfigTxDelayCompensation(FDCAN_HandleTypeDef *hfdcan, uint32_t TdcOffset, uint32_t TdcFilter);
+HAL_StatusTypeDef HAL_FDCAN_EnableTxDelayCompensation(FDCAN_HandleTypeDef *hfdcan);
+HAL_StatusTypeDef HAL_FDCAN_ConfigTimestampCounter(FDCAN_HandleTypeDef *hfdcan, uint32_t TimestampPrescaler);
+HAL_StatusTypeDef HAL_FDCAN_EnableTimestampCounter(FDCAN_HandleTypeDef *hfdcan, uint32_t TimestampOperation);
+HAL_StatusTypeDef HAL_FDCAN_Start(FDCAN_HandleTypeDef *hfdcan);
+HAL_StatusTypeDef HAL_FDCAN_Stop(FDCAN_HandleTypeDef *hfdcan);
+HAL_StatusTypeDef HAL_FDCAN_AddMessageToTxFifoQ(FDCAN_HandleTypeDef *hfdcan, FDCAN_TxHeaderTypeDef *pTxHeader, uint8_t *pTxData);
+HAL_StatusTypeDef HAL_FDCAN_GetRxMessage(FDCAN_HandleTypeDef *hfdcan, uint32_t RxLocation, FDCAN_RxHeaderTypeDef *pRxHeader, uint8_t *pRxData);
+uint32_t HAL_FDCAN_GetTxFifoFreeLevel(FDCAN_HandleTypeDef *hfdcan);
+uint32_t HAL_FDCAN_GetRxFifoFillLevel(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo);
+HAL_StatusTypeDef HAL_FDCAN_ConfigInterruptLines(FDCAN_HandleTypeDef *hfdcan, uint32_t ITList, uint32_t InterruptLine);
+HAL_StatusTypeDef HAL_FDCAN_ActivateNotification(FDCAN_HandleTypeDef *hfdcan, uint32_t ActiveITs, uint32_t BufferIndexes);
+void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs);
+void HAL_FDCAN_RxFifo1Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo1ITs);
+void HAL_FDCAN_TxBufferCompleteCallback(FDCAN_HandleTypeDef *hfdcan, uint32_t BufferIndexes);
+
+/* RTC ------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t DR;        /**< Not kept, the calendar is modelled by sim_hal.c */
+    uint32_t SSR;       /**< Sub-second register, kept up to date by sim_hal.c */
+    uint32_t SR;        /**< Event flags, RTC_FLAG_x */
+} RTC_TypeDef;
+
+extern RTC_TypeDef Sim_Rtc;
+
+/* Register reads with side effects go through the simulation (SSR and DR lock the RTC shadow registers) */
+uint32_t Sim_ReadReg(const volatile uint32_t *reg);
+#define READ_REG(REG) Sim_ReadReg(&(REG))
+
+#define RTC (&Sim_Rtc)
+
+typedef struct
+{
+    uint32_t HourFormat;
+    uint32_t AsynchPrediv;
+    uint32_t SynchPrediv;
+    uint32_t OutPut;
+    uint32_t OutPutRemap;
+    uint32_t OutPutPolarity;
+    uint32_t OutPutType;
+    uint32_t OutPutPullUp;
+} RTC_InitTypeDef;
+
+typedef struct
+{
+    RTC_TypeDef *Instance;
+    RTC_InitTypeDef Init;
+} RTC_HandleTypeDef;
+
+typedef struct
+{
+    uint8_t Hours;
+    uint8_t Minutes;
+    uint8_t Seconds;
+    uint8_t TimeFormat;
+    uint32_t SubSeconds;
+    uint32_t SecondFraction;
+    uint32_t DayLightSaving;
+    uint32_t StoreOperation;
+} RTC_TimeTypeDef;
+
+typedef struct
+{
+    uint8_t WeekDay;
+    uint8_t Month;
+    uint8_t Date;
+    uint8_t Year;
+} RTC_DateTypeDef;
+
+typedef struct
+{
+    RTC_TimeTypeDef AlarmTime;
+    uint32_t AlarmMask;
+    uint32_t AlarmSubSecondMask;
+    uint32_t AlarmDateWeekDaySel;
+    uint8_t AlarmDateWeekDay;
+    uint32_t Alarm;
+} RTC_AlarmTypeDef;
+
+#define RTC_HOURFORMAT_24       0x00000000u
+#define RTC_OUTPUT_DISABLE      0x00000000u
+#define RTC_FORMAT_BIN          0x00000000u
+#define RTC_FORMAT_BCD          0x00000001u
+#define RTC_MONTH_AUGUST        ((uint8_t)0x08U)
+#define RTC_WEEKDAY_MONDAY      ((uint8_t)0x01U)
+#define RTC_WEEKDAY_WEDNESDAY   ((uint8_t)0x03U)
+#define RTC_WEEKDAY_SUNDAY      ((uint8_t)0x07U)
+#define RTC_HOURFORMAT12_AM     ((uint8_t)0x00U)
+#define RTC_ALARM_A             0x00000100u
+#define RTC_ALARMMASK_NONE      0x00000000u
+#define RTC_ALARMMASK_DATEWEEKDAY 0x80000000u
+#define RTC_ALARMMASK_HOURS     0x00800000u
+#define RTC_ALARMMASK_MINUTES   0x00008000u
+#define RTC_ALARMMASK_SECONDS   0x00000080u
+#define RTC_ALARMSUBSECONDMASK_ALL 0x00000000u
+#define RTC_ALARMDATEWEEKDAYSEL_DATE 0x00000000u
+#define RTC_SHIFTADD1S_RESET    0x00000000u
+#define RTC_SHIFTADD1S_SET      0x80000000u
+#define RTC_WAKEUPCLOCK_CK_SPRE_16BITS 0x00000004u
+#define RTC_FLAG_ALRAF          0x00000001u
+#define RTC_FLAG_WUTF           0x00000004u
+
+#define __HAL_RTC_WAKEUPTIMER_GET_FLAG(__HANDLE__, __FLAG__) ((((__HANDLE__)->Instance->SR & (__FLAG__)) != 0u) ? 1U : 0U)
+
+HAL_StatusTypeDef HAL_RTC_Init(RTC_HandleTypeDef *hrtc);
+HAL_StatusTypeDef HAL_RTC_SetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_SetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_SetAlarm(RTC_HandleTypeDef *hrtc, RTC_AlarmTypeDef *sAlarm, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_SetAlarm_IT(RTC_HandleTypeDef *hrtc, RTC_AlarmTypeDef *sAlarm, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_GetAlarm(RTC_HandleTypeDef *hrtc, RTC_AlarmTypeDef *sAlarm, uint32_t Alarm, uint32_t Format);
+HAL_StatusTypeDef HAL_RTCEx_SetSynchroShift(RTC_HandleTypeDef *hrtc, uint32_t ShiftAdd1S, uint32_t ShiftSubFS);
+HAL_StatusTypeDef HAL_RTCEx_SetWakeUpTimer_IT(RTC_HandleTypeDef *hrtc, uint32_t WakeUpCounter, uint32_t WakeUpClock);
+void HAL_RTC_AlarmAEventCallback(RTC_HandleTypeDef *hrtc);
+void HAL_RTCEx_WakeUpTimerEventCallback(RTC_HandleTypeDef *hrtc);
+
+/* SPI ------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Reserved;  /**< No registers, transfers are modelled by sim_hal.c */
+} SPI_TypeDef;
+
+typedef struct
+{
+    SPI_TypeDef *Instance;
+} SPI_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+#endif // __STM32G0XX_H__
@@ -0,0 +1,11 @@
+#ifndef __STM32G0XX_HAL_H__
+#define __STM32G0XX_HAL_H__
+
+/**
+ * @file stm32g0xx_hal.h
+ * @brief Simulated HAL header for the host build, everything lives in stm32g0xx.h.
+ */
+
+#include "stm32g0xx.h"
+
+#endif // __STM32G0XX_HAL_H__
@@ -0,0 +1,181 @@
+#include "unity.h"
+#include "app_bench.h"
+
+#define READ_COST 3u /* Counter ticks between two consecutive reads, the probe overhead */
+
+static Bench_HandleTypeDef bench;
+
+/* Simulated free running counter, every read costs READ_COST ticks */
+static uint32_t counter;
+
+static uint32_t ReadCounter(void)
+{
+    uint32_t value = counter;
+
+    counter += READ_COST;
+
+    return value;
+}
+
+/* Take one sample of the given length on a probe */
+static void Sample(uint8_t probe, uint32_t length)
+{
+    Bench_Begin(&bench, probe);
+    counter += length;
+    Bench_End(&bench, probe);
+}
+
+/* Read a big endian 32 bit field of a record */
+static uint32_t Get32(const uint8_t *buffer)
+{
+    return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | buffer[3];
+}
+
+/* This function is called before every test is run */
+void setUp(void)
+{
+    counter = 1000;
+    Bench_Init(&bench, ReadCounter, 16000000u);
+}
+
+/* This function is called after every test is run */
+void tearDown(void)
+{
+
+}
+
+// Testing the statistics
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: The cost of a begin/end pair is measured and no samples are left behind */
+void test_Bench_InitMeasuresOverhead(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(READ_COST, bench.Overhead);
+    TEST_ASSERT_EQUAL_UINT32(16000000u, bench.Frequency);
+    TEST_ASSERT_EQUAL_UINT32(0, bench.Probes[0].Count);
+    TEST_ASSERT_EQUAL_UINT32(0, Bench_Mean(&bench, 0));
+}
+
+/* Test case: Samples are measured without the probe overhead */
+void test_Bench_SampleExcludesOverhead(void)
+{
+    Sample(1, 100);
+
+    TEST_ASSERT_EQUAL_UINT32(1, bench.Probes[1].Count);
+    TEST_ASSERT_EQUAL_UINT32(100, bench.Probes[1].Min);
+    TEST_ASSERT_EQUAL_UINT32(100, bench.Probes[1].Max);
+}
+
+/* Test case: Minimum, maximum and mean follow the samples */
+void test_Bench_MinMaxMean(void)
+{
+    Sample(2, 40);
+    Sample(2, 10);
+    Sample(2, 70);
+
+    TEST_ASSERT_EQUAL_UINT32(3, bench.Probes[2].Count);
+    TEST_ASSERT_EQUAL_UINT32(10, bench.Probes[2].Min);
+    TEST_ASSERT_EQUAL_UINT32(70, bench.Probes[2].Max);
+    TEST_ASSERT_EQUAL_UINT32(40, Bench_Mean(&bench, 2));
+}
+
+/* Test case: Probes keep separate statistics */
+void test_Bench_ProbesAreIndependent(void)
+{
+    Sample(0, 5);
+    Sample(3, 500);
+
+    TEST_ASSERT_EQUAL_UINT32(5, bench.Probes[0].Max);
+    TEST_ASSERT_EQUAL_UINT32(500, bench.Probes[3].Min);
+    TEST_ASSERT_EQUAL_UINT32(0, bench.Probes[1].Count);
+}
+
+/* Test case: A sample taken across a counter wrap around is right */
+void test_Bench_CounterWrapAround(void)
+{
+    counter = 0xFFFFFFF0UL;
+    Sample(1, 50);
+
+    TEST_ASSERT_EQUAL_UINT32(50, bench.Probes[1].Max);
+}
+
+/* Test case: Samples go to the bin of their number of significant bits, long ones to the last */
+void test_Bench_Histogram(void)
+{
+    Sample(1, 0);
+    Sample(1, 1);
+    Sample(1, 2);
+    Sample(1, 3);
+    Sample(1, 1000);
+    Sample(1, 100000);
+
+    TEST_ASSERT_EQUAL_UINT32(1, bench.Probes[1].Histogram[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, bench.Probes[1].Histogram[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, bench.Probes[1].Histogram[2]);
+    TEST_ASSERT_EQUAL_UINT32(1, bench.Probes[1].Histogram[10]);
+    TEST_ASSERT_EQUAL_UINT32(1, bench.Probes[1].Histogram[BENCH_HISTOGRAM_BINS - 1u]);
+}
+
+/* Test case: Reset clears one probe, out of range probes are refused */
+void test_Bench_Reset(void)
+{
+    Sample(1, 20);
+    Sample(2, 20);
+
+    TEST_ASSERT_EQUAL_UINT8(BENCH_OK, Bench_Reset(&bench, 1));
+    TEST_ASSERT_EQUAL_UINT8(BENCH_ERROR, Bench_Reset(&bench, BENCH_MAX_PROBES));
+    TEST_ASSERT_EQUAL_UINT32(0, bench.Probes[1].Count);
+    TEST_ASSERT_EQUAL_UINT32(0, bench.Probes[1].Histogram[5]);
+    TEST_ASSERT_EQUAL_UINT32(1, bench.Probes[2].Count);
+}
+
+/* Test case: Out of range probes are ignored */
+void test_Bench_OutOfRangeProbeIgnored(void)
+{
+    Sample(BENCH_MAX_PROBES, 20);
+
+    for (uint8_t i = 0; i < BENCH_MAX_PROBES; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(0, bench.Probes[i].Count);
+    }
+}
+
+// Testing the records
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: A record carries the statistics big endian */
+void test_Bench_Serialize(void)
+{
+    uint8_t record[BENCH_RECORD_SIZE];
+
+    Sample(4, 300);
+    Sample(4, 100);
+
+    TEST_ASSERT_EQUAL_UINT8(BENCH_RECORD_SIZE, Bench_Serialize(&bench, 4, record));
+    TEST_ASSERT_EQUAL_UINT8(4, record[0]);
+    TEST_ASSERT_EQUAL_UINT32(16000000u, Get32(&record[1]));
+    TEST_ASSERT_EQUAL_UINT32(2, Get32(&record[5]));
+    TEST_ASSERT_EQUAL_UINT32(100, Get32(&record[9]));
+    TEST_ASSERT_EQUAL_UINT32(300, Get32(&record[13]));
+    TEST_ASSERT_EQUAL_UINT32(200, Get32(&record[17]));
+    TEST_ASSERT_EQUAL_UINT8(0, record[21 + (7 * 2)]);
+    TEST_ASSERT_EQUAL_UINT8(1, record[21 + (7 * 2) + 1]);
+    TEST_ASSERT_EQUAL_UINT8(1, record[21 + (9 * 2) + 1]);
+}
+
+/* Test case: A probe without samples reports a minimum of 0 */
+void test_Bench_SerializeEmptyProbe(void)
+{
+    uint8_t record[BENCH_RECORD_SIZE];
+
+    TEST_ASSERT_EQUAL_UINT8(BENCH_RECORD_SIZE, Bench_Serialize(&bench, 5, record));
+    TEST_ASSERT_EQUAL_UINT32(0, Get32(&record[5]));
+    TEST_ASSERT_EQUAL_UINT32(0, Get32(&record[9]));
+    TEST_ASSERT_EQUAL_UINT32(0, Get32(&record[13]));
+}
+
+/* Test case: Out of range probes give an empty record */
+void test_Bench_SerializeInvalidProbe(void)
+{
+    uint8_t record[BENCH_RECORD_SIZE];
+
+    TEST_ASSERT_EQUAL_UINT8(0, Bench_Serialize(&bench, BENCH_MAX_PROBES, record));
+}
@@ -0,0 +1,142 @@
+#include "unity.h"
+#include "app_bittiming.h"
+
+/* Expected solution for a clock, bit rate and sample point */
+typedef struct
+{
+    uint32_t Clock;
+    uint32_t Bitrate;
+    uint16_t SamplePoint;
+    BitTiming_PhaseTypeDef Phase;
+    uint32_t Prescaler;
+    uint32_t TimeSeg1;
+    uint32_t TimeSeg2;
+    uint32_t SyncJumpWidth;
+    uint16_t Reached;
+} TimingCase;
+
+/* Known good values, every entry checked by hand: bitrate = clock / (prescaler * (1 + seg1 + seg2)) */
+static const TimingCase timingTable[] =
+{
+    /* Nominal phase */
+    {16000000u,   10000u, 875u, BITTIMING_NOMINAL,  8u, 174u, 25u, 25u, 875u},
+    {16000000u,  100000u, 750u, BITTIMING_NOMINAL,  1u, 119u, 40u, 40u, 750u},
+    {16000000u,  125000u, 875u, BITTIMING_NOMINAL,  1u, 111u, 16u, 16u, 875u},
+    {16000000u,  250000u, 875u, BITTIMING_NOMINAL,  1u,  55u,  8u,  8u, 875u},
+    {16000000u,  500000u, 875u, BITTIMING_NOMINAL,  1u,  27u,  4u,  4u, 875u},
+    {16000000u, 1000000u, 750u, BITTIMING_NOMINAL,  1u,  11u,  4u,  4u, 750u},
+    {40000000u,  500000u, 800u, BITTIMING_NOMINAL,  1u,  63u, 16u, 16u, 800u},
+    {40000000u, 1000000u, 800u, BITTIMING_NOMINAL,  1u,  31u,  8u,  8u, 800u},
+    {48000000u,  500000u, 875u, BITTIMING_NOMINAL,  1u,  83u, 12u, 12u, 875u},
+    {64000000u,  500000u, 800u, BITTIMING_NOMINAL,  1u, 101u, 26u, 26u, 796u},
+    {64000000u, 1000000u, 800u, BITTIMING_NOMINAL,  1u,  50u, 13u, 13u, 796u},
+    /* Data phase */
+    {16000000u, 2000000u, 750u, BITTIMING_DATA,     1u,   5u,  2u,  2u, 750u},
+    {16000000u, 4000000u, 750u, BITTIMING_DATA,     1u,   2u,  1u,  1u, 750u},
+    {40000000u, 2000000u, 800u, BITTIMING_DATA,     1u,  15u,  4u,  4u, 800u},
+    {40000000u, 5000000u, 750u, BITTIMING_DATA,     1u,   5u,  2u,  2u, 750u},
+    {64000000u, 2000000u, 800u, BITTIMING_DATA,     1u,  25u,  6u,  6u, 812u},
+    {80000000u, 5000000u, 750u, BITTIMING_DATA,     1u,  11u,  4u,  4u, 750u},
+    {16000000u,  500000u, 800u, BITTIMING_DATA,     1u,  25u,  6u,  6u, 812u},
+};
+
+/* This function is called before every test is run */
+void setUp(void)
+{
+
+}
+
+/* This function is called after every test is run */
+void tearDown(void)
+{
+
+}
+
+// Testing solutions against the known good table
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: Every entry of the table is solved with the expected values */
+void test_BitTiming_KnownGoodTable(void)
+{
+    APP_BitTimingTypeDef timing;
+
+    for (uint32_t i = 0; i < (sizeof(timingTable) / sizeof(timingTable[0])); i++)
+    {
+        const TimingCase *entry = &timingTable[i];
+
+        TEST_ASSERT_EQUAL_UINT8(BITTIMING_OK, BitTiming_Calculate(entry->Clock, entry->Bitrate, entry->SamplePoint, entry->Phase, &timing));
+        TEST_ASSERT_EQUAL_UINT32(entry->Prescaler, timing.Prescaler);
+        TEST_ASSERT_EQUAL_UINT32(entry->TimeSeg1, timing.TimeSeg1);
+        TEST_ASSERT_EQUAL_UINT32(entry->TimeSeg2, timing.TimeSeg2);
+        TEST_ASSERT_EQUAL_UINT32(entry->SyncJumpWidth, timing.SyncJumpWidth);
+        TEST_ASSERT_EQUAL_UINT16(entry->Reached, timing.SamplePoint);
+
+        /* The solution really gives the bit rate */
+        TEST_ASSERT_EQUAL_UINT32(entry->Bitrate, entry->Clock / (timing.Prescaler * (1u + timing.TimeSeg1 + timing.TimeSeg2)));
+    }
+}
+
+/* Test case: Solutions always fit in the FDCAN registers */
+void test_BitTiming_SolutionsWithinRegisterLimits(void)
+{
+    static const uint32_t clocks[] = {8000000u, 16000000u, 24000000u, 32000000u, 40000000u, 48000000u, 64000000u, 80000000u};
+    static const uint32_t rates[] = {10000u, 20000u, 50000u, 100000u, 125000u, 250000u, 500000u, 800000u, 1000000u, 2000000u, 4000000u, 5000000u, 8000000u};
+    APP_BitTimingTypeDef timing;
+
+    for (uint32_t c = 0; c < (sizeof(clocks) / sizeof(clocks[0])); c++)
+    {
+        for (uint32_t r = 0; r < (sizeof(rates) / sizeof(rates[0])); r++)
+        {
+            if (BitTiming_Calculate(clocks[c], rates[r], 875u, BITTIMING_NOMINAL, &timing) == BITTIMING_OK)
+            {
+                TEST_ASSERT_UINT32_WITHIN(511u, 1u, timing.Prescaler);
+                TEST_ASSERT_UINT32_WITHIN(255u, 1u, timing.TimeSeg1);
+                TEST_ASSERT_UINT32_WITHIN(127u, 1u, timing.TimeSeg2);
+                TEST_ASSERT_LESS_OR_EQUAL_UINT32(timing.TimeSeg2, timing.SyncJumpWidth);
+                TEST_ASSERT_EQUAL_UINT32(rates[r], clocks[c] / (timing.Prescaler * (1u + timing.TimeSeg1 + timing.TimeSeg2)));
+            }
+
+            if (BitTiming_Calculate(clocks[c], rates[r], 750u, BITTIMING_DATA, &timing) == BITTIMING_OK)
+            {
+                TEST_ASSERT_UINT32_WITHIN(31u, 1u, timing.Prescaler);
+                TEST_ASSERT_UINT32_WITHIN(31u, 1u, timing.TimeSeg1);
+                TEST_ASSERT_UINT32_WITHIN(15u, 1u, timing.TimeSeg2);
+                TEST_ASSERT_LESS_OR_EQUAL_UINT32(timing.TimeSeg2, timing.SyncJumpWidth);
+                TEST_ASSERT_EQUAL_UINT32(rates[r], clocks[c] / (timing.Prescaler * (1u + timing.TimeSeg1 + timing.TimeSeg2)));
+            }
+        }
+    }
+}
+
+// Testing requests without solution
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: Bit rates that can not be reached exactly are rejected */
+void test_BitTiming_NoExactBitrate(void)
+{
+    APP_BitTimingTypeDef timing;
+
+    TEST_ASSERT_EQUAL_UINT8(BITTIMING_ERROR, BitTiming_Calculate(16000000u, 3000000u, 750u, BITTIMING_DATA, &timing));
+    TEST_ASSERT_EQUAL_UINT8(BITTIMING_ERROR, BitTiming_Calculate(16000000u, 333333u, 875u, BITTIMING_NOMINAL, &timing));
+}
+
+/* Test case: Bit rates out of the reach of the clock or the registers are rejected */
+void test_BitTiming_OutOfRange(void)
+{
+    APP_BitTimingTypeDef timing;
+
+    /* Less than 4 quanta per bit */
+    TEST_ASSERT_EQUAL_UINT8(BITTIMING_ERROR, BitTiming_Calculate(16000000u, 8000000u, 750u, BITTIMING_DATA, &timing));
+    TEST_ASSERT_EQUAL_UINT8(BITTIMING_ERROR, BitTiming_Calculate(1000000u, 2000000u, 750u, BITTIMING_NOMINAL, &timing));
+    /* Data phase prescaler and segments too small for such a slow bit rate */
+    TEST_ASSERT_EQUAL_UINT8(BITTIMING_ERROR, BitTiming_Calculate(64000000u, 10000u, 750u, BITTIMING_DATA, &timing));
+}
+
+/* Test case: Invalid parameters are rejected */
+void test_BitTiming_InvalidParameters(void)
+{
+    APP_BitTimingTypeDef timing;
+
+    TEST_ASSERT_EQUAL_UINT8(BITTIMING_ERROR, BitTiming_Calculate(16000000u, 0u, 750u, BITTIMING_NOMINAL, &timing));
+    TEST_ASSERT_EQUAL_UINT8(BITTIMING_ERROR, BitTiming_Calculate(16000000u, 500000u, 0u, BITTIMING_NOMINAL, &timing));
+    TEST_ASSERT_EQUAL_UINT8(BITTIMING_ERROR, BitTiming_Calculate(16000000u, 500000u, 1000u, BITTIMING_NOMINAL, &timing));
+    TEST_ASSERT_EQUAL_UINT8(BITTIMING_ERROR, BitTiming_Calculate(16000000u, 500000u, 875u, BITTIMING_NOMINAL, NULL));
+}
@@ -0,0 +1,219 @@
+#include "unity.h"
+#include "app_canfilter.h"
+
+#define RANDOM_TABLES 50u
+
+static CanFilter_HandleTypeDef table;
+
+/* State of the pseudo random generator used to make up tables */
+static uint32_t seed;
+
+/* This function is called before every test is run */
+void setUp(void)
+{
+    CanFilter_Init(&table);
+    seed = 0x12345678u;
+}
+
+/* This function is called after every test is run */
+void tearDown(void)
+{
+
+}
+
+/* Small linear congruential generator, deterministic across runs */
+static uint32_t NextRandom(void)
+{
+    seed = (seed * 1664525u) + 1013904223u;
+    return seed >> 8;
+}
+
+/* Check one element built */
+static void CheckElement(const CanFilter_ElementTypeDef *element, uint8_t type, uint8_t fifo, uint32_t id1, uint32_t id2)
+{
+    TEST_ASSERT_EQUAL_UINT8(type, element->Type);
+    TEST_ASSERT_EQUAL_UINT8(fifo, element->Fifo);
+    TEST_ASSERT_EQUAL_HEX32(id1, element->Id1);
+    TEST_ASSERT_EQUAL_HEX32(id2, element->Id2);
+}
+
+/* Where the registrations send an identifier, high priority first: 0 or 1, 2 if rejected */
+static uint8_t Expected(uint8_t idType, uint32_t id)
+{
+    uint8_t fifo = 2;
+    const CanFilter_ElementTypeDef *rule;
+
+    for (uint8_t i = 0; i < table.RuleCount; i++)
+    {
+        rule = &table.Rules[i];
+        if ((rule->IdType == idType) &&
+            (((rule->Type == CAN_FILTER_RANGE) && (id >= rule->Id1) && (id <= rule->Id2)) ||
+             ((rule->Type == CAN_FILTER_MASK) && ((id & rule->Id2) == rule->Id1))) &&
+            ((fifo == 2u) || (rule->Fifo == 1u)))
+        {
+            fifo = rule->Fifo;
+        }
+    }
+
+    return fifo;
+}
+
+// Testing the registrations
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: Out of range identifiers, reversed ranges and unknown priorities are refused */
+void test_CanFilter_InvalidRegistrations(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_ERROR, CanFilter_AddId(&table, CAN_FILTER_STANDARD, 0x800, CAN_FILTER_PRIORITY_NORMAL));
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_ERROR, CanFilter_AddId(&table, CAN_FILTER_EXTENDED, 0x20000000uL, CAN_FILTER_PRIORITY_NORMAL));
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_ERROR, CanFilter_AddRange(&table, CAN_FILTER_STANDARD, 0x200, 0x100, CAN_FILTER_PRIORITY_NORMAL));
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_ERROR, CanFilter_AddId(&table, CAN_FILTER_STANDARD, 0x100, 2));
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_ERROR, CanFilter_AddId(&table, 2, 0x100, CAN_FILTER_PRIORITY_NORMAL));
+    TEST_ASSERT_EQUAL_UINT8(0, table.RuleCount);
+}
+
+/* Test case: Registrations beyond the table size are refused */
+void test_CanFilter_TableFull(void)
+{
+    for (uint8_t i = 0; i < CAN_FILTER_MAX_RULES; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(CANFILTER_OK, CanFilter_AddId(&table, CAN_FILTER_STANDARD, i, CAN_FILTER_PRIORITY_NORMAL));
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_ERROR, CanFilter_AddId(&table, CAN_FILTER_STANDARD, 0x7FF, CAN_FILTER_PRIORITY_NORMAL));
+}
+
+// Testing the elements built
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: Without registrations every frame is rejected */
+void test_CanFilter_EmptyTableRejectsAll(void)
+{
+    uint8_t fifo;
+
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_OK, CanFilter_Build(&table));
+    TEST_ASSERT_EQUAL_UINT8(0, table.StdCount);
+    TEST_ASSERT_EQUAL_UINT8(0, table.ExtCount);
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_ERROR, CanFilter_Match(&table, CAN_FILTER_STANDARD, 0x111, &fifo));
+}
+
+/* Test case: Single identifiers are paired in dual elements */
+void test_CanFilter_SinglesPairedInDuals(void)
+{
+    CanFilter_AddId(&table, CAN_FILTER_STANDARD, 0x300, CAN_FILTER_PRIORITY_NORMAL);
+    CanFilter_AddId(&table, CAN_FILTER_STANDARD, 0x111, CAN_FILTER_PRIORITY_NORMAL);
+    CanFilter_AddId(&table, CAN_FILTER_STANDARD, 0x200, CAN_FILTER_PRIORITY_NORMAL);
+
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_OK, CanFilter_Build(&table));
+    TEST_ASSERT_EQUAL_UINT8(2, table.StdCount);
+    CheckElement(&table.Std[0], CAN_FILTER_DUAL, 0, 0x111, 0x200);
+    CheckElement(&table.Std[1], CAN_FILTER_DUAL, 0, 0x300, 0x300);
+}
+
+/* Test case: Overlapping and adjacent ranges become one range element */
+void test_CanFilter_RangesMerged(void)
+{
+    CanFilter_AddRange(&table, CAN_FILTER_STANDARD, 0x110, 0x11F, CAN_FILTER_PRIORITY_NORMAL);
+    CanFilter_AddId(&table, CAN_FILTER_STANDARD, 0x105, CAN_FILTER_PRIORITY_NORMAL);
+    CanFilter_AddRange(&table, CAN_FILTER_STANDARD, 0x100, 0x10F, CAN_FILTER_PRIORITY_NORMAL);
+    CanFilter_AddId(&table, CAN_FILTER_STANDARD, 0x120, CAN_FILTER_PRIORITY_NORMAL);
+
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_OK, CanFilter_Build(&table));
+    TEST_ASSERT_EQUAL_UINT8(1, table.StdCount);
+    CheckElement(&table.Std[0], CAN_FILTER_RANGE, 0, 0x100, 0x120);
+}
+
+/* Test case: Masks are kept once each with the don't care bits cleared */
+void test_CanFilter_MasksDeduplicated(void)
+{
+    CanFilter_AddMask(&table, CAN_FILTER_STANDARD, 0x12F, 0x7F0, CAN_FILTER_PRIORITY_NORMAL);
+    CanFilter_AddMask(&table, CAN_FILTER_STANDARD, 0x120, 0x7F0, CAN_FILTER_PRIORITY_NORMAL);
+
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_OK, CanFilter_Build(&table));
+    TEST_ASSERT_EQUAL_UINT8(1, table.StdCount);
+    CheckElement(&table.Std[0], CAN_FILTER_MASK, 0, 0x120, 0x7F0);
+}
+
+/* Test case: High priority elements come first and win over normal ones */
+void test_CanFilter_HighPriorityFirst(void)
+{
+    uint8_t fifo = 0xFF;
+
+    CanFilter_AddRange(&table, CAN_FILTER_STANDARD, 0x100, 0x1FF, CAN_FILTER_PRIORITY_NORMAL);
+    CanFilter_AddId(&table, CAN_FILTER_STANDARD, 0x111, CAN_FILTER_PRIORITY_HIGH);
+
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_OK, CanFilter_Build(&table));
+    CheckElement(&table.Std[0], CAN_FILTER_DUAL, 1, 0x111, 0x111);
+    CheckElement(&table.Std[1], CAN_FILTER_RANGE, 0, 0x100, 0x1FF);
+
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_OK, CanFilter_Match(&table, CAN_FILTER_STANDARD, 0x111, &fifo));
+    TEST_ASSERT_EQUAL_UINT8(1, fifo);
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_OK, CanFilter_Match(&table, CAN_FILTER_STANDARD, 0x112, &fifo));
+    TEST_ASSERT_EQUAL_UINT8(0, fifo);
+}
+
+/* Test case: Extended identifiers get their own elements */
+void test_CanFilter_ExtendedSeparate(void)
+{
+    uint8_t fifo;
+
+    CanFilter_AddId(&table, CAN_FILTER_EXTENDED, 0x111, CAN_FILTER_PRIORITY_NORMAL);
+
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_OK, CanFilter_Build(&table));
+    TEST_ASSERT_EQUAL_UINT8(0, table.StdCount);
+    TEST_ASSERT_EQUAL_UINT8(1, table.ExtCount);
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_ERROR, CanFilter_Match(&table, CAN_FILTER_STANDARD, 0x111, &fifo));
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_OK, CanFilter_Match(&table, CAN_FILTER_EXTENDED, 0x111, &fifo));
+}
+
+/* Test case: More elements than the hardware has can not be built */
+void test_CanFilter_TooManyElements(void)
+{
+    for (uint32_t i = 0; i <= CAN_FILTER_MAX_EXT; i++)
+    {
+        CanFilter_AddMask(&table, CAN_FILTER_EXTENDED, i << 8, 0x1FFFFF00uL, CAN_FILTER_PRIORITY_NORMAL);
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(CANFILTER_ERROR, CanFilter_Build(&table));
+    TEST_ASSERT_EQUAL_UINT8(CAN_FILTER_MAX_EXT, table.ExtCount);
+}
+
+/* Test case: Random tables accept exactly the registered identifiers in the right FIFO */
+void test_CanFilter_RandomTables(void)
+{
+    uint32_t first;
+    uint8_t fifo;
+    uint8_t expected;
+
+    for (uint32_t n = 0; n < RANDOM_TABLES; n++)
+    {
+        CanFilter_Init(&table);
+
+        for (uint8_t i = 0; i < CAN_FILTER_MAX_RULES; i++)
+        {
+            first = NextRandom() & 0x7FFu;
+            switch (NextRandom() % 3u)
+            {
+                case 0:
+                    CanFilter_AddId(&table, CAN_FILTER_STANDARD, first, (uint8_t)(NextRandom() & 1u));
+                    break;
+                case 1:
+                    CanFilter_AddRange(&table, CAN_FILTER_STANDARD, first, first + ((0x7FFu - first) & NextRandom() & 0x3Fu),
+                                       (uint8_t)(NextRandom() & 1u));
+                    break;
+                default:
+                    CanFilter_AddMask(&table, CAN_FILTER_STANDARD, first, 0x7F0u | (NextRandom() & 0xFu), (uint8_t)(NextRandom() & 1u));
+                    break;
+            }
+        }
+
+        TEST_ASSERT_EQUAL_UINT8(CANFILTER_OK, CanFilter_Build(&table));
+        TEST_ASSERT_TRUE(table.StdCount <= CAN_FILTER_MAX_RULES);
+
+        for (uint32_t id = 0; id <= 0x7FFu; id++)
+        {
+            expected = Expected(CAN_FILTER_STANDARD, id);
+            fifo = 2;
+            (void)CanFilter_Match(&table, CAN_FILTER_STANDARD, id, &fifo);
+            TEST_ASSERT_EQUAL_UINT8(expected, fifo);
+        }
+    }
+}
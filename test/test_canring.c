@@ -0,0 +1,236 @@
+#include "unity.h"
+#include "app_canring.h"
+
+#define HAMMER_STEPS 200000u
+
+static CanRing_HandleTypeDef ring;
+
+/* State of the pseudo random generator used to interleave ISR and task */
+static uint32_t seed;
+
+/* This function is called before every test is run */
+void setUp(void)
+{
+    CanRing_Init(&ring);
+    seed = 0x12345678u;
+}
+
+/* This function is called after every test is run */
+void tearDown(void)
+{
+
+}
+
+/* Small linear congruential generator, deterministic across runs */
+static uint32_t NextRandom(void)
+{
+    seed = (seed * 1664525u) + 1013904223u;
+    return seed >> 8;
+}
+
+/* Fill a frame whose content can be checked back from its sequence number */
+static void MakeFrame(APP_CanFrameTypeDef *frame, uint32_t sequence)
+{
+    frame->Identifier = 0x111u;
+    frame->Timestamp = sequence;
+    frame->IdType = 0u;
+    frame->Length = (uint8_t)(1u + (sequence % CAN_RING_PAYLOAD_SIZE));
+    frame->Flags = 0u;
+
+    for (uint8_t i = 0; i < CAN_RING_PAYLOAD_SIZE; i++)
+    {
+        frame->Data[i] = (uint8_t)(sequence + i);
+    }
+}
+
+/* Check a frame content against the one generated for the sequence number */
+static void CheckFrame(const APP_CanFrameTypeDef *frame, uint32_t sequence)
+{
+    APP_CanFrameTypeDef expected;
+
+    MakeFrame(&expected, sequence);
+    TEST_ASSERT_EQUAL_UINT32(expected.Timestamp, frame->Timestamp);
+    TEST_ASSERT_EQUAL_UINT8(expected.Length, frame->Length);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.Data, frame->Data, CAN_RING_PAYLOAD_SIZE);
+}
+
+/* Simulated FDCAN interrupt: store the next frame the same way the ISR does */
+static uint8_t SimulatedIsr(uint32_t sequence)
+{
+    uint8_t status = CANRING_ERROR;
+    APP_CanFrameTypeDef *slot = CanRing_Reserve(&ring);
+
+    if (slot != NULL)
+    {
+        MakeFrame(slot, sequence);
+        CanRing_Commit(&ring);
+        status = CANRING_OK;
+    }
+
+    return status;
+}
+
+// Testing basic ring operations
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: A new ring is empty */
+void test_CanRing_EmptyAfterInit(void)
+{
+    APP_CanFrameTypeDef frame;
+
+    TEST_ASSERT_EQUAL_UINT32(0, CanRing_Count(&ring));
+    TEST_ASSERT_NULL(CanRing_Peek(&ring));
+    TEST_ASSERT_EQUAL_UINT8(CANRING_ERROR, CanRing_Pop(&ring, &frame));
+}
+
+/* Test case: Frames come out in the same order and with the same content */
+void test_CanRing_PushPopKeepsOrder(void)
+{
+    APP_CanFrameTypeDef frame;
+
+    for (uint32_t i = 0; i < CAN_RING_DEPTH; i++)
+    {
+        MakeFrame(&frame, i);
+        TEST_ASSERT_EQUAL_UINT8(CANRING_OK, CanRing_Push(&ring, &frame));
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(CAN_RING_DEPTH, CanRing_Count(&ring));
+
+    for (uint32_t i = 0; i < CAN_RING_DEPTH; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(CANRING_OK, CanRing_Pop(&ring, &frame));
+        CheckFrame(&frame, i);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0, CanRing_Count(&ring));
+}
+
+/* Test case: A full ring rejects the newest frame and counts the overflow */
+void test_CanRing_FullRingCountsOverflow(void)
+{
+    APP_CanFrameTypeDef frame;
+
+    for (uint32_t i = 0; i < CAN_RING_DEPTH; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(CANRING_OK, SimulatedIsr(i));
+    }
+
+    TEST_ASSERT_NULL(CanRing_Reserve(&ring));
+    TEST_ASSERT_EQUAL_UINT8(CANRING_ERROR, SimulatedIsr(CAN_RING_DEPTH));
+    TEST_ASSERT_EQUAL_UINT32(2, ring.Overflows);
+    TEST_ASSERT_EQUAL_UINT32(CAN_RING_DEPTH, CanRing_Count(&ring));
+    TEST_ASSERT_EQUAL_UINT32(CAN_RING_DEPTH, ring.HighWater);
+
+    /* The frames already stored are untouched */
+    TEST_ASSERT_EQUAL_UINT8(CANRING_OK, CanRing_Pop(&ring, &frame));
+    CheckFrame(&frame, 0);
+}
+
+/* Test case: Free running indexes wrap around 32 bits without losing frames */
+void test_CanRing_IndexWrapAround(void)
+{
+    APP_CanFrameTypeDef frame;
+
+    ring.Head = 0xFFFFFFFEu;
+    ring.Tail = 0xFFFFFFFEu;
+
+    for (uint32_t i = 0; i < CAN_RING_DEPTH; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(CANRING_OK, SimulatedIsr(i));
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(CAN_RING_DEPTH, CanRing_Count(&ring));
+
+    for (uint32_t i = 0; i < CAN_RING_DEPTH; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(CANRING_OK, CanRing_Pop(&ring, &frame));
+        CheckFrame(&frame, i);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0, CanRing_Count(&ring));
+}
+
+// Testing interleavings between the ISR (producer) and Serial_Task (consumer)
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: The ISR fires while the task holds a peeked slot, the slot is never overwritten */
+void test_CanRing_IsrDuringPeekDoesNotOverwriteSlot(void)
+{
+    const APP_CanFrameTypeDef *slot;
+    uint32_t accepted = 0;
+
+    TEST_ASSERT_EQUAL_UINT8(CANRING_OK, SimulatedIsr(100));
+    slot = CanRing_Peek(&ring);
+    TEST_ASSERT_NOT_NULL(slot);
+
+    /* Interrupt burst bigger than the ring while the task is decoding */
+    for (uint32_t i = 0; i < (2u * CAN_RING_DEPTH); i++)
+    {
+        accepted += (SimulatedIsr(200 + i) == CANRING_OK) ? 1u : 0u;
+    }
+
+    CheckFrame(slot, 100);
+    TEST_ASSERT_EQUAL_UINT32(CAN_RING_DEPTH - 1u, accepted);
+    TEST_ASSERT_EQUAL_UINT32((2u * CAN_RING_DEPTH) - accepted, ring.Overflows);
+
+    CanRing_Release(&ring);
+    TEST_ASSERT_EQUAL_UINT32(CAN_RING_DEPTH - 1u, CanRing_Count(&ring));
+}
+
+/* Test case: Random interleavings of ISR and task steps never lose, duplicate or reorder frames */
+void test_CanRing_HammerRandomInterleavings(void)
+{
+    const APP_CanFrameTypeDef *slot = NULL;
+    APP_CanFrameTypeDef copy;
+    uint32_t produced = 0;  /* Sequence numbers handed to the ISR */
+    uint32_t consumed = 0;  /* Frames read back by the task */
+    uint32_t lost = 0;      /* Frames rejected by the ISR */
+    uint32_t expected = 0;  /* Next sequence number the task must see */
+    uint8_t taskStep = 0;   /* Task is split in peek / copy / release to be preempted */
+    uint8_t rejected[HAMMER_STEPS / 8u + 1u] = {0};
+
+    for (uint32_t step = 0; step < HAMMER_STEPS; step++)
+    {
+        /* Vary the bus load so the ring goes from empty to overflow several times */
+        uint32_t load = ((step / 5000u) % 4u) + 1u;
+
+        if ((NextRandom() % 8u) < (2u * load))
+        {
+            if (SimulatedIsr(produced) != CANRING_OK)
+            {
+                rejected[produced / 8u] |= (uint8_t)(1u << (produced % 8u));
+                lost++;
+            }
+            produced++;
+        }
+        else if (taskStep == 0u)
+        {
+            slot = CanRing_Peek(&ring);
+            taskStep = (slot != NULL) ? 1u : 0u;
+        }
+        else if (taskStep == 1u)
+        {
+            copy = *slot;
+            taskStep = 2u;
+        }
+        else
+        {
+            CanRing_Release(&ring);
+
+            while ((rejected[expected / 8u] & (uint8_t)(1u << (expected % 8u))) != 0u)
+            {
+                expected++; /* Skip the frames the ISR could not store */
+            }
+
+            CheckFrame(&copy, expected);
+            expected++;
+            consumed++;
+            taskStep = 0u;
+        }
+
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(CAN_RING_DEPTH, CanRing_Count(&ring));
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(lost, ring.Overflows);
+    TEST_ASSERT_EQUAL_UINT32(produced, consumed + lost + CanRing_Count(&ring));
+    TEST_ASSERT_GREATER_THAN_UINT32(0, lost);
+    TEST_ASSERT_EQUAL_UINT32(CAN_RING_DEPTH, ring.HighWater);
+}
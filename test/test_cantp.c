@@ -0,0 +1,554 @@
+#include "unity.h"
+#include "app_cantp.h"
+#include <string.h>
+
+#define MAX_CAPTURED_FRAMES 600u
+
+static CanTp_HandleTypeDef node;   /* Engine under test */
+static CanTp_HandleTypeDef peer;   /* Second engine used for end to end transfers */
+
+/* Frames sent by the engine under test */
+static uint8_t sentFrames[MAX_CAPTURED_FRAMES][CANTP_FD_FRAME_SIZE];
+static uint8_t sentLengths[MAX_CAPTURED_FRAMES];
+static uint32_t sentCount;
+static uint8_t failTx;             /* Simulate a full hardware TX FIFO */
+
+/* Frames sent by the peer engine */
+static uint8_t peerFrames[MAX_CAPTURED_FRAMES][CANTP_FD_FRAME_SIZE];
+static uint8_t peerLengths[MAX_CAPTURED_FRAMES];
+static uint32_t peerCount;
+
+static uint8_t NodeTxFrame(const uint8_t *data, uint8_t length)
+{
+    uint8_t status = CANTP_ERROR;
+
+    if ((failTx == 0u) && (sentCount < MAX_CAPTURED_FRAMES))
+    {
+        sentLengths[sentCount] = length;
+        memcpy(sentFrames[sentCount++], data, length);
+        status = CANTP_OK;
+    }
+
+    return status;
+}
+
+static uint8_t PeerTxFrame(const uint8_t *data, uint8_t length)
+{
+    peerLengths[peerCount] = length;
+    memcpy(peerFrames[peerCount++], data, length);
+    return CANTP_OK;
+}
+
+/* Fill a test message with a known pattern */
+static void FillPattern(uint8_t *buffer, uint16_t size)
+{
+    for (uint16_t i = 0; i < size; i++)
+    {
+        buffer[i] = (uint8_t)((i * 7u) + 3u);
+    }
+}
+
+/* This function is called before every test is run */
+void setUp(void)
+{
+    memset(&node, 0, sizeof(node));
+    memset(&peer, 0, sizeof(peer));
+    node.TxFrame = NodeTxFrame;
+    peer.TxFrame = PeerTxFrame;
+    CanTp_Init(&node);
+    CanTp_Init(&peer);
+    sentCount = 0;
+    peerCount = 0;
+    failTx = 0;
+}
+
+/* This function is called after every test is run */
+void tearDown(void)
+{
+
+}
+
+// Testing single frames
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: A single frame is delivered as a complete message */
+void test_CanTp_RxSingleFrame(void)
+{
+    uint8_t frame[8] = {0x04, 0x01, 0x12, 0x30, 0x45, 0x00, 0x00, 0x00};
+    const uint8_t *message;
+    uint16_t size = 0;
+
+    TEST_ASSERT_EQUAL_UINT8(CANTP_OK, CanTp_RxIndication(&node, frame, 8, 0));
+    message = CanTp_GetRxMessage(&node, &size);
+
+    TEST_ASSERT_NOT_NULL(message);
+    TEST_ASSERT_EQUAL_UINT16(4, size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&frame[1], message, 4);
+
+    CanTp_ReleaseRxMessage(&node);
+    TEST_ASSERT_NULL(CanTp_GetRxMessage(&node, &size));
+}
+
+/* Test case: A single frame message is read in place, a segmented one from the buffer */
+void test_CanTp_RxSingleFrameNotCopied(void)
+{
+    uint8_t single[8] = {0x02, 0x0A, 0x0B, 0x00, 0x00, 0x00, 0x00, 0x00};
+    uint8_t first[8] = {0x10, 0x08, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+    uint8_t consecutive[8] = {0x21, 0x07, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00};
+    uint16_t size = 0;
+
+    CanTp_RxIndication(&node, single, 8, 0);
+    TEST_ASSERT_EQUAL_PTR(&single[1], CanTp_GetRxMessage(&node, &size));
+    CanTp_ReleaseRxMessage(&node);
+
+    CanTp_RxIndication(&node, first, 8, 0);
+    CanTp_Task(&node, 0);
+    CanTp_RxIndication(&node, consecutive, 8, 1);
+    TEST_ASSERT_EQUAL_PTR(node.RxBuffer, CanTp_GetRxMessage(&node, &size));
+    TEST_ASSERT_EQUAL_UINT16(8, size);
+}
+
+/* Test case: Single frames with an invalid length are rejected */
+void test_CanTp_RxSingleFrameInvalidLength(void)
+{
+    uint8_t empty[8] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    uint8_t tooLong[8] = {0x08, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    uint8_t badPci[8] = {0x40, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    uint16_t size;
+
+    TEST_ASSERT_EQUAL_UINT8(CANTP_ERROR, CanTp_RxIndication(&node, empty, 8, 0));
+    TEST_ASSERT_EQUAL_UINT8(CANTP_ERROR, CanTp_RxIndication(&node, tooLong, 8, 0));
+    TEST_ASSERT_EQUAL_UINT8(CANTP_ERROR, CanTp_RxIndication(&node, badPci, 8, 0));
+    TEST_ASSERT_NULL(CanTp_GetRxMessage(&node, &size));
+}
+
+/* Test case: Short messages are sent in one padded single frame */
+void test_CanTp_TxSingleFrame(void)
+{
+    uint8_t message[2] = {0x55, 0xAA};
+
+    TEST_ASSERT_EQUAL_UINT8(CANTP_OK, CanTp_Transmit(&node, message, 2, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, sentCount);
+    TEST_ASSERT_EQUAL_HEX8(0x02, sentFrames[0][0]);
+    TEST_ASSERT_EQUAL_HEX8(0x55, sentFrames[0][1]);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, sentFrames[0][2]);
+    TEST_ASSERT_EQUAL_HEX8(CANTP_PADDING_BYTE, sentFrames[0][7]);
+    TEST_ASSERT_EQUAL_INT(CANTP_TX_IDLE_STATE, node.TxState);
+    TEST_ASSERT_EQUAL_INT(CANTP_RESULT_OK, node.TxResult);
+}
+
+// Testing CAN FD frames
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: Messages longer than 7 bytes use the escaped length and the shortest FD frame */
+void test_CanTp_TxFdSingleFrame(void)
+{
+    uint8_t message[20];
+
+    FillPattern(message, sizeof(message));
+    node.FrameSize = CANTP_FD_FRAME_SIZE;
+    CanTp_Init(&node);
+
+    TEST_ASSERT_EQUAL_UINT8(CANTP_OK, CanTp_Transmit(&node, message, sizeof(message), 0));
+    TEST_ASSERT_EQUAL_UINT32(1, sentCount);
+    TEST_ASSERT_EQUAL_UINT8(24, sentLengths[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, sentFrames[0][0]);
+    TEST_ASSERT_EQUAL_HEX8(20, sentFrames[0][1]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(message, &sentFrames[0][2], sizeof(message));
+    TEST_ASSERT_EQUAL_HEX8(CANTP_PADDING_BYTE, sentFrames[0][23]);
+
+    /* Short messages keep the classic layout */
+    TEST_ASSERT_EQUAL_UINT8(CANTP_OK, CanTp_Transmit(&node, message, 3, 0));
+    TEST_ASSERT_EQUAL_UINT8(CANTP_FRAME_SIZE, sentLengths[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x03, sentFrames[1][0]);
+}
+
+/* Test case: A 64 bytes single frame with escaped length is received */
+void test_CanTp_RxFdSingleFrame(void)
+{
+    uint8_t frame[CANTP_FD_FRAME_SIZE];
+    const uint8_t *message;
+    uint16_t size = 0;
+
+    frame[0] = 0x00;
+    frame[1] = 62;
+    FillPattern(&frame[2], 62);
+
+    TEST_ASSERT_EQUAL_UINT8(CANTP_OK, CanTp_RxIndication(&node, frame, CANTP_FD_FRAME_SIZE, 0));
+    message = CanTp_GetRxMessage(&node, &size);
+
+    TEST_ASSERT_NOT_NULL(message);
+    TEST_ASSERT_EQUAL_UINT16(62, size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&frame[2], message, 62);
+    CanTp_ReleaseRxMessage(&node);
+
+    /* Escaped length bigger than the frame */
+    frame[1] = 63;
+    TEST_ASSERT_EQUAL_UINT8(CANTP_ERROR, CanTp_RxIndication(&node, frame, CANTP_FD_FRAME_SIZE, 0));
+}
+
+/* Test case: Invalid frame sizes fall back to classic frames, the rest round up to a DLC length */
+void test_CanTp_FdFrameSizeIsNormalized(void)
+{
+    node.FrameSize = 100;
+    CanTp_Init(&node);
+    TEST_ASSERT_EQUAL_UINT8(CANTP_FRAME_SIZE, node.FrameSize);
+
+    node.FrameSize = 40;
+    CanTp_Init(&node);
+    TEST_ASSERT_EQUAL_UINT8(48, node.FrameSize);
+}
+
+// Testing segmented reception
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: First frame is answered with a flow control and consecutive frames rebuild the message */
+void test_CanTp_RxSegmentedMessage(void)
+{
+    uint8_t message[20];
+    uint8_t frame[8];
+    const uint8_t *received;
+    uint16_t size = 0;
+
+    FillPattern(message, sizeof(message));
+    node.BlockSize = 0;
+    node.STmin = 5;
+
+    frame[0] = 0x10;
+    frame[1] = 20;
+    memcpy(&frame[2], &message[0], 6);
+    TEST_ASSERT_EQUAL_UINT8(CANTP_OK, CanTp_RxIndication(&node, frame, 8, 0));
+
+    /* Flow control: continue to send, block size 0, STmin 5 ms */
+    TEST_ASSERT_EQUAL_UINT32(1, sentCount);
+    TEST_ASSERT_EQUAL_HEX8(0x30, sentFrames[0][0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, sentFrames[0][1]);
+    TEST_ASSERT_EQUAL_HEX8(0x05, sentFrames[0][2]);
+
+    frame[0] = 0x21;
+    memcpy(&frame[1], &message[6], 7);
+    CanTp_RxIndication(&node, frame, 8, 5);
+    TEST_ASSERT_NULL(CanTp_GetRxMessage(&node, &size));
+
+    frame[0] = 0x22;
+    memcpy(&frame[1], &message[13], 7);
+    CanTp_RxIndication(&node, frame, 8, 10);
+
+    received = CanTp_GetRxMessage(&node, &size);
+    TEST_ASSERT_NOT_NULL(received);
+    TEST_ASSERT_EQUAL_UINT16(20, size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(message, received, 20);
+}
+
+/* Test case: A new flow control is sent after every block */
+void test_CanTp_RxBlockSizeSendsFlowControl(void)
+{
+    uint8_t frame[8] = {0x10, 100, 0, 0, 0, 0, 0, 0};
+
+    node.BlockSize = 2;
+    CanTp_RxIndication(&node, frame, 8, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, sentCount);
+
+    frame[0] = 0x21;
+    CanTp_RxIndication(&node, frame, 8, 1);
+    TEST_ASSERT_EQUAL_UINT32(1, sentCount);
+
+    frame[0] = 0x22;
+    CanTp_RxIndication(&node, frame, 8, 2);
+    TEST_ASSERT_EQUAL_UINT32(2, sentCount);
+    TEST_ASSERT_EQUAL_HEX8(0x30, sentFrames[1][0]);
+    TEST_ASSERT_EQUAL_HEX8(0x02, sentFrames[1][1]);
+}
+
+/* Test case: A wrong sequence number aborts the reception */
+void test_CanTp_RxWrongSequenceNumber(void)
+{
+    uint8_t frame[8] = {0x10, 20, 0, 0, 0, 0, 0, 0};
+    uint16_t size;
+
+    CanTp_RxIndication(&node, frame, 8, 0);
+    frame[0] = 0x22;
+    CanTp_RxIndication(&node, frame, 8, 1);
+
+    TEST_ASSERT_EQUAL_INT(CANTP_RESULT_WRONG_SN, node.RxResult);
+    TEST_ASSERT_EQUAL_INT(CANTP_RX_IDLE_STATE, node.RxState);
+    TEST_ASSERT_NULL(CanTp_GetRxMessage(&node, &size));
+}
+
+/* Test case: Reception is aborted when consecutive frames stop (N_Cr) */
+void test_CanTp_RxConsecutiveFrameTimeout(void)
+{
+    uint8_t frame[8] = {0x10, 20, 0, 0, 0, 0, 0, 0};
+
+    CanTp_RxIndication(&node, frame, 8, 0);
+    CanTp_Task(&node, CANTP_N_CR_TIMEOUT - 1u);
+    TEST_ASSERT_EQUAL_INT(CANTP_RX_WAIT_CF_STATE, node.RxState);
+
+    CanTp_Task(&node, CANTP_N_CR_TIMEOUT);
+    TEST_ASSERT_EQUAL_INT(CANTP_RESULT_TIMEOUT_CR, node.RxResult);
+    TEST_ASSERT_EQUAL_INT(CANTP_RX_IDLE_STATE, node.RxState);
+}
+
+/* Test case: Messages bigger than the buffer are refused with an overflow flow control */
+void test_CanTp_RxMessageTooLong(void)
+{
+    uint8_t frame[8] = {0x1F, 0xFF, 0, 0, 0, 0, 0, 0};
+
+    CanTp_RxIndication(&node, frame, 8, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(1, sentCount);
+    TEST_ASSERT_EQUAL_HEX8(0x32, sentFrames[0][0]);
+    TEST_ASSERT_EQUAL_INT(CANTP_RESULT_BUFFER_OVFLW, node.RxResult);
+}
+
+// Testing segmented transmission
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: After the first frame the sender waits for the flow control, then sends everything */
+void test_CanTp_TxSegmentedFullSpeed(void)
+{
+    uint8_t message[100];
+    uint8_t flowControl[3] = {0x30, 0x00, 0x00};
+
+    FillPattern(message, sizeof(message));
+    CanTp_Transmit(&node, message, sizeof(message), 0);
+
+    TEST_ASSERT_EQUAL_UINT32(1, sentCount);
+    TEST_ASSERT_EQUAL_HEX8(0x10, sentFrames[0][0]);
+    TEST_ASSERT_EQUAL_HEX8(100, sentFrames[0][1]);
+    TEST_ASSERT_EQUAL_INT(CANTP_TX_WAIT_FC_STATE, node.TxState);
+
+    /* Nothing moves without the flow control */
+    CanTp_Task(&node, 1);
+    TEST_ASSERT_EQUAL_UINT32(1, sentCount);
+
+    CanTp_RxIndication(&node, flowControl, 3, 2);
+    CanTp_Task(&node, 2);
+
+    /* (100 - 6) / 7 rounded up = 14 consecutive frames in the same call */
+    TEST_ASSERT_EQUAL_UINT32(15, sentCount);
+    TEST_ASSERT_EQUAL_HEX8(0x21, sentFrames[1][0]);
+    TEST_ASSERT_EQUAL_HEX8(0x2E, sentFrames[14][0]);
+    TEST_ASSERT_EQUAL_INT(CANTP_RESULT_OK, node.TxResult);
+    TEST_ASSERT_EQUAL_INT(CANTP_TX_IDLE_STATE, node.TxState);
+}
+
+/* Test case: The sender stops at the end of each block and honours STmin */
+void test_CanTp_TxBlockSizeAndSTmin(void)
+{
+    uint8_t message[50];
+    uint8_t flowControl[3] = {0x30, 0x02, 0x0A};
+
+    FillPattern(message, sizeof(message));
+    CanTp_Transmit(&node, message, sizeof(message), 0);
+    CanTp_RxIndication(&node, flowControl, 3, 0);
+
+    CanTp_Task(&node, 0);
+    TEST_ASSERT_EQUAL_UINT32(2, sentCount);
+
+    CanTp_Task(&node, 10);
+    TEST_ASSERT_EQUAL_UINT32(2, sentCount);
+
+    CanTp_Task(&node, 11);
+    TEST_ASSERT_EQUAL_UINT32(3, sentCount);
+    TEST_ASSERT_EQUAL_INT(CANTP_TX_WAIT_FC_STATE, node.TxState);
+
+    CanTp_Task(&node, 100);
+    TEST_ASSERT_EQUAL_UINT32(3, sentCount);
+}
+
+/* Test case: Exactly STmin ticks later is not enough, the frames could be less than STmin apart */
+void test_CanTp_TxSTminWaitsOneMoreTick(void)
+{
+    uint8_t message[50];
+    uint8_t flowControl[3] = {0x30, 0x00, 0x01};
+
+    FillPattern(message, sizeof(message));
+    CanTp_Transmit(&node, message, sizeof(message), 0);
+    CanTp_RxIndication(&node, flowControl, 3, 0);
+
+    CanTp_Task(&node, 0);
+    TEST_ASSERT_EQUAL_UINT32(2, sentCount);
+
+    CanTp_Task(&node, 1);
+    TEST_ASSERT_EQUAL_UINT32(2, sentCount);
+
+    CanTp_Task(&node, 2);
+    TEST_ASSERT_EQUAL_UINT32(3, sentCount);
+}
+
+/* Test case: No flow control after the first frame (N_Bs) */
+void test_CanTp_TxFlowControlTimeout(void)
+{
+    uint8_t message[20] = {0};
+
+    CanTp_Transmit(&node, message, sizeof(message), 0);
+    CanTp_Task(&node, CANTP_N_BS_TIMEOUT);
+
+    TEST_ASSERT_EQUAL_INT(CANTP_RESULT_TIMEOUT_BS, node.TxResult);
+    TEST_ASSERT_EQUAL_INT(CANTP_TX_IDLE_STATE, node.TxState);
+}
+
+/* Test case: Frames never accepted by the hardware (N_As) */
+void test_CanTp_TxHardwareTimeout(void)
+{
+    uint8_t message[20] = {0};
+
+    failTx = 1;
+    TEST_ASSERT_EQUAL_UINT8(CANTP_OK, CanTp_Transmit(&node, message, sizeof(message), 0));
+    TEST_ASSERT_EQUAL_UINT8(CANTP_BUSY, CanTp_Transmit(&node, message, sizeof(message), 0));
+
+    CanTp_Task(&node, CANTP_N_AS_TIMEOUT - 1u);
+    TEST_ASSERT_EQUAL_INT(CANTP_TX_SEND_FIRST_STATE, node.TxState);
+
+    CanTp_Task(&node, CANTP_N_AS_TIMEOUT);
+    TEST_ASSERT_EQUAL_INT(CANTP_RESULT_TIMEOUT_A, node.TxResult);
+    TEST_ASSERT_EQUAL_INT(CANTP_TX_IDLE_STATE, node.TxState);
+}
+
+/* Test case: WAIT flow control restarts N_Bs, too many of them abort the transfer */
+void test_CanTp_TxWaitFlowControl(void)
+{
+    uint8_t message[20] = {0};
+    uint8_t waitFrame[3] = {0x31, 0x00, 0x00};
+    uint32_t now = 0;
+
+    CanTp_Transmit(&node, message, sizeof(message), now);
+
+    for (uint8_t i = 0; i < CANTP_MAX_WFT; i++)
+    {
+        now += CANTP_N_BS_TIMEOUT - 1u;
+        CanTp_RxIndication(&node, waitFrame, 3, now);
+        CanTp_Task(&node, now);
+        TEST_ASSERT_EQUAL_INT(CANTP_TX_WAIT_FC_STATE, node.TxState);
+    }
+
+    CanTp_RxIndication(&node, waitFrame, 3, now);
+    TEST_ASSERT_EQUAL_INT(CANTP_RESULT_WFT_OVRN, node.TxResult);
+    TEST_ASSERT_EQUAL_INT(CANTP_TX_IDLE_STATE, node.TxState);
+}
+
+// Testing CanTp_NextDeadline() function
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: An idle engine has no deadline */
+void test_CanTp_NextDeadlineIdle(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(CANTP_NO_DEADLINE, CanTp_NextDeadline(&node, 0));
+}
+
+/* Test case: The receiver deadline follows N_Cr and reaches 0 when it expires */
+void test_CanTp_NextDeadlineConsecutiveFrame(void)
+{
+    uint8_t frame[8] = {0x10, 20, 0, 0, 0, 0, 0, 0};
+
+    CanTp_RxIndication(&node, frame, 8, 100);
+
+    TEST_ASSERT_EQUAL_UINT32(CANTP_N_CR_TIMEOUT - 10u, CanTp_NextDeadline(&node, 110));
+    TEST_ASSERT_EQUAL_UINT32(0, CanTp_NextDeadline(&node, 100u + CANTP_N_CR_TIMEOUT));
+}
+
+/* Test case: The sender deadline follows N_Bs, then STmin between consecutive frames */
+void test_CanTp_NextDeadlineSender(void)
+{
+    uint8_t message[50];
+    uint8_t flowControl[3] = {0x30, 0x00, 0x0A};
+
+    FillPattern(message, sizeof(message));
+    CanTp_Transmit(&node, message, sizeof(message), 0);
+    TEST_ASSERT_EQUAL_UINT32(CANTP_N_BS_TIMEOUT - 5u, CanTp_NextDeadline(&node, 5));
+
+    CanTp_RxIndication(&node, flowControl, 3, 5);
+    CanTp_Task(&node, 5);
+    TEST_ASSERT_EQUAL_UINT32(2, sentCount);
+    TEST_ASSERT_EQUAL_UINT32(7, CanTp_NextDeadline(&node, 9));
+
+    CanTp_Task(&node, 16);
+    TEST_ASSERT_EQUAL_UINT32(3, sentCount);
+    TEST_ASSERT_EQUAL_UINT32(11, CanTp_NextDeadline(&node, 16));
+}
+
+/* Test case: A refused frame leaves only N_As, the retry comes from the caller */
+void test_CanTp_NextDeadlineHardwareBusy(void)
+{
+    uint8_t message[20] = {0};
+
+    failTx = 1;
+    CanTp_Transmit(&node, message, sizeof(message), 0);
+
+    TEST_ASSERT_EQUAL_UINT32(CANTP_N_AS_TIMEOUT - 1u, CanTp_NextDeadline(&node, 1));
+}
+
+// Testing end to end transfers between two engines
+/*-----------------------------------------------------------------------------------------------*/
+/* Deliver the frames sent by each engine to the other one until the peer gets the message */
+static const uint8_t *RunTransfer(uint16_t *size, uint8_t backPressure)
+{
+    const uint8_t *received = NULL;
+    uint32_t nodeRead = 0;
+    uint32_t peerRead = 0;
+
+    for (uint32_t now = 0; (now < 10000u) && (received == NULL); now++)
+    {
+        /* Hardware FIFO of the node is full every other millisecond */
+        failTx = (backPressure != 0u) ? (uint8_t)(now & 1u) : 0u;
+
+        while (nodeRead < sentCount)
+        {
+            CanTp_RxIndication(&peer, sentFrames[nodeRead], sentLengths[nodeRead], now);
+            nodeRead++;
+        }
+        while (peerRead < peerCount)
+        {
+            CanTp_RxIndication(&node, peerFrames[peerRead], peerLengths[peerRead], now);
+            peerRead++;
+        }
+
+        CanTp_Task(&node, now);
+        CanTp_Task(&peer, now);
+        received = CanTp_GetRxMessage(&peer, size);
+    }
+
+    return received;
+}
+
+/* Test case: A full buffer travels between two engines with blocks and hardware back pressure */
+void test_CanTp_EndToEndFullBuffer(void)
+{
+    static uint8_t message[CANTP_BUFFER_SIZE];
+    const uint8_t *received;
+    uint16_t size = 0;
+
+    FillPattern(message, sizeof(message));
+    peer.BlockSize = 3;
+    peer.STmin = 0;
+
+    TEST_ASSERT_EQUAL_UINT8(CANTP_OK, CanTp_Transmit(&node, message, sizeof(message), 0));
+    received = RunTransfer(&size, 1);
+
+    TEST_ASSERT_NOT_NULL(received);
+    TEST_ASSERT_EQUAL_UINT16(CANTP_BUFFER_SIZE, size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(message, received, CANTP_BUFFER_SIZE);
+    TEST_ASSERT_EQUAL_INT(CANTP_RESULT_OK, node.TxResult);
+}
+
+/* Test case: A full buffer travels in 64 bytes CAN FD frames */
+void test_CanTp_EndToEndFdFullBuffer(void)
+{
+    static uint8_t message[CANTP_BUFFER_SIZE];
+    const uint8_t *received;
+    uint16_t size = 0;
+
+    FillPattern(message, sizeof(message));
+    node.FrameSize = CANTP_FD_FRAME_SIZE;
+    peer.FrameSize = CANTP_FD_FRAME_SIZE;
+    CanTp_Init(&node);
+    CanTp_Init(&peer);
+
+    TEST_ASSERT_EQUAL_UINT8(CANTP_OK, CanTp_Transmit(&node, message, sizeof(message), 0));
+    received = RunTransfer(&size, 0);
+
+    TEST_ASSERT_NOT_NULL(received);
+    TEST_ASSERT_EQUAL_UINT16(CANTP_BUFFER_SIZE, size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(message, received, CANTP_BUFFER_SIZE);
+
+    /* First frame carries 62 bytes, then (512 - 62) / 63 rounded up = 8 consecutive frames */
+    TEST_ASSERT_EQUAL_UINT32(9, sentCount);
+    TEST_ASSERT_EQUAL_UINT8(CANTP_FD_FRAME_SIZE, sentLengths[0]);
+    TEST_ASSERT_EQUAL_UINT8(CANTP_FRAME_SIZE, peerLengths[0]);
+}
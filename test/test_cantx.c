@@ -0,0 +1,185 @@
+#include "unity.h"
+#include "app_cantx.h"
+
+#define RANDOM_STEPS 20000u
+
+static CanTx_HandleTypeDef queue;
+
+/* State of the pseudo random generator used to mix pushes and releases */
+static uint32_t seed;
+
+/* This function is called before every test is run */
+void setUp(void)
+{
+    CanTx_Init(&queue);
+    seed = 0x12345678u;
+}
+
+/* This function is called after every test is run */
+void tearDown(void)
+{
+
+}
+
+/* Small linear congruential generator, deterministic across runs */
+static uint32_t NextRandom(void)
+{
+    seed = (seed * 1664525u) + 1013904223u;
+    return seed >> 8;
+}
+
+/* Queue a frame, the sequence number goes in the first data byte */
+static uint8_t Push(uint32_t identifier, uint8_t idType, uint8_t sequence)
+{
+    APP_CanFrameTypeDef frame = {0};
+
+    frame.Identifier = identifier;
+    frame.IdType = idType;
+    frame.Length = 1;
+    frame.Data[0] = sequence;
+
+    return CanTx_Push(&queue, &frame);
+}
+
+/* Take the next frame out and check it */
+static void Expect(uint32_t identifier, uint8_t sequence)
+{
+    const APP_CanFrameTypeDef *frame = CanTx_Peek(&queue);
+
+    TEST_ASSERT_NOT_NULL(frame);
+    TEST_ASSERT_EQUAL_HEX32(identifier, frame->Identifier);
+    TEST_ASSERT_EQUAL_UINT8(sequence, frame->Data[0]);
+    CanTx_Release(&queue);
+}
+
+// Testing the ordering
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: An empty queue has nothing to send */
+void test_CanTx_EmptyQueue(void)
+{
+    TEST_ASSERT_NULL(CanTx_Peek(&queue));
+    TEST_ASSERT_EQUAL_UINT32(0, CanTx_Depth(&queue));
+
+    CanTx_Release(&queue);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.Stats.Sent);
+}
+
+/* Test case: Frames come out lowest identifier first */
+void test_CanTx_LowestIdentifierFirst(void)
+{
+    Push(0x132, 0, 1);
+    Push(0x122, 0, 2);
+    Push(0x130, 0, 3);
+    Push(0x005, 0, 4);
+
+    Expect(0x005, 4);
+    Expect(0x122, 2);
+    Expect(0x130, 3);
+    Expect(0x132, 1);
+    TEST_ASSERT_NULL(CanTx_Peek(&queue));
+}
+
+/* Test case: Frames with the same identifier keep their order */
+void test_CanTx_SameIdentifierKeepsOrder(void)
+{
+    Push(0x122, 0, 1);
+    Push(0x130, 0, 2);
+    Push(0x122, 0, 3);
+    Push(0x122, 0, 4);
+
+    Expect(0x122, 1);
+    Expect(0x122, 3);
+    Expect(0x122, 4);
+    Expect(0x130, 2);
+}
+
+/* Test case: A standard frame wins against an extended one with the same base identifier */
+void test_CanTx_StandardBeforeExtended(void)
+{
+    Push((0x122uL << 18) | 0x00001u, 1, 1);
+    Push(0x122, 0, 2);
+    Push(0x123, 0, 3);
+
+    Expect(0x122, 2);
+    Expect((0x122uL << 18) | 0x00001u, 1);
+    Expect(0x123, 3);
+}
+
+/* Test case: A frame stays queued until released */
+void test_CanTx_PeekDoesNotRemove(void)
+{
+    Push(0x122, 0, 1);
+
+    TEST_ASSERT_EQUAL_PTR(CanTx_Peek(&queue), CanTx_Peek(&queue));
+    TEST_ASSERT_EQUAL_UINT32(1, CanTx_Depth(&queue));
+}
+
+// Testing the statistics
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: A full queue drops the new frame and keeps the others */
+void test_CanTx_FullQueueDrops(void)
+{
+    for (uint8_t i = 0; i < CAN_TX_QUEUE_SIZE; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(CANTX_OK, Push(0x200 + i, 0, i));
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(CANTX_ERROR, Push(0x001, 0, 0xFF));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.Stats.Dropped);
+    TEST_ASSERT_EQUAL_UINT32(CAN_TX_QUEUE_SIZE, queue.Stats.Queued);
+    Expect(0x200, 0);
+}
+
+/* Test case: The depth statistics follow the queue */
+void test_CanTx_DepthStatistics(void)
+{
+    Push(0x122, 0, 1);
+    Push(0x122, 0, 2);
+    Push(0x122, 0, 3);
+    CanTx_Release(&queue);
+    CanTx_Release(&queue);
+    Push(0x122, 0, 4);
+
+    TEST_ASSERT_EQUAL_UINT32(2, CanTx_Depth(&queue));
+    TEST_ASSERT_EQUAL_UINT32(3, queue.Stats.MaxDepth);
+    TEST_ASSERT_EQUAL_UINT32(4, queue.Stats.Queued);
+    TEST_ASSERT_EQUAL_UINT32(2, queue.Stats.Sent);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.Stats.Dropped);
+}
+
+/* Test case: Random pushes and releases always give the lowest identifier, oldest first */
+void test_CanTx_RandomTraffic(void)
+{
+    uint8_t sequence[4] = {0};   /* Next sequence number per identifier */
+    uint8_t expected[4] = {0};   /* Next sequence number expected per identifier */
+    const APP_CanFrameTypeDef *frame;
+    uint32_t id;
+
+    for (uint32_t step = 0; step < RANDOM_STEPS; step++)
+    {
+        if ((NextRandom() % 3u) != 0u)
+        {
+            id = NextRandom() % 4u;
+            if (Push(0x100 + id, 0, sequence[id]) == CANTX_OK)
+            {
+                sequence[id]++;
+            }
+        }
+        else if ((frame = CanTx_Peek(&queue)) != NULL)
+        {
+            id = frame->Identifier - 0x100u;
+
+            /* No lower identifier may be waiting behind it */
+            for (uint32_t lower = 0; lower < id; lower++)
+            {
+                TEST_ASSERT_EQUAL_UINT8(sequence[lower], expected[lower]);
+            }
+
+            TEST_ASSERT_EQUAL_UINT8(expected[id], frame->Data[0]);
+            expected[id]++;
+            CanTx_Release(&queue);
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(queue.Stats.Queued - queue.Stats.Sent, CanTx_Depth(&queue));
+}
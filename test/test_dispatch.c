@@ -0,0 +1,184 @@
+#include "unity.h"
+#include "app_dispatch.h"
+#include <stddef.h>
+
+#define TYPE_SET     1u
+#define TYPE_ECHO    2u
+#define TYPE_RAW     3u
+
+static Dispatch_HandleTypeDef dispatcher;
+
+/* Message decoded by the test entries */
+typedef struct
+{
+    uint8_t Value;
+    uint8_t Decoded;
+} Message;
+
+static Message message;
+static uint8_t response[8];
+static uint16_t responseSize;
+static uint32_t handled;
+static uint8_t lastValue;
+
+static void Decode(const uint8_t *data, uint16_t size, void *msg)
+{
+    (void)size;
+    ((Message *)msg)->Value = data[1];
+    ((Message *)msg)->Decoded = 1;
+}
+
+/* Values up to 9 are valid */
+static uint8_t Validate(const void *msg)
+{
+    return (((const Message *)msg)->Value <= 9u) ? DISPATCH_OK : DISPATCH_ERROR;
+}
+
+/* Records the value, just an acknowledge */
+static uint16_t HandleSet(const void *msg, uint8_t *resp)
+{
+    (void)resp;
+    handled++;
+    lastValue = ((const Message *)msg)->Value;
+    return 0;
+}
+
+/* Answers with the value twice */
+static uint16_t HandleEcho(const void *msg, uint8_t *resp)
+{
+    handled++;
+    resp[0] = ((const Message *)msg)->Value;
+    resp[1] = ((const Message *)msg)->Value;
+    return 2;
+}
+
+/* Gets the payload itself, answers with its second byte */
+static uint16_t HandleRaw(const void *msg, uint8_t *resp)
+{
+    handled++;
+    resp[0] = ((const uint8_t *)msg)[1];
+    return 1;
+}
+
+static const Dispatch_EntryTypeDef table[] =
+{
+    {TYPE_SET, 2u, Decode, Validate, HandleSet},
+    {TYPE_ECHO, 2u, Decode, NULL, HandleEcho},
+    {TYPE_RAW, 2u, NULL, NULL, HandleRaw},
+};
+
+/* This function is called before every test is run */
+void setUp(void)
+{
+    Dispatch_Init(&dispatcher);
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_OK, Dispatch_Register(&dispatcher, table, sizeof(table) / sizeof(table[0])));
+    message.Value = 0xFF;
+    message.Decoded = 0;
+    responseSize = 0xFFFF;
+    handled = 0;
+    lastValue = 0xFF;
+}
+
+/* This function is called after every test is run */
+void tearDown(void)
+{
+
+}
+
+/* Test case: A valid request is decoded, handled and acknowledged */
+void test_Dispatch_ValidRequestHandled(void)
+{
+    const uint8_t request[] = {TYPE_SET, 7};
+
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_OK, Dispatch_Process(&dispatcher, request, sizeof(request), &message, response, &responseSize));
+    TEST_ASSERT_EQUAL_UINT32(1, handled);
+    TEST_ASSERT_EQUAL_UINT8(7, lastValue);
+    TEST_ASSERT_EQUAL_UINT16(0, responseSize);
+    TEST_ASSERT_EQUAL_UINT32(1, dispatcher.Stats.Handled);
+}
+
+/* Test case: A request refused by its validator never reaches the handler */
+void test_Dispatch_InvalidRequestRefused(void)
+{
+    const uint8_t request[] = {TYPE_SET, 10};
+
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_ERROR, Dispatch_Process(&dispatcher, request, sizeof(request), &message, response, &responseSize));
+    TEST_ASSERT_EQUAL_UINT32(0, handled);
+    TEST_ASSERT_EQUAL_UINT16(0, responseSize);
+    TEST_ASSERT_EQUAL_UINT32(1, dispatcher.Stats.Invalid);
+}
+
+/* Test case: Requests shorter than their type needs are not decoded */
+void test_Dispatch_ShortRequestRefused(void)
+{
+    const uint8_t request[] = {TYPE_SET};
+
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_ERROR, Dispatch_Process(&dispatcher, request, sizeof(request), &message, response, &responseSize));
+    TEST_ASSERT_EQUAL_UINT8(0, message.Decoded);
+    TEST_ASSERT_EQUAL_UINT32(1, dispatcher.Stats.Short);
+}
+
+/* Test case: Types without entry, out of range or empty requests are unknown */
+void test_Dispatch_UnknownTypes(void)
+{
+    const uint8_t unregistered[] = {0, 1};
+    const uint8_t outOfRange[] = {DISPATCH_MAX_TYPES, 1};
+
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_ERROR, Dispatch_Process(&dispatcher, unregistered, sizeof(unregistered), &message, response, &responseSize));
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_ERROR, Dispatch_Process(&dispatcher, outOfRange, sizeof(outOfRange), &message, response, &responseSize));
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_ERROR, Dispatch_Process(&dispatcher, unregistered, 0, &message, response, &responseSize));
+    TEST_ASSERT_EQUAL_UINT32(3, dispatcher.Stats.Unknown);
+    TEST_ASSERT_EQUAL_UINT32(0, handled);
+}
+
+/* Test case: A handler can give its own response, without validator every message is valid */
+void test_Dispatch_HandlerResponse(void)
+{
+    const uint8_t request[] = {TYPE_ECHO, 42};
+
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_OK, Dispatch_Process(&dispatcher, request, sizeof(request), &message, response, &responseSize));
+    TEST_ASSERT_EQUAL_UINT16(2, responseSize);
+    TEST_ASSERT_EQUAL_UINT8(42, response[0]);
+    TEST_ASSERT_EQUAL_UINT8(42, response[1]);
+}
+
+/* Test case: Without decoder the steps get the payload */
+void test_Dispatch_NoDecoderGivesPayload(void)
+{
+    const uint8_t request[] = {TYPE_RAW, 0x5A};
+
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_OK, Dispatch_Process(&dispatcher, request, sizeof(request), &message, response, &responseSize));
+    TEST_ASSERT_EQUAL_UINT8(0, message.Decoded);
+    TEST_ASSERT_EQUAL_UINT16(1, responseSize);
+    TEST_ASSERT_EQUAL_UINT8(0x5A, response[0]);
+}
+
+/* Test case: Entries out of range or without handler are refused, the others registered */
+void test_Dispatch_RegisterRefusesBadEntries(void)
+{
+    static const Dispatch_EntryTypeDef bad[] =
+    {
+        {DISPATCH_MAX_TYPES, 1u, NULL, NULL, HandleRaw},
+        {4u, 1u, NULL, NULL, NULL},
+        {5u, 2u, NULL, NULL, HandleRaw},
+    };
+    const uint8_t request4[] = {4, 1};
+    const uint8_t request5[] = {5, 1};
+
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_ERROR, Dispatch_Register(&dispatcher, bad, sizeof(bad) / sizeof(bad[0])));
+    TEST_ASSERT_NULL(dispatcher.Entries[4]);
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_ERROR, Dispatch_Process(&dispatcher, request4, sizeof(request4), &message, response, &responseSize));
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_OK, Dispatch_Process(&dispatcher, request5, sizeof(request5), &message, response, &responseSize));
+}
+
+/* Test case: Registering a type again replaces its entry */
+void test_Dispatch_RegisterReplaces(void)
+{
+    static const Dispatch_EntryTypeDef echo[] = {{TYPE_SET, 2u, Decode, NULL, HandleEcho}};
+    const uint8_t request[] = {TYPE_SET, 12};
+
+    Dispatch_Register(&dispatcher, echo, 1);
+
+    TEST_ASSERT_EQUAL_UINT8(DISPATCH_OK, Dispatch_Process(&dispatcher, request, sizeof(request), &message, response, &responseSize));
+    TEST_ASSERT_EQUAL_UINT16(2, responseSize);
+}
@@ -0,0 +1,148 @@
+#include "unity.h"
+#include "app_queue.h"
+
+#define DEPTH 3u
+
+/* Message of the test queue, not a multiple of a word to check the copies */
+typedef struct
+{
+    uint16_t Value;
+    uint8_t Type;
+} Message;
+
+static Queue_HandleTypeDef queue;
+static Message storage[DEPTH];
+
+static Message MakeMessage(uint16_t value)
+{
+    Message message;
+
+    message.Value = value;
+    message.Type = (uint8_t)(value & 0x0Fu);
+
+    return message;
+}
+
+/* This function is called before every test is run */
+void setUp(void)
+{
+    Queue_Init(&queue, storage, sizeof(storage[0]), DEPTH);
+}
+
+/* This function is called after every test is run */
+void tearDown(void)
+{
+
+}
+
+/* Test case: An empty queue has nothing to read */
+void test_Queue_EmptyAfterInit(void)
+{
+    Message message;
+
+    TEST_ASSERT_EQUAL_UINT32(0, Queue_Count(&queue));
+    TEST_ASSERT_EQUAL_UINT32(DEPTH, Queue_Space(&queue));
+    TEST_ASSERT_NULL(Queue_Peek(&queue));
+    TEST_ASSERT_EQUAL_UINT8(QUEUE_ERROR, Queue_Get(&queue, &message));
+}
+
+/* Test case: The messages of several producers come out whole and in posting order */
+void test_Queue_FifoOrder(void)
+{
+    Message first = MakeMessage(0x1231);
+    Message second = MakeMessage(0x4562);
+    Message message;
+
+    TEST_ASSERT_EQUAL_UINT8(QUEUE_OK, Queue_Post(&queue, &first));
+    TEST_ASSERT_EQUAL_UINT8(QUEUE_OK, Queue_Post(&queue, &second));
+    TEST_ASSERT_EQUAL_UINT32(2, Queue_Count(&queue));
+
+    TEST_ASSERT_EQUAL_UINT8(QUEUE_OK, Queue_Get(&queue, &message));
+    TEST_ASSERT_EQUAL_UINT16(0x1231, message.Value);
+    TEST_ASSERT_EQUAL_UINT8(1, message.Type);
+    TEST_ASSERT_EQUAL_UINT8(QUEUE_OK, Queue_Get(&queue, &message));
+    TEST_ASSERT_EQUAL_UINT16(0x4562, message.Value);
+    TEST_ASSERT_EQUAL_UINT8(2, message.Type);
+}
+
+/* Test case: A full queue drops the newest message and counts it */
+void test_Queue_FullDropsNewest(void)
+{
+    Message message;
+
+    for (uint16_t i = 0; i < (DEPTH + 2u); i++)
+    {
+        message = MakeMessage(i);
+        Queue_Post(&queue, &message);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(DEPTH, Queue_Count(&queue));
+    TEST_ASSERT_EQUAL_UINT32(0, Queue_Space(&queue));
+    TEST_ASSERT_EQUAL_UINT32(DEPTH, queue.Posted);
+    TEST_ASSERT_EQUAL_UINT32(2, queue.Drops);
+
+    Queue_Get(&queue, &message);
+    TEST_ASSERT_EQUAL_UINT16(0, message.Value);
+}
+
+/* Test case: A peeked message is read in place and stays until released */
+void test_Queue_PeekRelease(void)
+{
+    Message posted = MakeMessage(7);
+    const Message *message;
+
+    Queue_Post(&queue, &posted);
+    message = Queue_Peek(&queue);
+
+    TEST_ASSERT_EQUAL_PTR(&storage[0], message);
+    TEST_ASSERT_EQUAL_UINT16(7, message->Value);
+    TEST_ASSERT_EQUAL_PTR(message, Queue_Peek(&queue));
+
+    Queue_Release(&queue);
+    TEST_ASSERT_NULL(Queue_Peek(&queue));
+
+    /* Releasing an empty queue does nothing */
+    Queue_Release(&queue);
+    TEST_ASSERT_EQUAL_UINT32(0, Queue_Count(&queue));
+}
+
+/* Test case: The high water mark keeps the deepest level reached */
+void test_Queue_HighWater(void)
+{
+    Message message = MakeMessage(1);
+
+    Queue_Post(&queue, &message);
+    Queue_Post(&queue, &message);
+    Queue_Get(&queue, &message);
+    Queue_Post(&queue, &message);
+    Queue_Get(&queue, &message);
+    Queue_Get(&queue, &message);
+
+    TEST_ASSERT_EQUAL_UINT32(2, queue.HighWater);
+    TEST_ASSERT_EQUAL_UINT32(0, Queue_Count(&queue));
+}
+
+/* Test case: The indexes wrap around a depth that is not a power of two */
+void test_Queue_WrapAround(void)
+{
+    Message message;
+    uint16_t next = 0;
+
+    for (uint16_t i = 0; i < 100u; i++)
+    {
+        message = MakeMessage(i);
+        TEST_ASSERT_EQUAL_UINT8(QUEUE_OK, Queue_Post(&queue, &message));
+
+        if ((i % 2u) == 1u)
+        {
+            while (Queue_Get(&queue, &message) == QUEUE_OK)
+            {
+                TEST_ASSERT_EQUAL_UINT16(next, message.Value);
+                next++;
+            }
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT16(100, next);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.Drops);
+}
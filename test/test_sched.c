@@ -0,0 +1,260 @@
+#include "unity.h"
+#include "app_sched.h"
+
+#define MAX_RECORDS 64u
+
+#define EVENT_RX    0u
+#define EVENT_MSG   1u
+
+static Sched_HandleTypeDef sched;
+
+/* Simulated SysTick, it only moves while the core sleeps or when a task takes time */
+static uint32_t tick;
+
+/* Simulated interrupt: sets EVENT_RX while sleeping at the given tick */
+static uint32_t isrTick;
+static uint8_t isrArmed;
+
+/* Execution records */
+static uint32_t runTicks[MAX_RECORDS];
+static uint32_t runCount;
+static char order[MAX_RECORDS];
+static uint32_t orderCount;
+static uint32_t taskCost;           /* Ticks consumed by the periodic task */
+static uint8_t rearm;               /* Events the message task still has to set on itself */
+
+static uint32_t GetTick(void)
+{
+    return tick;
+}
+
+/* Sleep until the next interrupt: the SysTick one, or the simulated ISR if it fires first */
+static void Idle(void)
+{
+    tick++;
+
+    if ((isrArmed != 0u) && (tick >= isrTick))
+    {
+        isrArmed = 0;
+        Sched_SetEvent(&sched, EVENT_RX);
+    }
+}
+
+static void PeriodicTask(void)
+{
+    if (runCount < MAX_RECORDS)
+    {
+        runTicks[runCount++] = tick;
+    }
+    tick += taskCost;
+}
+
+static void RxTask(void)
+{
+    if (runCount < MAX_RECORDS)
+    {
+        runTicks[runCount++] = tick;
+    }
+    order[orderCount++] = 'R';
+}
+
+static void MsgTask(void)
+{
+    order[orderCount++] = 'M';
+
+    if (rearm > 0u)
+    {
+        rearm--;
+        Sched_SetEvent(&sched, EVENT_MSG); /* Work left, run again right away */
+    }
+}
+
+/* Run the scheduler until the simulated tick reaches the limit */
+static void RunUntil(uint32_t limit)
+{
+    while (tick < limit)
+    {
+        (void)Sched_RunOnce(&sched);
+    }
+}
+
+/* This function is called before every test is run */
+void setUp(void)
+{
+    tick = 0;
+    isrArmed = 0;
+    runCount = 0;
+    orderCount = 0;
+    taskCost = 0;
+    rearm = 0;
+    Sched_Init(&sched, GetTick, Idle);
+}
+
+/* This function is called after every test is run */
+void tearDown(void)
+{
+
+}
+
+// Testing task registration
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: Tasks that can never run and tasks beyond the table size are rejected */
+void test_Sched_AddTaskRejectsInvalidTasks(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERROR, Sched_AddTask(&sched, NULL, 10, 0));
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERROR, Sched_AddTask(&sched, RxTask, 0, 0));
+
+    for (uint32_t i = 0; i < SCHED_MAX_TASKS; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(SCHED_OK, Sched_AddTask(&sched, RxTask, 10, 0));
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERROR, Sched_AddTask(&sched, RxTask, 10, 0));
+}
+
+// Testing periodic activation
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: A periodic task runs exactly once per period and the core sleeps in between */
+void test_Sched_PeriodicTaskRunsOnEveryPeriod(void)
+{
+    Sched_AddTask(&sched, PeriodicTask, 10, 0);
+    RunUntil(105);
+
+    TEST_ASSERT_EQUAL_UINT32(10, runCount);
+    for (uint32_t i = 0; i < runCount; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32((i + 1u) * 10u, runTicks[i]);
+    }
+
+    /* Every tick without work is spent in the idle hook */
+    TEST_ASSERT_EQUAL_UINT32(105, sched.IdleCount);
+}
+
+/* Test case: The time spent by the task does not move the next activations */
+void test_Sched_PeriodicTaskDoesNotDrift(void)
+{
+    taskCost = 3;
+    Sched_AddTask(&sched, PeriodicTask, 10, 0);
+    RunUntil(105);
+
+    TEST_ASSERT_EQUAL_UINT32(10, runCount);
+    TEST_ASSERT_EQUAL_UINT32(50, runTicks[4]);
+    TEST_ASSERT_EQUAL_UINT32(100, runTicks[9]);
+}
+
+/* Test case: After a long stall the missed periods are skipped, not run in a burst */
+void test_Sched_PeriodicTaskSkipsMissedPeriods(void)
+{
+    Sched_AddTask(&sched, PeriodicTask, 10, 0);
+
+    tick = 35; /* Something kept the CPU for three and a half periods */
+    RunUntil(60);
+
+    TEST_ASSERT_EQUAL_UINT32(3, runCount);
+    TEST_ASSERT_EQUAL_UINT32(35, runTicks[0]);
+    TEST_ASSERT_EQUAL_UINT32(45, runTicks[1]);
+    TEST_ASSERT_EQUAL_UINT32(55, runTicks[2]);
+}
+
+/* Test case: A period of 0 stops the periodic runs, a new period starts from now */
+void test_Sched_SetPeriodStopsAndResumes(void)
+{
+    Sched_AddTask(&sched, PeriodicTask, 10, 0);
+    RunUntil(25);
+    TEST_ASSERT_EQUAL_UINT32(2, runCount);
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_OK, Sched_SetPeriod(&sched, PeriodicTask, 0));
+    RunUntil(100);
+    TEST_ASSERT_EQUAL_UINT32(2, runCount);
+
+    TEST_ASSERT_EQUAL_UINT8(SCHED_OK, Sched_SetPeriod(&sched, PeriodicTask, 5));
+    RunUntil(112);
+    TEST_ASSERT_EQUAL_UINT32(4, runCount);
+    TEST_ASSERT_EQUAL_UINT32(105, runTicks[2]);
+    TEST_ASSERT_EQUAL_UINT32(110, runTicks[3]);
+}
+
+/* Test case: Only registered tasks can change their period */
+void test_Sched_SetPeriodUnknownTask(void)
+{
+    Sched_AddTask(&sched, PeriodicTask, 10, 0);
+    TEST_ASSERT_EQUAL_UINT8(SCHED_ERROR, Sched_SetPeriod(&sched, RxTask, 10));
+}
+
+// Testing event activation
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: An event set from an interrupt runs the task in the same tick it woke up */
+void test_Sched_EventFromIsrRunsTaskWithoutDelay(void)
+{
+    Sched_AddTask(&sched, RxTask, 0, SCHED_EVENT_MASK(EVENT_RX));
+    isrTick = 37;
+    isrArmed = 1;
+
+    RunUntil(100);
+
+    TEST_ASSERT_EQUAL_UINT32(1, runCount);
+    TEST_ASSERT_EQUAL_UINT32(37, runTicks[0]);
+}
+
+/* Test case: Event tasks do not run without their event */
+void test_Sched_EventTaskIdleWithoutEvent(void)
+{
+    Sched_AddTask(&sched, RxTask, 0, SCHED_EVENT_MASK(EVENT_RX));
+    Sched_SetEvent(&sched, EVENT_MSG);
+
+    TEST_ASSERT_EQUAL_UINT8(1, Sched_EventPending(&sched));
+    TEST_ASSERT_EQUAL_UINT32(0, Sched_RunOnce(&sched));
+    TEST_ASSERT_EQUAL_UINT8(0, Sched_EventPending(&sched));
+    RunUntil(50);
+
+    TEST_ASSERT_EQUAL_UINT32(0, runCount);
+}
+
+/* Test case: Several settings of the same event before the task runs are served by one run */
+void test_Sched_EventsAreCoalesced(void)
+{
+    Sched_AddTask(&sched, RxTask, 0, SCHED_EVENT_MASK(EVENT_RX));
+    Sched_SetEvent(&sched, EVENT_RX);
+    Sched_SetEvent(&sched, EVENT_RX);
+
+    TEST_ASSERT_EQUAL_UINT32(1, Sched_RunOnce(&sched));
+    TEST_ASSERT_EQUAL_UINT32(0, Sched_RunOnce(&sched));
+    TEST_ASSERT_EQUAL_UINT32(1, runCount);
+}
+
+/* Test case: A task setting its own event runs again on the next pass, without sleeping */
+void test_Sched_TaskRearmsItself(void)
+{
+    Sched_AddTask(&sched, MsgTask, 0, SCHED_EVENT_MASK(EVENT_MSG));
+    rearm = 3;
+    Sched_SetEvent(&sched, EVENT_MSG);
+
+    for (uint32_t i = 0; i < 4u; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(1, Sched_RunOnce(&sched));
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0, tick);
+    TEST_ASSERT_EQUAL_UINT32(0, sched.IdleCount);
+    TEST_ASSERT_EQUAL_UINT32(4, orderCount);
+}
+
+/* Test case: Tasks ready in the same pass run in registration (priority) order */
+void test_Sched_TasksRunInPriorityOrder(void)
+{
+    Sched_AddTask(&sched, MsgTask, 0, SCHED_EVENT_MASK(EVENT_MSG));
+    Sched_AddTask(&sched, RxTask, 0, SCHED_EVENT_MASK(EVENT_RX));
+    Sched_SetEvent(&sched, EVENT_RX);
+    Sched_SetEvent(&sched, EVENT_MSG);
+
+    TEST_ASSERT_EQUAL_UINT32(2, Sched_RunOnce(&sched));
+    TEST_ASSERT_EQUAL_INT('M', order[0]);
+    TEST_ASSERT_EQUAL_INT('R', order[1]);
+}
+
+/* Test case: Out of range events are ignored */
+void test_Sched_InvalidEventIgnored(void)
+{
+    Sched_SetEvent(&sched, SCHED_MAX_EVENTS);
+    TEST_ASSERT_EQUAL_UINT8(0, Sched_EventPending(&sched));
+}
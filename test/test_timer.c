@@ -0,0 +1,241 @@
+#include "unity.h"
+#include "app_timer.h"
+
+#define MAX_RECORDS 32u
+
+static Timer_HandleTypeDef service;
+static Timer_TypeDef timerA;
+static Timer_TypeDef timerB;
+static Timer_TypeDef timerC;
+
+/* Expiry records */
+static uint32_t now;
+static char order[MAX_RECORDS];
+static uint32_t firedTicks[MAX_RECORDS];
+static uint32_t fired;
+static uint32_t rearms;             /* Calls of the rearm hook */
+
+static void Record(void *context)
+{
+    if (fired < MAX_RECORDS)
+    {
+        order[fired] = *(const char *)context;
+        firedTicks[fired] = now;
+    }
+    fired++;
+}
+
+/* Stops timer B from the callback of timer A */
+static void StopOther(void *context)
+{
+    Record(context);
+    Timer_Stop(&service, &timerB);
+}
+
+/* Restarts its own timer with no delay */
+static void RestartSelf(void *context)
+{
+    Record(context);
+    Timer_Start(&service, &timerA, now, 0, 0);
+}
+
+static void Rearm(void)
+{
+    rearms++;
+}
+
+static const char nameA = 'A';
+static const char nameB = 'B';
+static const char nameC = 'C';
+
+/* Advance the simulated tick one by one, processing the timers on every tick */
+static void RunUntil(uint32_t limit)
+{
+    while (now < limit)
+    {
+        now++;
+        (void)Timer_Process(&service, now);
+    }
+}
+
+/* This function is called before every test is run */
+void setUp(void)
+{
+    now = 0;
+    fired = 0;
+    rearms = 0;
+    Timer_Init(&service, NULL);
+    Timer_Create(&timerA, Record, (void *)&nameA);
+    Timer_Create(&timerB, Record, (void *)&nameB);
+    Timer_Create(&timerC, Record, (void *)&nameC);
+}
+
+/* This function is called after every test is run */
+void tearDown(void)
+{
+
+}
+
+// Testing one-shot timers
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: A one-shot timer fires once at its delay and stops */
+void test_Timer_OneShotFiresOnce(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(TIMER_OK, Timer_Start(&service, &timerA, now, 25, 0));
+    TEST_ASSERT_EQUAL_UINT8(1, Timer_IsActive(&timerA));
+
+    RunUntil(100);
+
+    TEST_ASSERT_EQUAL_UINT32(1, fired);
+    TEST_ASSERT_EQUAL_UINT32(25, firedTicks[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, Timer_IsActive(&timerA));
+}
+
+/* Test case: Timers fire in expiry order, whatever the order they were started */
+void test_Timer_FireInExpiryOrder(void)
+{
+    Timer_Start(&service, &timerA, now, 30, 0);
+    Timer_Start(&service, &timerB, now, 10, 0);
+    Timer_Start(&service, &timerC, now, 20, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(3, Timer_Process(&service, 50));
+    TEST_ASSERT_EQUAL_INT('B', order[0]);
+    TEST_ASSERT_EQUAL_INT('C', order[1]);
+    TEST_ASSERT_EQUAL_INT('A', order[2]);
+}
+
+/* Test case: The rearm hook is only called when the first expiry moves */
+void test_Timer_RearmOnFirstExpiry(void)
+{
+    Timer_Init(&service, Rearm);
+
+    Timer_Start(&service, &timerA, now, 30, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, rearms);
+
+    Timer_Start(&service, &timerB, now, 50, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, rearms);
+
+    Timer_Start(&service, &timerC, now, 10, 0);
+    TEST_ASSERT_EQUAL_UINT32(2, rearms);
+    TEST_ASSERT_EQUAL_UINT32(10, Timer_NextExpiry(&service, now));
+}
+
+/* Test case: Timers with the same expiry fire in the order they were started */
+void test_Timer_SameExpiryKeepsStartOrder(void)
+{
+    Timer_Start(&service, &timerC, now, 10, 0);
+    Timer_Start(&service, &timerA, now, 10, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(2, Timer_Process(&service, 10));
+    TEST_ASSERT_EQUAL_INT('C', order[0]);
+    TEST_ASSERT_EQUAL_INT('A', order[1]);
+}
+
+/* Test case: Restarting a running timer moves its expiry */
+void test_Timer_RestartMovesExpiry(void)
+{
+    Timer_Start(&service, &timerA, now, 10, 0);
+    RunUntil(5);
+    Timer_Start(&service, &timerA, now, 10, 0);
+
+    RunUntil(50);
+
+    TEST_ASSERT_EQUAL_UINT32(1, fired);
+    TEST_ASSERT_EQUAL_UINT32(15, firedTicks[0]);
+}
+
+/* Test case: A stopped timer does not fire, stopping it again does nothing */
+void test_Timer_StopPreventsExpiry(void)
+{
+    Timer_Start(&service, &timerA, now, 10, 0);
+    Timer_Start(&service, &timerB, now, 20, 0);
+    Timer_Stop(&service, &timerA);
+    Timer_Stop(&service, &timerA);
+
+    RunUntil(50);
+
+    TEST_ASSERT_EQUAL_UINT32(1, fired);
+    TEST_ASSERT_EQUAL_INT('B', order[0]);
+}
+
+/* Test case: Timers without callback are rejected */
+void test_Timer_StartWithoutCallbackFails(void)
+{
+    Timer_Create(&timerA, NULL, NULL);
+
+    TEST_ASSERT_EQUAL_UINT8(TIMER_ERROR, Timer_Start(&service, &timerA, now, 10, 0));
+    TEST_ASSERT_EQUAL_UINT32(TIMER_NO_EXPIRY, Timer_NextExpiry(&service, now));
+}
+
+// Testing periodic timers
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: A periodic timer fires on every period */
+void test_Timer_PeriodicFiresEveryPeriod(void)
+{
+    Timer_Start(&service, &timerA, now, 100, 100);
+
+    RunUntil(1000);
+
+    TEST_ASSERT_EQUAL_UINT32(10, fired);
+    for (uint32_t i = 0; i < fired; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32((i + 1u) * 100u, firedTicks[i]);
+    }
+}
+
+/* Test case: Late processing does not drift the next expiries, missed ones are skipped */
+void test_Timer_PeriodicDoesNotDrift(void)
+{
+    Timer_Start(&service, &timerA, now, 100, 100);
+
+    now = 130;
+    TEST_ASSERT_EQUAL_UINT32(1, Timer_Process(&service, now)); /* 30 ticks late */
+    TEST_ASSERT_EQUAL_UINT32(70, Timer_NextExpiry(&service, now));
+
+    now = 450;
+    TEST_ASSERT_EQUAL_UINT32(1, Timer_Process(&service, now)); /* 200, 300 and 400 missed, one run */
+    TEST_ASSERT_EQUAL_UINT32(2, service.Skipped);
+    TEST_ASSERT_EQUAL_UINT32(50, Timer_NextExpiry(&service, now));
+}
+
+/* Test case: The callback of a timer can stop a timer expiring in the same call */
+void test_Timer_CallbackStopsAnotherTimer(void)
+{
+    Timer_Create(&timerA, StopOther, (void *)&nameA);
+    Timer_Start(&service, &timerA, now, 10, 0);
+    Timer_Start(&service, &timerB, now, 10, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(1, Timer_Process(&service, 10));
+    TEST_ASSERT_EQUAL_INT('A', order[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, Timer_IsActive(&timerB));
+}
+
+/* Test case: A timer restarted from its callback without delay waits for the next tick */
+void test_Timer_CallbackRestartsItself(void)
+{
+    Timer_Create(&timerA, RestartSelf, (void *)&nameA);
+    Timer_Start(&service, &timerA, now, 10, 0);
+
+    RunUntil(13);
+
+    TEST_ASSERT_EQUAL_UINT32(4, fired);
+    TEST_ASSERT_EQUAL_UINT32(10, firedTicks[0]);
+    TEST_ASSERT_EQUAL_UINT32(13, firedTicks[3]);
+}
+
+// Testing the tick wrap around
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: Expiries beyond the tick wrap around keep their order */
+void test_Timer_WrapAround(void)
+{
+    now = 0xFFFFFFF0UL;
+    Timer_Start(&service, &timerA, now, 0x20, 0);   /* Expires at 0x10, after the wrap */
+    Timer_Start(&service, &timerB, now, 0x08, 0);   /* Expires at 0xFFFFFFF8 */
+
+    TEST_ASSERT_EQUAL_UINT32(8, Timer_NextExpiry(&service, now));
+    TEST_ASSERT_EQUAL_UINT32(1, Timer_Process(&service, 0xFFFFFFFFUL));
+    TEST_ASSERT_EQUAL_UINT32(0, Timer_Process(&service, 0x0FUL));
+    TEST_ASSERT_EQUAL_UINT32(1, Timer_Process(&service, 0x10UL));
+    TEST_ASSERT_EQUAL_INT('B', order[0]);
+    TEST_ASSERT_EQUAL_INT('A', order[1]);
+}
@@ -45,4 +45,38 @@ void test_Validate_Time_SecondsNotValid(void)
     uint8_t result = Validate_Time(12, 30, 60);
     /* Assert that if seconds = 60 (out of range), the result should be 0 (invalid) */
     TEST_ASSERT_EQUAL_UINT8(0, result);
-}
\ No newline at end of file
+}
+
+// Testing Validate_Date() function
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: All values (day, month, and year) are valid */
+void test_Validate_Date_AllValuesValid(void)
+{
+    uint8_t result = Validate_Date(29, 2, 20, 24);
+    /* Assert that Feb 29th 2024 (leap year) is valid */
+    TEST_ASSERT_EQUAL_UINT8(1, result);
+}
+
+/* Test case: Month value is not valid, with a valid year */
+void test_Validate_Date_MonthNotValid(void)
+{
+    /* Assert that months 0 and 13 are rejected before the days of the month are looked up */
+    TEST_ASSERT_EQUAL_UINT8(0, Validate_Date(1, 0, 20, 23));
+    TEST_ASSERT_EQUAL_UINT8(0, Validate_Date(1, 13, 20, 23));
+}
+
+/* Test case: Year value is not valid, with a valid month */
+void test_Validate_Date_YearNotValid(void)
+{
+    /* Assert that the years 1900 and 2150 (out of the 1901 to 2099 range) are rejected */
+    TEST_ASSERT_EQUAL_UINT8(0, Validate_Date(1, 6, 19, 0));
+    TEST_ASSERT_EQUAL_UINT8(0, Validate_Date(1, 6, 21, 50));
+}
+
+/* Test case: Day value is not valid for its month */
+void test_Validate_Date_DayNotValid(void)
+{
+    /* Assert that Feb 29th 2023 (not a leap year) and day 0 are rejected */
+    TEST_ASSERT_EQUAL_UINT8(0, Validate_Date(29, 2, 20, 23));
+    TEST_ASSERT_EQUAL_UINT8(0, Validate_Date(0, 1, 20, 23));
+}
@@ -0,0 +1,141 @@
+#include "unity.h"
+#include "app_serial.h"
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_ITERATIONS 20000u
+
+/* This function is called before every test is run */
+void setUp(void)
+{
+
+}
+
+/* This function is called after every test is run */
+void tearDown(void)
+{
+
+}
+
+/* Host reference: ask the C library for the day of the week */
+static uint8_t ReferenceWeekDay(uint8_t day, uint8_t month, uint16_t year)
+{
+    struct tm date = {0};
+
+    date.tm_mday = day;
+    date.tm_mon = month - 1;
+    date.tm_year = year - 1900;
+    date.tm_hour = 12;      /* Away from midnight so DST changes do not move the day */
+    date.tm_isdst = -1;
+    (void)mktime(&date);
+
+    return (uint8_t)date.tm_wday;
+}
+
+/* Previous implementation, kept only to benchmark against the closed form */
+static uint8_t LegacyWeekDay(uint8_t day, uint8_t month, uint16_t year)
+{
+    uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int leap_year = ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
+    volatile uint32_t totalDays = 0;
+
+    if (leap_year)
+    {
+        daysInMonth[1] = 29;
+    }
+
+    for (uint16_t y = 0; y < year; y++)
+    {
+        totalDays += leap_year ? 366 : 365;
+    }
+
+    for (uint8_t m = 1; m < month; m++)
+    {
+        totalDays += daysInMonth[m - 1];
+    }
+
+    totalDays += day - 1;
+
+    return (uint8_t)(totalDays % 7);
+}
+
+// Testing WeekDay() function
+/*-----------------------------------------------------------------------------------------------*/
+/* Test case: Known dates */
+void test_WeekDay_KnownDates(void)
+{
+    /* Assert that Jan 1st 1901 was Tuesday (2) */
+    TEST_ASSERT_EQUAL_UINT8(2, WeekDay(1, 1, 1901));
+    /* Assert that Feb 29th 2000 was Tuesday (2) */
+    TEST_ASSERT_EQUAL_UINT8(2, WeekDay(29, 2, 2000));
+    /* Assert that Aug 16th 2023 was Wednesday (3) */
+    TEST_ASSERT_EQUAL_UINT8(3, WeekDay(16, 8, 2023));
+    /* Assert that Dec 31st 2099 is Thursday (4) */
+    TEST_ASSERT_EQUAL_UINT8(4, WeekDay(31, 12, 2099));
+    /* Assert that Aug 20th 2023 was Sunday (0), the date handler turns it into RTC_WEEKDAY_SUNDAY */
+    TEST_ASSERT_EQUAL_UINT8(0, WeekDay(20, 8, 2023));
+}
+
+/* Test case: Months outside 1 to 12 have no day of the week */
+void test_WeekDay_InvalidMonth(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(SERIAL_WEEKDAY_INVALID, WeekDay(1, 0, 2023));
+    TEST_ASSERT_EQUAL_UINT8(SERIAL_WEEKDAY_INVALID, WeekDay(1, 13, 2023));
+}
+
+/* Test case: Every valid date from 1901 to 2099 matches the host reference */
+void test_WeekDay_AllDatesMatchReference(void)
+{
+    static const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    char text[64];
+
+    for (uint16_t year = 1901; year <= 2099; year++)
+    {
+        for (uint8_t month = 1; month <= 12; month++)
+        {
+            uint8_t lastDay = daysInMonth[month - 1];
+
+            if ((month == 2) && ((year % 4) == 0))
+            {
+                lastDay = 29; /* 2000 is the only century in range and it is leap */
+            }
+
+            for (uint8_t day = 1; day <= lastDay; day++)
+            {
+                snprintf(text, sizeof(text), "%02u/%02u/%04u", day, month, year);
+                TEST_ASSERT_EQUAL_UINT8_MESSAGE(ReferenceWeekDay(day, month, year), WeekDay(day, month, year), text);
+            }
+        }
+    }
+}
+
+/* Test case: The closed form is faster than the previous year by year loop */
+void test_WeekDay_BenchmarkAgainstLegacy(void)
+{
+    volatile uint8_t sink = 0;
+    clock_t start;
+    clock_t legacyTicks;
+    clock_t newTicks;
+    char text[96];
+
+    start = clock();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        sink += LegacyWeekDay((uint8_t)(1 + (i % 28)), (uint8_t)(1 + (i % 12)), (uint16_t)(1901 + (i % 199)));
+    }
+    legacyTicks = clock() - start;
+
+    start = clock();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        sink += WeekDay((uint8_t)(1 + (i % 28)), (uint8_t)(1 + (i % 12)), (uint16_t)(1901 + (i % 199)));
+    }
+    newTicks = clock() - start;
+
+    snprintf(text, sizeof(text), "%u calls: legacy %ld clock ticks, closed form %ld clock ticks",
+             BENCH_ITERATIONS, (long)legacyTicks, (long)newTicks);
+    TEST_MESSAGE(text);
+
+    TEST_ASSERT_TRUE(newTicks <= legacyTicks);
+    (void)sink;
+}
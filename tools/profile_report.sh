@@ -0,0 +1,106 @@
+#!/bin/sh
+# Compare the debug and release build profiles.
+#
+#     profile_report.sh <debug dir> <release dir> <target> [host commands]
+#
+# Prints, for both profiles side by side: the Berkeley sizes of the firmware
+# images, the output sections of their map files, the flash taken by the hot
+# path functions (0 when LTO inlined them) and the execution time probes of
+# the host builds after a soak of [host commands] commands. Firmware images
+# that were not built, when the cross toolchain is missing, are skipped.
+# The probe times are host nanoseconds, they show how the profiles compare;
+# the target cycles are read from a BENCH=1 image with the CAN dump command.
+
+DEBUG_DIR=$1
+RELEASE_DIR=$2
+TARGET=$3
+COMMANDS=${4:-1000}
+TOOLCHAIN=${TOOLCHAIN:-arm-none-eabi}
+HOT="Serial_Task Clock_Task CAN_Task HAL_FDCAN_RxFifo0Callback WeekDay HEL_LCD_String HEL_LCD_Print CanTp_Task CanRing_Peek Sched_Run"
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+if [ -z "$TARGET" ]; then
+    echo "usage: $0 <debug dir> <release dir> <target> [host commands]" >&2
+    exit 1
+fi
+
+# Print a table of "key debug release" lines with the change in percent
+compare() {
+    awk -v title="$1" 'BEGIN { printf "\n%-28s %12s %12s %8s\n", title, "debug", "release", "change" }
+    {
+        change = ($2 > 0) ? sprintf("%+.1f%%", (100.0 * ($3 - $2)) / $2) : "-"
+        printf "%-28s %12s %12s %8s\n", $1, $2, $3, change
+    }'
+}
+
+# Join two "key value" files on the key, keys missing on one side get 0
+join_files() {
+    awk 'NR == FNR { d[$1] = $2; order[++n] = $1; next }
+         { r[$1] = $2; if (!($1 in d)) order[++n] = $1 }
+         END { for (i = 1; i <= n; i++) { k = order[i]; print k, (k in d) ? d[k] : 0, (k in r) ? r[k] : 0 } }' "$1" "$2"
+}
+
+# Hexadecimal to number, strtonum is not in every awk
+HEX='function hex(s,   v, i) { s = tolower(s); sub(/^0x/, "", s); v = 0
+         for (i = 1; i <= length(s); i++) v = (v * 16) + index("0123456789abcdef", substr(s, i, 1)) - 1
+         return v }'
+
+# Loaded output sections of a map file, in bytes
+map_sections() {
+    awk "$HEX"'
+         /^Linker script and memory map/ { m = 1; next }
+         !m { next }
+         /^\.[A-Za-z_.]+$/ { name = $1; next }
+         /^\.[A-Za-z_.]+ +0x[0-9a-f]+ +0x[0-9a-f]+/ { name = $1; addr = $2; size = $3 }
+         /^ +0x[0-9a-f]+ +0x[0-9a-f]+/ && name != "" { addr = $1; size = $2 }
+         size != "" { if ((hex(addr) != 0) && (hex(size) > 0)) print name, hex(size); name = ""; size = "" }
+         !/^\./ && !/^ +0x/ { name = "" }' "$1"
+}
+
+# Size of the hot path functions, LTO may add a suffix to local ones
+hot_functions() {
+    "$TOOLCHAIN-nm" -S --size-sort "$1" | awk -v hot="$HOT" "$HEX"'
+        BEGIN { n = split(hot, h, " "); for (i = 1; i <= n; i++) size[h[i]] = 0 }
+        { name = $4; sub(/\..*/, "", name); if (name in size) size[name] += hex($2) }
+        END { for (i = 1; i <= n; i++) print h[i], size[h[i]] }'
+}
+
+# Minimum and mean of every probe after a host soak, the maximum is mostly host scheduling noise
+host_probes() {
+    "$1" "$COMMANDS" > "$TMP/run.txt" || echo "warning: $1 reported failures" >&2
+    awk '/^probe / { p = 1; next } /^commands:/ { p = 0 }
+         p { name = substr($0, 1, 12); gsub(/ +$/, "", name); gsub(/ /, "_", name)
+             $0 = substr($0, 13); print name "_min", $2; print name "_mean", $4 }' "$TMP/run.txt"
+}
+
+DEBUG_ELF=$DEBUG_DIR/$TARGET.elf
+RELEASE_ELF=$RELEASE_DIR/$TARGET.elf
+
+if [ -f "$DEBUG_ELF" ] && [ -f "$RELEASE_ELF" ]; then
+    for elf in "$DEBUG_ELF" "$RELEASE_ELF"; do
+        "$TOOLCHAIN-size" --format=berkeley "$elf" | awk 'NR == 2 { print "text", $1; print "data", $2; print "bss", $3; print "flash", $1 + $2 }'
+    done > "$TMP/size.txt"
+    head -n 4 "$TMP/size.txt" > "$TMP/size_debug.txt"
+    tail -n 4 "$TMP/size.txt" > "$TMP/size_release.txt"
+    join_files "$TMP/size_debug.txt" "$TMP/size_release.txt" | compare "image (bytes)"
+
+    map_sections "$DEBUG_DIR/$TARGET.map" > "$TMP/map_debug.txt"
+    map_sections "$RELEASE_DIR/$TARGET.map" > "$TMP/map_release.txt"
+    join_files "$TMP/map_debug.txt" "$TMP/map_release.txt" | compare "map sections (bytes)"
+
+    hot_functions "$DEBUG_ELF" > "$TMP/hot_debug.txt"
+    hot_functions "$RELEASE_ELF" > "$TMP/hot_release.txt"
+    join_files "$TMP/hot_debug.txt" "$TMP/hot_release.txt" | compare "hot functions (bytes)"
+else
+    echo "firmware images not found in $DEBUG_DIR and $RELEASE_DIR, sizes skipped"
+fi
+
+if [ -x "$DEBUG_DIR/host/$TARGET" ] && [ -x "$RELEASE_DIR/host/$TARGET" ]; then
+    host_probes "$DEBUG_DIR/host/$TARGET" > "$TMP/probes_debug.txt"
+    host_probes "$RELEASE_DIR/host/$TARGET" > "$TMP/probes_release.txt"
+    join_files "$TMP/probes_debug.txt" "$TMP/probes_release.txt" | compare "host probes (ns)"
+else
+    echo "host builds not found in $DEBUG_DIR/host and $RELEASE_DIR/host, probes skipped"
+fi